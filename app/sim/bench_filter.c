@@ -0,0 +1,350 @@
+/*
+ * Replay harness of the position filter (app/src/gps_filter.c).
+ *
+ * Generates tracks with a known true path, turns them into the NMEA a GOKE receiver
+ * sends (GGA, GSA, RMC, VTG) with its error model applied, and feeds them through
+ * GPS_Update() -> gps_Process() twice: with gps_filter disabled and enabled. The
+ * reported positions are scored against the truth:
+ *
+ *   err rms/p95/max   horizontal error of the reported position, m
+ *   path              length of the reported track relative to the true one; noise
+ *                     inflates it (for the parked track: metres travelled while still)
+ *   rejected          fixes the filter replaced by its prediction
+ *   ns/fix            CPU cost of GpsFilter_Update() alone
+ *
+ * Scenarios:
+ *
+ *   parked    standing still, slowly wandering error (the receiver's correlated drift)
+ *   walk      1.4 m/s, meandering
+ *   urban     10 m/s, a 90 degree turn every 20 s, high HDOP and multipath jumps of
+ *             40-150 m lasting a few seconds
+ *   highway   30 m/s, gentle curve, good geometry
+ *
+ * Recorded traces (gps_logging output) are replayed with --trace; without a truth only
+ * the path lengths and the distance between the raw and the filtered track are shown.
+ *
+ *   build/filter_bench [--trace FILE]... [--accel X]... [--uere X] [--epochs N] [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "sim_host.h"
+#include "host_bench.h"
+
+#define MAX_TRACES      16
+#define MAX_ACCELS      8
+#define METRES_PER_DEG  111320.0
+#define KNOTS           1.943844
+
+typedef struct {
+    double latitude, longitude;
+} point_t;
+
+typedef struct {
+    bench_nmea_t nmea;
+    point_t*     truth;       // per epoch, NULL for recorded traces
+    double       truthPath;   // m
+    sim_fix_t*   fixes;       // the receiver's fixes, for the CPU cost
+    int          fixCount;
+} trace_t;
+
+typedef struct {
+    int      fixes;
+    double   rms, p95, max;
+    double   path;          // m
+    double   offset;        // mean distance to the raw track, m
+    uint32_t rejected;
+    double   nsPerFix;
+} score_t;
+
+static double Distance(const point_t* a, const point_t* b)
+{
+    double dn = (b->latitude - a->latitude) * METRES_PER_DEG;
+    double de = (b->longitude - a->longitude) * METRES_PER_DEG * cos(a->latitude * M_PI / 180);
+    return sqrt(dn * dn + de * de);
+}
+
+static void Move(point_t* p, double east, double north)
+{
+    p->latitude  += north / METRES_PER_DEG;
+    p->longitude += east / (METRES_PER_DEG * cos(p->latitude * M_PI / 180));
+}
+
+// ---------------------------------------------------------------------------
+// traces
+// ---------------------------------------------------------------------------
+
+typedef enum { SCENARIO_PARKED, SCENARIO_WALK, SCENARIO_URBAN, SCENARIO_HIGHWAY } scenario_t;
+
+static void Generate(trace_t* t, scenario_t scenario, int epochs, float uere)
+{
+    static const char* const names[] = { "parked", "walk", "urban", "highway" };
+    memset(t, 0, sizeof(*t));
+    t->nmea.name = strdup(names[scenario]);
+    t->truth = calloc(epochs, sizeof(point_t));
+    t->fixes = calloc(epochs, sizeof(sim_fix_t));
+    g_benchSeed = 4242 + scenario;
+
+    point_t truth = { 52.2297, 21.0122 };
+    double heading = 40.0, speed = 0.0;
+    // receiver error: a first order Gauss-Markov drift (tau 30 s) plus white noise, per axis
+    const double drift = exp(-1.0 / 30.0);
+    double driftE = 0.0, driftN = 0.0;
+    double jumpE = 0.0, jumpN = 0.0;
+    int jumpFor = 0;
+
+    for (int e = 0; e < epochs; ++e) {
+        double hdop = 1.2;
+        switch (scenario) {
+            case SCENARIO_PARKED:
+                hdop = 1.0 + 0.6 * bench_random_unit();
+                break;
+            case SCENARIO_WALK:
+                speed = 1.4;
+                heading += 5.0 * bench_gauss();
+                break;
+            case SCENARIO_URBAN:
+                speed = 10.0;
+                hdop = 2.0 + 2.0 * bench_random_unit();
+                // the turn takes 3 s
+                if (e % 20 >= 17) heading += 30.0;
+                if (jumpFor == 0 && bench_random_unit() < 0.03) {
+                    double size = 40.0 + 110.0 * bench_random_unit(), dir = 2.0 * M_PI * bench_random_unit();
+                    jumpE = size * sin(dir);
+                    jumpN = size * cos(dir);
+                    jumpFor = 2 + bench_random() % 5;
+                }
+                break;
+            case SCENARIO_HIGHWAY:
+                speed = 30.0;
+                hdop = 0.9;
+                heading += 0.3;
+                break;
+        }
+        heading = fmod(heading + 360.0, 360.0);
+        double ve = speed * sin(heading * M_PI / 180), vn = speed * cos(heading * M_PI / 180);
+        if (e > 0) Move(&truth, ve, vn);
+        if (e > 0) t->truthPath += speed;
+        t->truth[e] = truth;
+
+        double sigma = hdop * uere / 2.0;
+        driftE = drift * driftE + sqrt(1.0 - drift * drift) * sigma * bench_gauss();
+        driftN = drift * driftN + sqrt(1.0 - drift * drift) * sigma * bench_gauss();
+        point_t fix = truth;
+        Move(&fix, driftE + 0.3 * sigma * bench_gauss(), driftN + 0.3 * sigma * bench_gauss());
+        if (jumpFor) {
+            Move(&fix, jumpE, jumpN);
+            jumpFor--;
+        }
+        // Doppler velocity
+        double me = ve + 0.1 * hdop * bench_gauss(), mn = vn + 0.1 * hdop * bench_gauss();
+        double knots = sqrt(me * me + mn * mn) * KNOTS;
+        double course = fmod(atan2(me, mn) * 180 / M_PI + 360.0, 360.0);
+
+        int second = 8 * 3600 + e;
+        char tm[16], date[] = "140618", la[32], lo[32], ns, ew;
+        snprintf(tm, sizeof(tm), "%02d%02d%02d.000", second / 3600 % 24, second / 60 % 60, second % 60);
+        bench_coord(fix.latitude, 2, la, sizeof(la), &ns, 'N', 'S');
+        bench_coord(fix.longitude, 3, lo, sizeof(lo), &ew, 'E', 'W');
+        bench_sentence(&t->nmea, "GNGGA,%s,%s,%c,%s,%c,1,09,%.2f,112.0,M,34.5,M,,", tm, la, ns, lo, ew, hdop);
+        bench_sentence(&t->nmea, "GPGSA,A,3,01,04,07,10,13,16,19,22,25,,,,%.2f,%.2f,%.2f", hdop * 1.4, hdop, hdop * 1.1);
+        bench_sentence(&t->nmea, "GNRMC,%s,A,%s,%c,%s,%c,%.3f,%.2f,%s,,,A", tm, la, ns, lo, ew, knots, course, date);
+        bench_sentence(&t->nmea, "GNVTG,%.2f,T,,M,%.3f,N,%.3f,K,A", course, knots, knots * 1.852);
+
+        sim_fix_t* f = &t->fixes[t->fixCount++];
+        f->time = second;
+        f->latitude = fix.latitude;
+        f->longitude = fix.longitude;
+        f->speed = knots;
+        f->bearing = course;
+        f->accuracy = hdop * uere;
+        t->nmea.epochs++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// measurement
+// ---------------------------------------------------------------------------
+
+static int CompareDouble(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Feeds the trace epoch by epoch (up to the end of every VTG sentence) and records the
+ * reported position after each one; positions[] gets NAN for epochs without a fix.
+ */
+static void Replay(const trace_t* t, int filter, float accel, float uere, point_t* positions)
+{
+    sim_bench_filter_config(filter, accel, uere);
+    sim_bench_gps_init();
+    const char* p = t->nmea.data;
+    const char* end = t->nmea.data + t->nmea.size;
+    for (int e = 0; e < t->nmea.epochs && p < end; ++e) {
+        const char* vtg = strstr(p, "VTG,");
+        const char* eol = vtg ? strchr(vtg, '\n') : NULL;
+        const char* next = eol ? eol + 1 : end;
+        sim_bench_gps_feed((const uint8_t*)p, (uint32_t)(next - p));
+        p = next;
+        if (sim_bench_gps_valid()) {
+            sim_bench_gps_position(&positions[e].latitude, &positions[e].longitude);
+        } else {
+            positions[e].latitude = positions[e].longitude = NAN;
+        }
+    }
+}
+
+static void Score(const trace_t* t, const point_t* positions, const point_t* reference, score_t* s)
+{
+    double* errors = malloc(t->nmea.epochs * sizeof(double));
+    const point_t* last = NULL;
+    double sum = 0.0, offset = 0.0;
+    memset(s, 0, sizeof(*s));
+    for (int e = 0; e < t->nmea.epochs; ++e) {
+        const point_t* p = &positions[e];
+        if (isnan(p->latitude)) continue;
+        if (last) s->path += Distance(last, p);
+        last = p;
+        if (reference && !isnan(reference[e].latitude)) offset += Distance(&reference[e], p);
+        if (t->truth) {
+            double d = Distance(&t->truth[e], p);
+            errors[s->fixes] = d;
+            sum += d * d;
+        }
+        s->fixes++;
+    }
+    if (t->truth && s->fixes) {
+        qsort(errors, s->fixes, sizeof(double), CompareDouble);
+        s->rms = sqrt(sum / s->fixes);
+        s->p95 = errors[s->fixes * 95 / 100];
+        s->max = errors[s->fixes - 1];
+    }
+    if (s->fixes) s->offset = offset / s->fixes;
+    free(errors);
+}
+
+// CPU cost and rejects of GpsFilter_Update() on the receiver's fixes
+static void Cost(const trace_t* t, float accel, int iterations, score_t* s)
+{
+    if (!t->fixCount) return;
+    sim_fix_t* work = malloc(t->fixCount * sizeof(sim_fix_t));
+    uint64_t ns = 0;
+    for (int i = 0; i < iterations; ++i) {
+        memcpy(work, t->fixes, t->fixCount * sizeof(sim_fix_t));
+        uint64_t t0 = bench_now_ns();
+        s->rejected = sim_bench_filter_run(work, t->fixCount, accel);
+        ns += bench_now_ns() - t0;
+    }
+    s->nsPerFix = (double)ns / ((double)iterations * t->fixCount);
+    free(work);
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void PrintScore(const trace_t* t, const char* mode, const score_t* s, int csv)
+{
+    double path = t->truth && t->truthPath > 0 ? s->path / t->truthPath : s->path;
+    if (csv) {
+        printf("%s,%s,%d,%.2f,%.2f,%.2f,%.3f,%.2f,%u,%.0f\n", t->nmea.name, mode, s->fixes,
+               s->rms, s->p95, s->max, path, s->offset, s->rejected, s->nsPerFix);
+    } else if (t->truth) {
+        printf("%-10s %-10s %6d %8.2f %8.2f %8.2f %9.3f%c %8u %8.0f\n", t->nmea.name, mode, s->fixes,
+               s->rms, s->p95, s->max, path, t->truthPath > 0 ? 'x' : 'm', s->rejected, s->nsPerFix);
+    } else {
+        printf("%-10s %-10s %6d %8s %8s %8s %9.0fm %8s %8s  (%.2f m from raw)\n", t->nmea.name, mode, s->fixes,
+               "-", "-", "-", path, "-", "-", s->offset);
+    }
+}
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --trace FILE       replay a recorded NMEA trace (repeatable), default: generated scenarios\n"
+        "  --epochs N         epochs per generated scenario (default 600)\n"
+        "  --accel X          gps_filter_accel, m/s^2 (repeatable, default 1.5)\n"
+        "  --uere X           gps_uere (default 5)\n"
+        "  --iterations N     passes for the CPU cost (default 200)\n"
+        "  --csv              machine readable output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    static const struct option options[] = {
+        { "trace",      required_argument, NULL, 't' },
+        { "epochs",     required_argument, NULL, 'e' },
+        { "accel",      required_argument, NULL, 'a' },
+        { "uere",       required_argument, NULL, 'u' },
+        { "iterations", required_argument, NULL, 'i' },
+        { "csv",        no_argument,       NULL, 'C' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    trace_t traces[MAX_TRACES];
+    memset(traces, 0, sizeof(traces));
+    float accels[MAX_ACCELS];
+    const char* paths[MAX_TRACES];
+    int traceCount = 0, pathCount = 0, accelCount = 0, epochs = 600, iterations = 200, csv = 0;
+    float uere = 5.0f;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 't': if (pathCount < MAX_TRACES) paths[pathCount++] = optarg; break;
+            case 'e': epochs = atoi(optarg); break;
+            case 'a': if (accelCount < MAX_ACCELS) accels[accelCount++] = atof(optarg); break;
+            case 'u': uere = atof(optarg); break;
+            case 'i': iterations = atoi(optarg); break;
+            case 'C': csv = 1; break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (epochs < 2) epochs = 2;
+    if (iterations < 1) iterations = 1;
+    if (accelCount == 0) accels[accelCount++] = 1.5f;
+    for (int i = 0; i < pathCount; ++i)
+        if (bench_load_trace(&traces[traceCount++].nmea, paths[i], 0) != 0) return 1;
+    if (traceCount == 0) {
+        for (int s = SCENARIO_PARKED; s <= SCENARIO_HIGHWAY; ++s)
+            Generate(&traces[traceCount++], (scenario_t)s, epochs, uere);
+    }
+
+    sim_sdk_init();
+
+    if (csv) {
+        printf("trace,mode,fixes,err_rms,err_p95,err_max,path,offset,rejected,ns_per_fix\n");
+    } else {
+        printf("%-10s %-10s %6s %8s %8s %8s %10s %8s %8s\n", "trace", "mode", "fixes",
+               "err rms", "err p95", "err max", "path", "rejected", "ns/fix");
+    }
+    for (int i = 0; i < traceCount; ++i) {
+        const trace_t* t = &traces[i];
+        point_t* raw = malloc(t->nmea.epochs * sizeof(point_t));
+        point_t* filtered = malloc(t->nmea.epochs * sizeof(point_t));
+        score_t s;
+
+        Replay(t, 0, accels[0], uere, raw);
+        Score(t, raw, NULL, &s);
+        PrintScore(t, "raw", &s, csv);
+        for (int a = 0; a < accelCount; ++a) {
+            char mode[16];
+            snprintf(mode, sizeof(mode), "kf %.2g", accels[a]);
+            Replay(t, 1, accels[a], uere, filtered);
+            Score(t, filtered, raw, &s);
+            Cost(t, accels[a], iterations, &s);
+            PrintScore(t, mode, &s, csv);
+        }
+        free(raw);
+        free(filtered);
+    }
+    return 0;
+}
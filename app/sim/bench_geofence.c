@@ -0,0 +1,265 @@
+/*
+ * Benchmark of the geofence engine (app/src/geofence.c).
+ *
+ * Scatters circles and polygons over a 40 x 40 km area, drives a generated track
+ * through it and checks every fix with GeofenceSet_Check(), once with the grid index
+ * and once testing every fence:
+ *
+ *   grid          cells of the index and fence entries in them
+ *   tested/fix    fences tested per fix, the exact shape only when the bounding box holds
+ *   ns/fix        CPU cost of GeofenceSet_Check()
+ *   enter/exit    events of the track; both runs must agree
+ *
+ * Before that, circles from 50 m to the 100 km limit are checked alone: a track crossing
+ * each must enter and exit it once, and radii past the limit must be
+ * refused.
+ *
+ *   build/geofence_bench [--fences N]... [--fixes N] [--margin M] [--seed N] [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "sim_host.h"
+#include "host_bench.h"
+
+#define MAX_SIZES       8
+#define METRES_PER_DEG  111320.0
+#define ORIGIN_LAT      52.05
+#define ORIGIN_LON      20.75
+#define AREA            40000.0     // m
+#define POLYGON_SHARE   0.3
+#define MAX_VERTICES    24
+#define SPEED           14.0        // m/s
+
+typedef struct {
+    uint32_t width, height, items;
+    uint32_t tested, enters, exits;
+    double   nsPerFix;
+} result_t;
+
+static double MetresPerDegLon(void)
+{
+    return METRES_PER_DEG * cos((ORIGIN_LAT + AREA / 2 / METRES_PER_DEG) * M_PI / 180.0);
+}
+
+// ---------------------------------------------------------------------------
+// fences and track
+// ---------------------------------------------------------------------------
+
+// adds count random fences, in lines short enough for the remote command
+static int AddFences(int count)
+{
+    double lonScale = MetresPerDegLon();
+    uint32_t vertices = 0;
+    for (int i = 0; i < count; ++i) {
+        double x = bench_random_unit() * AREA, y = bench_random_unit() * AREA;
+        double lat = ORIGIN_LAT + y / METRES_PER_DEG, lon = ORIGIN_LON + x / lonScale;
+        char line[1024];
+        if (bench_random_unit() >= POLYGON_SHARE) {
+            snprintf(line, sizeof(line), "c%d circle %.6f,%.6f %d", i, lat, lon, 50 + (int)(bench_random_unit() * 450));
+            vertices++;
+        } else {
+            // star shaped: a random radius at every angle, concave as often as not
+            int n = 5 + (int)(bench_random_unit() * (MAX_VERTICES - 5));
+            double size = 100 + bench_random_unit() * 700;
+            int length = snprintf(line, sizeof(line), "p%d poly", i);
+            for (int k = 0; k < n; ++k) {
+                double a = 2.0 * M_PI * (k + bench_random_unit() * 0.5) / n;
+                double r = size * (0.4 + 0.6 * bench_random_unit());
+                length += snprintf(line + length, sizeof(line) - length, " %.6f,%.6f",
+                                   lat + r * sin(a) / METRES_PER_DEG, lon + r * cos(a) / lonScale);
+            }
+            vertices += n;
+        }
+        if (sim_bench_geofence_add(line) != 0) {
+            fprintf(stderr, "fence rejected: %s\n", line);
+            return -1;
+        }
+    }
+    return (int)vertices;
+}
+
+// a drive at SPEED over the area, turning now and then, one fix a second
+static void Track(int32_t* latitudes, int32_t* longitudes, int count)
+{
+    double lonScale = MetresPerDegLon();
+    double x = AREA / 2, y = AREA / 2, heading = bench_random_unit() * 2.0 * M_PI;
+    for (int i = 0; i < count; ++i) {
+        if (bench_random_unit() < 0.02) heading += (bench_random_unit() - 0.5) * M_PI;
+        x += SPEED * cos(heading);
+        y += SPEED * sin(heading);
+        // turn back at the edges
+        if (x < 0 || x > AREA) { heading = M_PI - heading; x = x < 0 ? 0 : AREA; }
+        if (y < 0 || y > AREA) { heading = -heading; y = y < 0 ? 0 : AREA; }
+        latitudes[i]  = (int32_t)lround((ORIGIN_LAT + y / METRES_PER_DEG) * 1e6);
+        longitudes[i] = (int32_t)lround((ORIGIN_LON + x / lonScale) * 1e6);
+    }
+}
+
+/**
+ * One circle at the origin, fixes at 1.1, 0.9 and again 1.1 times its radius to the north.
+ * @return 0 if it was entered and left once, or refused when expected
+ */
+static int CheckRadius(const char* radius, double metres, int valid)
+{
+    char line[128];
+    snprintf(line, sizeof(line), "r circle %.6f,%.6f %s", ORIGIN_LAT, ORIGIN_LON, radius);
+    sim_bench_geofence_setup(1, 1, 3, 16);
+    int added = sim_bench_geofence_add(line) == 0;
+    if (added != valid) {
+        fprintf(stderr, "radius %s m %s\n", radius, added ? "accepted past the limit" : "refused");
+        return -1;
+    }
+    if (!added) return 0;
+
+    enum { FIXES = 10 };
+    int32_t latitudes[3 * FIXES], longitudes[3 * FIXES];
+    for (int i = 0; i < 3 * FIXES; ++i) {
+        double r = metres * (i >= FIXES && i < 2 * FIXES ? 0.9 : 1.1);
+        latitudes[i]  = (int32_t)lround((ORIGIN_LAT + r / METRES_PER_DEG) * 1e6);
+        longitudes[i] = (int32_t)lround(ORIGIN_LON * 1e6);
+    }
+    uint32_t w, h, items, enters, exits;
+    sim_bench_geofence_index(1, &w, &h, &items);
+    sim_bench_geofence_run(latitudes, longitudes, 3 * FIXES, 0.0f, &enters, &exits);
+    if (enters != 1 || exits != 1) {
+        fprintf(stderr, "radius %s m: %u enter, %u exit events instead of 1 and 1\n", radius, enters, exits);
+        return -1;
+    }
+    return 0;
+}
+
+static int CheckRadii(void)
+{
+    static const struct { const char* text; double metres; int valid; } radii[] = {
+        { "50", 50, 1 }, { "2147", 2147, 1 }, { "2148", 2148, 1 }, { "5000", 5000, 1 },
+        { "12500.5", 12500.5, 1 }, { "100000", 100000, 1 },
+        { "0", 0, 0 }, { "100000.5", 0, 0 }, { "100001", 0, 0 }, { "4294968", 0, 0 },
+    };
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(radii) / sizeof(radii[0]); ++i)
+        if (CheckRadius(radii[i].text, radii[i].metres, radii[i].valid) != 0) failed = 1;
+    return failed;
+}
+
+static void Run(int grid, const int32_t* latitudes, const int32_t* longitudes, int count, float margin,
+                int iterations, result_t* r)
+{
+    memset(r, 0, sizeof(*r));
+    sim_bench_geofence_index(grid, &r->width, &r->height, &r->items);
+    uint64_t ns = 0;
+    for (int i = 0; i < iterations; ++i) {
+        uint64_t t0 = bench_now_ns();
+        r->tested = sim_bench_geofence_run(latitudes, longitudes, count, margin, &r->enters, &r->exits);
+        ns += bench_now_ns() - t0;
+    }
+    r->nsPerFix = (double)ns / ((double)iterations * count);
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --fences N         fences in the area (repeatable, default 16, 256, 1000, 4000)\n"
+        "  --fixes N          fixes of the track (default 3600)\n"
+        "  --margin M         geofence_margin in metres (default 25)\n"
+        "  --iterations N     passes over the track (default 3)\n"
+        "  --seed N           random seed (default 1)\n"
+        "  --csv              machine readable output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    static const struct option options[] = {
+        { "fences",     required_argument, NULL, 'f' },
+        { "fixes",      required_argument, NULL, 'x' },
+        { "margin",     required_argument, NULL, 'm' },
+        { "iterations", required_argument, NULL, 'i' },
+        { "seed",       required_argument, NULL, 's' },
+        { "csv",        no_argument,       NULL, 'C' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int sizes[MAX_SIZES];
+    int sizeCount = 0, fixes = 3600, iterations = 3, csv = 0;
+    float margin = 25.0f;
+    uint32_t seed = 1;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'f': if (sizeCount < MAX_SIZES) sizes[sizeCount++] = atoi(optarg); break;
+            case 'x': fixes = atoi(optarg); break;
+            case 'm': margin = atof(optarg); break;
+            case 'i': iterations = atoi(optarg); break;
+            case 's': seed = strtoul(optarg, NULL, 0); break;
+            case 'C': csv = 1; break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (fixes < 1) fixes = 1;
+    if (iterations < 1) iterations = 1;
+    if (sizeCount == 0) {
+        static const int defaults[] = { 16, 256, 1000, 4000 };
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); ++i)
+            sizes[sizeCount++] = defaults[i];
+    }
+
+    sim_sdk_init();
+
+    int failed = CheckRadii();
+    if (!csv) printf("circle radii 50 m to 100 km: %s\n\n", failed ? "FAILED" : "ok");
+
+    int32_t* latitudes  = malloc(fixes * sizeof(int32_t));
+    int32_t* longitudes = malloc(fixes * sizeof(int32_t));
+    if (csv) {
+        printf("fences,vertices,index,cells,items,tested_per_fix,ns_per_fix,enters,exits\n");
+    } else {
+        printf("%6s %8s %-6s %9s %6s %10s %8s %6s %5s\n", "fences", "vertices", "index", "cells",
+               "items", "tested/fix", "ns/fix", "enter", "exit");
+    }
+    for (int s = 0; s < sizeCount; ++s) {
+        int count = sizes[s];
+        if (count < 1 || count > 65535) continue;
+        g_benchSeed = seed;
+        uint32_t maxPoints = count * (POLYGON_SHARE * MAX_VERTICES + 2);
+        if (maxPoints > 65535) maxPoints = 65535;
+        if (sim_bench_geofence_setup(count, maxPoints, 2 * count + 1, 16 * count) != 0) {
+            fprintf(stderr, "no memory for %d fences\n", count);
+            return 1;
+        }
+        int vertices = AddFences(count);
+        if (vertices < 0) return 1;
+        Track(latitudes, longitudes, fixes);
+
+        result_t results[2];
+        for (int grid = 1; grid >= 0; --grid) {
+            result_t* r = &results[grid];
+            Run(grid, latitudes, longitudes, fixes, margin, iterations, r);
+            char cells[24];
+            snprintf(cells, sizeof(cells), "%ux%u", r->width, r->height);
+            if (csv)
+                printf("%d,%d,%s,%s,%u,%.2f,%.1f,%u,%u\n", count, vertices, grid ? "grid" : "none",
+                       grid ? cells : "", r->items, (double)r->tested / fixes, r->nsPerFix, r->enters, r->exits);
+            else
+                printf("%6d %8d %-6s %9s %6u %10.2f %8.1f %6u %5u\n", count, vertices, grid ? "grid" : "none",
+                       grid ? cells : "-", r->items, (double)r->tested / fixes, r->nsPerFix, r->enters, r->exits);
+        }
+        if (results[0].enters != results[1].enters || results[0].exits != results[1].exits) {
+            fprintf(stderr, "%d fences: the grid and the full scan disagree\n", count);
+            failed = 1;
+        }
+    }
+    free(latitudes);
+    free(longitudes);
+    return failed;
+}
@@ -0,0 +1,408 @@
+/*
+ * Tower flapping simulation of the GPRS reconnect policy (app/src/link_manager.c).
+ *
+ * Generates a day of coverage per scenario, second by second: whether the cell carries
+ * data and the signal quality. The same day is lived twice by a device model that
+ * reconnects, attaches and activates in CONNECT_TIME seconds, and reports every
+ * report_interval seconds while the link is up, with urgent alerts (geofence, trip)
+ * every half hour or so:
+ *
+ *   immediate   the former policy: a reconnect at once on every loss of the link and on
+ *               every network monitor round (15 s) while it is down, every report sent
+ *   backoff     the link manager: reconnects through LinkManager_MayConnect() with the
+ *               reconnect timer, routine reports held back by LinkManager_Defer()
+ *
+ * A reconnect is wasted when it fails or when its link drops before it carries a report.
+ * Scenarios:
+ *
+ *   stable      good coverage, three short losses
+ *   flapping    the edge of a cell: hours of links up for 5-60 s and down for 5-40 s,
+ *               between stable hours
+ *   outage      20 minutes without coverage every 3 hours
+ *   weak        good coverage but the signal at CSQ 4 for hours, most uploads fail
+ *
+ * The exit status is 1 when the backoff does not save half of the wasted reconnects while
+ * flapping, loses more than 5 % of the reports of the stable and outage days, comes back
+ * later than LINK_BACKOFF_MAX after the coverage, misses an urgent alert or does not save
+ * half of the failed uploads of the weak day.
+ *
+ *   build/link_bench [--interval S] [--seed N] [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <getopt.h>
+
+#include "sim_host.h"
+#include "host_bench.h"
+
+#define DAY             86400
+#define START           1000        // uptime of the first second
+#define CONNECT_TIME    4           // s, attach and activation
+#define MONITOR_PERIOD  15          // s, NETWORK_MONITOR_INTERVAL_MS
+#define ALERT_PERIOD    1800        // s, mean
+#define RETURN_OUTAGE   60          // s without coverage before its return is timed
+
+typedef enum { SCENARIO_STABLE, SCENARIO_FLAPPING, SCENARIO_OUTAGE, SCENARIO_WEAK, SCENARIO_MAX } scenario_t;
+
+static const char* const g_scenarioNames[SCENARIO_MAX] = { "stable", "flapping", "outage", "weak" };
+
+typedef struct {
+    uint8_t* data;              // per second: the cell carries data
+    int8_t*  signal;            // per second: %
+    uint8_t* alert;             // per second: an urgent alert is raised
+} day_t;
+
+typedef enum { LINK_DOWN, LINK_CONNECTING, LINK_UP } link_state_t;
+
+typedef struct {
+    // results
+    uint32_t attempts;          // reconnects started
+    uint32_t failed;            // of them failed
+    uint32_t wasted;            // failed, or dropped before a report
+    uint32_t upSeconds;
+    uint32_t reports;           // delivered
+    uint32_t uploads;           // tried
+    uint32_t uploadFailures;
+    uint32_t deferred;
+    uint32_t alerts;            // raised
+    uint32_t alertsSent;
+    uint32_t alertDelayMax;     // s
+    double   alertDelaySum;
+    uint32_t returns;           // coverage returns after RETURN_OUTAGE
+    uint32_t returnDelayMax;    // s to the link after one
+    double   returnDelaySum;
+} result_t;
+
+static int      g_errors = 0;
+static uint32_t g_backoffMax, g_stableTime, g_deferMax;
+
+static uint32_t Uniform(uint32_t low, uint32_t high)
+{
+    return low + bench_random() % (high - low + 1);
+}
+
+static void Error(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "FAIL: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    g_errors++;
+}
+
+// ---------------------------------------------------------------------------
+// coverage
+// ---------------------------------------------------------------------------
+
+static void Fill(day_t* day, uint32_t from, uint32_t to, int data, int signal)
+{
+    for (uint32_t t = from; t < to && t < DAY; ++t) {
+        day->data[t]   = data;
+        day->signal[t] = signal;
+    }
+}
+
+static void Generate(day_t* day, scenario_t scenario)
+{
+    Fill(day, 0, DAY, 1, 70);
+    switch (scenario) {
+        case SCENARIO_STABLE:
+            for (int i = 0; i < 3; ++i) {
+                uint32_t at = Uniform(3600, DAY - 3600);
+                Fill(day, at, at + Uniform(10, 60), 0, 0);
+            }
+            break;
+        case SCENARIO_FLAPPING:
+            // 4 flapping hours, 2 stable ones
+            for (uint32_t hour = 1; hour < 24; hour += 6) {
+                uint32_t t = hour * 3600, end = (hour + 4) * 3600;
+                while (t < end) {
+                    uint32_t up = Uniform(5, 60), down = Uniform(5, 40);
+                    Fill(day, t, t + up, 1, 20 + bench_random() % 20);
+                    Fill(day, t + up, t + up + down, 0, 0);
+                    t += up + down;
+                }
+            }
+            break;
+        case SCENARIO_OUTAGE:
+            for (uint32_t t = 2 * 3600; t < DAY; t += 3 * 3600)
+                Fill(day, t, t + 20 * 60, 0, 0);
+            break;
+        case SCENARIO_WEAK:
+            for (uint32_t t = 3 * 3600; t < DAY; t += 8 * 3600)
+                Fill(day, t, t + 4 * 3600, 1, 13);    // CSQ 4
+            break;
+        default:
+            break;
+    }
+    memset(day->alert, 0, DAY);
+    for (uint32_t t = Uniform(60, ALERT_PERIOD); t < DAY; t += Uniform(ALERT_PERIOD / 2, ALERT_PERIOD * 3 / 2))
+        day->alert[t] = 1;
+}
+
+// an upload over the link at this signal gets through
+static int Delivered(int signal)
+{
+    double p = signal >= 30 ? 0.98 : signal >= 15 ? 0.7 : 0.3;
+    return bench_random_unit() < p;
+}
+
+// ---------------------------------------------------------------------------
+// device
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int          backoff;       // the policy
+    link_state_t state;
+    uint32_t     connectEnd;
+    int          connectOk;     // the cell carried data all along
+    uint32_t     retryAt;       // the reconnect timer, 0: not running
+    uint32_t     linkReports;   // delivered over the current link
+    uint32_t     nextWake;      // of the tracker
+    uint32_t     lastReport;    // uptime of the last report tried, 0: none
+    uint32_t     alertTime;     // uptime of the oldest alert not delivered, 0: none
+    uint32_t     returnTime;    // uptime the coverage came back, 0: none pending
+} device_t;
+
+static void Connect(device_t* d, const day_t* day, uint32_t t, result_t* r)
+{
+    d->state      = LINK_CONNECTING;
+    d->connectEnd = t + CONNECT_TIME;
+    d->connectOk  = day->data[t - START];
+    r->attempts++;
+}
+
+// NetworkReconnect(): at once, or when the backoff allows
+static void Reconnect(device_t* d, const day_t* day, uint32_t t, result_t* r)
+{
+    if (d->state != LINK_DOWN) return;
+    if (!d->backoff) {
+        Connect(d, day, t, r);
+        return;
+    }
+    uint32_t wait;
+    if (sim_bench_link_may_connect(t, &wait))
+        Connect(d, day, t, r);
+    else if (d->retryAt == 0)
+        d->retryAt = t + wait;
+}
+
+static void Live(const day_t* day, int backoff, uint32_t interval, result_t* r)
+{
+    device_t d;
+    memset(&d, 0, sizeof(d));
+    memset(r, 0, sizeof(*r));
+    d.backoff  = backoff;
+    d.nextWake = START;
+    sim_bench_link_init(g_benchSeed);
+    uint32_t downSince = 0;
+
+    // boot: the network registers and the first reconnect starts
+    Reconnect(&d, day, START, r);
+    for (uint32_t t = START; t < START + DAY; ++t) {
+        int data   = day->data[t - START];
+        int signal = day->signal[t - START];
+        if (t % 10 == 0)
+            sim_bench_link_signal(data ? signal : 0);
+
+        // coverage returns
+        if (!data && downSince == 0) downSince = t;
+        if (data && downSince != 0) {
+            if (t - downSince >= RETURN_OUTAGE && d.state != LINK_UP) d.returnTime = t;
+            downSince = 0;
+        }
+
+        if (day->alert[t - START] && d.alertTime == 0) {
+            d.alertTime = t;
+            r->alerts++;
+            d.nextWake = t;
+        }
+
+        // the network events
+        if (d.state == LINK_UP && !data) {
+            d.state = LINK_DOWN;
+            if (d.linkReports == 0) r->wasted++;
+            sim_bench_link_down(t);
+            Reconnect(&d, day, t, r);
+        } else if (d.state == LINK_CONNECTING) {
+            if (!data) d.connectOk = 0;
+            if (t >= d.connectEnd) {
+                if (d.connectOk) {
+                    d.state       = LINK_UP;
+                    d.linkReports = 0;
+                    d.nextWake    = t;      // a report as soon as the link is back
+                    sim_bench_link_up(t);
+                    if (d.returnTime) {
+                        uint32_t delay = t - d.returnTime;
+                        r->returns++;
+                        r->returnDelaySum += delay;
+                        if (delay > r->returnDelayMax) r->returnDelayMax = delay;
+                        d.returnTime = 0;
+                    }
+                } else {
+                    // an activation failure waits for the monitor
+                    d.state = LINK_DOWN;
+                    r->failed++;
+                    r->wasted++;
+                }
+            }
+        }
+        // the tracker finds an alert and no link
+        if (backoff && d.alertTime != 0 && d.state == LINK_DOWN)
+            sim_bench_link_urgent();
+        // the reconnect timer and the network monitor
+        if (d.retryAt != 0 && t >= d.retryAt) {
+            d.retryAt = 0;
+            Reconnect(&d, day, t, r);
+        }
+        if (t % MONITOR_PERIOD == 0)
+            Reconnect(&d, day, t, r);
+
+        if (d.state == LINK_UP) r->upSeconds++;
+
+        // the tracker
+        if (t < d.nextWake) continue;
+        d.nextWake = t + interval;
+        if (d.state != LINK_UP) continue;
+        int urgent = d.alertTime != 0;
+        if (!urgent && d.lastReport != 0 && t - d.lastReport < interval) continue;
+        if (backoff && !urgent && d.lastReport != 0 && sim_bench_link_defer(t - d.lastReport)) {
+            r->deferred++;
+            continue;
+        }
+        d.lastReport = t;
+        r->uploads++;
+        int ok = Delivered(signal);
+        sim_bench_link_upload(ok);
+        if (!ok) {
+            r->uploadFailures++;
+            continue;
+        }
+        r->reports++;
+        d.linkReports++;
+        if (urgent) {
+            uint32_t delay = t - d.alertTime;
+            r->alertsSent++;
+            r->alertDelaySum += delay;
+            if (delay > r->alertDelayMax) r->alertDelayMax = delay;
+            d.alertTime = 0;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void Print(scenario_t scenario, const char* policy, const result_t* r, int csv)
+{
+    double alertMean  = r->alertsSent ? r->alertDelaySum / r->alertsSent : 0;
+    double returnMean = r->returns ? r->returnDelaySum / r->returns : 0;
+    if (csv) {
+        printf("%s,%s,%u,%u,%u,%.1f,%u,%u,%u,%u,%u/%u,%.1f,%u,%.1f,%u\n", g_scenarioNames[scenario], policy,
+               r->attempts, r->failed, r->wasted, 100.0 * r->upSeconds / DAY, r->reports, r->uploads,
+               r->uploadFailures, r->deferred, r->alertsSent, r->alerts, alertMean, r->alertDelayMax,
+               returnMean, r->returnDelayMax);
+    } else {
+        printf("%-9s %-9s %8u %6u %6u %5.1f%% %7u %7u %6u %8u %3u/%-3u %5.1f/%-4u %6.1f/%-4u\n",
+               g_scenarioNames[scenario], policy, r->attempts, r->failed, r->wasted,
+               100.0 * r->upSeconds / DAY, r->reports, r->uploads, r->uploadFailures, r->deferred,
+               r->alertsSent, r->alerts, alertMean, r->alertDelayMax, returnMean, r->returnDelayMax);
+    }
+}
+
+static void Check(scenario_t scenario, const result_t* immediate, const result_t* backoff, uint32_t interval)
+{
+    const char* name = g_scenarioNames[scenario];
+    if (backoff->alertsSent + 1 < backoff->alerts)
+        Error("%s: %u of %u alerts delivered", name, backoff->alertsSent, backoff->alerts);
+    if (backoff->returnDelayMax > g_backoffMax + CONNECT_TIME + interval)
+        Error("%s: the link came back %u s after the coverage", name, backoff->returnDelayMax);
+    switch (scenario) {
+        case SCENARIO_FLAPPING:
+            if (backoff->wasted * 2 > immediate->wasted)
+                Error("%s: %u wasted reconnects, %u without the backoff", name, backoff->wasted, immediate->wasted);
+            break;
+        case SCENARIO_STABLE:
+        case SCENARIO_OUTAGE:
+            if (backoff->reports < immediate->reports * 0.95)
+                Error("%s: %u reports, %u without the backoff", name, backoff->reports, immediate->reports);
+            break;
+        case SCENARIO_WEAK:
+            if (backoff->uploadFailures * 2 > immediate->uploadFailures)
+                Error("%s: %u failed uploads, %u without deferral", name, backoff->uploadFailures,
+                      immediate->uploadFailures);
+            break;
+        default:
+            break;
+    }
+}
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --interval S       report_interval (default 10)\n"
+        "  --seed N           random seed (default 1)\n"
+        "  --csv              machine readable output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    static const struct option options[] = {
+        { "interval", required_argument, NULL, 'i' },
+        { "seed",     required_argument, NULL, 's' },
+        { "csv",      no_argument,       NULL, 'C' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    uint32_t interval = 10;
+    int csv = 0, opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'i': interval = strtoul(optarg, NULL, 0); break;
+            case 's': g_benchSeed = strtoul(optarg, NULL, 0); break;
+            case 'C': csv = 1; break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (interval < 1) interval = 1;
+
+    sim_sdk_init();
+    sim_bench_link_limits(&g_backoffMax, &g_stableTime, &g_deferMax);
+
+    day_t day = { malloc(DAY), malloc(DAY), malloc(DAY) };
+    if (csv)
+        printf("scenario,policy,reconnects,failed,wasted,link_up_pct,reports,uploads,upload_failures,"
+               "deferred,alerts,alert_delay_mean,alert_delay_max,return_delay_mean,return_delay_max\n");
+    else
+        printf("%-9s %-9s %8s %6s %6s %6s %7s %7s %6s %8s %7s %10s %11s\n", "scenario", "policy", "reconn",
+               "failed", "wasted", "up", "reports", "uploads", "upfail", "deferred", "alerts", "alert s",
+               "return s");
+    for (int s = 0; s < SCENARIO_MAX; ++s) {
+        result_t immediate, backoff;
+        Generate(&day, s);
+        // the same luck for both
+        uint32_t seed = g_benchSeed;
+        Live(&day, 0, interval, &immediate);
+        g_benchSeed = seed;
+        Live(&day, 1, interval, &backoff);
+        Print(s, "immediate", &immediate, csv);
+        Print(s, "backoff", &backoff, csv);
+        Check(s, &immediate, &backoff, interval);
+    }
+    free(day.data);
+    free(day.signal);
+    free(day.alert);
+    if (!csv)
+        printf("backoff up to %u s, links holding %u s end it; reports held back up to %u s\n", g_backoffMax,
+               g_stableTime, g_deferMax);
+    return g_errors ? 1 : 0;
+}
@@ -0,0 +1,431 @@
+/*
+ * NMEA replay benchmark of the GPS data path.
+ *
+ * Feeds NMEA traces through GPS_Update() -> GPS_Parse() -> gps_Process(), the work done
+ * for every API_EVENT_ID_GPS_UART_RECEIVED event, in UART sized chunks and reports
+ * throughput, per chunk latency, heap and stack high-water marks and the parser
+ * statistics. Without --trace it generates four scenarios of a GOKE GN/GP/BD receiver:
+ *
+ *   highway   1 Hz fix at 110 km/h, 10 GPS + 8 BeiDou satellites
+ *   urban     few satellites, high HDOP, fix lost and regained in bursts
+ *   cold      cold start: no position for 40 s, satellites appear one by one
+ *   garbled   highway with bit flips, lost bytes and binary noise on the UART
+ *
+ * Recorded traces (gps_logging output, any NMEA capture) are replayed with --trace.
+ * The stack figure is the depth below the event handler on the host, so compare it
+ * between builds rather than with the module.
+ *
+ *   build/nmea_bench [--trace FILE]... [--chunk N]... [--iterations N] [--csv]
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include "sim_host.h"
+#include "host_bench.h"
+
+#define MAX_TRACES      16
+#define MAX_CHUNKS      8
+#define STACK_SIZE      (256 * 1024)
+#define STACK_PATTERN   0xA5u
+#define CHUNK_VARIABLE  0               // random sizes 1..512, like UART idle interrupts
+
+typedef bench_nmea_t trace_t;
+
+typedef struct {
+    const trace_t*  trace;
+    uint32_t        chunk;
+    int             iterations;
+    // results
+    double          seconds;
+    uint64_t        bytes;
+    uint64_t        chunks;
+    uint32_t        p50Ns, p99Ns, maxNs;
+    uint32_t        heapPeak;
+    uint32_t        stackUsed;
+    uint32_t        validEpochs;
+    sim_gps_stats_t stats;
+} run_t;
+
+// ---------------------------------------------------------------------------
+// traces
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int prn, elevation, azimuth, snr;   // snr 0: not tracked
+} sat_t;
+
+static void Gsv(trace_t* t, const char* talker, const sat_t* sats, int count)
+{
+    int total = (count + 3) / 4;
+    if (total == 0) {
+        bench_sentence(t, "%sGSV,1,1,00", talker);
+        return;
+    }
+    for (int msg = 0; msg < total; ++msg) {
+        char body[160];
+        int n = snprintf(body, sizeof(body), "%sGSV,%d,%d,%02d", talker, total, msg + 1, count);
+        for (int i = msg * 4; i < count && i < msg * 4 + 4; ++i) {
+            if (sats[i].snr)
+                n += snprintf(body + n, sizeof(body) - n, ",%02d,%02d,%03d,%02d",
+                              sats[i].prn, sats[i].elevation, sats[i].azimuth, sats[i].snr);
+            else
+                n += snprintf(body + n, sizeof(body) - n, ",%02d,%02d,%03d,",
+                              sats[i].prn, sats[i].elevation, sats[i].azimuth);
+        }
+        bench_sentence(t, "%s", body);
+    }
+}
+
+static void Gsa(trace_t* t, const char* talker, const sat_t* sats, int count, int fix,
+                double pdop, double hdop, double vdop)
+{
+    char body[160];
+    int n = snprintf(body, sizeof(body), "%sGSA,A,%d", talker, fix ? 3 : 1);
+    int used = 0;
+    for (int i = 0; i < count && used < 12; ++i)
+        if (fix && sats[i].snr >= 25) {
+            n += snprintf(body + n, sizeof(body) - n, ",%02d", sats[i].prn);
+            used++;
+        }
+    for (; used < 12; ++used) n += snprintf(body + n, sizeof(body) - n, ",");
+    if (fix) snprintf(body + n, sizeof(body) - n, ",%.2f,%.2f,%.2f", pdop, hdop, vdop);
+    else     snprintf(body + n, sizeof(body) - n, ",,,");
+    bench_sentence(t, "%s", body);
+}
+
+typedef enum { SCENARIO_HIGHWAY, SCENARIO_URBAN, SCENARIO_COLD, SCENARIO_GARBLED } scenario_t;
+
+static void InitSats(sat_t* sats, int count, int prnBase)
+{
+    for (int i = 0; i < count; ++i) {
+        sats[i].prn = prnBase + i * 3 + 1;
+        sats[i].elevation = 10 + bench_random() % 75;
+        sats[i].azimuth = bench_random() % 360;
+        sats[i].snr = 0;
+    }
+}
+
+static void Generate(trace_t* t, scenario_t scenario, int epochs)
+{
+    static const char* const names[] = { "highway", "urban", "cold", "garbled" };
+    memset(t, 0, sizeof(*t));
+    t->name = strdup(names[scenario]);
+    g_benchSeed = 12345 + scenario;
+
+    sat_t gps[12], bds[12];
+    int gpsCount = scenario == SCENARIO_URBAN ? 12 : 10;
+    int bdsCount = scenario == SCENARIO_URBAN ? 10 : 8;
+    InitSats(gps, gpsCount, 0);
+    InitSats(bds, bdsCount, 200);
+
+    double lat = 52.2297, lon = 21.0122, heading = 70.0, alt = 112.0;
+    int lostFor = 0;
+
+    for (int e = 0; e < epochs; ++e) {
+        int second = 8 * 3600 + e;
+        char tm[16], date[] = "140618";
+        snprintf(tm, sizeof(tm), "%02d%02d%02d.000", second / 3600 % 24, second / 60 % 60, second % 60);
+
+        double speed = 30.5;                    // m/s
+        double hdop = 0.9;
+        int fix = 1;
+        switch (scenario) {
+            case SCENARIO_URBAN:
+                speed = 8.0 + 6.0 * sin(e / 15.0);
+                hdop = 2.0 + 6.0 * bench_random_unit();
+                if (lostFor == 0 && bench_random_unit() < 0.04) lostFor = 3 + bench_random() % 12;
+                if (lostFor) {
+                    fix = 0;
+                    lostFor--;
+                }
+                break;
+            case SCENARIO_COLD:
+                fix = e >= 40;
+                hdop = fix ? 1.8 - fmin(e - 40, 60) / 100.0 : 0;
+                break;
+            default:
+                break;
+        }
+
+        // satellites: SNR builds up during a cold start, fluctuates in town
+        int tracked = 0;
+        for (int i = 0; i < gpsCount + bdsCount; ++i) {
+            sat_t* s = i < gpsCount ? &gps[i] : &bds[i - gpsCount];
+            if (scenario == SCENARIO_COLD && e < i * 3)
+                s->snr = 0;
+            else if (scenario == SCENARIO_URBAN)
+                s->snr = bench_random_unit() < 0.4 ? 0 : 18 + bench_random() % 22;
+            else
+                s->snr = 32 + bench_random() % 15;
+            if (s->snr >= 25) tracked++;
+            if (e % 30 == 0) s->azimuth = (s->azimuth + 1) % 360;
+        }
+
+        heading = fmod(heading + (scenario == SCENARIO_URBAN ? (bench_random() % 3 == 0 ? 90 : 0) : 0.3) + 360, 360);
+        if (fix) {
+            lat += speed * cos(heading * M_PI / 180) / 111320.0;
+            lon += speed * sin(heading * M_PI / 180) / (111320.0 * cos(lat * M_PI / 180));
+        }
+
+        char la[32], lo[32], ns, ew;
+        bench_coord(lat, 2, la, sizeof(la), &ns, 'N', 'S');
+        bench_coord(lon, 3, lo, sizeof(lo), &ew, 'E', 'W');
+        double knots = speed * 1.943844;
+        size_t start = t->size;
+
+        if (fix) {
+            bench_sentence(t, "GNGGA,%s,%s,%c,%s,%c,1,%02d,%.2f,%.1f,M,34.5,M,,", tm, la, ns, lo, ew,
+                     tracked > 12 ? 12 : tracked, hdop, alt);
+        } else {
+            bench_sentence(t, "GNGGA,%s,,,,,0,%02d,,,,,,,", tm, tracked);
+        }
+        Gsa(t, "GP", gps, gpsCount, fix, hdop * 1.4, hdop, hdop * 1.1);
+        Gsa(t, "BD", bds, bdsCount, fix, hdop * 1.4, hdop, hdop * 1.1);
+        Gsv(t, "GP", gps, scenario == SCENARIO_COLD && e < 10 ? e : gpsCount);
+        Gsv(t, "BD", bds, scenario == SCENARIO_COLD && e < 20 ? e / 2 : bdsCount);
+        if (fix) {
+            bench_sentence(t, "GNRMC,%s,A,%s,%c,%s,%c,%.3f,%.2f,%s,,,A", tm, la, ns, lo, ew, knots, heading, date);
+            bench_sentence(t, "GNVTG,%.2f,T,,M,%.3f,N,%.3f,K,A", heading, knots, speed * 3.6);
+        } else {
+            bench_sentence(t, "GNRMC,%s,V,,,,,,,%s,,,N", tm, date);
+            bench_sentence(t, "GNVTG,,T,,M,,N,,K,N");
+        }
+        t->epochs++;
+
+        if (scenario == SCENARIO_GARBLED) {
+            // bit errors in the epoch just written
+            for (size_t i = start; i < t->size; ++i)
+                if (bench_random_unit() < 0.002) t->data[i] ^= 1 << (bench_random() % 8);
+            // a lost run of bytes
+            if (bench_random_unit() < 0.05) {
+                size_t len = t->size - start;
+                size_t cut = 20 + bench_random() % 100;
+                size_t at = start + bench_random() % len;
+                if (at + cut > t->size) cut = t->size - at;
+                memmove(t->data + at, t->data + at + cut, t->size - at - cut);
+                t->size -= cut;
+            }
+            // binary noise, e.g. a receiver reset banner
+            if (bench_random_unit() < 0.03) {
+                uint8_t noise[256];
+                int len = 30 + bench_random() % 200;
+                for (int i = 0; i < len; ++i) noise[i] = (uint8_t)bench_random();
+                bench_append(t, noise, len);
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// measurement
+// ---------------------------------------------------------------------------
+
+static int CompareU32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// fill the unused part of the thread stack with a pattern, like the OS stack checks
+static __attribute__((noinline)) void PaintStack(uint8_t* low)
+{
+    uint8_t* high = (uint8_t*)__builtin_frame_address(0) - 256;
+    for (volatile uint8_t* p = low; p < high; ++p) *p = STACK_PATTERN;
+}
+
+static void StackBounds(uint8_t** low, uint8_t** high)
+{
+    pthread_attr_t attr;
+    void* addr;
+    size_t size;
+    pthread_getattr_np(pthread_self(), &attr);
+    pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+    *low = (uint8_t*)addr + 4096;
+    *high = (uint8_t*)addr + size;
+}
+
+static void* RunThread(void* param)
+{
+    run_t* run = param;
+    const trace_t* trace = run->trace;
+    uint64_t maxChunks = (trace->size / (run->chunk ? run->chunk : 1) + 2) * run->iterations;
+    uint32_t* latency = malloc(maxChunks * sizeof(uint32_t));
+    sim_gps_stats_t before, after;
+
+    uint8_t *low, *high;
+    StackBounds(&low, &high);
+    uint8_t* frame = __builtin_frame_address(0);
+    PaintStack(low);
+
+    sim_bench_gps_init();
+    sim_bench_gps_stats(&before);
+    host_heap_peak(1);
+    g_benchSeed = 777;
+
+    uint64_t chunks = 0;
+    uint64_t start = bench_now_ns();
+    for (int it = 0; it < run->iterations; ++it) {
+        size_t pos = 0;
+        while (pos < trace->size) {
+            uint32_t len = run->chunk != CHUNK_VARIABLE ? run->chunk : 1 + bench_random() % 512;
+            if (len > trace->size - pos) len = trace->size - pos;
+            sim_gps_stats_t s;
+            sim_bench_gps_stats(&s);
+            uint32_t framesBefore = s.frames;
+
+            uint64_t t0 = bench_now_ns();
+            sim_bench_gps_feed((const uint8_t*)trace->data + pos, len);
+            uint64_t t1 = bench_now_ns();
+
+            if (chunks < maxChunks) latency[chunks] = (uint32_t)(t1 - t0);
+            chunks++;
+            sim_bench_gps_stats(&s);
+            // frames completed by this chunk, counted as fixes when the last one has one
+            if (sim_bench_gps_valid()) run->validEpochs += s.frames - framesBefore;
+            pos += len;
+        }
+    }
+    run->seconds = (bench_now_ns() - start) / 1e9;
+    run->bytes = (uint64_t)trace->size * run->iterations;
+    run->chunks = chunks;
+    run->heapPeak = host_heap_peak(0);
+
+    sim_bench_gps_stats(&after);
+    run->stats.frames    = after.frames - before.frames;
+    run->stats.sentences = after.sentences - before.sentences;
+    run->stats.invalid   = after.invalid - before.invalid;
+    run->stats.failed    = after.failed - before.failed;
+    run->stats.dropped   = after.dropped - before.dropped;
+    run->stats.overflows = after.overflows - before.overflows;
+
+    uint8_t* p = low;
+    while (p < frame && *p == STACK_PATTERN) p++;
+    run->stackUsed = (uint32_t)(frame - p);
+
+    uint64_t n = chunks < maxChunks ? chunks : maxChunks;
+    qsort(latency, n, sizeof(uint32_t), CompareU32);
+    run->p50Ns = n ? latency[n / 2] : 0;
+    run->p99Ns = n ? latency[n * 99 / 100] : 0;
+    run->maxNs = n ? latency[n - 1] : 0;
+    free(latency);
+    return NULL;
+}
+
+static void Run(run_t* run)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, STACK_SIZE);
+    pthread_create(&thread, &attr, RunThread, run);
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void PrintRun(const run_t* r, int csv)
+{
+    char chunk[16];
+    if (r->chunk == CHUNK_VARIABLE) strcpy(chunk, "var");
+    else snprintf(chunk, sizeof(chunk), "%u", r->chunk);
+    double mbps = r->bytes / r->seconds / 1e6;
+    double eps = (double)r->trace->epochs * r->iterations / r->seconds;
+    const sim_gps_stats_t* s = &r->stats;
+    if (csv) {
+        printf("%s,%s,%llu,%.3f,%.0f,%.2f,%.2f,%.2f,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+               r->trace->name, chunk, (unsigned long long)r->bytes, mbps, eps,
+               r->p50Ns / 1e3, r->p99Ns / 1e3, r->maxNs / 1e3, r->heapPeak, r->stackUsed,
+               s->frames, r->validEpochs, s->sentences, s->invalid, s->failed, s->dropped, s->overflows);
+    } else {
+        printf("%-10s %5s %8.2f %9.0f %8.2f %8.2f %9.2f %6u %6u %7u %6u %8u %6u %6u %6u %6u\n",
+               r->trace->name, chunk, mbps, eps, r->p50Ns / 1e3, r->p99Ns / 1e3, r->maxNs / 1e3,
+               r->heapPeak, r->stackUsed, s->frames, r->validEpochs, s->sentences,
+               s->invalid, s->failed, s->dropped, s->overflows);
+    }
+}
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --trace FILE       replay a recorded NMEA trace (repeatable), default: generated scenarios\n"
+        "  --epochs N         epochs per generated scenario (default 600)\n"
+        "  --chunk N          UART chunk size in bytes, 0 for random 1..512 (repeatable,\n"
+        "                     default 32, 128, 512 and random)\n"
+        "  --iterations N     passes over each trace (default 20)\n"
+        "  --csv              machine readable output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    static const struct option options[] = {
+        { "trace",      required_argument, NULL, 't' },
+        { "epochs",     required_argument, NULL, 'e' },
+        { "chunk",      required_argument, NULL, 'c' },
+        { "iterations", required_argument, NULL, 'i' },
+        { "csv",        no_argument,       NULL, 'C' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    trace_t traces[MAX_TRACES];
+    uint32_t chunks[MAX_CHUNKS];
+    int traceCount = 0, chunkCount = 0, iterations = 20, epochs = 600, csv = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                if (traceCount < MAX_TRACES && bench_load_trace(&traces[traceCount], optarg, 0) == 0) traceCount++;
+                else return 1;
+                break;
+            case 'e': epochs = atoi(optarg); break;
+            case 'c': if (chunkCount < MAX_CHUNKS) chunks[chunkCount++] = atoi(optarg); break;
+            case 'i': iterations = atoi(optarg); break;
+            case 'C': csv = 1; break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (iterations < 1) iterations = 1;
+    if (traceCount == 0) {
+        for (int s = SCENARIO_HIGHWAY; s <= SCENARIO_GARBLED; ++s)
+            Generate(&traces[traceCount++], (scenario_t)s, epochs);
+    }
+    if (chunkCount == 0) {
+        chunks[chunkCount++] = 32;
+        chunks[chunkCount++] = 128;
+        chunks[chunkCount++] = 512;
+        chunks[chunkCount++] = CHUNK_VARIABLE;
+    }
+
+    sim_sdk_init();
+
+    if (csv) {
+        printf("trace,chunk,bytes,mb_per_s,epochs_per_s,p50_us,p99_us,max_us,heap_peak,stack_used,"
+               "frames,valid,sentences,invalid,failed,dropped,overflows\n");
+    } else {
+        for (int i = 0; i < traceCount; ++i)
+            printf("trace %-10s %8zu bytes, %5d epochs\n", traces[i].name, traces[i].size, traces[i].epochs);
+        printf("\n%-10s %5s %8s %9s %8s %8s %9s %6s %6s %7s %6s %8s %6s %6s %6s %6s\n",
+               "trace", "chunk", "MB/s", "epochs/s", "p50 us", "p99 us", "max us", "heap", "stack",
+               "frames", "valid", "sentence", "invald", "failed", "drop", "ovfl");
+    }
+    for (int i = 0; i < traceCount; ++i) {
+        for (int c = 0; c < chunkCount; ++c) {
+            run_t run = { .trace = &traces[i], .chunk = chunks[c], .iterations = iterations };
+            Run(&run);
+            PrintRun(&run, csv);
+        }
+    }
+    return 0;
+}
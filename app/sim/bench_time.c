@@ -0,0 +1,255 @@
+/*
+ * Check and benchmark of the calendar conversions in app/src/utils.c.
+ *
+ * Checks, against the host C library (timegm, gmtime_r), every day from 1980 to 2100:
+ *
+ *   days_from_civil()    the day number of the date
+ *   civil_from_days()    the date of the day number
+ *   mk_time()            a time of every day with the two digit NMEA year (1980-2079)
+ *   time_to_rtc()        the RTC fields and rtc_to_time() back
+ *
+ * and the day numbers of years 0 to 9999 round trip. Then times mk_time() on random dates
+ * against the year by year loop it replaced and timegm(). The exit status is 1 when a
+ * conversion differs.
+ *
+ *   build/time_bench [--count N] [--iterations N] [--seed N] [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "sim_host.h"
+#include "host_bench.h"
+
+#define FIRST_YEAR      1980
+#define LAST_YEAR       2100
+#define MAX_ERRORS      10
+
+static int      g_errors = 0;
+
+static void Error(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void Error(const char* fmt, ...)
+{
+    if (g_errors++ >= MAX_ERRORS) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+// ---------------------------------------------------------------------------
+// the previous mk_time(), for comparison
+// ---------------------------------------------------------------------------
+
+static int LoopIsLeapYear(int year)
+{
+    year += 1900;
+    return (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+}
+
+static int LoopDaysInMonth(int month, int year)
+{
+    static const int days[12] = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+    if (month == 1 && LoopIsLeapYear(year)) return 29;
+    return days[month];
+}
+
+static uint32_t LoopMkTime(const uint8_t* f)
+{
+    int year = f[0], month = f[1] - 1, day = f[2] - 1;
+    if (year < 70) year += 100;
+    long days = 0;
+    for (int y = 70; y < year; y++)
+        days += LoopIsLeapYear(y) ? 366 : 365;
+    for (int m = 0; m < month; m++)
+        days += LoopDaysInMonth(m, year);
+    days += day;
+    return (uint32_t)(days * 86400L + f[3] * 3600L + f[4] * 60L + f[5]);
+}
+
+static uint32_t LoopRun(const uint8_t* fields, uint32_t count)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; ++i, fields += 6) sum += LoopMkTime(fields);
+    return sum;
+}
+
+static uint32_t TimegmRun(const uint8_t* fields, uint32_t count)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; ++i, fields += 6) {
+        struct tm tm = { 0 };
+        tm.tm_year = fields[0] + (fields[0] < 80 ? 100 : 0);
+        tm.tm_mon  = fields[1] - 1;
+        tm.tm_mday = fields[2];
+        tm.tm_hour = fields[3];
+        tm.tm_min  = fields[4];
+        tm.tm_sec  = fields[5];
+        sum += (uint32_t)timegm(&tm);
+    }
+    return sum;
+}
+
+// ---------------------------------------------------------------------------
+// checks
+// ---------------------------------------------------------------------------
+
+// every day of FIRST_YEAR..LAST_YEAR; returns the number of days checked
+static int CheckDays(void)
+{
+    struct tm first = { .tm_year = FIRST_YEAR - 1900, .tm_mday = 1 };
+    struct tm last  = { .tm_year = LAST_YEAR - 1900, .tm_mon = 11, .tm_mday = 31 };
+    int64_t from = timegm(&first) / 86400, to = timegm(&last) / 86400;
+    int checked = 0;
+    for (int64_t d = from; d <= to; ++d, ++checked) {
+        time_t t = (time_t)(d * 86400);
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        int year = tm.tm_year + 1900;
+        unsigned month = tm.tm_mon + 1, day = tm.tm_mday;
+
+        int32_t days = sim_bench_days_from_civil(year, month, day);
+        if (days != d) Error("days_from_civil(%d-%02u-%02u) = %d, expected %lld", year, month, day, days, (long long)d);
+
+        int y;
+        unsigned m, dd;
+        sim_bench_civil_from_days((int32_t)d, &y, &m, &dd);
+        if (y != year || m != month || dd != day)
+            Error("civil_from_days(%lld) = %d-%02u-%02u, expected %d-%02u-%02u", (long long)d, y, m, dd, year, month, day);
+
+        // a time of the day that walks through hours, minutes and seconds
+        uint32_t second = (uint32_t)(d * 7919 % 86400);
+        uint32_t expected = (uint32_t)(t + second);
+        if (year < 2080) {
+            uint32_t mk = sim_bench_mk_time(year % 100, month, day, second / 3600, second / 60 % 60, second % 60);
+            if (mk != expected) Error("mk_time(%d-%02u-%02u +%us) = %u, expected %u", year, month, day, second, mk, expected);
+        }
+        if (expected < (uint32_t)t) continue;   // past 2106
+        int fields[6];
+        uint32_t back = sim_bench_rtc_round_trip(expected, fields);
+        if (fields[0] != year || fields[1] != (int)month || fields[2] != (int)day ||
+            fields[3] != (int)(second / 3600) || fields[4] != (int)(second / 60 % 60) ||
+            fields[5] != (int)(second % 60) || back != expected)
+            Error("time_to_rtc(%u) = %d-%02d-%02d %02d:%02d:%02d, back %u", expected, fields[0], fields[1],
+                  fields[2], fields[3], fields[4], fields[5], back);
+    }
+    return checked;
+}
+
+// day numbers of years 0 to 9999 round trip and follow each other
+static int CheckRoundTrip(void)
+{
+    int32_t from = sim_bench_days_from_civil(0, 1, 1), to = sim_bench_days_from_civil(9999, 12, 31);
+    int checked = 0;
+    for (int32_t d = from; d <= to; ++d, ++checked) {
+        int y;
+        unsigned m, dd;
+        sim_bench_civil_from_days(d, &y, &m, &dd);
+        if (sim_bench_days_from_civil(y, m, dd) != d || m < 1 || m > 12 || dd < 1 || dd > 31)
+            Error("day %d: %d-%02u-%02u does not round trip", d, y, m, dd);
+    }
+    return checked;
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+typedef uint32_t (*run_t)(const uint8_t* fields, uint32_t count);
+
+static double Time(run_t run, const uint8_t* fields, uint32_t count, int iterations, uint32_t* sum)
+{
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < iterations; ++i) {
+        uint64_t t0 = bench_now_ns();
+        *sum = run(fields, count);
+        uint64_t ns = bench_now_ns() - t0;
+        if (ns < best) best = ns;
+    }
+    return (double)best / count;
+}
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --count N          random dates timed (default 1000000)\n"
+        "  --iterations N     timed passes, the best is shown (default 5)\n"
+        "  --seed N           random seed (default 1)\n"
+        "  --csv              machine readable output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    static const struct option options[] = {
+        { "count",      required_argument, NULL, 'n' },
+        { "iterations", required_argument, NULL, 'i' },
+        { "seed",       required_argument, NULL, 's' },
+        { "csv",        no_argument,       NULL, 'C' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    int count = 1000000, iterations = 5, csv = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 'n': count = atoi(optarg); break;
+            case 'i': iterations = atoi(optarg); break;
+            case 's': g_benchSeed = strtoul(optarg, NULL, 0); break;
+            case 'C': csv = 1; break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (count < 1) count = 1;
+    if (iterations < 1) iterations = 1;
+
+    sim_sdk_init();
+
+    int days = CheckDays();
+    int roundTrip = CheckRoundTrip();
+    if (csv) {
+        printf("check,days,errors\n");
+        printf("%d-%d,%d,%d\n", FIRST_YEAR, LAST_YEAR, days, g_errors);
+        printf("0-9999,%d,\n", roundTrip);
+    } else {
+        printf("checked %d days %d-%d against timegm/gmtime_r, %d days of years 0-9999 round trip: "
+               "%d errors\n", days, FIRST_YEAR, LAST_YEAR, roundTrip, g_errors);
+    }
+
+    // random NMEA dates of 1980-2069: the loop took 70-79 for the 1970s
+    uint8_t* fields = malloc((size_t)count * 6);
+    for (int i = 0; i < count; ++i) {
+        uint8_t* f = fields + i * 6;
+        int year = 1980 + bench_random() % 90;
+        f[0] = year % 100;
+        f[1] = 1 + bench_random() % 12;
+        f[2] = 1 + bench_random() % 28;
+        f[3] = bench_random() % 24;
+        f[4] = bench_random() % 60;
+        f[5] = bench_random() % 60;
+    }
+    static const struct { const char* name; run_t run; } runs[] = {
+        { "mk_time",     sim_bench_mk_time_run },
+        { "year loop",   LoopRun },
+        { "timegm",      TimegmRun },
+    };
+    uint32_t sums[3];
+    if (csv) printf("conversion,ns_per_call\n");
+    else printf("%-10s %8s\n", "", "ns/call");
+    for (int r = 0; r < 3; ++r) {
+        double ns = Time(runs[r].run, fields, count, iterations, &sums[r]);
+        if (csv) printf("%s,%.2f\n", runs[r].name, ns);
+        else printf("%-10s %8.2f\n", runs[r].name, ns);
+    }
+    if (sums[0] != sums[1] || sums[0] != sums[2]) Error("the timed conversions disagree");
+    free(fields);
+    return g_errors ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * Benchmark of the track simplifier (app/src/track_simplify.c).
+ *
+ * Replays NMEA traces through GPS_Update() -> gps_Process() (the position filter at
+ * its default settings), samples the reported fix every --interval epochs like the
+ * tracker does for the SMS fallback queue, and runs the samples through
+ * TrackSimplify_Add() at several tolerances:
+ *
+ *   kept          fixes the simplifier keeps, and the compression ratio
+ *   err max/mean  distance between every sampled fix and the kept track interpolated
+ *                 at its time, m; the maximum stays within the tolerance
+ *   SMS bytes     the kept fixes in the SMS report encoding (sms_report.h), before base64
+ *   ns/fix        CPU cost of TrackSimplify_Add()
+ *
+ * Without --trace it replays the recordings next to it (sample.nmea, parked.nmea) and
+ * a generated 40 minute drive: town blocks with stops at traffic lights, a highway and
+ * a parking lot, with a correlated receiver error.
+ *
+ *   build/track_bench [--trace FILE]... [--tolerance M]... [--interval N] [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "sim_host.h"
+#include "host_bench.h"
+
+#define MAX_TRACES      16
+#define MAX_TOLERANCES  8
+#define METRES_PER_DEG  111320.0
+#define KNOTS           1.943844
+// SMS report encoding: first fix 16 bytes, then varint deltas and 2 bytes, in 1e-5 degrees
+#define SMS_FIRST_BYTES 16
+#define SMS_MAX_BYTES   103
+#define SMS_MAX_FIXES   15
+
+typedef struct {
+    bench_nmea_t nmea;
+    sim_fix_t*   fixes;       // sampled from the replay
+    int          fixCount;
+} trace_t;
+
+typedef struct {
+    uint32_t kept;
+    double   errMax, errMean;
+    uint32_t smsBytes, smsCount;
+    double   nsPerFix;
+} result_t;
+
+// ---------------------------------------------------------------------------
+// traces
+// ---------------------------------------------------------------------------
+
+static void Generate(trace_t* t, int epochs)
+{
+    memset(t, 0, sizeof(*t));
+    t->nmea.name = strdup("drive");
+    g_benchSeed = 2024;
+
+    double lat = 52.2297, lon = 21.0122, heading = 90.0, speed = 0.0;
+    const double drift = exp(-1.0 / 30.0);
+    double driftE = 0.0, driftN = 0.0;
+    int stopFor = 0;
+
+    for (int e = 0; e < epochs; ++e) {
+        double target, hdop = 1.0 + bench_random_unit();
+        if (e < epochs * 5 / 12) {
+            // town: 90 degree turns every 40 s, red lights
+            target = 12.0;
+            if (e % 40 >= 37) heading += 30.0 * (e / 40 % 3 == 1 ? -1 : 1);
+            if (stopFor == 0 && e % 40 == 20 && bench_random_unit() < 0.5) stopFor = 20 + bench_random() % 40;
+            if (stopFor) {
+                target = 0.0;
+                stopFor--;
+            }
+        } else if (e < epochs * 10 / 12) {
+            target = 30.0;
+            heading += 0.15 * sin(e / 120.0);
+            hdop = 0.9;
+        } else {
+            target = 0.0;
+        }
+        // 2.5 m/s^2 at most
+        speed += fmax(-2.5, fmin(2.5, target - speed));
+        heading = fmod(heading + 360.0, 360.0);
+        double ve = speed * sin(heading * M_PI / 180), vn = speed * cos(heading * M_PI / 180);
+        lat += vn / METRES_PER_DEG;
+        lon += ve / (METRES_PER_DEG * cos(lat * M_PI / 180));
+
+        double sigma = hdop * 2.0;
+        driftE = drift * driftE + sqrt(1.0 - drift * drift) * sigma * bench_gauss();
+        driftN = drift * driftN + sqrt(1.0 - drift * drift) * sigma * bench_gauss();
+        double fixLat = lat + (driftN + 0.3 * sigma * bench_gauss()) / METRES_PER_DEG;
+        double fixLon = lon + (driftE + 0.3 * sigma * bench_gauss()) / (METRES_PER_DEG * cos(lat * M_PI / 180));
+        double me = ve + 0.1 * hdop * bench_gauss(), mn = vn + 0.1 * hdop * bench_gauss();
+        double knots = sqrt(me * me + mn * mn) * KNOTS;
+        double course = fmod(atan2(me, mn) * 180 / M_PI + 360.0, 360.0);
+
+        int second = 8 * 3600 + e;
+        char tm[16], date[] = "140618", la[32], lo[32], ns, ew;
+        snprintf(tm, sizeof(tm), "%02d%02d%02d.000", second / 3600 % 24, second / 60 % 60, second % 60);
+        bench_coord(fixLat, 2, la, sizeof(la), &ns, 'N', 'S');
+        bench_coord(fixLon, 3, lo, sizeof(lo), &ew, 'E', 'W');
+        bench_sentence(&t->nmea, "GNGGA,%s,%s,%c,%s,%c,1,09,%.2f,112.0,M,34.5,M,,", tm, la, ns, lo, ew, hdop);
+        bench_sentence(&t->nmea, "GPGSA,A,3,01,04,07,10,13,16,19,22,25,,,,%.2f,%.2f,%.2f", hdop * 1.4, hdop, hdop * 1.1);
+        bench_sentence(&t->nmea, "GNRMC,%s,A,%s,%c,%s,%c,%.3f,%.2f,%s,,,A", tm, la, ns, lo, ew, knots, course, date);
+        bench_sentence(&t->nmea, "GNVTG,%.2f,T,,M,%.3f,N,%.3f,K,A", course, knots, knots * 1.852);
+        t->nmea.epochs++;
+    }
+}
+
+// seconds of the day of the RMC in [p, end), -1 if there is none
+static int RmcSecond(const char* p, const char* end)
+{
+    const char* rmc = strstr(p, "RMC,");
+    if (!rmc || rmc >= end) return -1;
+    int h, m, s;
+    if (sscanf(rmc + 4, "%2d%2d%2d", &h, &m, &s) != 3) return -1;
+    return h * 3600 + m * 60 + s;
+}
+
+/**
+ * Feeds the trace epoch by epoch (up to the end of every VTG sentence) and samples
+ * the reported fix of every interval-th epoch with a valid fix.
+ */
+static void Sample(trace_t* t, int interval)
+{
+    sim_bench_filter_config(1, 1.5f, 5.0f);
+    sim_bench_gps_init();
+    t->fixes = calloc(t->nmea.epochs + 1, sizeof(sim_fix_t));
+    const char* p = t->nmea.data;
+    const char* end = t->nmea.data + t->nmea.size;
+    double day = 0.0, lastSecond = -1.0;
+    int valid = 0;
+    for (int e = 0; e < t->nmea.epochs && p < end; ++e) {
+        const char* vtg = strstr(p, "VTG,");
+        const char* eol = vtg ? strchr(vtg, '\n') : NULL;
+        const char* next = eol ? eol + 1 : end;
+        int second = RmcSecond(p, next);
+        sim_bench_gps_feed((const uint8_t*)p, (uint32_t)(next - p));
+        p = next;
+        if (second < 0 || !sim_bench_gps_valid()) continue;
+        if (second < lastSecond) day += 86400.0;
+        lastSecond = second;
+        if (valid++ % interval) continue;
+        sim_fix_t* f = &t->fixes[t->fixCount++];
+        f->time = day + second;
+        sim_bench_gps_position(&f->latitude, &f->longitude);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// measurement
+// ---------------------------------------------------------------------------
+
+static double Distance(double lat1, double lon1, double lat2, double lon2)
+{
+    double dn = (lat2 - lat1) * METRES_PER_DEG;
+    double de = (lon2 - lon1) * METRES_PER_DEG * cos(lat1 * M_PI / 180);
+    return sqrt(dn * dn + de * de);
+}
+
+static int VarintSize(uint32_t v)
+{
+    int n = 1;
+    while (v >>= 7) n++;
+    return n;
+}
+
+static uint32_t ZigZag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+// payload bytes and messages of the fixes in the SMS report encoding
+static void SmsSize(const sim_fix_t* fixes, uint32_t count, uint32_t* bytes, uint32_t* messages)
+{
+    uint32_t len = 0, inMessage = 0;
+    *bytes = 0;
+    *messages = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t size = SMS_FIRST_BYTES;
+        if (inMessage) {
+            const sim_fix_t* a = &fixes[i - 1];
+            const sim_fix_t* b = &fixes[i];
+            size = VarintSize((uint32_t)(b->time - a->time)) + 2 +
+                   VarintSize(ZigZag((int32_t)lround((b->latitude - a->latitude) * 1e5))) +
+                   VarintSize(ZigZag((int32_t)lround((b->longitude - a->longitude) * 1e5)));
+        }
+        if (!inMessage || len + size > SMS_MAX_BYTES || inMessage == SMS_MAX_FIXES) {
+            if (inMessage) *bytes += len;
+            (*messages)++;
+            inMessage = 0;
+            size = SMS_FIRST_BYTES;
+            len = 0;
+        }
+        len += size;
+        inMessage++;
+    }
+    *bytes += len;
+}
+
+static void Run(const trace_t* t, float tolerance, int iterations, result_t* r)
+{
+    sim_fix_t* kept = malloc((t->fixCount + 1) * sizeof(sim_fix_t));
+    memset(r, 0, sizeof(*r));
+    uint64_t ns = 0;
+    for (int i = 0; i < iterations; ++i) {
+        uint64_t t0 = bench_now_ns();
+        r->kept = sim_bench_track_run(t->fixes, t->fixCount, tolerance, kept);
+        ns += bench_now_ns() - t0;
+    }
+    r->nsPerFix = t->fixCount ? (double)ns / ((double)iterations * t->fixCount) : 0;
+
+    // every sampled fix against the kept track at its time
+    uint32_t k = 0;
+    double sum = 0.0;
+    for (int i = 0; i < t->fixCount; ++i) {
+        const sim_fix_t* f = &t->fixes[i];
+        while (k + 1 < r->kept && kept[k + 1].time <= f->time) k++;
+        const sim_fix_t* a = &kept[k];
+        const sim_fix_t* b = k + 1 < r->kept ? &kept[k + 1] : a;
+        double span = b->time - a->time;
+        double x = span > 0 ? (f->time - a->time) / span : 0.0;
+        double d = Distance(f->latitude, f->longitude, a->latitude + x * (b->latitude - a->latitude),
+                            a->longitude + x * (b->longitude - a->longitude));
+        sum += d;
+        if (d > r->errMax) r->errMax = d;
+    }
+    r->errMean = t->fixCount ? sum / t->fixCount : 0;
+    SmsSize(kept, r->kept, &r->smsBytes, &r->smsCount);
+    free(kept);
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --trace FILE       replay an NMEA trace (repeatable), default: sample.nmea, parked.nmea\n"
+        "                     and a generated drive\n"
+        "  --tolerance M      track_tolerance in metres (repeatable, default 0, 5, 10, 20, 50)\n"
+        "  --interval N       sample every N-th fix, like report_interval (default 1)\n"
+        "  --epochs N         epochs of the generated drive (default 2400)\n"
+        "  --iterations N     passes for the CPU cost (default 200)\n"
+        "  --csv              machine readable output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    static const struct option options[] = {
+        { "trace",      required_argument, NULL, 't' },
+        { "tolerance",  required_argument, NULL, 'm' },
+        { "interval",   required_argument, NULL, 'n' },
+        { "epochs",     required_argument, NULL, 'e' },
+        { "iterations", required_argument, NULL, 'i' },
+        { "csv",        no_argument,       NULL, 'C' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    trace_t traces[MAX_TRACES];
+    memset(traces, 0, sizeof(traces));
+    float tolerances[MAX_TOLERANCES];
+    int traceCount = 0, toleranceCount = 0, interval = 1, epochs = 2400, iterations = 200, csv = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                if (traceCount < MAX_TRACES && bench_load_trace(&traces[traceCount].nmea, optarg, 0) == 0) traceCount++;
+                else return 1;
+                break;
+            case 'm': if (toleranceCount < MAX_TOLERANCES) tolerances[toleranceCount++] = atof(optarg); break;
+            case 'n': interval = atoi(optarg); break;
+            case 'e': epochs = atoi(optarg); break;
+            case 'i': iterations = atoi(optarg); break;
+            case 'C': csv = 1; break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (interval < 1) interval = 1;
+    if (iterations < 1) iterations = 1;
+    if (toleranceCount == 0) {
+        static const float defaults[] = { 0, 5, 10, 20, 50 };
+        for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); ++i)
+            tolerances[toleranceCount++] = defaults[i];
+    }
+    if (traceCount == 0) {
+        static const char* const recorded[] = { "sample.nmea", "parked.nmea" };
+        for (size_t i = 0; i < sizeof(recorded) / sizeof(recorded[0]); ++i)
+            if (bench_load_trace(&traces[traceCount].nmea, recorded[i], 1) == 0) traceCount++;
+        Generate(&traces[traceCount++], epochs);
+    }
+
+    sim_sdk_init();
+
+    if (csv) {
+        printf("trace,tolerance,fixes,kept,ratio,err_max,err_mean,sms_bytes,sms,ns_per_fix\n");
+    } else {
+        printf("%-12s %5s %6s %6s %7s %8s %8s %9s %5s %7s\n", "trace", "tol m", "fixes", "kept",
+               "ratio", "err max", "err mean", "SMS bytes", "SMS", "ns/fix");
+    }
+    for (int i = 0; i < traceCount; ++i) {
+        trace_t* t = &traces[i];
+        Sample(t, interval);
+        for (int m = 0; m < toleranceCount; ++m) {
+            result_t r;
+            Run(t, tolerances[m], iterations, &r);
+            double ratio = r.kept ? (double)t->fixCount / r.kept : 0;
+            if (csv)
+                printf("%s,%.1f,%d,%u,%.2f,%.2f,%.2f,%u,%u,%.1f\n", t->nmea.name, tolerances[m], t->fixCount,
+                       r.kept, ratio, r.errMax, r.errMean, r.smsBytes, r.smsCount, r.nsPerFix);
+            else
+                printf("%-12s %5.0f %6d %6u %6.1fx %8.2f %8.2f %9u %5u %7.1f\n", t->nmea.name, tolerances[m],
+                       t->fixCount, r.kept, ratio, r.errMax, r.errMean, r.smsBytes, r.smsCount, r.nsPerFix);
+        }
+    }
+    return 0;
+}
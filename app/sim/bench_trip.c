@@ -0,0 +1,350 @@
+/*
+ * Replay test of the trip detector and odometer (app/src/trip.c).
+ *
+ * Replays NMEA traces through GPS_Update() -> gps_Process() (the position filter at its
+ * default settings), takes the reported fix of every epoch and runs the fixes through
+ * TripDetector_Update(). For every trip found it prints the start, the duration, the
+ * distance and the top speed, and the odometer at the end.
+ *
+ * Without --trace it replays the recordings next to it (sample.nmea, parked.nmea) and
+ * a generated day with a known truth: parked with a wandering fix, town driving with
+ * red lights and a 150 s jam, a highway, a night in an underground garage without GPS,
+ * and a tunnel. The trips of the day are checked against the truth (count, start and end
+ * within 10 s, distance within 5 %) and the parked recording must not move the
+ * odometer; the exit status is 1 otherwise.
+ *
+ *   build/trip_bench [--trace FILE]... [--stop-time S] [--csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "sim_host.h"
+#include "host_bench.h"
+
+#define MAX_TRACES      16
+#define MAX_TRIPS       64
+#define METRES_PER_DEG  111320.0
+#define KNOTS           1.943844
+#define START_DATE      "140618"
+#define START_SECOND    (6 * 3600)
+#define MAX_TIME_ERROR  10.0        // s
+#define MAX_DIST_ERROR  0.05
+
+typedef struct {
+    bench_nmea_t nmea;
+    sim_fix_t*   fixes;
+    int          fixCount;
+    // generated traces: the true trips; recorded ones: -1, or 0 when known to be parked
+    int          truthCount;
+    sim_trip_t   truth[MAX_TRIPS];
+} trace_t;
+
+typedef enum { ROAD_PARKED, ROAD_TOWN, ROAD_JAM, ROAD_HIGHWAY } road_t;
+
+typedef struct {
+    road_t road;
+    int    seconds;
+    int    gps;             // the receiver has a fix
+} segment_t;
+
+// the generated day
+static const segment_t g_day[] = {
+    { ROAD_PARKED,   900, 1 },
+    { ROAD_TOWN,     700, 1 },
+    { ROAD_JAM,      150, 1 },
+    { ROAD_TOWN,     300, 1 },
+    { ROAD_PARKED,  1200, 1 },
+    { ROAD_HIGHWAY,  900, 1 },
+    { ROAD_PARKED,   120, 1 },
+    { ROAD_PARKED,  1800, 0 },  // underground garage
+    { ROAD_TOWN,     400, 1 },
+    { ROAD_HIGHWAY,   25, 0 },  // tunnel, shorter than any trip_stop_time
+    { ROAD_TOWN,     300, 1 },
+    { ROAD_PARKED,   600, 1 },
+};
+
+// ---------------------------------------------------------------------------
+// traces
+// ---------------------------------------------------------------------------
+
+/**
+ * The true trips of a speed profile, as the detector should see them: moving from the
+ * first second with speed to the start of a stand of stopTime seconds or more. The gaps
+ * in the fixes while driving are shorter than any stop time.
+ */
+static void Truth(trace_t* t, const double* speed, const double* lat, const double* lon, int seconds,
+                  int stopTime)
+{
+    t->truthCount = 0;
+    int start = -1, still = 0;
+    double distance = 0.0, maxSpeed = 0.0;
+    for (int s = 0; s <= seconds; ++s) {
+        int moving = s < seconds && speed[s] > 0.05;
+        if (moving) {
+            if (start < 0) {
+                start = s;
+                distance = maxSpeed = 0.0;
+            }
+            distance += speed[s];
+            if (speed[s] > maxSpeed) maxSpeed = speed[s];
+            still = 0;
+            continue;
+        }
+        if (start < 0) continue;
+        if (++still >= stopTime || s == seconds) {
+            int end = s - still + 1;
+            sim_trip_t* trip = &t->truth[t->truthCount++];
+            trip->start     = START_SECOND + start;
+            trip->end       = START_SECOND + end;
+            trip->latitude  = lat[end];
+            trip->longitude = lon[end];
+            trip->distance  = distance;
+            trip->maxSpeed  = maxSpeed * KNOTS;
+            start = -1;
+            still = 0;
+        }
+    }
+}
+
+static void Generate(trace_t* t, int stopTime)
+{
+    memset(t, 0, sizeof(*t));
+    t->nmea.name = strdup("day");
+    g_benchSeed = 45;
+
+    int seconds = 0;
+    for (size_t i = 0; i < sizeof(g_day) / sizeof(g_day[0]); ++i) seconds += g_day[i].seconds;
+    double* trueSpeed = calloc(seconds + 1, sizeof(double));
+    double* trueLat   = calloc(seconds + 1, sizeof(double));
+    double* trueLon   = calloc(seconds + 1, sizeof(double));
+
+    double lat = 52.2297, lon = 21.0122, heading = 90.0, speed = 0.0;
+    const double drift = exp(-1.0 / 60.0);
+    double driftE = 0.0, driftN = 0.0;
+    int stopFor = 0, s = 0;
+
+    for (size_t i = 0; i < sizeof(g_day) / sizeof(g_day[0]); ++i) {
+        const segment_t* seg = &g_day[i];
+        for (int k = 0; k < seg->seconds; ++k, ++s) {
+            double target = 0.0, hdop = 1.0 + bench_random_unit();
+            switch (seg->road) {
+                case ROAD_PARKED:
+                case ROAD_JAM:
+                    hdop += 1.0;
+                    break;
+                case ROAD_TOWN:
+                    // a turn every 60 s, a red light at one crossing in three
+                    target = 12.0;
+                    if (k % 60 >= 57) heading += 30.0 * (s / 60 % 3 == 1 ? -1 : 1);
+                    if (stopFor == 0 && k % 60 == 30 && bench_random() % 3 == 0) stopFor = 20 + bench_random() % 40;
+                    if (stopFor) {
+                        target = 0.0;
+                        stopFor--;
+                    }
+                    break;
+                case ROAD_HIGHWAY:
+                    target = 30.0;
+                    heading += 0.1 * sin(s / 150.0);
+                    hdop = 0.9;
+                    break;
+            }
+            // 2.5 m/s^2 at most, a standing car does not creep
+            speed += fmax(-2.5, fmin(2.5, target - speed));
+            if (speed < 0.05) speed = 0.0;
+            heading = fmod(heading + 360.0, 360.0);
+            double ve = speed * sin(heading * M_PI / 180), vn = speed * cos(heading * M_PI / 180);
+            lat += vn / METRES_PER_DEG;
+            lon += ve / (METRES_PER_DEG * cos(lat * M_PI / 180));
+            trueSpeed[s] = speed;
+            trueLat[s] = lat;
+            trueLon[s] = lon;
+
+            double sigma = hdop * 2.0;
+            driftE = drift * driftE + sqrt(1.0 - drift * drift) * sigma * bench_gauss();
+            driftN = drift * driftN + sqrt(1.0 - drift * drift) * sigma * bench_gauss();
+            if (!seg->gps) continue;
+
+            double fixLat = lat + (driftN + 0.3 * sigma * bench_gauss()) / METRES_PER_DEG;
+            double fixLon = lon + (driftE + 0.3 * sigma * bench_gauss()) / (METRES_PER_DEG * cos(lat * M_PI / 180));
+            double me = ve + 0.1 * hdop * bench_gauss(), mn = vn + 0.1 * hdop * bench_gauss();
+            double knots = sqrt(me * me + mn * mn) * KNOTS;
+            double course = fmod(atan2(me, mn) * 180 / M_PI + 360.0, 360.0);
+
+            int second = START_SECOND + s;
+            char tm[16], la[32], lo[32], ns, ew;
+            snprintf(tm, sizeof(tm), "%02d%02d%02d.000", second / 3600 % 24, second / 60 % 60, second % 60);
+            bench_coord(fixLat, 2, la, sizeof(la), &ns, 'N', 'S');
+            bench_coord(fixLon, 3, lo, sizeof(lo), &ew, 'E', 'W');
+            bench_sentence(&t->nmea, "GNGGA,%s,%s,%c,%s,%c,1,09,%.2f,112.0,M,34.5,M,,", tm, la, ns, lo, ew, hdop);
+            bench_sentence(&t->nmea, "GPGSA,A,3,01,04,07,10,13,16,19,22,25,,,,%.2f,%.2f,%.2f", hdop * 1.4, hdop, hdop * 1.1);
+            bench_sentence(&t->nmea, "GNRMC,%s,A,%s,%c,%s,%c,%.3f,%.2f,%s,,,A", tm, la, ns, lo, ew, knots, course, START_DATE);
+            bench_sentence(&t->nmea, "GNVTG,%.2f,T,,M,%.3f,N,%.3f,K,A", course, knots, knots * 1.852);
+            t->nmea.epochs++;
+        }
+    }
+    Truth(t, trueSpeed, trueLat, trueLon, seconds, stopTime);
+    free(trueSpeed);
+    free(trueLat);
+    free(trueLon);
+}
+
+// a recorded trace; the parked one is known to hold no trip
+static int LoadTrace(trace_t* t, const char* path, int quiet)
+{
+    if (bench_load_trace(&t->nmea, path, quiet) != 0) return -1;
+    t->truthCount = strstr(t->nmea.name, "parked") ? 0 : -1;
+    return 0;
+}
+
+// seconds of the day of the RMC in [p, end), -1 if there is none
+static int RmcSecond(const char* p, const char* end)
+{
+    const char* rmc = strstr(p, "RMC,");
+    if (!rmc || rmc >= end) return -1;
+    int h, m, s;
+    if (sscanf(rmc + 4, "%2d%2d%2d", &h, &m, &s) != 3) return -1;
+    return h * 3600 + m * 60 + s;
+}
+
+// feeds the trace epoch by epoch and takes the reported fix of every valid one
+static void Sample(trace_t* t)
+{
+    sim_bench_filter_config(1, 1.5f, 5.0f);
+    sim_bench_gps_init();
+    t->fixes = calloc(t->nmea.epochs + 1, sizeof(sim_fix_t));
+    const char* p = t->nmea.data;
+    const char* end = t->nmea.data + t->nmea.size;
+    double day = 0.0, lastSecond = -1.0;
+    for (int e = 0; e < t->nmea.epochs && p < end; ++e) {
+        const char* vtg = strstr(p, "VTG,");
+        const char* eol = vtg ? strchr(vtg, '\n') : NULL;
+        const char* next = eol ? eol + 1 : end;
+        int second = RmcSecond(p, next);
+        sim_bench_gps_feed((const uint8_t*)p, (uint32_t)(next - p));
+        p = next;
+        if (second < 0 || !sim_bench_gps_valid()) continue;
+        if (second < lastSecond) day += 86400.0;
+        lastSecond = second;
+        sim_fix_t* f = &t->fixes[t->fixCount++];
+        sim_bench_gps_fix(f);
+        f->time = day + second;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void Clock(double seconds, char* out, size_t size)
+{
+    int s = (int)seconds % 86400;
+    snprintf(out, size, "%02d:%02d:%02d", s / 3600, s / 60 % 60, s % 60);
+}
+
+static void PrintTrip(const char* trace, const char* what, int index, const sim_trip_t* trip, int csv)
+{
+    char start[16], end[16];
+    Clock(trip->start, start, sizeof(start));
+    Clock(trip->end, end, sizeof(end));
+    if (csv)
+        printf("%s,%s,%d,%s,%s,%.0f,%.0f,%.1f\n", trace, what, index + 1, start, end,
+               trip->end - trip->start, trip->distance, trip->maxSpeed);
+    else
+        printf("%-12s %-6s %4d %9s %9s %7.0f %9.0f %8.1f\n", trace, what, index + 1, start, end,
+               trip->end - trip->start, trip->distance, trip->maxSpeed);
+}
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --trace FILE       replay an NMEA trace (repeatable), default: sample.nmea, parked.nmea\n"
+        "                     and a generated day\n"
+        "  --stop-time S      trip_stop_time in seconds (default 180)\n"
+        "  --csv              machine readable output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    static const struct option options[] = {
+        { "trace",      required_argument, NULL, 't' },
+        { "stop-time",  required_argument, NULL, 's' },
+        { "csv",        no_argument,       NULL, 'C' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    trace_t traces[MAX_TRACES];
+    memset(traces, 0, sizeof(traces));
+    int traceCount = 0, stopTime = 180, csv = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+            case 't':
+                if (traceCount < MAX_TRACES && LoadTrace(&traces[traceCount], optarg, 0) == 0) traceCount++;
+                else return 1;
+                break;
+            case 's': stopTime = atoi(optarg); break;
+            case 'C': csv = 1; break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    // the limits of trip_stop_time
+    if (stopTime < 30) stopTime = 30;
+    if (stopTime > 3600) stopTime = 3600;
+    if (traceCount == 0) {
+        static const char* const recorded[] = { "sample.nmea", "parked.nmea" };
+        for (size_t i = 0; i < sizeof(recorded) / sizeof(recorded[0]); ++i)
+            if (LoadTrace(&traces[traceCount], recorded[i], 1) == 0) traceCount++;
+        Generate(&traces[traceCount++], stopTime);
+    }
+
+    sim_sdk_init();
+
+    if (csv)
+        printf("trace,kind,trip,start,end,duration,distance,max_speed\n");
+    else
+        printf("%-12s %-6s %4s %9s %9s %7s %9s %8s\n", "trace", "kind", "trip", "start", "end",
+               "s", "m", "max kn");
+    int failed = 0;
+    for (int i = 0; i < traceCount; ++i) {
+        trace_t* t = &traces[i];
+        Sample(t);
+        sim_trip_t trips[MAX_TRIPS];
+        double odometer;
+        uint32_t count = sim_bench_trip_run(t->fixes, t->fixCount, stopTime, trips, MAX_TRIPS, &odometer);
+
+        double truthOdometer = 0.0;
+        for (uint32_t k = 0; k < count; ++k) PrintTrip(t->nmea.name, "found", k, &trips[k], csv);
+        for (int k = 0; k < t->truthCount; ++k) {
+            PrintTrip(t->nmea.name, "truth", k, &t->truth[k], csv);
+            truthOdometer += t->truth[k].distance;
+        }
+        if (csv)
+            printf("%s,odometer,,,,,%.0f,\n", t->nmea.name, odometer);
+        else if (t->truthCount >= 0)
+            printf("%-12s odometer %.0f m, truth %.0f m\n", t->nmea.name, odometer, truthOdometer);
+        else
+            printf("%-12s odometer %.0f m\n", t->nmea.name, odometer);
+
+        if (t->truthCount < 0) continue;
+        int ok = (int)count == t->truthCount;
+        for (uint32_t k = 0; ok && k < count; ++k) {
+            const sim_trip_t* a = &trips[k];
+            const sim_trip_t* b = &t->truth[k];
+            ok = fabs(a->start - b->start) <= MAX_TIME_ERROR && fabs(a->end - b->end) <= MAX_TIME_ERROR &&
+                 fabs(a->distance - b->distance) <= MAX_DIST_ERROR * b->distance;
+        }
+        ok = ok && fabs(odometer - truthOdometer) <= MAX_DIST_ERROR * truthOdometer + 1.0;
+        if (!ok) {
+            fprintf(stderr, "%s: the trips differ from the truth\n", t->nmea.name);
+            failed = 1;
+        }
+    }
+    return failed;
+}
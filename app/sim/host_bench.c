@@ -0,0 +1,86 @@
+/*
+ * Host CSDK simulator - helpers shared by the benchmarks.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+
+#include "host_bench.h"
+
+uint32_t g_benchSeed = 1;
+
+uint32_t bench_random(void)
+{
+    g_benchSeed = g_benchSeed * 1103515245u + 12345u;
+    return (g_benchSeed >> 8) & 0xFFFFFF;
+}
+
+double bench_random_unit(void)
+{
+    return (bench_random() + 0.5) / (double)0x1000000;
+}
+
+double bench_gauss(void)
+{
+    return sqrt(-2.0 * log(bench_random_unit())) * cos(2.0 * M_PI * bench_random_unit());
+}
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void bench_append(bench_nmea_t* nmea, const void* data, size_t len)
+{
+    if (nmea->size + len + 1 > nmea->cap) {
+        nmea->cap = (nmea->size + len + 1) * 2;
+        nmea->data = realloc(nmea->data, nmea->cap);
+    }
+    memcpy(nmea->data + nmea->size, data, len);
+    nmea->size += len;
+    nmea->data[nmea->size] = '\0';
+}
+
+void bench_sentence(bench_nmea_t* nmea, const char* fmt, ...)
+{
+    char body[160], line[176];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(body, sizeof(body), fmt, ap);
+    va_end(ap);
+    uint8_t cs = 0;
+    for (const char* p = body; *p; ++p) cs ^= (uint8_t)*p;
+    int n = snprintf(line, sizeof(line), "$%s*%02X\r\n", body, cs);
+    bench_append(nmea, line, n);
+}
+
+void bench_coord(double v, int degDigits, char* out, size_t size, char* hemi, char pos, char neg)
+{
+    *hemi = v >= 0 ? pos : neg;
+    v = fabs(v);
+    int deg = (int)v;
+    snprintf(out, size, "%0*d%07.4f", degDigits, deg, (v - deg) * 60.0);
+}
+
+int bench_load_trace(bench_nmea_t* nmea, const char* path, int quiet)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        if (!quiet) perror(path);
+        return -1;
+    }
+    memset(nmea, 0, sizeof(*nmea));
+    const char* base = strrchr(path, '/');
+    nmea->name = strdup(base ? base + 1 : path);
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) bench_append(nmea, buf, n);
+    fclose(f);
+    for (const char* p = nmea->data; p && (p = strstr(p, "VTG,")); p += 4) nmea->epochs++;
+    return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef HOST_BENCH_H
+#define HOST_BENCH_H
+
+/**
+ * Host CSDK simulator - helpers shared by the benchmarks (bench_*.c): the pseudo random
+ * sequence, the clock, and NMEA traces generated or read from a file. The firmware is
+ * reached through the sim_bench_*() entry points of sim_host.h.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+// an NMEA trace, as the GPS UART delivers it
+typedef struct {
+    char*  name;
+    char*  data;
+    size_t size;
+    size_t cap;
+    int    epochs;      // VTG sentences, one per epoch
+} bench_nmea_t;
+
+// state of the sequence; a bench seeds it per scenario so every run generates the same data
+extern uint32_t g_benchSeed;
+
+// 24 bit pseudo random numbers
+uint32_t bench_random(void);
+// in (0, 1)
+double   bench_random_unit(void);
+// standard normal
+double   bench_gauss(void);
+// monotonic ns
+uint64_t bench_now_ns(void);
+
+void     bench_append(bench_nmea_t* nmea, const void* data, size_t len);
+// appends "$<body>*<checksum>\r\n"
+void     bench_sentence(bench_nmea_t* nmea, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+// NMEA ddmm.mmmm / dddmm.mmmm of a coordinate in degrees, the hemisphere in *hemi
+void     bench_coord(double v, int degDigits, char* out, size_t size, char* hemi, char pos, char neg);
+// reads a recorded trace, named after the file; quiet: no message when it is missing
+int      bench_load_trace(bench_nmea_t* nmea, const char* path, int quiet);
+
+#endif // HOST_BENCH_H
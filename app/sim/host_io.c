@@ -0,0 +1,727 @@
+/*
+ * Host CSDK simulator - console, trace output, C library helpers, file system and
+ * TCP sockets on top of POSIX calls.
+ *
+ * The sockets run over loopback or the host network; the link model delays, loses and
+ * resets them like a GPRS bearer (--net-* options) and counts what would go on the air.
+ * The power log (--power-log) records the power states for app/tool/energy_model.py.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "sim_host.h"
+
+sim_options_t g_simOptions = {
+    .imei            = "860000000000001",
+    .apnReject       = "dummy_apn",
+    .smsLog          = NULL,
+    .attachDelayMs   = 500,
+    .activateDelayMs = 1000,
+    .batteryPercent  = 87,
+    .noNetwork       = 0,
+    .verbose         = 0,
+};
+const char* g_simFsRoot = "sim_fs";
+char**      g_simArgv   = NULL;
+
+static pthread_mutex_t g_outputLock = PTHREAD_MUTEX_INITIALIZER;
+static FILE*           g_powerLog   = NULL;
+
+// ---------------------------------------------------------------------------
+// console, trace and process control
+// ---------------------------------------------------------------------------
+
+void host_uart_write(int port, const uint8_t* data, uint32_t len)
+{
+    pthread_mutex_lock(&g_outputLock);
+    if (port == 1) {
+        fwrite(data, 1, len, stdout);
+        fflush(stdout);
+    }
+    pthread_mutex_unlock(&g_outputLock);
+}
+
+void host_trace(const char* fmt, va_list ap)
+{
+    if (!g_simOptions.verbose) return;
+    pthread_mutex_lock(&g_outputLock);
+    fprintf(stderr, "[trace] ");
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&g_outputLock);
+}
+
+void host_log(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    pthread_mutex_lock(&g_outputLock);
+    fprintf(stderr, "[sim %7.3f] ", host_uptime_us() / 1e6);
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&g_outputLock);
+    va_end(ap);
+}
+
+void host_sms_sent(const char* number, const uint8_t* text, uint32_t len)
+{
+    host_log("SMS to %s: %.*s", number, (int)len, (const char*)text);
+    if (!g_simOptions.smsLog) return;
+    FILE* f = fopen(g_simOptions.smsLog, "a");
+    if (!f) return;
+    fprintf(f, "%s\t%.*s\n", number, (int)len, (const char*)text);
+    fclose(f);
+}
+
+void host_restart(void)
+{
+    host_log("restart requested");
+    fflush(stdout);
+    execv("/proc/self/exe", g_simArgv);
+    host_log("restart failed: %s", strerror(errno));
+    _exit(1);
+}
+
+// ---------------------------------------------------------------------------
+// power log: "<seconds> <part> <state>" lines
+// ---------------------------------------------------------------------------
+
+static void PowerLog(const char* part, const char* state)
+{
+    pthread_mutex_lock(&g_outputLock);
+    if (!g_powerLog && !(g_powerLog = fopen(g_simOptions.powerLog, "w")))
+        fprintf(stderr, "[sim] cannot write %s\n", g_simOptions.powerLog);
+    if (g_powerLog)
+        fprintf(g_powerLog, "%.3f %s %s\n", host_uptime_us() / 1e6, part, state);
+    pthread_mutex_unlock(&g_outputLock);
+}
+
+static int g_cpuSleepMode = 0;
+
+void host_power_event(const char* part, const char* state)
+{
+    if (strcmp(part, "cpu") == 0) g_cpuSleepMode = strcmp(state, "sleep") == 0;
+    if (g_simOptions.powerLog) PowerLog(part, state);
+}
+
+void host_power_wake(const char* task)
+{
+    if (!g_simOptions.powerLog || !g_cpuSleepMode) return;
+    // one word per field: "GPS Tracker" is logged as GPS_Tracker
+    char name[32];
+    int n = 0;
+    for (; task[n] && n < (int)sizeof(name) - 1; ++n) name[n] = task[n] == ' ' ? '_' : task[n];
+    name[n] = '\0';
+    PowerLog("wake", name);
+}
+
+// the link counters give the radio energy, "end" the length of the run
+static void PowerLogEnd(void)
+{
+    char stats[512];
+    host_link_stats(stats, sizeof(stats));
+    for (char* line = strtok(stats, "\n"); line; line = strtok(NULL, "\n")) {
+        char* value = strchr(line, ' ');
+        if (!value) continue;
+        *value++ = '\0';
+        char state[128];
+        snprintf(state, sizeof(state), "%s %s", line, value);
+        PowerLog("link", state);
+    }
+    PowerLog("end", "-");
+    fclose(g_powerLog);
+    g_powerLog = NULL;
+}
+
+void host_shutdown(int code)
+{
+    host_log("shutdown (%d)", code);
+    if (g_simOptions.netStats && host_link_stats_write(g_simOptions.netStats) < 0)
+        host_log("cannot write %s", g_simOptions.netStats);
+    if (g_simOptions.powerLog)
+        PowerLogEnd();
+    fflush(stdout);
+    _exit(code);
+}
+
+// ---------------------------------------------------------------------------
+// C library
+// ---------------------------------------------------------------------------
+
+int host_vsnprintf(char* buf, uint32_t size, const char* fmt, va_list ap)
+{
+    return vsnprintf(buf, size, fmt, ap);
+}
+
+int host_vsscanf(const char* buf, const char* fmt, va_list ap)
+{
+    return vsscanf(buf, fmt, ap);
+}
+
+double host_strtod(const char* s)
+{
+    return strtod(s, NULL);
+}
+
+int64_t host_strtoll(const char* s, int base)
+{
+    return strtoll(s, NULL, base);
+}
+
+char* host_gcvt(double value, int ndigit, char* buf)
+{
+    return gcvt(value, ndigit, buf);
+}
+
+int host_rand(void)
+{
+    return rand() & 0x7FFF;     // RAND_MAX of the CSDK
+}
+
+void host_srand(uint32_t seed)
+{
+    srand(seed);
+}
+
+// ---------------------------------------------------------------------------
+// file system
+// ---------------------------------------------------------------------------
+
+#define MAX_DIRS          8
+#define SIM_FS_FLASH_SIZE (1024 * 1024)
+#define SIM_FS_TF_SIZE    (1024ULL * 1024 * 1024)
+
+static DIR* g_dirs[MAX_DIRS];
+
+static void HostPath(const char* path, char* out, size_t size)
+{
+    while (*path == '/') path++;
+    snprintf(out, size, "%s/%s", g_simFsRoot, path);
+}
+
+static int32_t FsError(void)
+{
+    return -(errno ? errno : EIO);
+}
+
+int32_t host_fs_open(const char* path, uint32_t flags)
+{
+    char p[1024];
+    HostPath(path, p, sizeof(p));
+    int f = (flags & 3) == SIM_FS_WRONLY ? O_WRONLY : (flags & 3) == SIM_FS_RDWR ? O_RDWR : O_RDONLY;
+    if (flags & SIM_FS_CREAT)  f |= O_CREAT;
+    if (flags & SIM_FS_EXCL)   f |= O_EXCL;
+    if (flags & SIM_FS_TRUNC)  f |= O_TRUNC;
+    if (flags & SIM_FS_APPEND) f |= O_APPEND;
+    int fd = open(p, f | O_CLOEXEC, 0644);
+    return fd < 0 ? FsError() : fd;
+}
+
+int32_t host_fs_close(int32_t fd)
+{
+    return close(fd) < 0 ? FsError() : 0;
+}
+
+int32_t host_fs_read(int32_t fd, uint8_t* buf, uint32_t len)
+{
+    ssize_t n = read(fd, buf, len);
+    return n < 0 ? FsError() : (int32_t)n;
+}
+
+int32_t host_fs_write(int32_t fd, const uint8_t* buf, uint32_t len)
+{
+    ssize_t n = write(fd, buf, len);
+    return n < 0 ? FsError() : (int32_t)n;
+}
+
+int32_t host_fs_flush(int32_t fd)
+{
+    return fsync(fd) < 0 ? FsError() : 0;
+}
+
+int64_t host_fs_seek(int32_t fd, int64_t offset, int whence)
+{
+    off_t pos = lseek(fd, offset, whence == 1 ? SEEK_CUR : whence == 2 ? SEEK_END : SEEK_SET);
+    return pos < 0 ? FsError() : pos;
+}
+
+int64_t host_fs_size(int32_t fd)
+{
+    struct stat st;
+    return fstat(fd, &st) < 0 ? FsError() : st.st_size;
+}
+
+int32_t host_fs_delete(const char* path)
+{
+    char p[1024];
+    HostPath(path, p, sizeof(p));
+    return unlink(p) < 0 ? FsError() : 0;
+}
+
+int32_t host_fs_rename(const char* from, const char* to)
+{
+    char p1[1024], p2[1024];
+    HostPath(from, p1, sizeof(p1));
+    HostPath(to, p2, sizeof(p2));
+    return rename(p1, p2) < 0 ? FsError() : 0;
+}
+
+int32_t host_fs_mkdir(const char* path)
+{
+    char p[1024];
+    HostPath(path, p, sizeof(p));
+    return mkdir(p, 0755) < 0 ? FsError() : 0;
+}
+
+int32_t host_fs_rmdir(const char* path)
+{
+    char p[1024];
+    HostPath(path, p, sizeof(p));
+    return rmdir(p) < 0 ? FsError() : 0;
+}
+
+// bytes used by the files below a host directory, without the TF card mount point
+static uint64_t DirUsage(const char* path, int top)
+{
+    uint64_t used = 0;
+    DIR* d = opendir(path);
+    if (!d) return 0;
+    struct dirent* e;
+    while ((e = readdir(d))) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+        if (top && strcmp(e->d_name, "t") == 0) continue;
+        char p[1024];
+        struct stat st;
+        snprintf(p, sizeof(p), "%s/%s", path, e->d_name);
+        if (stat(p, &st) < 0) continue;
+        used += S_ISDIR(st.st_mode) ? DirUsage(p, 0) : (uint64_t)st.st_size;
+    }
+    closedir(d);
+    return used;
+}
+
+// sizes of the module devices rather than of the host disk
+int32_t host_fs_info(const char* device, uint64_t* total, uint64_t* used)
+{
+    char p[1024];
+    int tf = strcmp(device, "/t") == 0;
+    if (!tf && strcmp(device, "/") != 0) return -ENODEV;
+    HostPath(device, p, sizeof(p));
+    *total = tf ? SIM_FS_TF_SIZE : SIM_FS_FLASH_SIZE;
+    *used  = DirUsage(p, !tf);
+    return 0;
+}
+
+int32_t host_fs_opendir(const char* path)
+{
+    char p[1024];
+    HostPath(path, p, sizeof(p));
+    for (int i = 0; i < MAX_DIRS; ++i) {
+        if (g_dirs[i]) continue;
+        g_dirs[i] = opendir(p);
+        return g_dirs[i] ? i : FsError();
+    }
+    return -EMFILE;
+}
+
+int32_t host_fs_readdir(int32_t dir, char* name, uint32_t size, int* isDir)
+{
+    if (dir < 0 || dir >= MAX_DIRS || !g_dirs[dir]) return 0;
+    struct dirent* e;
+    while ((e = readdir(g_dirs[dir])) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+        snprintf(name, size, "%s", e->d_name);
+        *isDir = e->d_type == DT_DIR;
+        return 1;
+    }
+    return 0;
+}
+
+void host_fs_closedir(int32_t dir)
+{
+    if (dir < 0 || dir >= MAX_DIRS || !g_dirs[dir]) return;
+    closedir(g_dirs[dir]);
+    g_dirs[dir] = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// link model
+// ---------------------------------------------------------------------------
+
+#define LINK_MSS          1400      // TCP segment payload
+#define LINK_HEADER_BYTES 40        // IPv4 + TCP header per packet
+#define LINK_RTO_MS       1000      // initial retransmission timeout
+#define LINK_MAX_RETRIES  5
+
+typedef struct {
+    uint64_t dnsLookups;
+    uint64_t connects;
+    uint64_t connectFailures;
+    uint64_t resets;
+    uint64_t segmentsLost;
+    uint64_t retransmitted;     // payload bytes sent again
+    uint64_t packets;
+    uint64_t payloadSent;
+    uint64_t payloadReceived;
+    uint64_t delayMs;
+} link_stats_t;
+
+static link_stats_t    g_link;
+static pthread_mutex_t g_linkLock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t        g_linkSeed = 1;
+
+#define LINK_COUNT(field, n) __atomic_add_fetch(&g_link.field, (n), __ATOMIC_RELAXED)
+
+static double LinkRandom(void)
+{
+    pthread_mutex_lock(&g_linkLock);
+    g_linkSeed = g_linkSeed * 1103515245u + 12345u;
+    uint32_t r = (g_linkSeed >> 8) & 0xFFFFFF;
+    pthread_mutex_unlock(&g_linkLock);
+    return r / (double)0x1000000;
+}
+
+// one way transfer time of len bytes in the given number of segments, with retransmissions
+static int LinkTransfer(uint32_t len, uint32_t segments, uint32_t* delayMs)
+{
+    double ms = g_simOptions.netLatencyMs + g_simOptions.netJitterMs * LinkRandom();
+    if (g_simOptions.netKbps) ms += len * 8.0 / g_simOptions.netKbps;
+    for (uint32_t i = 0; i < segments; ++i) {
+        uint32_t rto = LINK_RTO_MS;
+        int retries = 0;
+        while (g_simOptions.netLoss > 0 && LinkRandom() < g_simOptions.netLoss) {
+            LINK_COUNT(segmentsLost, 1);
+            LINK_COUNT(packets, 1);
+            LINK_COUNT(retransmitted, len / segments);
+            if (++retries > LINK_MAX_RETRIES) return -1;
+            ms += rto;
+            rto *= 2;
+        }
+    }
+    *delayMs = (uint32_t)ms;
+    return 0;
+}
+
+static void LinkWait(uint32_t ms)
+{
+    if (!ms) return;
+    LINK_COUNT(delayMs, ms);
+    host_sleep_us((uint64_t)ms * 1000);
+}
+
+static int LinkReset(void)
+{
+    if (g_simOptions.netReset <= 0 || LinkRandom() >= g_simOptions.netReset) return 0;
+    LINK_COUNT(resets, 1);
+    return 1;
+}
+
+static uint32_t Segments(uint32_t len)
+{
+    return len ? (len + LINK_MSS - 1) / LINK_MSS : 1;
+}
+
+void host_link_stats(char* buffer, uint32_t size)
+{
+    link_stats_t l;
+    memcpy(&l, &g_link, sizeof(l));
+    uint64_t wire = l.payloadSent + l.payloadReceived + l.retransmitted + l.packets * LINK_HEADER_BYTES;
+    snprintf(buffer, size,
+             "dns_lookups %llu\nconnects %llu\nconnect_failures %llu\nresets %llu\n"
+             "segments_lost %llu\nretransmitted %llu\npackets %llu\npayload_sent %llu\npayload_received %llu\n"
+             "wire_bytes %llu\nlink_delay_ms %llu\n",
+             (unsigned long long)l.dnsLookups, (unsigned long long)l.connects,
+             (unsigned long long)l.connectFailures, (unsigned long long)l.resets,
+             (unsigned long long)l.segmentsLost, (unsigned long long)l.retransmitted,
+             (unsigned long long)l.packets,
+             (unsigned long long)l.payloadSent, (unsigned long long)l.payloadReceived,
+             (unsigned long long)wire, (unsigned long long)l.delayMs);
+}
+
+int host_link_stats_write(const char* path)
+{
+    char buffer[512];
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+    host_link_stats(buffer, sizeof(buffer));
+    fputs(buffer, f);
+    fclose(f);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// sockets
+// ---------------------------------------------------------------------------
+
+static int g_sockets[SIM_SOCKET_MAX + 1];     // host descriptor + 1, 0 = free
+static int g_awaitingReply[SIM_SOCKET_MAX + 1]; // data sent, the reply still has the downlink ahead
+static int g_datagram[SIM_SOCKET_MAX + 1];      // UDP: no handshake, one packet per datagram
+static __thread int g_sockErrno;
+static pthread_mutex_t g_sockLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int HostFd(int32_t s)
+{
+    if (s < 1 || s > SIM_SOCKET_MAX || !g_sockets[s]) {
+        g_sockErrno = EBADF;
+        return -1;
+    }
+    return g_sockets[s] - 1;
+}
+
+static int32_t SockError(void)
+{
+    g_sockErrno = errno;
+    return -1;
+}
+
+int32_t host_sock_errno(void)
+{
+    return g_sockErrno;
+}
+
+int32_t host_sock_open(int datagram)
+{
+    pthread_mutex_lock(&g_sockLock);
+    for (int s = 1; s <= SIM_SOCKET_MAX; ++s) {
+        if (g_sockets[s]) continue;
+        int fd = datagram ? socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP)
+                          : socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (fd >= 0) {
+            g_sockets[s] = fd + 1;
+            g_datagram[s] = datagram;
+        }
+        pthread_mutex_unlock(&g_sockLock);
+        return fd < 0 ? SockError() : s;
+    }
+    pthread_mutex_unlock(&g_sockLock);
+    g_sockErrno = ENFILE;
+    return -1;
+}
+
+int32_t host_sock_connect(int32_t s, uint32_t addr, uint16_t port)
+{
+    int fd = HostFd(s);
+    if (fd < 0) return -1;
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = addr;
+    sa.sin_port = port;
+
+    // UDP only sets the peer
+    if (g_datagram[s]) {
+        g_awaitingReply[s] = 0;
+        return connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0 ? SockError() : 0;
+    }
+
+    // SYN, SYN-ACK, ACK
+    uint32_t up, down;
+    LINK_COUNT(connects, 1);
+    LINK_COUNT(packets, 3);
+    if (LinkTransfer(0, 1, &up) < 0 || LinkTransfer(0, 1, &down) < 0) {
+        LinkWait(LINK_RTO_MS * ((1 << (LINK_MAX_RETRIES + 1)) - 1));
+        LINK_COUNT(connectFailures, 1);
+        g_sockErrno = ETIMEDOUT;
+        return -1;
+    }
+    LinkWait(up + down);
+    if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0) {
+        LINK_COUNT(connectFailures, 1);
+        return SockError();
+    }
+    g_awaitingReply[s] = 0;
+    return 0;
+}
+
+// the bearer lost the connection: the peer sees a reset, the application an error
+static int32_t ResetSocket(int fd)
+{
+    shutdown(fd, SHUT_RDWR);
+    g_sockErrno = ECONNRESET;
+    return -1;
+}
+
+int32_t host_sock_send(int32_t s, const void* data, uint32_t len)
+{
+    int fd = HostFd(s);
+    if (fd < 0) return -1;
+    uint32_t delay;
+    if (g_datagram[s]) {
+        // a lost datagram is not retransmitted, the application times out
+        LINK_COUNT(packets, 1);
+        if (LinkReset() || (g_simOptions.netLoss > 0 && LinkRandom() < g_simOptions.netLoss)) {
+            LINK_COUNT(segmentsLost, 1);
+            return (int32_t)len;
+        }
+        LinkTransfer(len, 0, &delay);
+        LinkWait(delay);
+        ssize_t n = send(fd, data, len, 0);
+        if (n < 0) return SockError();
+        LINK_COUNT(payloadSent, n);
+        g_awaitingReply[s] = 1;
+        return (int32_t)n;
+    }
+    if (LinkReset() || LinkTransfer(len, Segments(len), &delay) < 0) return ResetSocket(fd);
+    LinkWait(delay);
+    ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n < 0) return SockError();
+    LINK_COUNT(payloadSent, n);
+    LINK_COUNT(packets, Segments(n) + 1);      // data and the peer's ACK
+    g_awaitingReply[s] = 1;
+    return (int32_t)n;
+}
+
+// delivers the reply of the peer over the downlink, returns 0 if it did not arrive in time
+static int AwaitReply(int32_t s, int64_t timeoutUs)
+{
+    if (!g_awaitingReply[s]) return 1;
+    uint32_t delay;
+    if (LinkTransfer(LINK_MSS, 1, &delay) < 0) delay = UINT32_MAX;
+    if (timeoutUs >= 0 && (uint64_t)delay * 1000 > (uint64_t)timeoutUs) {
+        LinkWait((uint32_t)(timeoutUs / 1000));
+        return 0;
+    }
+    LinkWait(delay);
+    g_awaitingReply[s] = 0;
+    return 1;
+}
+
+int32_t host_sock_recv(int32_t s, void* data, uint32_t len, int nonblock)
+{
+    int fd = HostFd(s);
+    if (fd < 0) return -1;
+    if (!nonblock) AwaitReply(s, -1);
+    if (LinkReset()) return ResetSocket(fd);
+    ssize_t n = recv(fd, data, len, nonblock ? MSG_DONTWAIT : 0);
+    if (n < 0) return SockError();
+    LINK_COUNT(payloadReceived, n);
+    if (n > 0) LINK_COUNT(packets, g_datagram[s] ? 1 : Segments(n) + 1);
+    return (int32_t)n;
+}
+
+int32_t host_sock_close(int32_t s)
+{
+    int fd = HostFd(s);
+    if (fd < 0) return -1;
+    pthread_mutex_lock(&g_sockLock);
+    g_sockets[s] = 0;
+    g_awaitingReply[s] = 0;
+    if (!g_datagram[s]) LINK_COUNT(packets, 4); // FIN and ACK both ways
+    g_datagram[s] = 0;
+    pthread_mutex_unlock(&g_sockLock);
+    return close(fd) < 0 ? SockError() : 0;
+}
+
+int32_t host_sock_shutdown(int32_t s, int how)
+{
+    int fd = HostFd(s);
+    if (fd < 0) return -1;
+    return shutdown(fd, how) < 0 ? SockError() : 0;
+}
+
+int32_t host_sock_select(uint32_t* readSet, uint32_t* writeSet, uint32_t* exceptSet, int64_t timeoutUs)
+{
+    uint32_t* sets[3] = { readSet, writeSet, exceptSet };
+    fd_set fds[3];
+    int maxfd = -1;
+    for (int k = 0; k < 3; ++k) {
+        FD_ZERO(&fds[k]);
+        if (!sets[k]) continue;
+        for (int s = 1; s <= SIM_SOCKET_MAX; ++s) {
+            if (!(*sets[k] & (1u << s))) continue;
+            int fd = HostFd(s);
+            if (fd < 0) return -1;
+            FD_SET(fd, &fds[k]);
+            if (fd > maxfd) maxfd = fd;
+        }
+    }
+    // a reply still on the downlink arrives after the link delay, or not before the timeout
+    if (readSet) {
+        for (int s = 1; s <= SIM_SOCKET_MAX; ++s) {
+            if (!(*readSet & (1u << s)) || !g_awaitingReply[s]) continue;
+            uint64_t start = host_uptime_us();
+            if (!AwaitReply(s, timeoutUs)) {
+                *readSet = 0;
+                if (writeSet) *writeSet = 0;
+                if (exceptSet) *exceptSet = 0;
+                return 0;
+            }
+            if (timeoutUs >= 0) {
+                int64_t spent = (int64_t)(host_uptime_us() - start);
+                timeoutUs = spent < timeoutUs ? timeoutUs - spent : 0;
+            }
+        }
+    }
+
+    struct timeval tv, *ptv = NULL;
+    if (timeoutUs >= 0) {
+        tv.tv_sec = timeoutUs / 1000000;
+        tv.tv_usec = timeoutUs % 1000000;
+        ptv = &tv;
+    }
+    int n = select(maxfd + 1, &fds[0], &fds[1], &fds[2], ptv);
+    if (n < 0) return SockError();
+    for (int k = 0; k < 3; ++k) {
+        if (!sets[k]) continue;
+        uint32_t out = 0;
+        for (int s = 1; s <= SIM_SOCKET_MAX; ++s)
+            if ((*sets[k] & (1u << s)) && FD_ISSET(g_sockets[s] - 1, &fds[k])) out |= 1u << s;
+        *sets[k] = out;
+    }
+    return n;
+}
+
+int32_t host_dns_resolve(const char* name, uint32_t* addr)
+{
+    uint32_t up, down;
+    LINK_COUNT(dnsLookups, 1);
+    LINK_COUNT(packets, 2);
+    if (LinkTransfer(64, 1, &up) < 0 || LinkTransfer(128, 1, &down) < 0) return -1;
+    LinkWait(up + down);
+
+    const char* map = g_simOptions.dnsMap;
+    size_t nameLen = strlen(name);
+    if (map && strncmp(map, name, nameLen) == 0 && map[nameLen] == '=')
+        return inet_pton(AF_INET, map + nameLen + 1, addr) == 1 ? 0 : -1;
+
+    struct addrinfo hints, *res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(name, NULL, &hints, &res) != 0 || !res) return -1;
+    *addr = ((struct sockaddr_in*)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+    return 0;
+}
+
+int32_t host_link_exchange(uint32_t sent, uint32_t received)
+{
+    // handshake, request, response, close
+    uint32_t up, down, request, response;
+    LINK_COUNT(connects, 1);
+    LINK_COUNT(packets, 3 + Segments(sent) + Segments(received) + 4);
+    if (LinkTransfer(0, 1, &up) < 0 || LinkTransfer(0, 1, &down) < 0 ||
+        LinkTransfer(sent, Segments(sent), &request) < 0 ||
+        LinkTransfer(received, Segments(received), &response) < 0) {
+        LINK_COUNT(connectFailures, 1);
+        return -1;
+    }
+    LINK_COUNT(payloadSent, sent);
+    LINK_COUNT(payloadReceived, received);
+    LinkWait(up + down + request + response);
+    return 0;
+}
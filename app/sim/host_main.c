@@ -0,0 +1,456 @@
+/*
+ * Host CSDK simulator - command line, console input, event script and NMEA replay.
+ *
+ * Runs the unmodified application (app_Main) as a Linux process:
+ *
+ *   ./a9g_sim --nmea track.nmea --script network.txt
+ *
+ * UART1 is mapped to stdin/stdout. Console lines starting with '!' and the lines of the
+ * script file are simulator commands, e.g. "!detach" or "!sms +123456789 status".
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <execinfo.h>
+#include <sys/stat.h>
+
+#include "sim_host.h"
+
+static const char* g_nmeaFile     = NULL;
+static uint32_t    g_nmeaInterval = 1000;
+static double      g_speed        = 1.0;
+static int         g_nmeaLoop     = 0;
+static int         g_nmeaNow      = 0;
+static volatile int g_gpsPaused   = 0;
+static const char* g_scriptFile   = NULL;
+static double      g_duration     = 0;
+static int         g_readStdin    = 1;
+
+// ---------------------------------------------------------------------------
+// simulator commands (console '!' lines and script)
+// ---------------------------------------------------------------------------
+
+static void Command(const char* line)
+{
+    while (*line == ' ' || *line == '\t') line++;
+    if (*line == '\0' || *line == '#') return;
+
+    if (strncmp(line, "uart ", 5) == 0) {
+        char buf[512];
+        int n = snprintf(buf, sizeof(buf), "%s\r\n", line + 5);
+        sim_uart_rx((const uint8_t*)buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf) - 1);
+    } else if (strcmp(line, "gps pause") == 0) {
+        g_gpsPaused = 1;
+        host_log("GPS output paused");
+    } else if (strcmp(line, "gps resume") == 0) {
+        g_gpsPaused = 0;
+        host_log("GPS output resumed");
+    } else if (strcmp(line, "tasks") == 0) {
+        char report[1024];
+        host_task_report(report, sizeof(report));
+        host_log("tasks:\n%s", report);
+    } else if (strcmp(line, "netstats") == 0) {
+        char stats[512];
+        host_link_stats(stats, sizeof(stats));
+        host_log("link:\n%s", stats);
+    } else if (strncmp(line, "quit", 4) == 0) {
+        host_shutdown(atoi(line + 4));
+    } else {
+        char reply[256] = "";
+        if (!sim_modem_command(line, reply, sizeof(reply)))
+            host_log("unknown command: %s", line);
+        else if (reply[0])
+            host_log("%s", reply);
+    }
+}
+
+static void* StdinThread(void* arg)
+{
+    (void)arg;
+    char line[1024];
+    while (fgets(line, sizeof(line), stdin)) {
+        if (line[0] == '!') {
+            line[strcspn(line, "\r\n")] = '\0';
+            Command(line + 1);
+            continue;
+        }
+        size_t len = strlen(line);
+        // the terminal sends "\n", the module console expects "\r\n"
+        if (len > 0 && line[len - 1] == '\n' && (len < 2 || line[len - 2] != '\r') && len + 1 < sizeof(line)) {
+            line[len - 1] = '\r';
+            line[len++] = '\n';
+            line[len] = '\0';
+        }
+        sim_uart_rx((const uint8_t*)line, len);
+    }
+    return NULL;
+}
+
+/**
+ * Script lines are "<seconds since start> <command>", in chronological order.
+ * Runs on the main thread, which also drives the modem model.
+ */
+static void RunScript(void)
+{
+    FILE* f = NULL;
+    if (g_scriptFile && !(f = fopen(g_scriptFile, "r"))) {
+        host_log("cannot open script %s: %s", g_scriptFile, strerror(errno));
+        exit(1);
+    }
+
+    char line[1024];
+    double at = -1;
+    const char* cmd = NULL;
+    uint64_t lastTick = 0;
+    while (1) {
+        if (f && at < 0) {
+            if (fgets(line, sizeof(line), f)) {
+                line[strcspn(line, "\r\n")] = '\0';
+                char* end;
+                at = strtod(line, &end);
+                if (end == line) {          // comment or empty line
+                    at = -1;
+                    continue;
+                }
+                cmd = end;
+            } else {
+                fclose(f);
+                f = NULL;
+            }
+        }
+
+        double now = host_uptime_us() / 1e6;
+        if (at >= 0 && now >= at / g_speed) {
+            Command(cmd);
+            at = -1;
+            continue;
+        }
+        if (g_duration > 0 && now >= g_duration)
+            host_shutdown(0);
+        if (host_uptime_us() - lastTick >= 1000000) {
+            lastTick = host_uptime_us();
+            sim_modem_tick();
+        }
+        host_sleep_us(10000);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// NMEA replay
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char*  data;
+    size_t len;
+} epoch_t;
+
+/**
+ * Splits the log into epochs. The GPS library parses a frame when it sees the VTG
+ * sentence, which the GPS chip sends last, so an epoch ends after a VTG line.
+ * Line endings are normalized to "\r\n".
+ */
+static epoch_t* LoadNmea(const char* path, size_t* count)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        host_log("cannot open NMEA file %s: %s", path, strerror(errno));
+        exit(1);
+    }
+    size_t cap = 1024, n = 0;
+    epoch_t* epochs = calloc(cap, sizeof(epoch_t));
+    char* buf = NULL;
+    size_t len = 0, bufCap = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* s = strchr(line, '$');
+        if (!s) continue;
+        size_t l = strlen(s);
+        if (len + l + 3 > bufCap) {
+            bufCap = (len + l + 3) * 2;
+            buf = realloc(buf, bufCap);
+        }
+        memcpy(buf + len, s, l);
+        len += l;
+        buf[len++] = '\r';
+        buf[len++] = '\n';
+        if (strstr(s, "VTG") || len > 4096) {
+            if (n == cap) epochs = realloc(epochs, (cap *= 2) * sizeof(epoch_t));
+            epochs[n].data = buf;
+            epochs[n].len = len;
+            n++;
+            buf = NULL;
+            len = bufCap = 0;
+        }
+    }
+    free(buf);      // trailing lines without VTG would never be parsed
+    fclose(f);
+    *count = n;
+    return epochs;
+}
+
+static int IsTalker(const char* sentence, const char* type)
+{
+    return strncmp(sentence + 3, type, 3) == 0 && sentence[6] == ',';
+}
+
+/**
+ * Replaces the time and date fields of the sentences with the current UTC time and
+ * recomputes the checksums, so the fixes of a recorded log look fresh (--nmea-now).
+ * The result is written to out, which must hold len + 64 bytes per sentence.
+ */
+static size_t RestampEpoch(const char* in, size_t len, char* out)
+{
+    int64_t nowUs = host_unix_time_us();
+    int year, month, day, hour, minute, second, wday, yday;
+    host_gmtime(nowUs / 1000000, &year, &month, &day, &hour, &minute, &second, &wday, &yday);
+    char hms[16], ddmmyy[8];
+    snprintf(hms, sizeof(hms), "%02d%02d%02d.%02d", hour, minute, second, (int)(nowUs % 1000000 / 10000));
+    snprintf(ddmmyy, sizeof(ddmmyy), "%02d%02d%02d", day, month, year % 100);
+
+    size_t n = 0;
+    const char* end = in + len;
+    while (in < end) {
+        const char* eol = memchr(in, '\n', end - in);
+        const char* next = eol ? eol + 1 : end;
+        const char* star = memchr(in, '*', next - in);
+        if (*in != '$' || !star || star - in < 7) {
+            memcpy(out + n, in, next - in);
+            n += next - in;
+            in = next;
+            continue;
+        }
+        // time is field 1 for GGA, RMC, GST and ZDA, field 5 for GLL;
+        // RMC has the date in field 9, ZDA day, month and year in fields 2..4
+        int timeField = IsTalker(in, "GLL") ? 5 :
+                        (IsTalker(in, "GGA") || IsTalker(in, "RMC") || IsTalker(in, "GST") || IsTalker(in, "ZDA")) ? 1 : -1;
+        size_t start = n;
+        int field = 0;
+        for (const char* p = in; p < star; ) {
+            const char* comma = memchr(p, ',', star - p);
+            const char* fieldEnd = comma ? comma : star;
+            char zda[8];
+            const char* value = NULL;
+            if (field == timeField && fieldEnd > p) value = hms;
+            else if (IsTalker(in, "RMC") && field == 9 && fieldEnd > p) value = ddmmyy;
+            else if (IsTalker(in, "ZDA") && field >= 2 && field <= 4 && fieldEnd > p) {
+                snprintf(zda, sizeof(zda), field == 4 ? "%04d" : "%02d", field == 2 ? day : field == 3 ? month : year);
+                value = zda;
+            }
+            if (value) {
+                size_t l = strlen(value);
+                memcpy(out + n, value, l);
+                n += l;
+            } else {
+                memcpy(out + n, p, fieldEnd - p);
+                n += fieldEnd - p;
+            }
+            if (!comma) break;
+            out[n++] = ',';
+            p = comma + 1;
+            field++;
+        }
+        uint8_t sum = 0;
+        for (size_t i = start + 1; i < n; ++i) sum ^= (uint8_t)out[i];
+        n += sprintf(out + n, "*%02X\r\n", sum);
+        in = next;
+    }
+    return n;
+}
+
+static void* NmeaThread(void* arg)
+{
+    (void)arg;
+    size_t count;
+    epoch_t* epochs = LoadNmea(g_nmeaFile, &count);
+    host_log("NMEA replay: %zu epochs from %s", count, g_nmeaFile);
+    if (count == 0) return NULL;
+
+    size_t maxLen = 0;
+    for (size_t i = 0; i < count; ++i)
+        if (epochs[i].len > maxLen) maxLen = epochs[i].len;
+    char* stamped = g_nmeaNow ? malloc(maxLen * 2 + 64) : NULL;
+
+    uint64_t period = (uint64_t)(g_nmeaInterval * 1000 / g_speed);
+    uint64_t next = host_uptime_us();
+    size_t i = 0;
+    while (1) {
+        uint64_t now = host_uptime_us();
+        if (now < next) host_sleep_us(next - now);
+        next += period;
+        if (!sim_gps_is_open() || g_gpsPaused) continue;
+
+        if (stamped)
+            sim_gps_rx((const uint8_t*)stamped, RestampEpoch(epochs[i].data, epochs[i].len, stamped));
+        else
+            sim_gps_rx((const uint8_t*)epochs[i].data, epochs[i].len);
+        if (++i == count) {
+            if (!g_nmeaLoop) break;
+            i = 0;
+        }
+    }
+    host_log("NMEA replay finished");
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// main
+// ---------------------------------------------------------------------------
+
+static void CrashHandler(int sig)
+{
+    static const char msg[] =
+        "\n[sim] crash - a NULL CSDK interface entry means the application called an SDK "
+        "function the simulator does not implement (see sdk_*.c)\n";
+    (void)write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    void* frames[32];
+    int n = backtrace(frames, 32);
+    backtrace_symbols_fd(frames, n, STDERR_FILENO);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void Usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --fs DIR              module file system root (default sim_fs)\n"
+        "  --nmea FILE           replay an NMEA log as GPS output\n"
+        "  --nmea-interval MS    time between epochs (default 1000)\n"
+        "  --nmea-loop           restart the NMEA log at the end\n"
+        "  --nmea-now            replace the NMEA times and dates with the current UTC time\n"
+        "  --speed X             replay NMEA and the script X times faster\n"
+        "  --script FILE         timed simulator commands, \"<seconds> <command>\"\n"
+        "  --duration S          exit after S seconds\n"
+        "  --no-stdin            do not read the console from stdin\n"
+        "  --no-network          do not register to the network at boot\n"
+        "  --reject-apn APN      APN refused by the network (default dummy_apn)\n"
+        "  --attach-delay MS     GPRS attach time (default 500)\n"
+        "  --activate-delay MS   PDP context activation time (default 1000)\n"
+        "  --imei IMEI           module IMEI\n"
+        "  --battery PERCENT     battery level (default 87)\n"
+        "  --sms-log FILE        append the sent SMS to FILE\n"
+        "  --net-latency MS      one way latency of the connections (default 0)\n"
+        "  --net-jitter MS       random extra latency up to MS\n"
+        "  --net-kbps KBPS       link bandwidth (default unlimited)\n"
+        "  --net-loss P          probability of losing a TCP segment, retransmitted after an RTO,\n"
+        "                        or a UDP datagram\n"
+        "  --net-reset P         probability of a connection reset per send/recv\n"
+        "  --net-stats FILE      write the link counters to FILE at exit\n"
+        "  --power-log FILE      record the power states for tool/energy_model.py\n"
+        "  --lbs LAT,LON         position returned by the LBS service (default: LBS fails)\n"
+        "  --dns NAME=ADDR       resolve NAME to ADDR, e.g. the AGPS server to a local one\n"
+        "  --gps-ack-delay MS    time the GPS takes to answer a command (default 0)\n"
+        "  -v, --verbose         print the SDK trace output\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    enum { O_FS = 256, O_NMEA, O_NMEA_INTERVAL, O_NMEA_LOOP, O_SPEED, O_SCRIPT, O_DURATION,
+           O_NO_STDIN, O_NO_NETWORK, O_REJECT_APN, O_ATTACH_DELAY, O_ACTIVATE_DELAY, O_IMEI,
+           O_BATTERY, O_SMS_LOG, O_NMEA_NOW, O_NET_LATENCY, O_NET_JITTER, O_NET_KBPS, O_NET_LOSS,
+           O_NET_RESET, O_NET_STATS, O_POWER_LOG, O_LBS, O_DNS, O_GPS_ACK_DELAY };
+    static const struct option options[] = {
+        { "fs",             required_argument, NULL, O_FS },
+        { "nmea",           required_argument, NULL, O_NMEA },
+        { "nmea-interval",  required_argument, NULL, O_NMEA_INTERVAL },
+        { "nmea-loop",      no_argument,       NULL, O_NMEA_LOOP },
+        { "nmea-now",       no_argument,       NULL, O_NMEA_NOW },
+        { "speed",          required_argument, NULL, O_SPEED },
+        { "script",         required_argument, NULL, O_SCRIPT },
+        { "duration",       required_argument, NULL, O_DURATION },
+        { "no-stdin",       no_argument,       NULL, O_NO_STDIN },
+        { "no-network",     no_argument,       NULL, O_NO_NETWORK },
+        { "reject-apn",     required_argument, NULL, O_REJECT_APN },
+        { "attach-delay",   required_argument, NULL, O_ATTACH_DELAY },
+        { "activate-delay", required_argument, NULL, O_ACTIVATE_DELAY },
+        { "imei",           required_argument, NULL, O_IMEI },
+        { "battery",        required_argument, NULL, O_BATTERY },
+        { "sms-log",        required_argument, NULL, O_SMS_LOG },
+        { "net-latency",    required_argument, NULL, O_NET_LATENCY },
+        { "net-jitter",     required_argument, NULL, O_NET_JITTER },
+        { "net-kbps",       required_argument, NULL, O_NET_KBPS },
+        { "net-loss",       required_argument, NULL, O_NET_LOSS },
+        { "net-reset",      required_argument, NULL, O_NET_RESET },
+        { "net-stats",      required_argument, NULL, O_NET_STATS },
+        { "power-log",      required_argument, NULL, O_POWER_LOG },
+        { "lbs",            required_argument, NULL, O_LBS },
+        { "dns",            required_argument, NULL, O_DNS },
+        { "gps-ack-delay",  required_argument, NULL, O_GPS_ACK_DELAY },
+        { "verbose",        no_argument,       NULL, 'v' },
+        { "help",           no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    g_simArgv = argv;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "vh", options, NULL)) != -1) {
+        switch (opt) {
+            case O_FS:             g_simFsRoot = optarg; break;
+            case O_NMEA:           g_nmeaFile = optarg; break;
+            case O_NMEA_INTERVAL:  g_nmeaInterval = atoi(optarg); break;
+            case O_NMEA_LOOP:      g_nmeaLoop = 1; break;
+            case O_NMEA_NOW:       g_nmeaNow = 1; break;
+            case O_SPEED:          g_speed = atof(optarg); break;
+            case O_SCRIPT:         g_scriptFile = optarg; break;
+            case O_DURATION:       g_duration = atof(optarg); break;
+            case O_NO_STDIN:       g_readStdin = 0; break;
+            case O_NO_NETWORK:     g_simOptions.noNetwork = 1; break;
+            case O_REJECT_APN:     g_simOptions.apnReject = optarg; break;
+            case O_ATTACH_DELAY:   g_simOptions.attachDelayMs = atoi(optarg); break;
+            case O_ACTIVATE_DELAY: g_simOptions.activateDelayMs = atoi(optarg); break;
+            case O_IMEI:           g_simOptions.imei = optarg; break;
+            case O_BATTERY:        g_simOptions.batteryPercent = atoi(optarg); break;
+            case O_SMS_LOG:        g_simOptions.smsLog = optarg; break;
+            case O_NET_LATENCY:    g_simOptions.netLatencyMs = atoi(optarg); break;
+            case O_NET_JITTER:     g_simOptions.netJitterMs = atoi(optarg); break;
+            case O_NET_KBPS:       g_simOptions.netKbps = atoi(optarg); break;
+            case O_NET_LOSS:       g_simOptions.netLoss = atof(optarg); break;
+            case O_NET_RESET:      g_simOptions.netReset = atof(optarg); break;
+            case O_NET_STATS:      g_simOptions.netStats = optarg; break;
+            case O_POWER_LOG:      g_simOptions.powerLog = optarg; break;
+            case O_LBS:
+                g_simOptions.lbsSet = sscanf(optarg, "%lf,%lf", &g_simOptions.lbsLatitude,
+                                             &g_simOptions.lbsLongitude) == 2;
+                break;
+            case O_DNS:            g_simOptions.dnsMap = optarg; break;
+            case O_GPS_ACK_DELAY:  g_simOptions.gpsAckDelayMs = atoi(optarg); break;
+            case 'v':              g_simOptions.verbose = 1; break;
+            default:
+                Usage(argv[0]);
+                return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (g_speed <= 0) g_speed = 1.0;
+
+    // the module has the internal flash at "/" and the TF card at "/t"
+    char path[1024];
+    mkdir(g_simFsRoot, 0755);
+    snprintf(path, sizeof(path), "%s/t", g_simFsRoot);
+    mkdir(path, 0755);
+
+    signal(SIGSEGV, CrashHandler);
+    signal(SIGBUS, CrashHandler);
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOFBF, 64 * 1024);
+
+    sim_sdk_boot();
+
+    pthread_t thread;
+    if (g_readStdin) {
+        pthread_create(&thread, NULL, StdinThread, NULL);
+        pthread_detach(thread);
+    }
+    if (g_nmeaFile) {
+        pthread_create(&thread, NULL, NmeaThread, NULL);
+        pthread_detach(thread);
+    }
+    RunScript();
+    return 0;
+}
@@ -0,0 +1,732 @@
+/*
+ * Host CSDK simulator - tasks, event queues, callback timers, mutexes, semaphores,
+ * memory and time on top of POSIX threads.
+ *
+ * Every CSDK task is a thread with an event queue. Callback timers do not run on a
+ * timer thread: when a timer expires its callback is queued to the target task and
+ * executed inside that task's OS_WaitEvent(), as on the module.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+
+#include "sim_host.h"
+
+#define MAX_TASKS        32
+#define MAX_MUTEXES      64
+#define MAX_SEMAPHORES   64
+#define MAX_TIMERS       64
+
+#define MIN_THREAD_STACK (256 * 1024)
+
+#define TASK_HANDLE_BASE  0x100
+#define MUTEX_HANDLE_BASE 0x200
+#define SEM_HANDLE_BASE   0x300
+
+typedef struct queue_item {
+    struct queue_item* next;
+    void*      event;        // NULL for a timer callback
+    sim_func_t callback;
+    void*      param;
+} queue_item_t;
+
+typedef struct {
+    int             used;
+    int             started;
+    pthread_t       thread;
+    char            name[32];
+    sim_func_t      entry;
+    void*           param;
+    uint32_t        stackSize;
+    uint32_t        priority;
+    void*           stack;        // below 4 GB, so the 32 bit stackTop of the CSDK holds it
+    size_t          stackBytes;
+    uintptr_t       stackTop;
+    pthread_cond_t  cond;
+    queue_item_t*   head;
+    queue_item_t*   tail;
+} task_t;
+
+typedef struct {
+    int        used;
+    uint32_t   task;
+    sim_func_t callback;
+    void*      param;
+    uint64_t   due;          // host_uptime_us()
+} timer_t_;
+
+typedef struct {
+    int             used;
+    uint32_t        count;
+    pthread_cond_t  cond;
+} sem_t_;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;  // tasks, queues, timers, semaphores
+static pthread_cond_t  g_timerCond;
+static task_t          g_tasks[MAX_TASKS];
+static timer_t_        g_timers[MAX_TIMERS];
+static sem_t_          g_sems[MAX_SEMAPHORES];
+static uint32_t        g_semNext = 0;
+static pthread_mutex_t g_mutexes[MAX_MUTEXES];
+static int             g_mutexUsed[MAX_MUTEXES];
+static int             g_tasksHeld = 1;
+static pthread_key_t   g_taskKey;
+static pthread_once_t  g_once = PTHREAD_ONCE_INIT;
+static struct timespec g_startTime;
+static int64_t         g_timeOffsetUs = 0;
+static uint64_t        g_heapUsed = 0;
+static uint64_t        g_heapPeak = 0;
+
+static void StartTimerThread(void);
+
+static void Init(void)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_timerCond, &attr);
+    for (int i = 0; i < MAX_TASKS; ++i)
+        pthread_cond_init(&g_tasks[i].cond, &attr);
+    for (int i = 0; i < MAX_SEMAPHORES; ++i)
+        pthread_cond_init(&g_sems[i].cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_key_create(&g_taskKey, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &g_startTime);
+    StartTimerThread();
+}
+
+static inline void EnsureInit(void)
+{
+    pthread_once(&g_once, Init);
+}
+
+static void DeadlineIn(struct timespec* ts, uint32_t timeoutMs)
+{
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec  += timeoutMs / 1000;
+    ts->tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// time
+// ---------------------------------------------------------------------------
+
+uint64_t host_uptime_us(void)
+{
+    EnsureInit();
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - g_startTime.tv_sec) * 1000000ULL +
+           (now.tv_nsec - g_startTime.tv_nsec) / 1000;
+}
+
+int64_t host_unix_time_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec + g_timeOffsetUs;
+}
+
+void host_set_unix_time(int64_t seconds)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    g_timeOffsetUs = (seconds - (int64_t)tv.tv_sec) * 1000000LL - tv.tv_usec;
+}
+
+int64_t host_timegm(int year, int month, int day, int hour, int minute, int second)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = year - 1900;
+    tm.tm_mon  = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min  = minute;
+    tm.tm_sec  = second;
+    return (int64_t)timegm(&tm);
+}
+
+void host_gmtime(int64_t t, int* year, int* month, int* day, int* hour, int* minute, int* second, int* wday, int* yday)
+{
+    time_t tt = (time_t)t;
+    struct tm tm;
+    gmtime_r(&tt, &tm);
+    *year = tm.tm_year + 1900;
+    *month = tm.tm_mon + 1;
+    *day = tm.tm_mday;
+    *hour = tm.tm_hour;
+    *minute = tm.tm_min;
+    *second = tm.tm_sec;
+    if (wday) *wday = tm.tm_wday;
+    if (yday) *yday = tm.tm_yday;
+}
+
+void host_sleep_us(uint64_t us)
+{
+    struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
+}
+
+// ---------------------------------------------------------------------------
+// tasks
+// ---------------------------------------------------------------------------
+
+static task_t* GetTask(uint32_t handle)
+{
+    if (handle < TASK_HANDLE_BASE || handle >= TASK_HANDLE_BASE + MAX_TASKS) return NULL;
+    task_t* t = &g_tasks[handle - TASK_HANDLE_BASE];
+    return t->used ? t : NULL;
+}
+
+static void* TaskThread(void* arg)
+{
+    task_t* t = arg;
+    pthread_setspecific(g_taskKey, t);
+    pthread_setname_np(pthread_self(), t->name);
+    t->entry(t->param);
+    host_log("task '%s' returned", t->name);
+    return NULL;
+}
+
+// called with g_lock held
+static void StartTask(task_t* t)
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, t->stack, t->stackBytes);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&t->thread, &attr, TaskThread, t) != 0) {
+        host_log("cannot start task '%s'", t->name);
+        abort();
+    }
+    pthread_attr_destroy(&attr);
+    t->started = 1;
+}
+
+uint32_t host_task_create(sim_func_t entry, void* param, const char* name, uint32_t stackSize, uint32_t priority)
+{
+    EnsureInit();
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < MAX_TASKS; ++i) {
+        task_t* t = &g_tasks[i];
+        if (t->used) continue;
+        t->used = 1;
+        t->started = 0;
+        snprintf(t->name, sizeof(t->name), "%s", name ? name : "task");
+        t->entry = entry;
+        t->param = param;
+        t->stackSize = stackSize;
+        t->priority = priority;
+        // known before the task runs, its creator may ask OS_GetTaskInfo() right away
+        if (!t->stack) {
+            t->stackBytes = stackSize < MIN_THREAD_STACK ? MIN_THREAD_STACK : stackSize;
+            t->stack = mmap(NULL, t->stackBytes, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_32BIT, -1, 0);
+            if (t->stack == MAP_FAILED) {
+                host_log("cannot allocate the stack of task '%s'", t->name);
+                abort();
+            }
+        }
+        t->stackTop = (uintptr_t)t->stack + t->stackBytes;
+        t->head = t->tail = NULL;
+        if (!g_tasksHeld) StartTask(t);
+        pthread_mutex_unlock(&g_lock);
+        return TASK_HANDLE_BASE + i;
+    }
+    pthread_mutex_unlock(&g_lock);
+    host_log("too many tasks, cannot create '%s'", name);
+    return 0;
+}
+
+void host_start_tasks(void)
+{
+    EnsureInit();
+    pthread_mutex_lock(&g_lock);
+    g_tasksHeld = 0;
+    for (int i = 0; i < MAX_TASKS; ++i)
+        if (g_tasks[i].used && !g_tasks[i].started) StartTask(&g_tasks[i]);
+    pthread_mutex_unlock(&g_lock);
+}
+
+const char* host_task_info(uint32_t task, uint32_t* stackSize, uint32_t* priority, uint32_t* stackTop)
+{
+    task_t* t = GetTask(task);
+    if (!t) return NULL;
+    *stackSize = t->stackSize;
+    *priority = t->priority;
+    *stackTop = (uint32_t)t->stackTop;
+    return t->name;
+}
+
+void host_task_report(char* buffer, uint32_t size)
+{
+    uint32_t len = snprintf(buffer, size, "%-16s %4s %8s %10s", "task", "prio", "stack", "cpu ms");
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < MAX_TASKS && len < size; ++i) {
+        task_t* t = &g_tasks[i];
+        if (!t->used || !t->started) continue;
+        clockid_t clock;
+        struct timespec cpu = { 0, 0 };
+        if (pthread_getcpuclockid(t->thread, &clock) == 0) clock_gettime(clock, &cpu);
+        len += snprintf(buffer + len, size - len, "\n%-16.16s %4u %8u %10.1f", t->name, t->priority,
+                        t->stackSize, cpu.tv_sec * 1e3 + cpu.tv_nsec / 1e6);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void host_task_woken(void)
+{
+    task_t* t = pthread_getspecific(g_taskKey);
+    if (t) host_power_wake(t->name);
+}
+
+uint32_t host_task_current(void)
+{
+    EnsureInit();
+    task_t* t = pthread_getspecific(g_taskKey);
+    return t ? TASK_HANDLE_BASE + (uint32_t)(t - g_tasks) : 0;
+}
+
+// called with g_lock held
+static int Enqueue(task_t* t, void* event, sim_func_t callback, void* param, int urgent)
+{
+    queue_item_t* item = malloc(sizeof(*item));
+    if (!item) return 0;
+    item->event = event;
+    item->callback = callback;
+    item->param = param;
+    item->next = NULL;
+    if (urgent) {
+        item->next = t->head;
+        t->head = item;
+        if (!t->tail) t->tail = item;
+    } else {
+        if (t->tail) t->tail->next = item;
+        else t->head = item;
+        t->tail = item;
+    }
+    pthread_cond_signal(&t->cond);
+    return 1;
+}
+
+int host_task_post(uint32_t task, void* event, int urgent)
+{
+    EnsureInit();
+    pthread_mutex_lock(&g_lock);
+    task_t* t = GetTask(task);
+    int ret = t ? Enqueue(t, event, NULL, NULL, urgent) : 0;
+    pthread_mutex_unlock(&g_lock);
+    return ret;
+}
+
+int host_task_wait(uint32_t task, void** event, uint32_t timeoutMs)
+{
+    EnsureInit();
+    struct timespec deadline;
+    if (timeoutMs != SIM_WAIT_FOREVER) DeadlineIn(&deadline, timeoutMs);
+
+    pthread_mutex_lock(&g_lock);
+    task_t* t = GetTask(task);
+    if (!t) {
+        pthread_mutex_unlock(&g_lock);
+        return 0;
+    }
+    while (1) {
+        while (!t->head) {
+            if (timeoutMs == SIM_WAIT_FOREVER) {
+                pthread_cond_wait(&t->cond, &g_lock);
+            } else if (pthread_cond_timedwait(&t->cond, &g_lock, &deadline) == ETIMEDOUT) {
+                pthread_mutex_unlock(&g_lock);
+                host_task_woken();
+                return 0;
+            }
+        }
+        queue_item_t* item = t->head;
+        t->head = item->next;
+        if (!t->head) t->tail = NULL;
+        pthread_mutex_unlock(&g_lock);
+        host_task_woken();
+
+        if (item->event) {
+            *event = item->event;
+            free(item);
+            return 1;
+        }
+        // timer callbacks run in the context of the waiting task
+        item->callback(item->param);
+        free(item);
+        pthread_mutex_lock(&g_lock);
+    }
+}
+
+int host_task_pending(uint32_t task)
+{
+    pthread_mutex_lock(&g_lock);
+    task_t* t = GetTask(task);
+    int ret = t && t->head;
+    pthread_mutex_unlock(&g_lock);
+    return ret;
+}
+
+void host_task_flush(uint32_t task)
+{
+    pthread_mutex_lock(&g_lock);
+    task_t* t = GetTask(task);
+    if (t) {
+        queue_item_t** link = &t->head;
+        t->tail = NULL;
+        while (*link) {
+            queue_item_t* item = *link;
+            if (item->event) {
+                *link = item->next;
+                free(item);
+            } else {
+                t->tail = item;
+                link = &item->next;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+// ---------------------------------------------------------------------------
+// callback timers
+// ---------------------------------------------------------------------------
+
+static void* TimerThread(void* arg)
+{
+    (void)arg;
+    pthread_setname_np(pthread_self(), "sim timers");
+    pthread_mutex_lock(&g_lock);
+    while (1) {
+        uint64_t now = host_uptime_us();
+        uint64_t next = UINT64_MAX;
+        for (int i = 0; i < MAX_TIMERS; ++i) {
+            timer_t_* tm = &g_timers[i];
+            if (!tm->used) continue;
+            if (tm->due <= now) {
+                task_t* t = GetTask(tm->task);
+                if (t) Enqueue(t, NULL, tm->callback, tm->param, 0);
+                tm->used = 0;
+            } else if (tm->due < next) {
+                next = tm->due;
+            }
+        }
+        if (next == UINT64_MAX) {
+            pthread_cond_wait(&g_timerCond, &g_lock);
+        } else {
+            uint64_t wait = next - now;
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec  += wait / 1000000;
+            deadline.tv_nsec += (long)(wait % 1000000) * 1000;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&g_timerCond, &g_lock, &deadline);
+        }
+    }
+    return NULL;
+}
+
+static void StartTimerThread(void)
+{
+    pthread_t thread;
+    pthread_create(&thread, NULL, TimerThread, NULL);
+    pthread_detach(thread);
+}
+
+// called with g_lock held
+static timer_t_* FindTimer(uint32_t task, sim_func_t callback, void* param)
+{
+    for (int i = 0; i < MAX_TIMERS; ++i) {
+        timer_t_* tm = &g_timers[i];
+        if (tm->used && tm->task == task && tm->callback == callback && tm->param == param)
+            return tm;
+    }
+    return NULL;
+}
+
+// removes an expired timer whose callback has not run yet; called with g_lock held
+static int DropQueuedCallback(uint32_t task, sim_func_t callback, void* param)
+{
+    task_t* t = GetTask(task);
+    if (!t) return 0;
+    int dropped = 0;
+    queue_item_t** link = &t->head;
+    t->tail = NULL;
+    while (*link) {
+        queue_item_t* item = *link;
+        if (!item->event && item->callback == callback && item->param == param) {
+            *link = item->next;
+            free(item);
+            dropped = 1;
+        } else {
+            t->tail = item;
+            link = &item->next;
+        }
+    }
+    return dropped;
+}
+
+int host_timer_start(uint32_t task, uint32_t ms, sim_func_t callback, void* param)
+{
+    EnsureInit();
+    pthread_mutex_lock(&g_lock);
+    if (!GetTask(task)) {
+        pthread_mutex_unlock(&g_lock);
+        return 0;
+    }
+    DropQueuedCallback(task, callback, param);
+    timer_t_* tm = FindTimer(task, callback, param);
+    for (int i = 0; !tm && i < MAX_TIMERS; ++i)
+        if (!g_timers[i].used) tm = &g_timers[i];
+    if (!tm) {
+        pthread_mutex_unlock(&g_lock);
+        host_log("out of callback timers");
+        return 0;
+    }
+    tm->used = 1;
+    tm->task = task;
+    tm->callback = callback;
+    tm->param = param;
+    tm->due = host_uptime_us() + (uint64_t)ms * 1000;
+    pthread_cond_signal(&g_timerCond);
+    pthread_mutex_unlock(&g_lock);
+    return 1;
+}
+
+int host_timer_stop(uint32_t task, sim_func_t callback, void* param)
+{
+    EnsureInit();
+    pthread_mutex_lock(&g_lock);
+    timer_t_* tm = FindTimer(task, callback, param);
+    int ret = DropQueuedCallback(task, callback, param);
+    if (tm) {
+        tm->used = 0;
+        ret = 1;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return ret;
+}
+
+uint32_t host_timer_query(uint32_t task, sim_func_t callback, void* param)
+{
+    EnsureInit();
+    uint32_t ms = 0;
+    pthread_mutex_lock(&g_lock);
+    timer_t_* tm = FindTimer(task, callback, param);
+    if (tm) {
+        uint64_t now = host_uptime_us();
+        ms = tm->due > now ? (uint32_t)((tm->due - now + 999) / 1000) : 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return ms;
+}
+
+// ---------------------------------------------------------------------------
+// mutexes and semaphores
+// ---------------------------------------------------------------------------
+
+uint32_t host_mutex_create(void)
+{
+    EnsureInit();
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < MAX_MUTEXES; ++i) {
+        if (g_mutexUsed[i]) continue;
+        g_mutexUsed[i] = 1;
+        pthread_mutex_init(&g_mutexes[i], NULL);
+        pthread_mutex_unlock(&g_lock);
+        return MUTEX_HANDLE_BASE + i;
+    }
+    pthread_mutex_unlock(&g_lock);
+    host_log("out of mutexes");
+    return 0;
+}
+
+static pthread_mutex_t* GetMutex(uint32_t handle)
+{
+    if (handle < MUTEX_HANDLE_BASE || handle >= MUTEX_HANDLE_BASE + MAX_MUTEXES) return NULL;
+    int i = handle - MUTEX_HANDLE_BASE;
+    return g_mutexUsed[i] ? &g_mutexes[i] : NULL;
+}
+
+void host_mutex_delete(uint32_t mutex)
+{
+    pthread_mutex_lock(&g_lock);
+    pthread_mutex_t* m = GetMutex(mutex);
+    if (m) {
+        pthread_mutex_destroy(m);
+        g_mutexUsed[mutex - MUTEX_HANDLE_BASE] = 0;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void host_mutex_lock(uint32_t mutex)
+{
+    pthread_mutex_t* m = GetMutex(mutex);
+    if (m) pthread_mutex_lock(m);
+}
+
+void host_mutex_unlock(uint32_t mutex)
+{
+    pthread_mutex_t* m = GetMutex(mutex);
+    if (m) pthread_mutex_unlock(m);
+}
+
+// SYS_EnterCriticalSection() masks the interrupts on the module, which stops the
+// scheduler; here it is one recursive lock shared by all tasks
+static pthread_mutex_t g_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void host_critical_enter(void)
+{
+    pthread_mutex_lock(&g_critical);
+}
+
+void host_critical_exit(void)
+{
+    pthread_mutex_unlock(&g_critical);
+}
+
+static sem_t_* GetSem(uint32_t handle)
+{
+    if (handle < SEM_HANDLE_BASE || handle >= SEM_HANDLE_BASE + MAX_SEMAPHORES) return NULL;
+    sem_t_* s = &g_sems[handle - SEM_HANDLE_BASE];
+    return s->used ? s : NULL;
+}
+
+uint32_t host_sem_create(uint32_t count)
+{
+    EnsureInit();
+    pthread_mutex_lock(&g_lock);
+    // round robin, so a released handle is not reused right away: the GPS library
+    // may release a semaphore from a timer after deleting it
+    for (int n = 0; n < MAX_SEMAPHORES; ++n) {
+        uint32_t i = (g_semNext + n) % MAX_SEMAPHORES;
+        if (g_sems[i].used) continue;
+        g_sems[i].used = 1;
+        g_sems[i].count = count;
+        g_semNext = i + 1;
+        pthread_mutex_unlock(&g_lock);
+        return SEM_HANDLE_BASE + i;
+    }
+    pthread_mutex_unlock(&g_lock);
+    host_log("out of semaphores");
+    return 0;
+}
+
+void host_sem_delete(uint32_t sem)
+{
+    pthread_mutex_lock(&g_lock);
+    sem_t_* s = GetSem(sem);
+    if (s) {
+        s->used = 0;
+        pthread_cond_broadcast(&s->cond);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+int host_sem_wait(uint32_t sem, uint32_t timeoutMs)
+{
+    struct timespec deadline;
+    if (timeoutMs != SIM_WAIT_FOREVER) DeadlineIn(&deadline, timeoutMs);
+
+    pthread_mutex_lock(&g_lock);
+    sem_t_* s = GetSem(sem);
+    while (s && s->used && s->count == 0) {
+        if (timeoutMs == SIM_WAIT_FOREVER) {
+            pthread_cond_wait(&s->cond, &g_lock);
+        } else if (pthread_cond_timedwait(&s->cond, &g_lock, &deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&g_lock);
+            host_task_woken();
+            return 0;
+        }
+    }
+    int ret = s && s->used;
+    if (ret) s->count--;
+    pthread_mutex_unlock(&g_lock);
+    host_task_woken();
+    return ret;
+}
+
+void host_sem_post(uint32_t sem)
+{
+    pthread_mutex_lock(&g_lock);
+    sem_t_* s = GetSem(sem);
+    if (s) {
+        s->count++;
+        pthread_cond_signal(&s->cond);
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+// ---------------------------------------------------------------------------
+// memory
+// ---------------------------------------------------------------------------
+
+static void HeapAdd(uint64_t bytes)
+{
+    uint64_t used = __atomic_add_fetch(&g_heapUsed, bytes, __ATOMIC_RELAXED);
+    uint64_t peak = __atomic_load_n(&g_heapPeak, __ATOMIC_RELAXED);
+    while (used > peak &&
+           !__atomic_compare_exchange_n(&g_heapPeak, &peak, used, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+// the A9G application heap is about 2 MB, allocations beyond it fail like on the module
+#define HOST_HEAP_SIZE (2 * 1024 * 1024)
+
+void* host_malloc(uint32_t size)
+{
+    if (__atomic_load_n(&g_heapUsed, __ATOMIC_RELAXED) + size > HOST_HEAP_SIZE) return NULL;
+    void* p = malloc(size);
+    if (p) HeapAdd(malloc_usable_size(p));
+    return p;
+}
+
+void* host_realloc(void* ptr, uint32_t size)
+{
+    size_t old = ptr ? malloc_usable_size(ptr) : 0;
+    void* p = realloc(ptr, size);
+    if (p) {
+        __atomic_sub_fetch(&g_heapUsed, old, __ATOMIC_RELAXED);
+        HeapAdd(malloc_usable_size(p));
+    }
+    return p;
+}
+
+void host_free(void* ptr)
+{
+    if (!ptr) return;
+    __atomic_sub_fetch(&g_heapUsed, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    free(ptr);
+}
+
+void host_heap_status(uint32_t* used, uint32_t* total)
+{
+    *used = (uint32_t)__atomic_load_n(&g_heapUsed, __ATOMIC_RELAXED);
+    *total = HOST_HEAP_SIZE;
+}
+
+uint32_t host_heap_peak(int reset)
+{
+    uint64_t used = __atomic_load_n(&g_heapUsed, __ATOMIC_RELAXED);
+    uint64_t peak = reset ? __atomic_exchange_n(&g_heapPeak, used, __ATOMIC_RELAXED)
+                          : __atomic_load_n(&g_heapPeak, __ATOMIC_RELAXED);
+    return (uint32_t)peak;
+}
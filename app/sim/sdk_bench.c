@@ -0,0 +1,288 @@
+/*
+ * Host CSDK simulator - entry points into the application for the benchmarks.
+ */
+#include <string.h>
+#include <api_os.h>
+
+#include "sdk_sim.h"
+#include "gps.h"
+#include "gps_parse.h"
+#include "utils.h"
+#include "gps_tracker.h"
+#include "gps_filter.h"
+#include "track_simplify.h"
+#include "geofence.h"
+#include "trip.h"
+#include "link_manager.h"
+#include "config_store.h"
+
+void sim_bench_gps_init(void)
+{
+    gps_Init();
+}
+
+void sim_bench_gps_feed(const uint8_t* data, uint32_t len)
+{
+    GPS_Update((uint8_t*)data, len);
+    gps_Process();
+}
+
+int sim_bench_gps_valid(void)
+{
+    return gps_isValid();
+}
+
+void sim_bench_gps_stats(sim_gps_stats_t* stats)
+{
+    GPS_Parse_Stats_t* s = Gps_GetParseStats();
+    stats->frames    = s->frames;
+    stats->sentences = s->sentences;
+    stats->invalid   = s->invalid;
+    stats->failed    = s->failed;
+    stats->dropped   = s->dropped;
+    stats->overflows = s->overflows;
+}
+
+void sim_bench_gps_position(double* latitude, double* longitude)
+{
+    *latitude  = gps_GetLastLatitude();
+    *longitude = gps_GetLastLongitude();
+}
+
+void sim_bench_gps_fix(sim_fix_t* fix)
+{
+    fix->latitude  = gps_GetLastLatitude();
+    fix->longitude = gps_GetLastLongitude();
+    fix->speed     = gps_GetLastSpeed();
+    fix->accuracy  = gps_GetLastAccuracy();
+}
+
+void sim_bench_filter_config(int enabled, float accel, float uere)
+{
+    g_ConfigStore.gps_filter       = enabled;
+    g_ConfigStore.gps_filter_accel = accel;
+    g_ConfigStore.gps_uere         = uere;
+}
+
+uint32_t sim_bench_filter_run(sim_fix_t* fixes, uint32_t count, float accel)
+{
+    GpsFilter_t filter;
+    uint32_t rejected = 0;
+    GpsFilter_Init(&filter, accel);
+    for (uint32_t i = 0; i < count; ++i) {
+        GpsFilter_Fix_t fix = { fixes[i].latitude, fixes[i].longitude, fixes[i].speed,
+                                fixes[i].bearing, fixes[i].accuracy };
+        if (GpsFilter_Update(&filter, fixes[i].time, &fix) == GPS_FILTER_REJECTED) rejected++;
+        fixes[i].latitude  = fix.latitude;
+        fixes[i].longitude = fix.longitude;
+        fixes[i].speed     = fix.speed;
+        fixes[i].bearing   = fix.bearing;
+        fixes[i].accuracy  = fix.accuracy;
+    }
+    return rejected;
+}
+
+uint32_t sim_bench_track_run(const sim_fix_t* fixes, uint32_t count, float tolerance, sim_fix_t* kept)
+{
+    TrackSimplify_t track;
+    TrackPoint_t out;
+    uint32_t n = 0;
+    TrackSimplify_Init(&track, tolerance);
+    for (uint32_t i = 0; i < count; ++i) {
+        TrackPoint_t point = { (uint32_t)fixes[i].time, fixes[i].latitude, fixes[i].longitude,
+                               fixes[i].speed, fixes[i].bearing };
+        if (TrackSimplify_Add(&track, &point, &out)) {
+            kept[n].time = out.timestamp;
+            kept[n].latitude = out.latitude;
+            kept[n].longitude = out.longitude;
+            n++;
+        }
+    }
+    if (TrackSimplify_Flush(&track, &out)) {
+        kept[n].time = out.timestamp;
+        kept[n].latitude = out.latitude;
+        kept[n].longitude = out.longitude;
+        n++;
+    }
+    return n;
+}
+
+// the benchmark's fences, far more than the tracker's static set holds
+static GeofenceSet_t benchFences;
+static void*         benchStorage = NULL;
+
+int sim_bench_geofence_setup(uint32_t maxFences, uint32_t maxPoints, uint32_t maxCells, uint32_t maxItems)
+{
+    if (benchStorage) OS_Free(benchStorage);
+    uint32_t size = maxFences * sizeof(Geofence_t) + maxPoints * sizeof(GeofencePoint_t) +
+                    (maxCells + 1) * sizeof(uint32_t) + maxItems * sizeof(uint16_t);
+    uint8_t* p = benchStorage = OS_Malloc(size);
+    if (!p) return -1;
+    Geofence_t*      fences = (Geofence_t*)p;      p += maxFences * sizeof(Geofence_t);
+    GeofencePoint_t* points = (GeofencePoint_t*)p; p += maxPoints * sizeof(GeofencePoint_t);
+    uint32_t*        cells  = (uint32_t*)p;        p += (maxCells + 1) * sizeof(uint32_t);
+    GeofenceSet_Init(&benchFences, fences, maxFences, points, maxPoints, cells, maxCells, (uint16_t*)p, maxItems);
+    return 0;
+}
+
+int sim_bench_geofence_add(const char* line)
+{
+    return GeofenceSet_Add(&benchFences, line) ? 0 : -1;
+}
+
+void sim_bench_geofence_index(int grid, uint32_t* width, uint32_t* height, uint32_t* items)
+{
+    GeofenceSet_BuildIndex(&benchFences);
+    if (!grid) benchFences.gridWidth = benchFences.gridHeight = 0;
+    *width  = benchFences.gridWidth;
+    *height = benchFences.gridHeight;
+    *items  = benchFences.gridWidth ? benchFences.cells[benchFences.gridWidth * benchFences.gridHeight] : 0;
+}
+
+static void CountEvent(void* param, const Geofence_t* fence, bool entered)
+{
+    uint32_t* events = (uint32_t*)param;
+    events[entered ? 0 : 1]++;
+}
+
+uint32_t sim_bench_geofence_run(const int32_t* latitudes, const int32_t* longitudes, uint32_t count,
+                                float margin, uint32_t* enters, uint32_t* exits)
+{
+    // every run starts outside every fence, as after boot
+    for (int i = 0; i < benchFences.count; ++i) {
+        benchFences.fences[i].state   = GEOFENCE_OUTSIDE;
+        benchFences.fences[i].pending = 0;
+        benchFences.fences[i].active  = false;
+    }
+    benchFences.activeCount = 0;
+    benchFences.primed = false;
+
+    uint32_t events[2] = {0, 0}, tested = 0;
+    for (uint32_t i = 0; i < count; ++i)
+        tested += GeofenceSet_Check(&benchFences, latitudes[i], longitudes[i], margin, CountEvent, events);
+    *enters = events[0];
+    *exits  = events[1];
+    return tested;
+}
+
+uint32_t sim_bench_trip_run(const sim_fix_t* fixes, uint32_t count, uint32_t stopTime,
+                            sim_trip_t* trips, uint32_t maxTrips, double* odometer)
+{
+    TripDetector_t detector;
+    TripEvent_t events[2];
+    uint32_t n = 0;
+    TripDetector_Init(&detector, stopTime, 0.0);
+    for (uint32_t i = 0; i <= count; ++i) {
+        int found;
+        if (i < count) {
+            TripFix_t fix = { (uint32_t)fixes[i].time, fixes[i].latitude, fixes[i].longitude,
+                              fixes[i].speed, fixes[i].accuracy };
+            found = TripDetector_Update(&detector, &fix, events);
+        } else {
+            // the end of the trace: a trip still open ends after the stop time
+            found = TripDetector_Timeout(&detector, detector.last.time + stopTime, events);
+        }
+        for (int e = 0; e < found; ++e) {
+            if (events[e].type != TRIP_EVENT_END || n == maxTrips) continue;
+            trips[n].start     = events[e].startTime;
+            trips[n].end       = events[e].endTime;
+            trips[n].latitude  = events[e].latitude;
+            trips[n].longitude = events[e].longitude;
+            trips[n].distance  = events[e].distance;
+            trips[n].maxSpeed  = events[e].maxSpeed;
+            n++;
+        }
+    }
+    *odometer = detector.odometer;
+    return n;
+}
+
+uint32_t sim_bench_mk_time(int year, int month, int day, int hour, int minute, int second)
+{
+    struct minmea_date date = { day, month, year };
+    struct minmea_time time = { hour, minute, second, 0 };
+    return (uint32_t)mk_time(&date, &time);
+}
+
+int32_t sim_bench_days_from_civil(int year, unsigned month, unsigned day)
+{
+    return days_from_civil(year, month, day);
+}
+
+void sim_bench_civil_from_days(int32_t days, int* year, unsigned* month, unsigned* day)
+{
+    civil_from_days(days, year, month, day);
+}
+
+uint32_t sim_bench_rtc_round_trip(uint32_t t, int* fields)
+{
+    RTC_Time_t rtc;
+    time_to_rtc(t, &rtc);
+    fields[0] = rtc.year;
+    fields[1] = rtc.month;
+    fields[2] = rtc.day;
+    fields[3] = rtc.hour;
+    fields[4] = rtc.minute;
+    fields[5] = rtc.second;
+    return rtc_to_time(&rtc);
+}
+
+uint32_t sim_bench_mk_time_run(const uint8_t* fields, uint32_t count)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; ++i, fields += 6) {
+        struct minmea_date date = { fields[2], fields[1], fields[0] };
+        struct minmea_time time = { fields[3], fields[4], fields[5], 0 };
+        sum += (uint32_t)mk_time(&date, &time);
+    }
+    return sum;
+}
+
+static LinkManager_t benchLink;
+
+void sim_bench_link_init(uint32_t seed)
+{
+    LinkManager_Init(&benchLink, seed);
+}
+
+void sim_bench_link_limits(uint32_t* backoffMax, uint32_t* stableTime, uint32_t* deferMax)
+{
+    *backoffMax = LINK_BACKOFF_MAX;
+    *stableTime = LINK_STABLE_TIME;
+    *deferMax   = LINK_DEFER_MAX;
+}
+
+int sim_bench_link_may_connect(uint32_t now, uint32_t* wait)
+{
+    return LinkManager_MayConnect(&benchLink, now, wait);
+}
+
+void sim_bench_link_urgent(void)
+{
+    LinkManager_Urgent(&benchLink);
+}
+
+void sim_bench_link_up(uint32_t now)
+{
+    LinkManager_Up(&benchLink, now);
+}
+
+void sim_bench_link_down(uint32_t now)
+{
+    LinkManager_Down(&benchLink, now);
+}
+
+void sim_bench_link_signal(int percent)
+{
+    LinkManager_Signal(&benchLink, percent);
+}
+
+void sim_bench_link_upload(int delivered)
+{
+    LinkManager_Upload(&benchLink, delivered);
+}
+
+int sim_bench_link_defer(uint32_t sinceReport)
+{
+    return LinkManager_Defer(&benchLink, sinceReport);
+}
@@ -0,0 +1,145 @@
+/*
+ * Host CSDK simulator - file system. The module paths ("/config.ini", "/t/gps_log.txt")
+ * are files below the --fs directory.
+ */
+#include <string.h>
+
+#include "sdk_sim.h"
+
+typedef struct {
+    Dir_t    dir;           // first member, the application only sees this part
+    Dirent_t entry;
+} sim_dir_t;
+
+static int32_t Sim_API_FS_Open(const char* fileName, uint32_t flags, uint32_t mode)
+{
+    uint32_t f = flags & FS_O_ACCMODE;     // same values as SIM_FS_*
+    if (flags & FS_O_CREAT)  f |= SIM_FS_CREAT;
+    if (flags & FS_O_EXCL)   f |= SIM_FS_EXCL;
+    if (flags & FS_O_TRUNC)  f |= SIM_FS_TRUNC;
+    if (flags & FS_O_APPEND) f |= SIM_FS_APPEND;
+    return host_fs_open(fileName, f);
+}
+
+static int32_t Sim_API_FS_Close(int32_t fd)
+{
+    return host_fs_close(fd);
+}
+
+static int32_t Sim_API_FS_Read(int32_t fd, uint8_t* buffer, uint32_t length)
+{
+    return host_fs_read(fd, buffer, length);
+}
+
+static int32_t Sim_API_FS_Write(int32_t fd, uint8_t* buffer, uint32_t length)
+{
+    return host_fs_write(fd, buffer, length);
+}
+
+static uint32_t Sim_API_FS_Flush(int32_t fd)
+{
+    return host_fs_flush(fd);
+}
+
+static int32_t Sim_API_FS_Create(const char* fileName, uint32_t mode)
+{
+    return host_fs_open(fileName, SIM_FS_RDWR | SIM_FS_CREAT | SIM_FS_TRUNC);
+}
+
+static int32_t Sim_API_FS_Delete(const char* fileName)
+{
+    return host_fs_delete(fileName);
+}
+
+static int64_t Sim_API_FS_Seek(int32_t fd, int64_t offset, uint8_t origin)
+{
+    return host_fs_seek(fd, offset, origin);
+}
+
+static int32_t Sim_API_FS_IsEndOfFile(int32_t fd)
+{
+    int64_t pos = host_fs_seek(fd, 0, FS_SEEK_CUR);
+    int64_t size = host_fs_size(fd);
+    if (pos < 0 || size < 0) return -1;
+    return pos >= size;
+}
+
+static int32_t Sim_API_FS_Rename(const char* oldName, const char* newName)
+{
+    return host_fs_rename(oldName, newName);
+}
+
+static int64_t Sim_API_FS_GetFileSize(int32_t fd)
+{
+    return host_fs_size(fd);
+}
+
+static int32_t Sim_API_FS_Mkdir(const char* fileName, uint32_t mode)
+{
+    return host_fs_mkdir(fileName);
+}
+
+static int32_t Sim_API_FS_Rmdir(const char* fileName)
+{
+    return host_fs_rmdir(fileName);
+}
+
+static int32_t Sim_API_FS_GetFSInfo(const char* devName, API_FS_INFO* info)
+{
+    uint64_t total, used;
+    int32_t ret = host_fs_info(devName, &total, &used);
+    if (ret < 0) return ret;
+    info->totalSize = total;
+    info->usedSize = used;
+    return 0;
+}
+
+static Dir_t* Sim_API_FS_OpenDir(const char* name)
+{
+    int32_t handle = host_fs_opendir(name);
+    if (handle < 0) return NULL;
+    sim_dir_t* d = host_malloc(sizeof(sim_dir_t));
+    memset(d, 0, sizeof(*d));
+    d->dir.fs_index = handle;
+    return &d->dir;
+}
+
+static Dirent_t* Sim_API_FS_ReadDir(Dir_t* dir)
+{
+    sim_dir_t* d = (sim_dir_t*)dir;
+    int isDir = 0;
+    if (!d || !host_fs_readdir(d->dir.fs_index, d->entry.d_name, sizeof(d->entry.d_name), &isDir))
+        return NULL;
+    d->entry.d_ino++;
+    d->entry.d_type = isDir ? 4 : 8;    // DT_DIR, DT_REG
+    return &d->entry;
+}
+
+static int Sim_API_FS_CloseDir(Dir_t* dir)
+{
+    if (!dir) return -1;
+    host_fs_closedir(dir->fs_index);
+    host_free(dir);
+    return 0;
+}
+
+void sim_fs_init(T_INTERFACE_VTBL_TAG* vt)
+{
+    vt->API_FS_Open        = Sim_API_FS_Open;
+    vt->API_FS_Close       = Sim_API_FS_Close;
+    vt->API_FS_Read        = Sim_API_FS_Read;
+    vt->API_FS_Write       = Sim_API_FS_Write;
+    vt->API_FS_Flush       = Sim_API_FS_Flush;
+    vt->API_FS_Create      = Sim_API_FS_Create;
+    vt->API_FS_Delete      = Sim_API_FS_Delete;
+    vt->API_FS_Seek        = Sim_API_FS_Seek;
+    vt->API_FS_IsEndOfFile = Sim_API_FS_IsEndOfFile;
+    vt->API_FS_Rename      = Sim_API_FS_Rename;
+    vt->API_FS_GetFileSize = Sim_API_FS_GetFileSize;
+    vt->API_FS_Mkdir       = Sim_API_FS_Mkdir;
+    vt->API_FS_Rmdir       = Sim_API_FS_Rmdir;
+    vt->API_FS_GetFSInfo   = Sim_API_FS_GetFSInfo;
+    vt->API_FS_OpenDir     = Sim_API_FS_OpenDir;
+    vt->API_FS_ReadDir     = Sim_API_FS_ReadDir;
+    vt->API_FS_CloseDir    = Sim_API_FS_CloseDir;
+}
@@ -0,0 +1,244 @@
+/*
+ * Host CSDK simulator - the interface table, boot sequence, trace and the C library
+ * functions the CSDK exports through the table.
+ */
+#include <string.h>
+#include <ctype.h>
+
+#include "sdk_sim.h"
+
+// host libm, declared here as the CSDK math.h maps these names to the table
+extern double acos(double), asin(double), atan(double), atan2(double, double);
+extern double cos(double), sin(double), tan(double), cosh(double), sinh(double), tanh(double);
+extern double exp(double), frexp(double, int*), ldexp(double, int), log(double), log10(double);
+extern double modf(double, double*), pow(double, double), sqrt(double), ceil(double), fabs(double);
+extern double floor(double), fmod(double, double), erf(double), erfc(double), gamma(double);
+extern double hypot(double, double), lgamma(double), acosh(double), asinh(double), atanh(double);
+extern double cbrt(double), logb(double), nextafter(double, double), remainder(double, double);
+extern double significand(double), copysign(double, double), rint(double);
+extern int    finite(double), ilogb(double);
+
+extern void app_Main(void);
+
+static T_INTERFACE_VTBL_TAG vtbl;
+T_INTERFACE_VTBL_TAG* g_InterfaceVtbl = &vtbl;
+
+// character classes used by the ctype.h macros, provided by the module's ROM
+#define C_ (_C)
+#define S_ (_C | _S)
+#define P_ (_P)
+#define D_ (_D)
+#define UX (_U | _X)
+#define U_ (_U)
+#define LX (_L | _X)
+#define L_ (_L)
+const unsigned char _ctype[256] = {
+    C_, C_, C_, C_, C_, C_, C_, C_, C_, S_, S_, S_, S_, S_, C_, C_,     // 0x00
+    C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_, C_,     // 0x10
+    _S | _SP, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, P_, // 0x20
+    D_, D_, D_, D_, D_, D_, D_, D_, D_, D_, P_, P_, P_, P_, P_, P_,     // 0x30
+    P_, UX, UX, UX, UX, UX, UX, U_, U_, U_, U_, U_, U_, U_, U_, U_,     // 0x40
+    U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, U_, P_, P_, P_, P_, P_,     // 0x50
+    P_, LX, LX, LX, LX, LX, LX, L_, L_, L_, L_, L_, L_, L_, L_, L_,     // 0x60
+    L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, L_, P_, P_, P_, P_, C_,     // 0x70
+};
+#undef C_
+#undef S_
+#undef P_
+#undef D_
+#undef UX
+#undef U_
+#undef LX
+#undef L_
+
+int strnicmp(const char* s1, const char* s2, size_t n)
+{
+    for (; n; --n, ++s1, ++s2) {
+        int c1 = tolower((unsigned char)*s1);
+        int c2 = tolower((unsigned char)*s2);
+        if (c1 != c2) return c1 - c2;
+        if (!c1) break;
+    }
+    return 0;
+}
+
+static bool Sim_Trace(uint16_t nIndex, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    host_trace(fmt, ap);
+    va_end(ap);
+    return true;
+}
+
+static void Sim_MemblockTrace(uint16_t nIndex, uint8_t* buffer, uint16_t len, uint8_t radix)
+{
+}
+
+static void Sim_Assert(const char* msg)
+{
+    host_log("assert: %s", msg);
+    host_shutdown(134);
+}
+
+static int Sim_sprintf(char* buf, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = host_vsnprintf(buf, 0x7FFFFFFF, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+static int Sim_snprintf(char* buf, size_t len, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = host_vsnprintf(buf, len, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+static int Sim_sscanf(const char* buf, const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = host_vsscanf(buf, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+static int Sim_vsprintf(char* buf, const char* fmt, va_list ap)
+{
+    return host_vsnprintf(buf, 0x7FFFFFFF, fmt, ap);
+}
+
+static int Sim_vsnprintf(char* buf, size_t size, const char* fmt, va_list ap)
+{
+    return host_vsnprintf(buf, size, fmt, ap);
+}
+
+static int Sim_vsscanf(const char* buf, const char* fmt, va_list ap)
+{
+    return host_vsscanf(buf, fmt, ap);
+}
+
+static long Sim_atol(const char* s)
+{
+    return (long)host_strtoll(s, 10);
+}
+
+static long long Sim_atoll(const char* s)
+{
+    return host_strtoll(s, 10);
+}
+
+static int Sim_atox(const char* s, int len)
+{
+    int value = 0;
+    for (int i = 0; i < len && s[i]; ++i) {
+        char c = s[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' :
+                    c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                    c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0) break;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+static double Sim_atof(const char* s)
+{
+    return host_strtod(s);
+}
+
+static unsigned char* Sim_itoa(int value, char* str, int radix)
+{
+    char tmp[34];
+    int n = 0;
+    unsigned int v = (radix == 10 && value < 0) ? -(unsigned int)value : (unsigned int)value;
+    if (radix < 2 || radix > 36) radix = 10;
+    do {
+        int d = v % radix;
+        tmp[n++] = d < 10 ? '0' + d : 'a' + d - 10;
+        v /= radix;
+    } while (v);
+    char* p = str;
+    if (radix == 10 && value < 0) *p++ = '-';
+    while (n) *p++ = tmp[--n];
+    *p = '\0';
+    return (unsigned char*)str;
+}
+
+static char* Sim_gcvt(double value, int ndigit, char* buf)
+{
+    return host_gcvt(value, ndigit, buf);
+}
+
+static int Sim_rand(void)
+{
+    return host_rand();
+}
+
+static void Sim_srand(unsigned int seed)
+{
+    host_srand(seed);
+}
+
+void sim_libc_init(T_INTERFACE_VTBL_TAG* vt)
+{
+    vt->Trace          = Sim_Trace;
+    vt->MEMBLOCK_Trace = Sim_MemblockTrace;
+    vt->__assert       = Sim_Assert;
+
+    vt->sprintf   = Sim_sprintf;
+    vt->snprintf  = Sim_snprintf;
+    vt->sscanf    = Sim_sscanf;
+    vt->vsprintf  = Sim_vsprintf;
+    vt->vsnprintf = Sim_vsnprintf;
+    vt->vsscanf   = Sim_vsscanf;
+    vt->atol      = Sim_atol;
+    vt->atoll     = Sim_atoll;
+    vt->atox      = Sim_atox;
+    vt->atof      = Sim_atof;
+    vt->itoa      = Sim_itoa;
+    vt->gcvt      = Sim_gcvt;
+    vt->rand      = Sim_rand;
+    vt->srand     = Sim_srand;
+
+    vt->acos = acos;   vt->asin = asin;   vt->atan = atan;   vt->atan2 = atan2;
+    vt->cos = cos;     vt->sin = sin;     vt->tan = tan;
+    vt->cosh = cosh;   vt->sinh = sinh;   vt->tanh = tanh;
+    vt->exp = exp;     vt->frexp = frexp; vt->ldexp = ldexp;
+    vt->log = log;     vt->log10 = log10; vt->modf = modf;   vt->pow = pow;
+    vt->sqrt = sqrt;   vt->ceil = ceil;   vt->fabs = fabs;   vt->floor = floor;
+    vt->fmod = fmod;   vt->erf = erf;     vt->erfc = erfc;   vt->gamma = gamma;
+    vt->hypot = hypot; vt->finite = finite; vt->lgamma = lgamma;
+    vt->acosh = acosh; vt->asinh = asinh; vt->atanh = atanh; vt->cbrt = cbrt;
+    vt->logb = logb;   vt->nextafter = nextafter; vt->remainder = remainder;
+    vt->significand = significand; vt->copysign = copysign;
+    vt->ilogb = ilogb; vt->rint = rint;
+}
+
+/**
+ * Entries the simulator does not implement stay NULL, calling one crashes with a
+ * backtrace (see CrashHandler in host_main.c).
+ */
+void sim_sdk_init(void)
+{
+    memset(&vtbl, 0, sizeof(vtbl));
+    sim_libc_init(&vtbl);
+    sim_os_init(&vtbl);
+    sim_fs_init(&vtbl);
+    sim_socket_init(&vtbl);
+    sim_uart_init(&vtbl);
+    sim_modem_init(&vtbl);
+}
+
+void sim_sdk_boot(void)
+{
+    sim_sdk_init();
+    app_Main();
+    host_start_tasks();
+    sim_modem_boot();
+}
@@ -0,0 +1,430 @@
+/*
+ * Host CSDK simulator - GSM network and SMS.
+ *
+ * The network model registers at boot, attaches and activates PDP contexts after the
+ * configured delays and reports every change through the status callback and the
+ * API_EVENT_ID_NETWORK_* events, executed on the application main task. Simulator
+ * commands (console "!<command>" lines or the --script file) change its state:
+ *
+ *   register | unregister | deny     network registration
+ *   detach | deactivate              drop the GPRS attach / the PDP context
+ *   fail attach|activate on|off      make the next attach / activation fail
+ *   signal <csq>                     signal quality, 0-31 or 99
+ *   cells <mcc>,<mnc>,<lac>,<cid>,<rxlev> ...    serving cell first, up to 8
+ *   sms <number> <text>              receive an SMS
+ *   battery <percent>                battery level
+ *   event <id> [param1 [param2]]     post a raw API_Event_t
+ *   status                           print the network state
+ *
+ * LBS_GetLocation() answers with the --lbs position after a request/response exchange on
+ * the link model; without --lbs the service knows no location.
+ */
+#include <string.h>
+#include <stdlib.h>
+
+#include "sdk_sim.h"
+
+#define MAX_CELLS                 8
+#define SIGNAL_REPORT_INTERVAL_S  10
+#define SIM_IP_ADDRESS            "10.0.0.2"
+
+static Network_Callback_Func_t statusCallback = NULL;
+static volatile bool registered = false;
+static volatile bool attached   = false;
+static volatile bool active     = false;
+static bool failAttach   = false;
+static bool failActivate = false;
+static uint8_t csq = 24;
+static Network_Location_t cells[MAX_CELLS];
+static int cellCount = 0;
+static uint32_t ticks = 0;
+
+static const char* const statusNames[NETWORK_STATUS_MAX] = {
+    "offline", "registering", "registered", "detached", "attaching", "attached",
+    "deactivated", "activating", "activated", "attach failed", "activate failed"
+};
+
+bool sim_modem_is_active(void)
+{
+    return active;
+}
+
+// runs on the main task, like the status callback of the module
+static void DeliverStatus(void* param)
+{
+    Network_Status_t status = (Network_Status_t)(long)param;
+    switch (status) {
+        case NETWORK_STATUS_REGISTERED:
+            registered = true;
+            sim_post_event(API_EVENT_ID_NETWORK_REGISTERED_HOME, 0, 0, NULL, 0, NULL, 0);
+            break;
+        case NETWORK_STATUS_REGISTERING:
+            registered = attached = active = false;
+            sim_post_event(API_EVENT_ID_NETWORK_REGISTER_SEARCHING, 0, 0, NULL, 0, NULL, 0);
+            break;
+        case NETWORK_STATUS_ATTACHED:
+            attached = true;
+            sim_post_event(API_EVENT_ID_NETWORK_ATTACHED, 0, 0, NULL, 0, NULL, 0);
+            break;
+        case NETWORK_STATUS_ATTACH_FAILED:
+            sim_post_event(API_EVENT_ID_NETWORK_ATTACH_FAILED, 0, 0, NULL, 0, NULL, 0);
+            break;
+        case NETWORK_STATUS_DETACHED:
+            attached = active = false;
+            sim_post_event(API_EVENT_ID_NETWORK_DETACHED, 0, 0, NULL, 0, NULL, 0);
+            break;
+        case NETWORK_STATUS_ACTIVATED:
+            active = true;
+            sim_post_event(API_EVENT_ID_NETWORK_ACTIVATED, 0, 0, NULL, 0, NULL, 0);
+            break;
+        case NETWORK_STATUS_ACTIVATE_FAILED:
+            sim_post_event(API_EVENT_ID_NETWORK_ACTIVATE_FAILED, 0, 0, NULL, 0, NULL, 0);
+            break;
+        case NETWORK_STATUS_DEACTIVED:
+            active = false;
+            sim_post_event(API_EVENT_ID_NETWORK_DEACTIVED, 0, 0, NULL, 0, NULL, 0);
+            break;
+        default:
+            break;
+    }
+    host_log("network: %s", statusNames[status]);
+    if (statusCallback) statusCallback(status);
+}
+
+static void ScheduleStatus(Network_Status_t status, uint32_t delayMs)
+{
+    host_timer_start(sim_main_task(), delayMs, DeliverStatus, (void*)(long)status);
+}
+
+void sim_modem_boot(void)
+{
+    sim_post_event(API_EVENT_ID_SYSTEM_READY, 0, 0, NULL, 0, NULL, 0);
+    if (!g_simOptions.noNetwork)
+        ScheduleStatus(NETWORK_STATUS_REGISTERED, 1000);
+}
+
+void sim_modem_tick(void)
+{
+    if (registered && ++ticks % SIGNAL_REPORT_INTERVAL_S == 0)
+        sim_post_event(API_EVENT_ID_SIGNAL_QUALITY, csq, 99, NULL, 0, NULL, 0);
+}
+
+// ---------------------------------------------------------------------------
+// network
+// ---------------------------------------------------------------------------
+
+// about 30 bytes per cell in the request, a short JSON answer
+#define LBS_REQUEST_BYTES(n)      (120 + 30 * (n))
+#define LBS_RESPONSE_BYTES        200
+
+static bool Sim_LBS_GetLocation(Network_Location_t* bsInfo, uint8_t bsNumber, int timeoutS,
+                                float* longitude, float* latitude)
+{
+    if (!active || bsNumber == 0 || host_link_exchange(LBS_REQUEST_BYTES(bsNumber), LBS_RESPONSE_BYTES) < 0) {
+        host_log("LBS request failed");
+        return false;
+    }
+    if (!g_simOptions.lbsSet) {
+        host_log("LBS: no location for %u cells", bsNumber);
+        return false;
+    }
+    *latitude  = (float)g_simOptions.lbsLatitude;
+    *longitude = (float)g_simOptions.lbsLongitude;
+    return true;
+}
+
+static void Sim_Network_SetStatusChangedCallback(Network_Callback_Func_t callback)
+{
+    statusCallback = callback;
+}
+
+static bool Sim_Network_StartAttach(void)
+{
+    if (!registered) return false;
+    ScheduleStatus(failAttach ? NETWORK_STATUS_ATTACH_FAILED : NETWORK_STATUS_ATTACHED,
+                   g_simOptions.attachDelayMs);
+    return true;
+}
+
+static bool Sim_Network_StartDetach(void)
+{
+    if (!attached) return false;
+    ScheduleStatus(NETWORK_STATUS_DETACHED, 100);
+    return true;
+}
+
+static bool Sim_Network_StartActive(Network_PDP_Context_t context)
+{
+    if (!attached) return false;
+    host_log("activating PDP context, APN '%s'", context.apn);
+    if (failActivate) {
+        ScheduleStatus(NETWORK_STATUS_ACTIVATE_FAILED, g_simOptions.activateDelayMs);
+    } else if (g_simOptions.apnReject && strcmp(context.apn, g_simOptions.apnReject) == 0) {
+        // a refused APN ends in a deactivation, the application's APN workaround relies on it
+        ScheduleStatus(NETWORK_STATUS_DEACTIVED, g_simOptions.activateDelayMs);
+    } else {
+        ScheduleStatus(NETWORK_STATUS_ACTIVATED, g_simOptions.activateDelayMs);
+    }
+    return true;
+}
+
+static bool Sim_Network_StartDeactive(uint8_t contextID)
+{
+    if (!active) return false;
+    ScheduleStatus(NETWORK_STATUS_DEACTIVED, 200);
+    return true;
+}
+
+static bool Sim_Network_GetIp(char* ip, uint8_t size)
+{
+    if (!active || size < sizeof(SIM_IP_ADDRESS)) return false;
+    strcpy(ip, SIM_IP_ADDRESS);
+    return true;
+}
+
+static bool Sim_Network_GetCellInfoRequst(void)
+{
+    if (!registered) return false;
+    sim_post_event(API_EVENT_ID_NETWORK_CELL_INFO, cellCount, 0,
+                   cells, cellCount * sizeof(Network_Location_t), NULL, 0);
+    return true;
+}
+
+static bool Sim_Network_GetAttachStatus(uint8_t* status)
+{
+    *status = attached;
+    return true;
+}
+
+static bool Sim_Network_GetActiveStatus(uint8_t* status)
+{
+    *status = active;
+    return true;
+}
+
+static bool Sim_Network_GetSignalQuality(Network_Signal_Quality_t* sq)
+{
+    sq->signalLevel = csq;
+    sq->bitError = 99;
+    return true;
+}
+
+static bool Sim_Network_SetFlightMode(bool enable)
+{
+    ScheduleStatus(enable ? NETWORK_STATUS_REGISTERING : NETWORK_STATUS_REGISTERED, 500);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// SMS
+// ---------------------------------------------------------------------------
+
+static bool Sim_SMS_SetFormat(SMS_Format_t format, SIM_ID_t simID)
+{
+    return true;
+}
+
+static bool Sim_SMS_SetParameter(SMS_Parameter_t* parameter, SIM_ID_t simID)
+{
+    return true;
+}
+
+static bool Sim_SMS_SetNewMessageStorage(SMS_Storage_t storage)
+{
+    return true;
+}
+
+static bool Sim_SMS_SendMessage(const char* phoneNumber, const uint8_t* message, uint8_t length, SIM_ID_t simID)
+{
+    if (!registered) return false;
+    host_sms_sent(phoneNumber, message, length);
+    sim_post_event(API_EVENT_ID_SMS_SENT, 0, 0, NULL, 0, NULL, 0);
+    return true;
+}
+
+// received messages are delivered by event only, the storage stays empty
+static bool Sim_SMS_ListMessageRequst(SMS_Status_t status, SMS_Storage_t storage)
+{
+    return true;
+}
+
+static bool Sim_SMS_DeleteMessage(uint8_t index, SMS_Status_t status, SMS_Storage_t storage)
+{
+    return true;
+}
+
+static bool Sim_SMS_GetStorageInfo(SMS_Storage_Info_t* info, SMS_Storage_t storage)
+{
+    memset(info, 0, sizeof(*info));
+    info->total = 50;
+    info->storageId = storage;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// simulator commands
+// ---------------------------------------------------------------------------
+
+static const char* Arg(const char* cmd, const char* name)
+{
+    size_t n = strlen(name);
+    if (strncmp(cmd, name, n) != 0 || (cmd[n] != '\0' && cmd[n] != ' ')) return NULL;
+    cmd += n;
+    while (*cmd == ' ') cmd++;
+    return cmd;
+}
+
+static void SetDigits(uint8_t* digits, const char* s, const char* end)
+{
+    int n = (int)(end - s);
+    for (int i = 0; i < 3; ++i) {
+        int k = i - (3 - n);        // right aligned, a two digit MNC gets a leading 0
+        digits[i] = (k >= 0 && k < n) ? s[k] - '0' : 0;
+    }
+}
+
+static bool ParseCells(const char* args)
+{
+    Network_Location_t parsed[MAX_CELLS];
+    int count = 0;
+    while (*args && count < MAX_CELLS) {
+        Network_Location_t* c = &parsed[count];
+        memset(c, 0, sizeof(*c));
+        char* end;
+        const char* mcc = args;
+        strtol(mcc, &end, 10);
+        if (*end != ',') return false;
+        SetDigits(c->sMcc, mcc, end);
+        const char* mnc = end + 1;
+        strtol(mnc, &end, 10);
+        if (*end != ',') return false;
+        SetDigits(c->sMnc, mnc, end);
+        c->sLac = strtol(end + 1, &end, 10);
+        if (*end != ',') return false;
+        c->sCellID = strtol(end + 1, &end, 10);
+        if (*end != ',') return false;
+        c->iRxLev = strtol(end + 1, &end, 10);
+        count++;
+        while (*end == ' ') end++;
+        args = end;
+    }
+    memcpy(cells, parsed, sizeof(parsed));
+    cellCount = count;
+    return true;
+}
+
+static void ReceiveSms(const char* number, const char* text)
+{
+    char header[96];
+    int year, month, day, hour, minute, second;
+    host_gmtime(host_unix_time_us() / 1000000, &year, &month, &day, &hour, &minute, &second, NULL, NULL);
+    // same format as the module: "+1234567890","2023/06/08,11:22:33+00"
+    int n = 0;
+    header[n++] = '"';
+    while (*number && n < 40) header[n++] = *number++;
+    header[n++] = '"';
+    header[n++] = ',';
+    header[n] = '\0';
+    char* p = header + n;
+    int fields[6] = { year, month, day, hour, minute, second };
+    const char seps[6] = { '/', '/', ',', ':', ':', '+' };
+    *p++ = '"';
+    for (int i = 0; i < 6; ++i) {
+        int v = fields[i];
+        if (i == 0) {
+            *p++ = '0' + v / 1000;
+            *p++ = '0' + v / 100 % 10;
+        }
+        *p++ = '0' + v / 10 % 10;
+        *p++ = '0' + v % 10;
+        *p++ = seps[i];
+    }
+    strcpy(p, "00\"");
+    sim_post_event(API_EVENT_ID_SMS_RECEIVED, SMS_ENCODE_TYPE_ASCII, strlen(text),
+                   header, strlen(header), text, strlen(text));
+}
+
+int sim_modem_command(const char* cmd, char* reply, uint32_t replySize)
+{
+    const char* args;
+    reply[0] = '\0';
+
+    if (Arg(cmd, "register")) {
+        ScheduleStatus(NETWORK_STATUS_REGISTERED, 100);
+    } else if (Arg(cmd, "unregister")) {
+        ScheduleStatus(NETWORK_STATUS_REGISTERING, 0);
+    } else if (Arg(cmd, "deny")) {
+        registered = attached = active = false;
+        sim_post_event(API_EVENT_ID_NETWORK_REGISTER_DENIED, 0, 0, NULL, 0, NULL, 0);
+    } else if (Arg(cmd, "detach")) {
+        ScheduleStatus(NETWORK_STATUS_DETACHED, 0);
+    } else if (Arg(cmd, "deactivate")) {
+        ScheduleStatus(NETWORK_STATUS_DEACTIVED, 0);
+    } else if ((args = Arg(cmd, "fail"))) {
+        bool on = strstr(args, " off") == NULL;
+        if (Arg(args, "attach")) failAttach = on;
+        else if (Arg(args, "activate")) failActivate = on;
+        else return 0;
+    } else if ((args = Arg(cmd, "signal"))) {
+        csq = strtol(args, NULL, 10);
+        sim_post_event(API_EVENT_ID_SIGNAL_QUALITY, csq, 99, NULL, 0, NULL, 0);
+    } else if ((args = Arg(cmd, "cells"))) {
+        if (!ParseCells(args)) {
+            strncpy(reply, "usage: cells <mcc>,<mnc>,<lac>,<cid>,<rxlev> ...", replySize - 1);
+            reply[replySize - 1] = '\0';
+        }
+    } else if ((args = Arg(cmd, "sms"))) {
+        char number[32];
+        int n = 0;
+        while (*args && *args != ' ' && n < (int)sizeof(number) - 1) number[n++] = *args++;
+        number[n] = '\0';
+        while (*args == ' ') args++;
+        ReceiveSms(number, args);
+    } else if ((args = Arg(cmd, "battery"))) {
+        g_simOptions.batteryPercent = strtol(args, NULL, 10);
+    } else if ((args = Arg(cmd, "event"))) {
+        char* end;
+        uint32_t id = strtol(args, &end, 10);
+        uint32_t p1 = strtol(end, &end, 10);
+        uint32_t p2 = strtol(end, &end, 10);
+        sim_post_event(id, p1, p2, NULL, 0, NULL, 0);
+    } else if (Arg(cmd, "status")) {
+        const char* state = active ? "activated" : attached ? "attached" : registered ? "registered" : "not registered";
+        uint32_t n = 0;
+        const char* parts[] = { "network ", state, failAttach ? ", attach fails" : "",
+                                failActivate ? ", activation fails" : "" };
+        for (int i = 0; i < 4; ++i)
+            for (const char* s = parts[i]; *s && n < replySize - 1; ++s) reply[n++] = *s;
+        reply[n] = '\0';
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+void sim_modem_init(T_INTERFACE_VTBL_TAG* vt)
+{
+    // serving cell of the default model
+    ParseCells("260,01,1234,5678,-70");
+
+    vt->Network_SetStatusChangedCallback = Sim_Network_SetStatusChangedCallback;
+    vt->Network_StartAttach              = Sim_Network_StartAttach;
+    vt->Network_StartDetach              = Sim_Network_StartDetach;
+    vt->Network_StartActive              = Sim_Network_StartActive;
+    vt->Network_StartDeactive            = Sim_Network_StartDeactive;
+    vt->Network_GetIp                    = Sim_Network_GetIp;
+    vt->Network_GetCellInfoRequst        = Sim_Network_GetCellInfoRequst;
+    vt->Network_GetAttachStatus          = Sim_Network_GetAttachStatus;
+    vt->Network_GetActiveStatus          = Sim_Network_GetActiveStatus;
+    vt->Network_GetSignalQuality         = Sim_Network_GetSignalQuality;
+    vt->Network_SetFlightMode            = Sim_Network_SetFlightMode;
+    vt->LBS_GetLocation                  = Sim_LBS_GetLocation;
+
+    vt->SMS_SetFormat            = Sim_SMS_SetFormat;
+    vt->SMS_SetParameter         = Sim_SMS_SetParameter;
+    vt->SMS_SetNewMessageStorage = Sim_SMS_SetNewMessageStorage;
+    vt->SMS_SendMessage          = Sim_SMS_SendMessage;
+    vt->SMS_ListMessageRequst    = Sim_SMS_ListMessageRequst;
+    vt->SMS_DeleteMessage        = Sim_SMS_DeleteMessage;
+    vt->SMS_GetStorageInfo       = Sim_SMS_GetStorageInfo;
+}
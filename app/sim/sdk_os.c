@@ -0,0 +1,467 @@
+/*
+ * Host CSDK simulator - OS, time, power management, GPIO and module information.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "sdk_sim.h"
+
+#define CLOCK_TICKS_PER_SECOND   16384      // CLOCKS_PER_MSEC is 16.384
+
+static HANDLE* userMainHandle = NULL;
+static GPIO_LEVEL gpioLevel[GPIO_PIN_MAX];
+static int32_t timeZone = 0;
+
+HANDLE sim_main_task(void)
+{
+    return userMainHandle ? *userMainHandle : 0;
+}
+
+void sim_post_event(uint32_t id, uint32_t param1, uint32_t param2,
+                    const void* data1, uint32_t len1, const void* data2, uint32_t len2)
+{
+    API_Event_t* event = host_malloc(sizeof(API_Event_t));
+    memset(event, 0, sizeof(*event));
+    event->id = id;
+    event->param1 = param1;
+    event->param2 = param2;
+    // payloads are null terminated, the application prints some of them as strings
+    if (data1) {
+        event->pParam1 = host_malloc(len1 + 1);
+        memcpy(event->pParam1, data1, len1);
+        event->pParam1[len1] = 0;
+    }
+    if (data2) {
+        event->pParam2 = host_malloc(len2 + 1);
+        memcpy(event->pParam2, data2, len2);
+        event->pParam2[len2] = 0;
+    }
+    if (!host_task_post(sim_main_task(), event, 0)) {
+        host_free(event->pParam1);
+        host_free(event->pParam2);
+        host_free(event);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// OS
+// ---------------------------------------------------------------------------
+
+static void Sim_OS_SetUserMainHandle(HANDLE* handle)
+{
+    userMainHandle = handle;
+}
+
+static HANDLE Sim_OS_GetUserMainHandle(void)
+{
+    return sim_main_task();
+}
+
+static HANDLE Sim_OS_CreateTask(PTASK_FUNC_T entry, void* param, void* stackAddr, uint16_t stackSize,
+                                uint8_t priority, uint16_t flags, uint16_t timeSlice, const char* name)
+{
+    // the CSDK stack size is in 4 byte words
+    return host_task_create(entry, param, name, (uint32_t)stackSize * 4, priority);
+}
+
+static bool Sim_OS_GetTaskInfo(HANDLE task, OS_Task_Info_t* info)
+{
+    uint32_t stackSize, priority;
+    const char* name = host_task_info(task, &stackSize, &priority, &info->stackTop);
+    if (!name) return false;
+    info->name = name;
+    info->priority = priority;
+    info->stackSize = stackSize / 4;
+    return true;
+}
+
+static bool Sim_OS_Sleep(uint32_t ms)
+{
+    host_sleep_us((uint64_t)ms * 1000);
+    host_task_woken();
+    return true;
+}
+
+static void Sim_OS_SleepUs(uint32_t us)
+{
+    host_sleep_us(us);
+}
+
+static bool Sim_OS_WaitEvent(HANDLE task, void** event, uint32_t timeout)
+{
+    return host_task_wait(task, event, timeout);
+}
+
+static bool Sim_OS_SendEvent(HANDLE task, void* event, uint32_t timeout, uint16_t option)
+{
+    return host_task_post(task, event, option == OS_EVENT_PRI_URGENT);
+}
+
+static bool Sim_OS_ResetEventQueue(HANDLE task)
+{
+    host_task_flush(task);
+    return true;
+}
+
+static bool Sim_OS_IsEventAvailable(HANDLE task)
+{
+    return host_task_pending(task);
+}
+
+static void* Sim_OS_Malloc(uint32_t size)
+{
+    return host_malloc(size);
+}
+
+static void* Sim_OS_Realloc(void* ptr, uint32_t size)
+{
+    return host_realloc(ptr, size);
+}
+
+static bool Sim_OS_Free(void* ptr)
+{
+    host_free(ptr);
+    return true;
+}
+
+static bool Sim_OS_GetHeapUsageStatus(OS_Heap_Status_t* status)
+{
+    host_heap_status(&status->usedSize, &status->totalSize);
+    return true;
+}
+
+static HANDLE Sim_OS_CreateSemaphore(uint32_t count)
+{
+    return host_sem_create(count);
+}
+
+static bool Sim_OS_DeleteSemaphore(HANDLE sem)
+{
+    host_sem_delete(sem);
+    return true;
+}
+
+static bool Sim_OS_WaitForSemaphore(HANDLE sem, uint32_t timeout)
+{
+    return host_sem_wait(sem, timeout);
+}
+
+static bool Sim_OS_ReleaseSemaphore(HANDLE sem)
+{
+    host_sem_post(sem);
+    return true;
+}
+
+static HANDLE Sim_OS_CreateMutex(void)
+{
+    return host_mutex_create();
+}
+
+static void Sim_OS_DeleteMutex(HANDLE mutex)
+{
+    host_mutex_delete(mutex);
+}
+
+static void Sim_OS_LockMutex(HANDLE mutex)
+{
+    host_mutex_lock(mutex);
+}
+
+static void Sim_OS_UnlockMutex(HANDLE mutex)
+{
+    host_mutex_unlock(mutex);
+}
+
+static bool Sim_OS_StartCallbackTimer(HANDLE task, uint32_t ms, OS_CALLBACK_FUNC_T callback, void* param)
+{
+    return host_timer_start(task, ms, callback, param);
+}
+
+static bool Sim_OS_StopCallbackTimer(HANDLE task, OS_CALLBACK_FUNC_T callback, void* param)
+{
+    return host_timer_stop(task, callback, param);
+}
+
+static uint32_t Sim_OS_QueryCallbackTimer(HANDLE task, OS_CALLBACK_FUNC_T callback, void* param)
+{
+    return host_timer_query(task, callback, param);
+}
+
+static uint32_t Sim_SYS_EnterCriticalSection(void)
+{
+    host_critical_enter();
+    return 0;
+}
+
+static void Sim_SYS_ExitCriticalSection(uint32_t status)
+{
+    host_critical_exit();
+}
+
+// ---------------------------------------------------------------------------
+// time
+// ---------------------------------------------------------------------------
+
+static time_t Sim_time(time_t* t)
+{
+    time_t now = (time_t)(host_unix_time_us() / 1000000);
+    if (t) *t = now;
+    return now;
+}
+
+static long Sim_clock(void)
+{
+    return (long)(host_uptime_us() * CLOCK_TICKS_PER_SECOND / 1000000);
+}
+
+// the module RTC runs in UTC, mktime() does not apply a time zone
+static time_t Sim_mktime(struct tm* tm)
+{
+    return (time_t)host_timegm(tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+                               tm->tm_hour, tm->tm_min, tm->tm_sec);
+}
+
+static int Sim_gettimeofday(timeval_t* tv, timezone_t* tz)
+{
+    int64_t us = host_unix_time_us();
+    if (tv) {
+        tv->tv_sec = (time_t)(us / 1000000);
+        tv->tv_usec = (long)(us % 1000000);
+    }
+    if (tz) {
+        tz->tz_minuteswest = -timeZone * 60;
+        tz->tz_dsttime = 0;
+    }
+    return 0;
+}
+
+static void Sim_TIME_SetIsAutoUpdateRtcTime(bool isAutoUpdate)
+{
+}
+
+static bool Sim_TIME_IsAutoUpdateRtcTime(void)
+{
+    return true;
+}
+
+static bool Sim_TIME_GetRtcTime(RTC_Time_t* rtc)
+{
+    int year, month, day, hour, minute, second;
+    host_gmtime(host_unix_time_us() / 1000000, &year, &month, &day, &hour, &minute, &second, NULL, NULL);
+    rtc->year = year;
+    rtc->month = month;
+    rtc->day = day;
+    rtc->hour = hour;
+    rtc->minute = minute;
+    rtc->second = second;
+    rtc->timeZone = timeZone;
+    rtc->timeZoneMinutes = 0;
+    return true;
+}
+
+static bool Sim_TIME_SetRtcTime(RTC_Time_t* rtc)
+{
+    int64_t t = host_timegm(rtc->year, rtc->month, rtc->day, rtc->hour, rtc->minute, rtc->second);
+    host_set_unix_time(t);
+    host_log("RTC set to %04u-%02u-%02u %02u:%02u:%02u", rtc->year, rtc->month, rtc->day,
+             rtc->hour, rtc->minute, rtc->second);
+    return true;
+}
+
+static uint32_t Sim_TIME_GetTime(void)
+{
+    return (uint32_t)(host_unix_time_us() / 1000000);
+}
+
+static bool Sim_TIME_TimeStamp2SystemTime(uint32_t stamp, TIME_System_t* st)
+{
+    int year, month, day, hour, minute, second, wday;
+    host_gmtime(stamp, &year, &month, &day, &hour, &minute, &second, &wday, NULL);
+    st->year = year;
+    st->month = month;
+    st->dayOfWeek = wday;
+    st->day = day;
+    st->hour = hour;
+    st->minute = minute;
+    st->second = second;
+    st->milliseconds = 0;
+    return true;
+}
+
+static uint32_t Sim_TIME_SystemTime2TimeStamp(TIME_System_t* st)
+{
+    return (uint32_t)host_timegm(st->year, st->month, st->day, st->hour, st->minute, st->second);
+}
+
+static bool Sim_TIME_GetSystemTime(TIME_System_t* st)
+{
+    int64_t us = host_unix_time_us();
+    Sim_TIME_TimeStamp2SystemTime((uint32_t)(us / 1000000), st);
+    st->milliseconds = (us / 1000) % 1000;
+    return true;
+}
+
+static bool Sim_TIME_GetLocalTime(TIME_System_t* st)
+{
+    int64_t us = host_unix_time_us() + (int64_t)timeZone * 3600 * 1000000;
+    Sim_TIME_TimeStamp2SystemTime((uint32_t)(us / 1000000), st);
+    st->milliseconds = (us / 1000) % 1000;
+    return true;
+}
+
+static int8_t Sim_TIME_GetTimeZone(void)
+{
+    return timeZone;
+}
+
+static bool Sim_TIME_SetTimeZone(int8_t zone)
+{
+    timeZone = zone;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// power management, GPIO, information
+// ---------------------------------------------------------------------------
+
+static bool Sim_PM_PowerEnable(Power_Type_t powerType, bool isOn)
+{
+    return true;
+}
+
+static void Sim_PM_SleepMode(bool isSleepMode)
+{
+    host_log("sleep mode %s", isSleepMode ? "on" : "off");
+    host_power_event("cpu", isSleepMode ? "sleep" : "run");
+}
+
+static uint16_t Sim_PM_Voltage(uint8_t* percent)
+{
+    if (percent) *percent = g_simOptions.batteryPercent;
+    // linear approximation of a Li-ion cell between 3.4 V and 4.2 V
+    return 3400 + g_simOptions.batteryPercent * 8;
+}
+
+static void Sim_PM_ShutDown(void)
+{
+    host_shutdown(0);
+}
+
+static void Sim_PM_Restart(void)
+{
+    host_restart();
+}
+
+static void Sim_PM_SetSysMinFreq(PM_Sys_Freq_t freq)
+{
+    char hz[16];
+    snprintf(hz, sizeof(hz), "%u", (uint32_t)freq);
+    host_power_event("freq", hz);
+}
+
+static bool Sim_GPIO_Init(GPIO_config_t config)
+{
+    if (config.pin < GPIO_PIN_MAX) gpioLevel[config.pin] = config.defaultLevel;
+    return true;
+}
+
+static bool Sim_GPIO_Set(GPIO_PIN pin, GPIO_LEVEL level)
+{
+    if (pin >= GPIO_PIN_MAX) return false;
+    gpioLevel[pin] = level;
+    return true;
+}
+
+static bool Sim_GPIO_Get(GPIO_PIN pin, GPIO_LEVEL* level)
+{
+    if (pin >= GPIO_PIN_MAX) return false;
+    *level = gpioLevel[pin];
+    return true;
+}
+
+static bool Sim_GPIO_Close(GPIO_PIN pin)
+{
+    return true;
+}
+
+static bool Sim_INFO_GetIMEI(uint8_t* imei)
+{
+    strcpy((char*)imei, g_simOptions.imei);
+    return true;
+}
+
+static bool Sim_SIM_GetICCID(uint8_t* iccid)
+{
+    strcpy((char*)iccid, "89000000000000000001");
+    return true;
+}
+
+static bool Sim_SIM_GetIMSI(uint8_t* imsi)
+{
+    strcpy((char*)imsi, "260010000000001");
+    return true;
+}
+
+void sim_os_init(T_INTERFACE_VTBL_TAG* vt)
+{
+    vt->OS_SetUserMainHandle     = Sim_OS_SetUserMainHandle;
+    vt->OS_GetUserMainHandle     = Sim_OS_GetUserMainHandle;
+    vt->OS_CreateTask            = Sim_OS_CreateTask;
+    vt->OS_Sleep                 = Sim_OS_Sleep;
+    vt->OS_SleepUs               = Sim_OS_SleepUs;
+    vt->OS_WaitEvent             = Sim_OS_WaitEvent;
+    vt->OS_SendEvent             = Sim_OS_SendEvent;
+    vt->OS_ResetEventQueue       = Sim_OS_ResetEventQueue;
+    vt->OS_IsEventAvailable      = Sim_OS_IsEventAvailable;
+    vt->OS_Malloc                = Sim_OS_Malloc;
+    vt->OS_Realloc               = Sim_OS_Realloc;
+    vt->OS_Free                  = Sim_OS_Free;
+    vt->OS_GetHeapUsageStatus    = Sim_OS_GetHeapUsageStatus;
+    vt->OS_GetTaskInfo           = Sim_OS_GetTaskInfo;
+    vt->OS_CreateSemaphore       = Sim_OS_CreateSemaphore;
+    vt->OS_DeleteSemaphore       = Sim_OS_DeleteSemaphore;
+    vt->OS_WaitForSemaphore      = Sim_OS_WaitForSemaphore;
+    vt->OS_ReleaseSemaphore      = Sim_OS_ReleaseSemaphore;
+    vt->OS_CreateMutex           = Sim_OS_CreateMutex;
+    vt->OS_DeleteMutex           = Sim_OS_DeleteMutex;
+    vt->OS_LockMutex             = Sim_OS_LockMutex;
+    vt->OS_UnlockMutex           = Sim_OS_UnlockMutex;
+    vt->OS_StartCallbackTimer    = Sim_OS_StartCallbackTimer;
+    vt->OS_StopCallbackTimer     = Sim_OS_StopCallbackTimer;
+    vt->OS_QueryCallbackTimer    = Sim_OS_QueryCallbackTimer;
+    vt->SYS_EnterCriticalSection = Sim_SYS_EnterCriticalSection;
+    vt->SYS_ExitCriticalSection  = Sim_SYS_ExitCriticalSection;
+
+    vt->time                        = Sim_time;
+    vt->clock                       = Sim_clock;
+    vt->mktime                      = Sim_mktime;
+    vt->timelocal                   = Sim_mktime;
+    vt->gettimeofday                = Sim_gettimeofday;
+    vt->TIME_SetIsAutoUpdateRtcTime = Sim_TIME_SetIsAutoUpdateRtcTime;
+    vt->TIME_IsAutoUpdateRtcTime    = Sim_TIME_IsAutoUpdateRtcTime;
+    vt->TIME_GetRtcTime             = Sim_TIME_GetRtcTime;
+    vt->TIME_SetRtcTime             = Sim_TIME_SetRtcTime;
+    vt->TIME_GetTime                = Sim_TIME_GetTime;
+    vt->TIME_GetSystemTime          = Sim_TIME_GetSystemTime;
+    vt->TIME_GetLocalTime           = Sim_TIME_GetLocalTime;
+    vt->TIME_GetTimeZone            = Sim_TIME_GetTimeZone;
+    vt->TIME_SetTimeZone            = Sim_TIME_SetTimeZone;
+    vt->TIME_SystemTime2TimeStamp   = Sim_TIME_SystemTime2TimeStamp;
+    vt->TIME_TimeStamp2SystemTime   = Sim_TIME_TimeStamp2SystemTime;
+
+    vt->PM_PowerEnable   = Sim_PM_PowerEnable;
+    vt->PM_SleepMode     = Sim_PM_SleepMode;
+    vt->PM_Voltage       = Sim_PM_Voltage;
+    vt->PM_ShutDown      = Sim_PM_ShutDown;
+    vt->PM_Restart       = Sim_PM_Restart;
+    vt->PM_SetSysMinFreq = Sim_PM_SetSysMinFreq;
+
+    vt->GPIO_Init  = Sim_GPIO_Init;
+    vt->GPIO_Set   = Sim_GPIO_Set;
+    vt->GPIO_Get   = Sim_GPIO_Get;
+    vt->GPIO_Close = Sim_GPIO_Close;
+
+    vt->INFO_GetIMEI  = Sim_INFO_GetIMEI;
+    vt->SIM_GetICCID  = Sim_SIM_GetICCID;
+    vt->SIM_GetIMSI   = Sim_SIM_GetIMSI;
+}
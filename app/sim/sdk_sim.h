@@ -0,0 +1,32 @@
+#ifndef SDK_SIM_H
+#define SDK_SIM_H
+
+/**
+ * Host CSDK simulator - declarations shared by the sdk_*.c files, which are compiled
+ * against the CSDK headers. Only sdk_init.h is included, as the api_*.h headers map
+ * the SDK functions to the interface table entries these files define.
+ */
+
+#include <sdk_init.h>
+#include <api_event.h>
+
+#include "sim_host.h"
+
+void sim_libc_init(T_INTERFACE_VTBL_TAG* vt);
+void sim_os_init(T_INTERFACE_VTBL_TAG* vt);
+void sim_fs_init(T_INTERFACE_VTBL_TAG* vt);
+void sim_socket_init(T_INTERFACE_VTBL_TAG* vt);
+void sim_uart_init(T_INTERFACE_VTBL_TAG* vt);
+void sim_modem_init(T_INTERFACE_VTBL_TAG* vt);
+
+// starts the network registration, after the application tasks are running
+void sim_modem_boot(void);
+// true while a PDP context is active, sockets can only connect then
+bool sim_modem_is_active(void);
+
+HANDLE sim_main_task(void);
+// posts an event to the application main task; the payloads are copied
+void   sim_post_event(uint32_t id, uint32_t param1, uint32_t param2,
+                      const void* data1, uint32_t len1, const void* data2, uint32_t len2);
+
+#endif // SDK_SIM_H
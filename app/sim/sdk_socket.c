@@ -0,0 +1,233 @@
+/*
+ * Host CSDK simulator - lwIP socket API, DNS and SSL.
+ *
+ * TCP and UDP sockets are host sockets; they can only connect while the simulated PDP
+ * context is active, like on the module. SSL is not simulated, use an http:// server URL.
+ */
+#include <string.h>
+
+#include "sdk_sim.h"
+
+static int Sim_lwip_socket(int domain, int type, int protocol)
+{
+    if (domain != AF_INET || (type != SOCK_STREAM && type != SOCK_DGRAM)) {
+        host_log("only TCP and UDP IPv4 sockets are simulated");
+        return -1;
+    }
+    return host_sock_open(type == SOCK_DGRAM);
+}
+
+static int Sim_lwip_connect(int s, const struct sockaddr* name, socklen_t namelen)
+{
+    if (!sim_modem_is_active()) {
+        host_log("connect: no active PDP context");
+        return -1;
+    }
+    const struct sockaddr_in* sa = (const struct sockaddr_in*)name;
+    return host_sock_connect(s, sa->sin_addr.s_addr, sa->sin_port);
+}
+
+static ssize_t Sim_lwip_send(int s, const void* data, size_t size, int flags)
+{
+    return host_sock_send(s, data, size);
+}
+
+static ssize_t Sim_lwip_write(int s, const void* data, size_t size)
+{
+    return host_sock_send(s, data, size);
+}
+
+static ssize_t Sim_lwip_recv(int s, void* mem, size_t len, int flags)
+{
+    return host_sock_recv(s, mem, len, flags & MSG_DONTWAIT);
+}
+
+static ssize_t Sim_lwip_read(int s, void* mem, size_t len)
+{
+    return host_sock_recv(s, mem, len, 0);
+}
+
+static int Sim_lwip_close(int s)
+{
+    return host_sock_close(s);
+}
+
+static int Sim_lwip_shutdown(int s, int how)
+{
+    return host_sock_shutdown(s, how);
+}
+
+static int Sim_lwip_setsockopt(int s, int level, int optname, const void* optval, socklen_t optlen)
+{
+    return 0;
+}
+
+static int Sim_lwip_fcntl(int s, int cmd, int val)
+{
+    return 0;
+}
+
+static uint32_t FdSetToMask(int maxfdp1, const fd_set* set)
+{
+    uint32_t mask = 0;
+    if (!set) return 0;
+    for (int s = LWIP_SOCKET_OFFSET; s < maxfdp1 && s <= SIM_SOCKET_MAX; ++s)
+        if (FD_ISSET(s, set)) mask |= 1u << s;
+    return mask;
+}
+
+static void MaskToFdSet(uint32_t mask, fd_set* set)
+{
+    if (!set) return;
+    FD_ZERO(set);
+    for (int s = LWIP_SOCKET_OFFSET; s <= SIM_SOCKET_MAX; ++s)
+        if (mask & (1u << s)) FD_SET(s, set);
+}
+
+static int Sim_lwip_select(int maxfdp1, fd_set* readset, fd_set* writeset, fd_set* exceptset, struct timeval* timeout)
+{
+    uint32_t r = FdSetToMask(maxfdp1, readset);
+    uint32_t w = FdSetToMask(maxfdp1, writeset);
+    uint32_t e = FdSetToMask(maxfdp1, exceptset);
+    int64_t us = timeout ? (int64_t)timeout->tv_sec * 1000000 + timeout->tv_usec : -1;
+    int ret = host_sock_select(readset ? &r : NULL, writeset ? &w : NULL, exceptset ? &e : NULL, us);
+    if (ret < 0) return ret;
+    MaskToFdSet(r, readset);
+    MaskToFdSet(w, writeset);
+    MaskToFdSet(e, exceptset);
+    return ret;
+}
+
+static int Sim_Socket_GetLastError(void)
+{
+    return host_sock_errno();
+}
+
+static uint16_t Sim_lwip_htons(uint16_t x)
+{
+    return (uint16_t)((x << 8) | (x >> 8));
+}
+
+static uint32_t Sim_lwip_htonl(uint32_t x)
+{
+    return (x << 24) | ((x << 8) & 0xFF0000) | ((x >> 8) & 0xFF00) | (x >> 24);
+}
+
+static int Sim_ip4addr_aton(const char* cp, ip4_addr_t* addr)
+{
+    uint32_t parts[4];
+    int n = 0;
+    while (n < 4) {
+        if (*cp < '0' || *cp > '9') return 0;
+        uint32_t v = 0;
+        while (*cp >= '0' && *cp <= '9') v = v * 10 + (*cp++ - '0');
+        if (v > 255) return 0;
+        parts[n++] = v;
+        if (*cp != '.') break;
+        cp++;
+    }
+    if (n != 4 || (*cp && *cp != ' ')) return 0;
+    // network byte order on a little endian host
+    if (addr) addr->addr = parts[0] | parts[1] << 8 | parts[2] << 16 | parts[3] << 24;
+    return 1;
+}
+
+static char* Sim_ip4addr_ntoa_r(const ip4_addr_t* addr, char* buf, int buflen)
+{
+    const uint8_t* b = (const uint8_t*)&addr->addr;
+    char tmp[16];
+    int n = 0;
+    for (int i = 0; i < 4; ++i) {
+        uint8_t v = b[i];
+        if (v >= 100) tmp[n++] = '0' + v / 100;
+        if (v >= 10)  tmp[n++] = '0' + v / 10 % 10;
+        tmp[n++] = '0' + v % 10;
+        tmp[n++] = i < 3 ? '.' : '\0';
+    }
+    if (n > buflen) return NULL;
+    memcpy(buf, tmp, n);
+    return buf;
+}
+
+static char* Sim_ip4addr_ntoa(const ip4_addr_t* addr)
+{
+    static char buf[16];
+    return Sim_ip4addr_ntoa_r(addr, buf, sizeof(buf));
+}
+
+static int32_t Sim_DNS_GetHostByName2(const uint8_t* domain, uint8_t* ip)
+{
+    ip4_addr_t addr;
+    if (!sim_modem_is_active() || host_dns_resolve((const char*)domain, &addr.addr) != 0) {
+        host_log("DNS lookup of %s failed", domain);
+        return -1;
+    }
+    Sim_ip4addr_ntoa_r(&addr, (char*)ip, 16);
+    return 0;
+}
+
+static DNS_Status_t Sim_DNS_GetHostByName(const char* domain, char* ip)
+{
+    return Sim_DNS_GetHostByName2((const uint8_t*)domain, (uint8_t*)ip) == 0 ? DNS_STATUS_OK : DNS_STATUS_ERROR;
+}
+
+static SSL_Error_t Sim_SSL_Init(SSL_Config_t* config)
+{
+    return SSL_ERROR_NONE;
+}
+
+static SSL_Error_t Sim_SSL_Connect(SSL_Config_t* config, const char* server, const char* port)
+{
+    host_log("SSL is not supported by the simulator, use an http:// server");
+    return SSL_ERROR_CONNECTION;
+}
+
+static int Sim_SSL_Write(SSL_Config_t* config, uint8_t* data, int length, int timeoutMs)
+{
+    return SSL_ERROR_CONNECTION;
+}
+
+static int Sim_SSL_Read(SSL_Config_t* config, uint8_t* data, int length, int timeoutMs)
+{
+    return SSL_ERROR_CONNECTION;
+}
+
+static SSL_Error_t Sim_SSL_Close(SSL_Config_t* config)
+{
+    return SSL_ERROR_NONE;
+}
+
+static SSL_Error_t Sim_SSL_Destroy(SSL_Config_t* config)
+{
+    return SSL_ERROR_NONE;
+}
+
+void sim_socket_init(T_INTERFACE_VTBL_TAG* vt)
+{
+    vt->lwip_socket         = Sim_lwip_socket;
+    vt->lwip_connect        = Sim_lwip_connect;
+    vt->lwip_send           = Sim_lwip_send;
+    vt->lwip_write          = Sim_lwip_write;
+    vt->lwip_recv           = Sim_lwip_recv;
+    vt->lwip_read           = Sim_lwip_read;
+    vt->lwip_close          = Sim_lwip_close;
+    vt->lwip_shutdown       = Sim_lwip_shutdown;
+    vt->lwip_setsockopt     = Sim_lwip_setsockopt;
+    vt->lwip_fcntl          = Sim_lwip_fcntl;
+    vt->lwip_select         = Sim_lwip_select;
+    vt->lwip_htons          = Sim_lwip_htons;
+    vt->lwip_htonl          = Sim_lwip_htonl;
+    vt->Socket_GetLastError = Sim_Socket_GetLastError;
+    vt->ip4addr_aton        = Sim_ip4addr_aton;
+    vt->ip4addr_ntoa        = Sim_ip4addr_ntoa;
+    vt->ip4addr_ntoa_r      = Sim_ip4addr_ntoa_r;
+    vt->DNS_GetHostByName   = Sim_DNS_GetHostByName;
+    vt->DNS_GetHostByName2  = Sim_DNS_GetHostByName2;
+
+    vt->SSL_Init    = Sim_SSL_Init;
+    vt->SSL_Connect = Sim_SSL_Connect;
+    vt->SSL_Write   = Sim_SSL_Write;
+    vt->SSL_Read    = Sim_SSL_Read;
+    vt->SSL_Close   = Sim_SSL_Close;
+    vt->SSL_Destroy = Sim_SSL_Destroy;
+}
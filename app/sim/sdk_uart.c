@@ -0,0 +1,272 @@
+/*
+ * Host CSDK simulator - UART and GPS.
+ *
+ * UART1 is the host console. UART2 is connected to an emulated GPS chip which
+ * acknowledges the $PGKC commands of the GPS library and outputs the NMEA data
+ * replayed by host_main.c. The standby command ($PGKC051) stops the output until
+ * the next command arrives, like the GK9501 does. $PGKC149,1 switches to binary
+ * frames for the AGPS GPD upload; the NMEA output pauses until the binary format
+ * command switches back. With --gps-ack-delay the answers come that long after the
+ * commands, each on its own: the commands are not processed one after the other.
+ */
+#include <string.h>
+
+#include "sdk_sim.h"
+
+#define GPS_CMD_LINE_MAX   600     // a binary GPD pack is 523 bytes
+#define GPS_REPLY_MAX      8       // answers on the way with --gps-ack-delay
+#define GPS_REPLY_LEN      64
+
+static UART_Config_t uartConfig[UART_PORT_MAX];
+static bool          uartOpen[UART_PORT_MAX];
+static volatile bool gpsOpen = false;
+static volatile bool gpsStandby = false;
+static volatile bool gpsBinary = false;
+static uint32_t      gpdBytes = 0;
+static uint8_t       gpsCmd[GPS_CMD_LINE_MAX];
+static uint32_t      gpsCmdLen = 0;
+
+typedef struct {
+    bool     used;
+    uint32_t len;
+    uint8_t  data[GPS_REPLY_LEN];
+} GpsReply_t;
+static GpsReply_t    gpsReplies[GPS_REPLY_MAX];
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// delivers data the way the application configured the port
+static void UartDeliver(UART_Port_t port, uint32_t eventId, const uint8_t* data, uint32_t len)
+{
+    if (uartConfig[port].rxCallback) {
+        UART_Callback_Param_t param = { port, len, (char*)data };
+        uartConfig[port].rxCallback(param);
+    } else if (eventId == API_EVENT_ID_GPS_UART_RECEIVED) {
+        sim_post_event(eventId, len, 0, data, len, NULL, 0);
+    } else if (uartConfig[port].useEvent) {
+        sim_post_event(eventId, port, len, data, len, NULL, 0);
+    }
+}
+
+void sim_uart_rx(const uint8_t* data, uint32_t len)
+{
+    if (uartOpen[UART1]) UartDeliver(UART1, API_EVENT_ID_UART_RECEIVED, data, len);
+}
+
+int sim_gps_is_open(void)
+{
+    return gpsOpen && !gpsStandby && !gpsBinary;
+}
+
+void sim_gps_rx(const uint8_t* data, uint32_t len)
+{
+    if (gpsOpen) UartDeliver(UART2, API_EVENT_ID_GPS_UART_RECEIVED, data, len);
+}
+
+// ---------------------------------------------------------------------------
+// GPS chip
+// ---------------------------------------------------------------------------
+
+static void GpsReplyDue(void* param)
+{
+    GpsReply_t* reply = (GpsReply_t*)param;
+    sim_gps_rx(reply->data, reply->len);
+    host_critical_enter();
+    reply->used = false;
+    host_critical_exit();
+}
+
+static void GpsReply(const uint8_t* data, uint32_t len)
+{
+    GpsReply_t* reply = NULL;
+    if (g_simOptions.gpsAckDelayMs && len <= GPS_REPLY_LEN) {
+        host_critical_enter();
+        for (int i = 0; i < GPS_REPLY_MAX && !reply; ++i)
+            if (!gpsReplies[i].used) reply = &gpsReplies[i];
+        if (reply) reply->used = true;
+        host_critical_exit();
+    }
+    if (!reply) {
+        sim_gps_rx(data, len);
+        return;
+    }
+    memcpy(reply->data, data, len);
+    reply->len = len;
+    host_timer_start((uint32_t)sim_main_task(), g_simOptions.gpsAckDelayMs, GpsReplyDue, reply);
+}
+
+static void GpsReplyNmea(const char* body)
+{
+    char line[GPS_CMD_LINE_MAX];
+    uint8_t cs = 0;
+    for (const char* p = body + 1; *p; ++p) cs ^= (uint8_t)*p;
+    uint32_t n = 0;
+    while (body[n] && n < sizeof(line) - 6) {
+        line[n] = body[n];
+        n++;
+    }
+    line[n++] = '*';
+    line[n++] = hexDigits[cs >> 4];
+    line[n++] = hexDigits[cs & 0x0F];
+    line[n++] = '\r';
+    line[n++] = '\n';
+    GpsReply((const uint8_t*)line, n);
+}
+
+static void GpsCommand(const uint8_t* cmd, uint32_t len)
+{
+    if (len >= 8 && cmd[0] == 0xAA && cmd[1] == 0xF0) {
+        // binary command: AA F0 <length:2> <id:2> ... <checksum> 0D 0A
+        int id = cmd[4] | cmd[5] << 8;
+        uint8_t ack[12] = { 0xAA, 0xF0, 12, 0, 0x01, 0x00, cmd[4], cmd[5], 3, 0, 0x0D, 0x0A };
+        if (id == 614) {
+            // GPD pack <index:2> <512 bytes>, acked with its index; index 0xFFFF ends the file
+            ack[4] = 3;
+            ack[6] = cmd[6];
+            ack[7] = cmd[7];
+            ack[8] = 1;
+            if (cmd[6] == 0xFF && cmd[7] == 0xFF) {
+                host_log("GPS received %u bytes of GPD data", gpdBytes);
+                gpdBytes = 0;
+            } else {
+                gpdBytes += 512;
+            }
+        }
+        uint8_t cs = ack[2];
+        for (int i = 3; i < 9; ++i) cs ^= ack[i];
+        ack[9] = cs;
+        if (id == 149 && cmd[6] == 0) {
+            // back to NMEA, acked in NMEA
+            gpsBinary = false;
+            GpsReplyNmea("$PGKC001,149,3");
+            return;
+        }
+        GpsReply(ack, sizeof(ack));
+        return;
+    }
+    if (len < 8 || memcmp(cmd, "$PGKC", 5) != 0) return;
+
+    int id = (cmd[5] - '0') * 100 + (cmd[6] - '0') * 10 + (cmd[7] - '0');
+    if (gpsStandby) {
+        gpsStandby = false;
+        host_log("GPS standby ended");
+        host_power_event("gps", "on");
+    }
+    char body[64];
+    if (id == 462) {
+        strcpy(body, "$PGKC463,GOKE9501_1.3_17101100");
+    } else {
+        strcpy(body, "$PGKC001,");
+        char* p = body + strlen(body);
+        if (id >= 100) *p++ = '0' + id / 100;
+        if (id >= 10)  *p++ = '0' + id / 10 % 10;
+        *p++ = '0' + id % 10;
+        strcpy(p, ",3");        // executed successfully
+    }
+    GpsReplyNmea(body);
+    if (id == 149 && len > 9 && cmd[9] == '1') {
+        gpsBinary = true;
+    } else if (id == 639) {
+        char seed[64];
+        uint32_t n = 0;
+        while (n + 9 < len && cmd[n + 9] != '*' && n < sizeof(seed) - 1) {
+            seed[n] = (char)cmd[n + 9];
+            n++;
+        }
+        seed[n] = '\0';
+        host_log("GPS reference position and time %s", seed);
+    }
+    if (id == 51) {
+        gpsStandby = true;
+        host_log("GPS standby");
+        host_power_event("gps", "standby");
+    }
+}
+
+static void GpsWrite(const uint8_t* data, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i) {
+        if (gpsCmdLen < sizeof(gpsCmd)) gpsCmd[gpsCmdLen++] = data[i];
+        // binary frames carry their length, their data may contain '\n'
+        bool binary = gpsCmdLen >= 4 && gpsCmd[0] == 0xAA && gpsCmd[1] == 0xF0;
+        uint32_t frameLen = binary ? (uint32_t)(gpsCmd[2] | gpsCmd[3] << 8) : 0;
+        if (binary ? gpsCmdLen >= frameLen || gpsCmdLen == sizeof(gpsCmd) : data[i] == '\n') {
+            GpsCommand(gpsCmd, gpsCmdLen);
+            gpsCmdLen = 0;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// CSDK functions
+// ---------------------------------------------------------------------------
+
+static bool Sim_UART_Init(UART_Port_t port, UART_Config_t config)
+{
+    if (port <= 0 || port >= UART_PORT_MAX) return false;
+    uartConfig[port] = config;
+    uartOpen[port] = true;
+    return true;
+}
+
+static uint32_t Sim_UART_Write(UART_Port_t port, uint8_t* data, uint32_t length)
+{
+    if (port == UART2) {
+        if (gpsOpen) GpsWrite(data, length);
+    } else {
+        host_uart_write(port, data, length);
+    }
+    return length;
+}
+
+static uint32_t Sim_UART_Read(UART_Port_t port, uint8_t* data, uint32_t length, uint32_t timeOutMs)
+{
+    if (timeOutMs) host_sleep_us((uint64_t)timeOutMs * 1000);
+    return 0;
+}
+
+static bool Sim_UART_Close(UART_Port_t port)
+{
+    if (port <= 0 || port >= UART_PORT_MAX) return false;
+    uartOpen[port] = false;
+    return true;
+}
+
+static bool Sim_GPS_Open(UART_Callback_t callback)
+{
+    memset(&uartConfig[UART2], 0, sizeof(uartConfig[UART2]));
+    uartConfig[UART2].rxCallback = callback;
+    uartOpen[UART2] = true;
+    gpsCmdLen = 0;
+    gpsStandby = false;
+    gpsBinary = false;
+    gpsOpen = true;
+    host_log("GPS on");
+    host_power_event("gps", "on");
+    return true;
+}
+
+static bool Sim_GPS_Close(void)
+{
+    gpsOpen = false;
+    uartOpen[UART2] = false;
+    host_log("GPS off");
+    host_power_event("gps", "off");
+    return true;
+}
+
+static bool Sim_GPS_IsOpen(void)
+{
+    return gpsOpen;
+}
+
+void sim_uart_init(T_INTERFACE_VTBL_TAG* vt)
+{
+    vt->UART_Init  = Sim_UART_Init;
+    vt->UART_Write = Sim_UART_Write;
+    vt->UART_Read  = Sim_UART_Read;
+    vt->UART_Close = Sim_UART_Close;
+    vt->GPS_Open   = Sim_GPS_Open;
+    vt->GPS_Close  = Sim_GPS_Close;
+    vt->GPS_IsOpen = Sim_GPS_IsOpen;
+}
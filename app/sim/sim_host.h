@@ -0,0 +1,268 @@
+#ifndef SIM_HOST_H
+#define SIM_HOST_H
+
+/**
+ * Host CSDK simulator - interface between the two halves of the simulator.
+ *
+ * sdk_*.c files are compiled like the firmware, against the CSDK headers, and fill the
+ * CSDK interface table (g_InterfaceVtbl). host_*.c files are compiled against the host
+ * C library and implement tasks, timers, sockets, files and the console with POSIX calls.
+ * The two halves only exchange the plain types used in this header.
+ */
+
+#include <stdint.h>
+#include <stdarg.h>
+
+typedef void (*sim_func_t)(void* param);
+
+#define SIM_WAIT_FOREVER    0xFFFFFFFF
+
+// ---------------------------------------------------------------------------
+// Host side (host_*.c), called by the CSDK implementation
+// ---------------------------------------------------------------------------
+
+// tasks: handles are small non-zero numbers; tasks created before host_start_tasks()
+// (i.e. while app_Main runs) are held until it is called
+// stackSize in bytes; the host thread gets at least 256 KB, the host C library needs more
+uint32_t host_task_create(sim_func_t entry, void* param, const char* name, uint32_t stackSize, uint32_t priority);
+uint32_t host_task_current(void);
+int      host_task_post(uint32_t task, void* event, int urgent);
+int      host_task_wait(uint32_t task, void** event, uint32_t timeoutMs);
+int      host_task_pending(uint32_t task);
+void     host_task_flush(uint32_t task);
+void     host_start_tasks(void);
+// name, or NULL for an invalid handle; stackTop is the highest address of the thread stack
+const char* host_task_info(uint32_t task, uint32_t* stackSize, uint32_t* priority, uint32_t* stackTop);
+// CPU time and stack of every task thread as text lines
+void     host_task_report(char* buffer, uint32_t size);
+// the calling task woke up: an event, a timer callback, a semaphore or the end of a sleep
+void     host_task_woken(void);
+
+// callback timers, executed by the target task while it waits for events;
+// a timer is identified by (task, callback, param)
+int      host_timer_start(uint32_t task, uint32_t ms, sim_func_t callback, void* param);
+int      host_timer_stop(uint32_t task, sim_func_t callback, void* param);
+uint32_t host_timer_query(uint32_t task, sim_func_t callback, void* param);
+
+uint32_t host_mutex_create(void);
+void     host_mutex_delete(uint32_t mutex);
+void     host_mutex_lock(uint32_t mutex);
+void     host_mutex_unlock(uint32_t mutex);
+uint32_t host_sem_create(uint32_t count);
+void     host_sem_delete(uint32_t sem);
+int      host_sem_wait(uint32_t sem, uint32_t timeoutMs);
+void     host_sem_post(uint32_t sem);
+void     host_critical_enter(void);     // recursive
+void     host_critical_exit(void);
+void     host_sleep_us(uint64_t us);
+
+void*    host_malloc(uint32_t size);
+void*    host_realloc(void* ptr, uint32_t size);
+void     host_free(void* ptr);
+void     host_heap_status(uint32_t* used, uint32_t* total);
+uint32_t host_heap_peak(int reset);     // highest use since the last reset
+
+// time
+uint64_t host_uptime_us(void);
+int64_t  host_unix_time_us(void);
+void     host_set_unix_time(int64_t seconds);
+int64_t  host_timegm(int year, int month, int day, int hour, int minute, int second);
+void     host_gmtime(int64_t t, int* year, int* month, int* day, int* hour, int* minute, int* second, int* wday, int* yday);
+
+// C library
+int      host_vsnprintf(char* buf, uint32_t size, const char* fmt, va_list ap);
+int      host_vsscanf(const char* buf, const char* fmt, va_list ap);
+double   host_strtod(const char* s);
+int64_t  host_strtoll(const char* s, int base);
+char*    host_gcvt(double value, int ndigit, char* buf);
+int      host_rand(void);
+void     host_srand(uint32_t seed);
+
+// console, trace and process control
+void     host_uart_write(int port, const uint8_t* data, uint32_t len);
+void     host_trace(const char* fmt, va_list ap);
+void     host_log(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void     host_sms_sent(const char* number, const uint8_t* text, uint32_t len);
+void     host_restart(void);
+// power state change for the power log, e.g. ("gps", "standby") or ("cpu", "sleep")
+void     host_power_event(const char* part, const char* state);
+// a task woke up; logged while the CPU is in sleep mode, each wake-up runs the CPU a while
+void     host_power_wake(const char* task);
+void     host_shutdown(int code);
+
+// file system; paths are device paths ("/t/gps_log.txt"), mapped below the root directory
+#define SIM_FS_RDONLY   0x00
+#define SIM_FS_WRONLY   0x01
+#define SIM_FS_RDWR     0x02
+#define SIM_FS_CREAT    0x10
+#define SIM_FS_EXCL     0x20
+#define SIM_FS_TRUNC    0x40
+#define SIM_FS_APPEND   0x80
+
+int32_t  host_fs_open(const char* path, uint32_t flags);
+int32_t  host_fs_close(int32_t fd);
+int32_t  host_fs_read(int32_t fd, uint8_t* buf, uint32_t len);
+int32_t  host_fs_write(int32_t fd, const uint8_t* buf, uint32_t len);
+int32_t  host_fs_flush(int32_t fd);
+int64_t  host_fs_seek(int32_t fd, int64_t offset, int whence);
+int64_t  host_fs_size(int32_t fd);
+int32_t  host_fs_delete(const char* path);
+int32_t  host_fs_rename(const char* from, const char* to);
+int32_t  host_fs_mkdir(const char* path);
+int32_t  host_fs_rmdir(const char* path);
+int32_t  host_fs_info(const char* device, uint64_t* total, uint64_t* used);
+int32_t  host_fs_opendir(const char* path);
+int32_t  host_fs_readdir(int32_t dir, char* name, uint32_t size, int* isDir);
+void     host_fs_closedir(int32_t dir);
+
+// TCP and UDP sockets; socket numbers are 1..SIM_SOCKET_MAX like lwIP's, addresses and
+// ports are in network byte order
+#define SIM_SOCKET_MAX  8
+
+int32_t  host_sock_open(int datagram);
+int32_t  host_sock_connect(int32_t s, uint32_t addr, uint16_t port);
+int32_t  host_sock_send(int32_t s, const void* data, uint32_t len);
+int32_t  host_sock_recv(int32_t s, void* data, uint32_t len, int nonblock);
+int32_t  host_sock_close(int32_t s);
+int32_t  host_sock_shutdown(int32_t s, int how);
+// sets are bit masks, bit n for socket n
+int32_t  host_sock_select(uint32_t* readSet, uint32_t* writeSet, uint32_t* exceptSet, int64_t timeoutUs);
+int32_t  host_sock_errno(void);
+int32_t  host_dns_resolve(const char* name, uint32_t* addr);
+// a request/response exchange on a new connection (LBS), in the link model's counters and
+// delays; -1 if the link lost it
+int32_t  host_link_exchange(uint32_t sent, uint32_t received);
+// link model counters as "name value" lines
+void     host_link_stats(char* buffer, uint32_t size);
+int      host_link_stats_write(const char* path);
+
+// ---------------------------------------------------------------------------
+// CSDK side (sdk_*.c), called by the host side
+// ---------------------------------------------------------------------------
+
+// sets up the interface table and runs app_Main()
+void     sim_sdk_boot(void);
+// sets up the interface table only, for the benchmarks
+void     sim_sdk_init(void);
+
+// UART1 input (console); ignored until the application opened the port
+void     sim_uart_rx(const uint8_t* data, uint32_t len);
+// NMEA output of the emulated GPS chip; ignored while the GPS is off
+int      sim_gps_is_open(void);
+void     sim_gps_rx(const uint8_t* data, uint32_t len);
+
+// network model, see sdk_modem.c for the commands
+int      sim_modem_command(const char* cmd, char* reply, uint32_t replySize);
+void     sim_modem_tick(void);
+
+// GPS data path of the application, for the benchmarks (sdk_bench.c)
+typedef struct {
+    uint32_t frames;
+    uint32_t sentences;
+    uint32_t invalid;
+    uint32_t failed;
+    uint32_t dropped;
+    uint32_t overflows;
+} sim_gps_stats_t;
+
+void     sim_bench_gps_init(void);
+// one GPS_UART_RECEIVED event: GPS_Update() and gps_Process(), as in system.c
+void     sim_bench_gps_feed(const uint8_t* data, uint32_t len);
+int      sim_bench_gps_valid(void);
+void     sim_bench_gps_stats(sim_gps_stats_t* stats);
+// the reported position (after the filter, when enabled)
+void     sim_bench_gps_position(double* latitude, double* longitude);
+// config gps_filter, gps_filter_accel and gps_uere
+void     sim_bench_filter_config(int enabled, float accel, float uere);
+
+// a fix for sim_bench_filter_run(), as GpsFilter_Fix_t
+typedef struct {
+    double time;                // s
+    double latitude;
+    double longitude;
+    float  speed;               // knots
+    float  bearing;
+    float  accuracy;            // m
+} sim_fix_t;
+
+// the reported fix: position, speed and accuracy (not the time)
+void     sim_bench_gps_fix(sim_fix_t* fix);
+// GpsFilter_Update() over the fixes, in place; returns the number of rejected fixes
+uint32_t sim_bench_filter_run(sim_fix_t* fixes, uint32_t count, float accel);
+// TrackSimplify_Add() over the fixes and a final flush; the kept fixes (time, latitude and
+// longitude) go to kept[], which holds count entries; returns their number
+uint32_t sim_bench_track_run(const sim_fix_t* fixes, uint32_t count, float tolerance, sim_fix_t* kept);
+// a trip found by sim_bench_trip_run(), as the TRIP_EVENT_END event
+typedef struct {
+    double start, end;          // s
+    double latitude, longitude; // where it ended
+    float  distance;            // m
+    float  maxSpeed;            // knots
+} sim_trip_t;
+
+// TripDetector_Update() over the fixes, then the stop time after the last one; the ended
+// trips go to trips[] (at most maxTrips), the final odometer (m) to *odometer
+uint32_t sim_bench_trip_run(const sim_fix_t* fixes, uint32_t count, uint32_t stopTime,
+                            sim_trip_t* trips, uint32_t maxTrips, double* odometer);
+// a geofence set with room for the given numbers of fences, vertices, grid cells and items
+int      sim_bench_geofence_setup(uint32_t maxFences, uint32_t maxPoints, uint32_t maxCells, uint32_t maxItems);
+// GeofenceSet_Add() of a line of the geofence file; 0 on success
+int      sim_bench_geofence_add(const char* line);
+// GeofenceSet_BuildIndex(), then without the grid unless grid is set (every fence is tested)
+void     sim_bench_geofence_index(int grid, uint32_t* width, uint32_t* height, uint32_t* items);
+// GeofenceSet_Check() of a track in 1e-6 degrees from the boot state; returns the fences tested
+uint32_t sim_bench_geofence_run(const int32_t* latitudes, const int32_t* longitudes, uint32_t count,
+                                float margin, uint32_t* enters, uint32_t* exits);
+
+// mk_time() of a minmea date (two digit year) and time
+uint32_t sim_bench_mk_time(int year, int month, int day, int hour, int minute, int second);
+int32_t  sim_bench_days_from_civil(int year, unsigned month, unsigned day);
+void     sim_bench_civil_from_days(int32_t days, int* year, unsigned* month, unsigned* day);
+// time_to_rtc() into fields (year, month, day, hour, minute, second), then rtc_to_time()
+uint32_t sim_bench_rtc_round_trip(uint32_t t, int* fields);
+// mk_time() of count dates of 6 bytes (yy, mm, dd, hh, mm, ss); returns the sum of the times
+uint32_t sim_bench_mk_time_run(const uint8_t* fields, uint32_t count);
+// one LinkManager_t (link_manager.h) driven by the benchmark; times in seconds
+void     sim_bench_link_init(uint32_t seed);
+void     sim_bench_link_limits(uint32_t* backoffMax, uint32_t* stableTime, uint32_t* deferMax);
+// LinkManager_MayConnect(): 1 if a reconnect may start now, else the seconds to *wait
+int      sim_bench_link_may_connect(uint32_t now, uint32_t* wait);
+void     sim_bench_link_urgent(void);
+void     sim_bench_link_up(uint32_t now);
+void     sim_bench_link_down(uint32_t now);
+// signal in %, -1 unknown
+void     sim_bench_link_signal(int percent);
+void     sim_bench_link_upload(int delivered);
+// LinkManager_Defer(): 1 if a routine report should wait
+int      sim_bench_link_defer(uint32_t sinceReport);
+
+// options
+typedef struct {
+    const char* imei;
+    const char* apnReject;      // APN refused by the network (the application's "dummy" APN)
+    const char* smsLog;         // file receiving the sent SMS, NULL for none
+    uint32_t    attachDelayMs;
+    uint32_t    activateDelayMs;
+    uint32_t    batteryPercent;
+    int         noNetwork;      // do not register at boot
+    int         verbose;
+    // GPRS link model applied to the TCP sockets, see host_io.c
+    uint32_t    netLatencyMs;   // one way
+    uint32_t    netJitterMs;
+    uint32_t    netKbps;        // 0: unlimited
+    double      netLoss;        // probability of losing a TCP segment
+    double      netReset;       // probability of a connection reset per socket operation
+    const char* netStats;       // file receiving the link counters at exit
+    const char* powerLog;       // file receiving the power state changes, see host_io.c
+    int         lbsSet;         // LBS_GetLocation() succeeds with the position below
+    double      lbsLatitude;
+    double      lbsLongitude;
+    const char* dnsMap;         // "name=address" resolved without a lookup
+    uint32_t    gpsAckDelayMs;  // time the emulated GPS takes to answer a command
+} sim_options_t;
+
+extern sim_options_t g_simOptions;
+extern const char*   g_simFsRoot;   // host directory holding the module file system
+extern char**        g_simArgv;     // for PM_Restart()
+
+#endif // SIM_HOST_H
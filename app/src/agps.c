@@ -0,0 +1,201 @@
+#include <string.h>
+#include <time.h>
+
+#include <api_os.h>
+#include <api_fs.h>
+
+#include "gps.h"
+
+#include "system.h"
+#include "utils.h"
+#include "config_store.h"
+#include "network.h"
+#include "agps.h"
+#include "lbs_cache.h"
+#include "time_sync.h"
+#include "debug.h"
+
+#define MODULE_TAG "AGPS"
+
+#define AGPS_CACHE_MAGIC          0x44504741   // "AGPD"
+#define AGPS_CACHE_TEMP           "/agps.tmp"
+// larger files are not cached; the GPS takes any length
+#define AGPS_GPD_MAX_LENGTH       (32 * 1024)
+
+// in front of the GPD file in AGPS_CACHE_FILE
+typedef struct {
+    uint32_t magic;
+    uint32_t saved;         // UTC download time
+    uint32_t length;
+    uint32_t crc;           // CRC-32 of the file
+} AgpsCacheHeader_t;
+
+// the cache file being written while the download streams to the GPS
+typedef struct {
+    int32_t           fd;
+    AgpsCacheHeader_t header;
+} AgpsCacheWriter_t;
+
+// the cache file being uploaded
+typedef struct {
+    int32_t  fd;
+    uint32_t left;
+} AgpsCacheReader_t;
+
+static bool ReadCacheHeader(int32_t fd, AgpsCacheHeader_t* header)
+{
+    return API_FS_Read(fd, (uint8_t*)header, sizeof(*header)) == sizeof(*header) &&
+           header->magic == AGPS_CACHE_MAGIC && header->length > 0 &&
+           header->length <= AGPS_GPD_MAX_LENGTH;
+}
+
+/**
+ * @return download time of the cached file, 0 if there is none
+ */
+static uint32_t CacheTime(void)
+{
+    int32_t fd = API_FS_Open(AGPS_CACHE_FILE, FS_O_RDONLY, 0);
+    if (fd < 0) return 0;
+    AgpsCacheHeader_t header;
+    bool ok = ReadCacheHeader(fd, &header);
+    API_FS_Close(fd);
+    return ok ? header.saved : 0;
+}
+
+// GPS_GPD_Tap_t: appends the pack to the new cache file
+static bool CacheWrite(void* param, const uint8_t* pack, int len)
+{
+    AgpsCacheWriter_t* writer = (AgpsCacheWriter_t*)param;
+    if (writer->fd < 0) return true;    // the GPS still gets the file
+    writer->header.crc = crc32_update(writer->header.crc, pack, len);
+    writer->header.length += len;
+    if (API_FS_Write(writer->fd, (uint8_t*)pack, len) != len) {
+        LOGE("write %s failed", AGPS_CACHE_TEMP);
+        API_FS_Close(writer->fd);
+        writer->fd = -1;
+    }
+    return true;
+}
+
+/**
+ * Streams the GPD file from the server to the GPS and to a new cache file, which
+ * replaces the old one once it is complete.
+ * @return the file length, -1 if the download failed
+ */
+static int Download(uint32_t now)
+{
+    GPS_GPD_Http_t http;
+    if (!GPS_GPDHttpOpen(&http)) {
+        GPS_GPDHttpClose(&http);
+        return -1;
+    }
+    AgpsCacheWriter_t writer = { API_FS_Open(AGPS_CACHE_TEMP, FS_O_RDWR | FS_O_CREAT | FS_O_TRUNC, 0),
+                                 { AGPS_CACHE_MAGIC, now, 0, 0 } };
+    // the header is rewritten at the end, until then the magic is invalid
+    AgpsCacheHeader_t placeholder = { 0 };
+    if (writer.fd >= 0 && API_FS_Write(writer.fd, (uint8_t*)&placeholder, sizeof(placeholder)) != sizeof(placeholder)) {
+        API_FS_Close(writer.fd);
+        writer.fd = -1;
+    }
+
+    int length = GPS_GPDStream(GPS_GPDHttpRead, &http, CacheWrite, &writer);
+    GPS_GPDHttpClose(&http);
+    if (writer.fd < 0) {
+        LOGE("cannot write %s", AGPS_CACHE_TEMP);
+    } else {
+        bool ok = length > 0 && writer.header.length <= AGPS_GPD_MAX_LENGTH &&
+                  API_FS_Seek(writer.fd, 0, FS_SEEK_SET) == 0 &&
+                  API_FS_Write(writer.fd, (uint8_t*)&writer.header, sizeof(writer.header)) == sizeof(writer.header);
+        API_FS_Flush(writer.fd);
+        API_FS_Close(writer.fd);
+        if (ok) {
+            API_FS_Delete(AGPS_CACHE_FILE);
+            ok = API_FS_Rename(AGPS_CACHE_TEMP, AGPS_CACHE_FILE) == 0;
+        }
+        if (!ok) API_FS_Delete(AGPS_CACHE_TEMP);
+    }
+    return length;
+}
+
+// GPS_GPD_Read_t of the cache file
+static int CacheRead(void* param, uint8_t* data, int len)
+{
+    AgpsCacheReader_t* reader = (AgpsCacheReader_t*)param;
+    if ((uint32_t)len > reader->left) len = reader->left;
+    if (len == 0) return 0;
+    int32_t n = API_FS_Read(reader->fd, data, len);
+    if (n <= 0) return -1;
+    reader->left -= n;
+    return n;
+}
+
+/**
+ * Uploads the cache file after checking its CRC.
+ * @return the file length, -1 if the cache is missing, damaged or the upload failed
+ */
+static int UploadCache(void)
+{
+    AgpsCacheReader_t reader = { API_FS_Open(AGPS_CACHE_FILE, FS_O_RDONLY, 0), 0 };
+    if (reader.fd < 0) return -1;
+    AgpsCacheHeader_t header;
+    int length = -1;
+    if (ReadCacheHeader(reader.fd, &header)) {
+        uint8_t  chunk[128];
+        uint32_t crc = 0;
+        reader.left = header.length;
+        for (int n; (n = CacheRead(&reader, chunk, sizeof(chunk))) > 0; )
+            crc = crc32_update(crc, chunk, n);
+        if (reader.left == 0 && crc == header.crc &&
+            API_FS_Seek(reader.fd, sizeof(header), FS_SEEK_SET) == sizeof(header)) {
+            reader.left = header.length;
+            length = GPS_GPDStream(CacheRead, &reader, NULL, NULL);
+        } else {
+            LOGE("cache %s damaged", AGPS_CACHE_FILE);
+        }
+    }
+    API_FS_Close(reader.fd);
+    return length;
+}
+
+/**
+ * Uploads the cached GPD file, or a new one when the cache is older than AGPS_GPD_REFRESH.
+ */
+static void InjectGpd(uint32_t now)
+{
+    uint32_t saved = CacheTime();
+    // a cache time ahead of the clock comes from a wrong clock, the file is of unknown age
+    uint32_t age = (saved && saved <= now) ? now - saved : UINT32_MAX;
+
+    if (age >= AGPS_GPD_REFRESH) {
+        int length = Download(now);
+        if (length > 0) {
+            LOGI("GPD file downloaded, %d bytes", length);
+            return;
+        }
+        LOGW("GPD download failed");
+    }
+    if (age < AGPS_GPD_VALIDITY) {
+        int length = UploadCache();
+        if (length > 0)
+            LOGI("GPD file from the cache, %d bytes, %u min old", length, age / 60);
+        else
+            LOGE("GPD upload from the cache failed");
+    }
+}
+
+void Agps_Start(void)
+{
+    if (!g_ConfigStore.agps) return;
+
+    uint32_t now = TimeSync_Now();
+    if (now >= AGPS_CLOCK_VALID)
+        InjectGpd(now);
+    else
+        LOGW("network time not set, GPD file skipped");
+
+    LbsPosition_t position;
+    if (LbsCache_Locate(&position)) {
+        if (!GPS_SetSeed(position.latitude, position.longitude, 0))
+            LOGE("GPS seed position failed");
+    }
+}
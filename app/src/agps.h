@@ -0,0 +1,31 @@
+#ifndef AGPS_H
+#define AGPS_H
+
+/**
+ * Assisted GPS start (config agps).
+ *
+ * Without assistance a cold start waits for the ephemeris broadcast by the satellites,
+ * minutes after every power cycle. Agps_Start() gives the GPS what the network knows:
+ * - the GPD file (ephemeris from the GOKE server, about 3.4 kB), downloaded at most
+ *   every AGPS_GPD_REFRESH seconds and cached on flash with its download time, so a
+ *   reboot re-injects it without a download while it is younger than AGPS_GPD_VALIDITY
+ * - the time, and the position of the cells seen (LbsCache_Locate(), cached on flash)
+ *
+ * The age of the cache needs the network time; before it is set only the LBS
+ * position is injected.
+ */
+
+#define AGPS_CACHE_FILE           "/agps.gpd"
+// the server publishes a new file every 2 hours, a file is usable for 6 hours
+#define AGPS_GPD_REFRESH          (2 * 3600)
+#define AGPS_GPD_VALIDITY         (6 * 3600)
+// earlier clock values mean the network time has not been received: 2024-01-01
+#define AGPS_CLOCK_VALID          1704067200
+
+/**
+ * @brief Inject the GPD file and the LBS position into the GPS. Blocks for the
+ *        downloads, up to about 25 s. Call with the GPS open and GPRS active.
+ */
+void Agps_Start(void);
+
+#endif // AGPS_H
@@ -1,3 +1,4 @@
+#include <api_os.h>
 #include <api_fs.h>
 #include <api_sms.h>
 #include <api_network.h>
@@ -8,20 +9,59 @@
 #include "debug.h"
 #include "network.h"
 #include "gps_tracker.h"
+#include "geofence.h"
+#include "trip.h"
+#include "time_sync.h"
+#include "lbs_cache.h"
+#include "link_manager.h"
 #include "config_store.h"
 #include "config_commands.h"
 #include "config_validation.h"
+#include "console.h"
+#include "file_dump.h"
+#include "perf_stats.h"
+#include "task_profiler.h"
+#include "mem_pool.h"
 
 #define MODULE_TAG "Config"
 
 typedef void (*UartCmdHandler)(char*);
 
+/**
+ * Output function used by the command handlers.
+ * While a command runs it points to Console_Printf for commands typed on the console,
+ * or to the caller supplied output function for commands received over the reporting link.
+ * It is only changed while cmd_mutex is held.
+ */
+static CmdOutputFunc cmd_printf = UART_Printf;
+static HANDLE        cmd_mutex  = 0;
+// true while the running command came from the server or an SMS
+static bool          cmd_remote = false;
+
+/**
+ * Parameters which can only be set on the console.
+ * A server response travels over plain http and an SMS sender can be spoofed, so the
+ * remote path must not be able to redirect the reports, change the network access or
+ * widen its own permissions.
+ */
+static const char* const local_only_params[] = {
+    PARAM_SERVER_ADDR,
+    PARAM_SERVER_PORT,
+    PARAM_SERVER_PROTOCOL,
+    PARAM_APN,
+    PARAM_APN_USER,
+    PARAM_APN_PASS,
+    PARAM_REMOTE_COMMANDS,
+    PARAM_SMS_WHITELIST,
+};
+
 static void HandleHelpCommand(char*);
 static void HandleLsCommand(char*);
 static void HandleRemoveFileCommand(char*);
 static void HandleSetCommand(char*);
 static void HandleGetCommand(char*);
 static void HandleTailCommand(char*);
+static void HandleDumpCommand(char*);
 static void HandleRestartCommand(char*);
 static void HandleNetworkActivateCommand(char*);
 static void HandleNetworkStatusCommand(char*);
@@ -30,30 +70,52 @@ static void HandleLocationCommand(char*);
 static void HandleSmsCommand(char*);
 static void HandleSmsLsCommand(char*);
 static void HandleSmsRmCommand(char*);
+static void HandleStatsCommand(char*);
+static void HandleTasksCommand(char*);
+static void HandleHeapCommand(char*);
+static void HandleFenceCommand(char*);
+static void HandleFenceAddCommand(char*);
+static void HandleFenceRmCommand(char*);
+static void HandleTripCommand(char*);
+static void HandleOdometerCommand(char*);
+static void HandleTimeCommand(char*);
+static void HandleLbsCommand(char*);
 
 struct uart_cmd_entry {
     const char* cmd;
     const int   cmd_len;
     UartCmdHandler handler;
+    const uint8_t flags;
     const char* syntax;
     const char* help;
 };
 
 static struct uart_cmd_entry uart_cmd_table[] = {
-    {"help",           4, HandleHelpCommand,            "help",                "Show this help message"},
-    {"set",            3, HandleSetCommand,             "set <param> [value]", "Set value to a specified parameter. if no value provided parameter will be cleared."},
-    {"get",            3, HandleGetCommand,             "get [para]",          "Print a value of a specified parameter. (for no parameter it prints all config)"},
-    {"ls",             2, HandleLsCommand,              "ls [path]",           "List files in specified folder (default: /)"},
-    {"rm",             2, HandleRemoveFileCommand,      "rm <file>",           "Remove file at specified path"},
-    {"tail",           4, HandleTailCommand,            "tail <file> [bytes]", "Print last [bytes] of file (default: 500 bytes)"},
-    {"net activate",  12, HandleNetworkActivateCommand, "net activate",        "Activate (attach and activate) the network"},
-    {"net deactivate",14, HandleNetworkDeactivateCommand, "net deactivate",    "Deactivate (detach and deactivate) the network"},
-    {"net status",    10, HandleNetworkStatusCommand,   "net status",          "Print network status"},
-    {"sms",            3, HandleSmsCommand,             "sms",                 "Show SMS storage info (default)"},
-    {"sms ls",         6, HandleSmsLsCommand,           "sms ls <all|read|unread>", "list SMS messages ()"},
-    {"sms rm",         6, HandleSmsRmCommand,           "sms rm <index|all>",  "remove SMS message (rm <index>) or remove all messages (rm all)"},
-    {"location",       8, HandleLocationCommand,        "location",            "Show the last known GPS position"},
-    {"restart",        7, HandleRestartCommand,         "restart",             "Restart the system immediately"},
+    {"help",           4, HandleHelpCommand,            0,                  "help",                "Show this help message"},
+    {"set",            3, HandleSetCommand,             CMD_FLAG_REMOTE,    "set <param> [value]", "Set value to a specified parameter. if no value provided parameter will be cleared."},
+    {"get",            3, HandleGetCommand,             CMD_FLAG_REMOTE,    "get [para]",          "Print a value of a specified parameter. (for no parameter it prints all config)"},
+    {"ls",             2, HandleLsCommand,              0,                  "ls [path]",           "List files in specified folder (default: /)"},
+    {"rm",             2, HandleRemoveFileCommand,      0,                  "rm <file>",           "Remove file at specified path"},
+    {"tail",           4, HandleTailCommand,            0,                  "tail <file> [bytes]", "Print last [bytes] of file (default: 500 bytes)"},
+    {"dump",           4, HandleDumpCommand,            0,                  "dump <file> [offset] [length]", "Send file (range) in CRC framed blocks, for tool/uart_dump.py"},
+    {"net activate",  12, HandleNetworkActivateCommand, 0,                  "net activate",        "Activate (attach and activate) the network"},
+    {"net deactivate",14, HandleNetworkDeactivateCommand, 0,                "net deactivate",      "Deactivate (detach and deactivate) the network"},
+    {"net status",    10, HandleNetworkStatusCommand,   0,                  "net status",          "Print network status, the link quality and the reconnects"},
+    {"sms",            3, HandleSmsCommand,             0,                  "sms",                 "Show SMS storage info (default)"},
+    {"sms ls",         6, HandleSmsLsCommand,           0,                  "sms ls <all|read|unread>", "list SMS messages ()"},
+    {"sms rm",         6, HandleSmsRmCommand,           0,                  "sms rm <index|all>",  "remove SMS message (rm <index>) or remove all messages (rm all)"},
+    {"location",       8, HandleLocationCommand,        0,                  "location",            "Show the last known GPS position"},
+    {"stats",          5, HandleStatsCommand,           0,                  "stats [reset]",       "Show the performance counters since boot, or clear them"},
+    {"tasks",          5, HandleTasksCommand,           0,                  "tasks [reset]",       "Show stack high-water marks and busy time of the tasks"},
+    {"fence",          5, HandleFenceCommand,           CMD_FLAG_REMOTE,    "fence",               "List the geofences and whether the device is inside"},
+    {"fence add",      9, HandleFenceAddCommand,        CMD_FLAG_REMOTE,    "fence add <name> circle <lat>,<lon> <m> | <name> poly <lat>,<lon> ...", "Add a geofence; a poly line with the name of a polygon adds vertices"},
+    {"fence rm",       8, HandleFenceRmCommand,         CMD_FLAG_REMOTE,    "fence rm <name|all>", "Remove a geofence, or all of them"},
+    {"trip",           4, HandleTripCommand,            CMD_FLAG_REMOTE,    "trip",                "Show the motion state, the current trip and the odometer"},
+    {"odometer",       8, HandleOdometerCommand,        CMD_FLAG_REMOTE,    "odometer [km]",       "Show the odometer, or set it"},
+    {"lbs",            3, HandleLbsCommand,             CMD_FLAG_REMOTE,    "lbs [cache|clear]",   "Locate the cells seen (cached or by the LBS service), list the cell cache or empty it"},
+    {"time",           4, HandleTimeCommand,            CMD_FLAG_REMOTE,    "time",                "Show the UTC time, its source (gps, ntp, rtc) and the corrections"},
+    {"heap",           4, HandleHeapCommand,            0,                  "heap [reset]",        "Show heap fragmentation, pools and live allocations, or restart the peaks"},
+    {"restart",        7, HandleRestartCommand,         CMD_FLAG_REMOTE | CMD_FLAG_DEFERRED, "restart", "Restart the system immediately"},
 };
 
 /**
@@ -98,7 +160,7 @@ static void HandleSetCommand(char* param)
 {
     param = trim_whitespace(param);
     if (!*param) {
-        UART_Printf("missing variable\r\n");
+        cmd_printf("missing variable\r\n");
         return;
     }
 
@@ -113,21 +175,30 @@ static void HandleSetCommand(char* param)
         value = (char*)"";
     }
 
-    t_config_map *configMap = getConfigMap(param);
+    const t_config_map *configMap = getConfigMap(param);
     if (!configMap) {
-        UART_Printf("unknown variable\r\n");
+        cmd_printf("unknown variable\r\n");
         return;
     }
 
+    if (cmd_remote) {
+        for (size_t i = 0; i < sizeof(local_only_params)/sizeof(local_only_params[0]); ++i) {
+            if (strcmp(configMap->param_name, local_only_params[i]) == 0) {
+                cmd_printf("%s can only be set on the console\r\n", param);
+                return;
+            }
+        }
+    }
+
     if (!configMap->validator(value)) {
-        UART_Printf("invalid value for %s\r\n", param);
+        cmd_printf("invalid value for %s\r\n", param);
         return;
     }
 
     if (!ConfigStore_Save(CONFIG_FILE_PATH))
         LOGE("Failed to save config file: %s", CONFIG_FILE_PATH);
 
-    UART_Printf("Set %s to '%s'\r\n", param, value);
+    cmd_printf("Set %s to '%s'\r\n", param, value);
     return;
 }
 
@@ -136,22 +207,22 @@ static void HandleGetCommand(char* param)
     param = trim_whitespace(param);
 
     if (*param == '\0') {
-        UART_Printf("Current configuration:\r\n");
+        cmd_printf("Current configuration:\r\n");
         for (size_t i = 0; i < g_config_map_size; ++i) {
             const t_config_map *configMap = &g_config_map[i];
-            UART_Printf("%-20s : %s\r\n",
+            cmd_printf("%-20s : %s\r\n",
                 configMap->param_name, 
                 configMap->serializer(configMap->value));
         }
         return;
     }
 
-    t_config_map *configMap = getConfigMap(param);
+    const t_config_map *configMap = getConfigMap(param);
     if (!configMap) {
-        UART_Printf("unknown variable\r\n");
+        cmd_printf("unknown variable\r\n");
         return;
     }
-    UART_Printf("%s : %s\r\n",
+    cmd_printf("%s : %s\r\n",
         configMap->param_name, 
         configMap->serializer(configMap->value));
     return;
@@ -162,10 +233,10 @@ static void HandleLsCommand(char* path)
     path = trim_whitespace(path);
     if (!path || path[0] == '\0') path = "/";
 
-    UART_Printf("File list in %s:\r\n", path);
+    cmd_printf("File list in %s:\r\n", path);
     Dir_t* dir = API_FS_OpenDir(path);
     if (!dir) {
-        UART_Printf("cannot open directory: %s\r\n", path);
+        cmd_printf("cannot open directory: %s\r\n", path);
         return;
     }
 
@@ -199,12 +270,12 @@ static void HandleLsCommand(char* path)
                 file_size = (int)API_FS_GetFileSize(fd);
                 API_FS_Close(fd);
             }
-            UART_Printf("<file>  %-*s  %8d\r\n", 20, dirent->d_name, file_size);
+            cmd_printf("<file>  %-*s  %8d\r\n", 20, dirent->d_name, file_size);
         } else if (dirent->d_type == 4) {
-            UART_Printf("<dir>   %-*s\r\n", 20, dirent->d_name);
+            cmd_printf("<dir>   %-*s\r\n", 20, dirent->d_name);
         }
         else 
-            UART_Printf("<unknown>\r\n");
+            cmd_printf("<unknown>\r\n");
     }
     API_FS_CloseDir(dir);
 }
@@ -213,14 +284,14 @@ static void HandleRemoveFileCommand(char* path)
 {
     path = trim_whitespace(path);
     if (!path || path[0] == '\0') {
-        UART_Printf("no file specified\r\n");
+        cmd_printf("no file specified\r\n");
         return;
     }
     int result = API_FS_Delete(path);
     if (result == 0) {
-        UART_Printf("File deleted: %s\r\n", path);
+        cmd_printf("File deleted: %s\r\n", path);
     } else {
-        UART_Printf("failed to delete file: %s\r\n", path);
+        cmd_printf("failed to delete file: %s\r\n", path);
     }
 }
 
@@ -229,7 +300,7 @@ static void HandleTailCommand(char* args)
     int bytes = 500;
     char* file_path = trim_whitespace(args);
     if (!file_path || !*file_path) {
-        UART_Printf("missing file\r\n");
+        cmd_printf("missing file\r\n");
         return;
     }
 
@@ -245,18 +316,18 @@ static void HandleTailCommand(char* args)
 
     int32_t fd = API_FS_Open(file_path, FS_O_RDONLY, 0);
     if (fd < 0) {
-        UART_Printf("tail: cannot open file %s\r\n", file_path);
+        cmd_printf("tail: cannot open file %s\r\n", file_path);
         return;
     }
     int file_size = (int)API_FS_GetFileSize(fd);
     if (file_size < 0) {
-        UART_Printf("tail: cannot get file size\r\n");
+        cmd_printf("tail: cannot get file size\r\n");
         API_FS_Close(fd);
         return;
     }
     int start = file_size > bytes ? file_size - bytes : 0;
     if (API_FS_Seek(fd, start, 0) < 0) {
-        UART_Printf("tail: seek error\r\n");
+        cmd_printf("tail: seek error\r\n");
         API_FS_Close(fd);
         return;
     }
@@ -264,105 +335,260 @@ static void HandleTailCommand(char* args)
     int remaining = file_size - start;
     while (remaining > 0) {
         int to_read = remaining > (int)sizeof(buf) ? (int)sizeof(buf) : remaining;
-        int n = API_FS_Read(fd, buf, to_read);
+        int n = API_FS_Read(fd, (uint8_t*)buf, to_read);
         if (n <= 0) break;
-        for (int i = 0; i < n; ++i) UART_Printf("%c", buf[i]);
+        cmd_printf("%.*s", n, buf);
         remaining -= n;
     }
-    UART_Printf("\r\n");
+    cmd_printf("\r\n");
     API_FS_Close(fd);
 }
 
+static void HandleDumpCommand(char* args)
+{
+    char* file_path = trim_whitespace(args);
+    if (!file_path || !*file_path) {
+        cmd_printf("missing file\r\n");
+        return;
+    }
+
+    int32_t offset = 0, length = 0;
+    char* space = strchr(file_path, ' ');
+    if (space) {
+        *space = '\0';
+        char* end = NULL;
+        offset = strtol(space + 1, &end, 10);
+        if (end) length = strtol(end, NULL, 10);
+    }
+
+    // the frames are written directly to the UART, send the pending text first
+    Console_Flush();
+    FileDump_Send(file_path, offset, length);
+}
+
 static void HandleLocationCommand(char* param)
 {
     // First check if GPS is active
     if (!IS_GPS_STATUS_ON()) {
-        UART_Printf("GPS is not active.\r\n");
+        cmd_printf("GPS is not active.\r\n");
         return;
     }   
-    gps_PrintLocation(LOGGER_OUTPUT_UART);
+    gps_PrintLocation(cmd_printf);
     return;
 }
 
+static void HandleStatsCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (strcmp(param, "reset") == 0) {
+        Perf_Reset();
+        cmd_printf("Counters cleared\r\n");
+        return;
+    }
+    if (*param) {
+        cmd_printf("usage: stats [reset]\r\n");
+        return;
+    }
+    Perf_Print(cmd_printf);
+}
+
+static void HandleFenceCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (*param) {
+        cmd_printf("usage: fence [add|rm]\r\n");
+        return;
+    }
+    Geofence_List(cmd_printf);
+}
+
+static void HandleFenceAddCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (Geofence_Add(param))
+        cmd_printf("Geofence saved\r\n");
+    else
+        cmd_printf("Invalid geofence, no room for it, or it could not be saved\r\n");
+}
+
+static void HandleFenceRmCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (Geofence_Remove(param))
+        cmd_printf("Geofence removed\r\n");
+    else
+        cmd_printf("No geofence %s\r\n", param);
+}
+
+static void HandleTripCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (*param) {
+        cmd_printf("usage: trip\r\n");
+        return;
+    }
+    Trip_Print(cmd_printf);
+}
+
+static void HandleOdometerCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (*param) {
+        double km = atof(param);
+        if (km < 0.0 || km > 4000000.0 || *param < '0' || *param > '9') {
+            cmd_printf("usage: odometer [km]\r\n");
+            return;
+        }
+        if (!Trip_SetOdometer((uint32_t)(km * 1000.0 + 0.5))) {
+            cmd_printf("Saving the odometer failed\r\n");
+            return;
+        }
+    }
+    uint32_t metres = Trip_GetOdometer();
+    cmd_printf("Odometer: %u.%03u km\r\n", (unsigned)(metres / 1000), (unsigned)(metres % 1000));
+}
+
+static void HandleTimeCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (*param) {
+        cmd_printf("usage: time\r\n");
+        return;
+    }
+    TimeSync_Print(cmd_printf);
+}
+
+static void HandleLbsCommand(char* param)
+{
+    static const char* const sources[] = {"LBS service", "cache", "cache, neighbour cell"};
+    param = trim_whitespace(param);
+    if (strcmp(param, "cache") == 0) {
+        LbsCache_Print(cmd_printf);
+    } else if (strcmp(param, "clear") == 0) {
+        LbsCache_Clear();
+        cmd_printf("Cell cache cleared\r\n");
+    } else if (*param) {
+        cmd_printf("usage: lbs [cache|clear]\r\n");
+    } else {
+        LbsPosition_t position;
+        if (LbsCache_Locate(&position))
+            cmd_printf("Cells at %.6f, %.6f, within %.0f m (%s)\r\n", position.latitude, position.longitude,
+                       position.accuracy, sources[position.source]);
+        else
+            cmd_printf("Cell position not available\r\n");
+    }
+}
+
+static void HandleTasksCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (strcmp(param, "reset") == 0) {
+        Profiler_Reset();
+        cmd_printf("Busy times cleared\r\n");
+        return;
+    }
+    if (*param) {
+        cmd_printf("usage: tasks [reset]\r\n");
+        return;
+    }
+    Profiler_Print(cmd_printf);
+}
+
+static void HandleHeapCommand(char* param)
+{
+    param = trim_whitespace(param);
+    if (strcmp(param, "reset") == 0) {
+        Mem_ResetPeaks();
+        cmd_printf("Peaks cleared\r\n");
+        return;
+    }
+    if (*param) {
+        cmd_printf("usage: heap [reset]\r\n");
+        return;
+    }
+    Perf_PrintHeap(cmd_printf);
+}
+
 static void HandleNetworkStatusCommand(char* param)
 {
-    UART_Printf("GSM Network registered: %s, active: %s\r\n",
+    cmd_printf("GSM Network registered: %s, active: %s\r\n",
                 IS_GSM_REGISTERED() ? "true" : "false",
                 IS_GSM_ACTIVE() ? "true" : "false");
     // Get and display IP address if network is active
     if (IS_GSM_ACTIVE()) {
         char ip_address[16] = {0};
         if (Network_GetIp(ip_address, sizeof(ip_address))) {
-            UART_Printf("IP address: %s\r\n", ip_address);
+            cmd_printf("IP address: %s\r\n", ip_address);
         } else {
-            UART_Printf("Failed to get IP address\r\n");
+            cmd_printf("Failed to get IP address\r\n");
         }
     } else {
-        UART_Printf("IP address: not available\r\n");
+        cmd_printf("IP address: not available\r\n");
     }
+    Link_Print(cmd_printf);
     // Print cell info using network module function
-    NetworkPrintCellInfo();
+    NetworkPrintCellInfo(cmd_printf);
 }
 
 static void HandleNetworkActivateCommand(char* param)
 {
     if (NetworkAttachActivate()) {
-        UART_Printf("Network activated.\r\n");
+        cmd_printf("Network activated.\r\n");
     } else {
-        UART_Printf("Network activation failed.\r\n");
+        cmd_printf("Network activation failed.\r\n");
     }
 }
 
 static void HandleNetworkDeactivateCommand(char* param)
 {
     if (Network_StartDeactive(1)) {
-        UART_Printf("Network deactivated.\r\n");
+        cmd_printf("Network deactivated.\r\n");
     } else {
-        UART_Printf("Network deactivation failed.\r\n");
+        cmd_printf("Network deactivation failed.\r\n");
     }
 }
 
 static void HandleRestartCommand(char* args)
 {
-    UART_Printf("System restarting...\r\n");
+    cmd_printf("System restarting...\r\n");
     PM_Restart();
 }
 
 static void HandleHelpCommand(char* args)
 {
-    UART_Printf("\r\nAvailable commands:\r\n");
+    cmd_printf("\r\nAvailable commands:\r\n");
     for (unsigned i = 0; i < sizeof(uart_cmd_table)/sizeof(uart_cmd_table[0]); ++i) {
-        UART_Printf("  %-24s- %s\r\n", uart_cmd_table[i].syntax, uart_cmd_table[i].help);
+        cmd_printf("  %-24s- %s\r\n", uart_cmd_table[i].syntax, uart_cmd_table[i].help);
     }
-    UART_Printf("\r\n<param> is one of:\r\n  ");
+    cmd_printf("\r\n<param> is one of:\r\n  ");
     for (size_t i = 0; i < g_config_map_size; ++i) {
-        UART_Printf("%s, ", g_config_map[i].param_name);
+        cmd_printf("%s, ", g_config_map[i].param_name);
     }
-    UART_Printf("\r\n");
+    cmd_printf("\r\n");
 }
 
 static void HandleSmsCommand(char* param)
 {
     param = trim_whitespace(param);
     if (*param != '\0') {
-        UART_Printf("Unknown sms command parameter\r\n");
+        cmd_printf("Unknown sms command parameter\r\n");
         return;
     }
     // Print all SMS storage info
     SMS_Storage_Info_t info;
     if (!SMS_GetStorageInfo(&info, SMS_STORAGE_SIM_CARD)) {
-        UART_Printf("Failed to get SMS storage info.\r\n");
+        cmd_printf("Failed to get SMS storage info.\r\n");
         return;
     }
-    UART_Printf("SMS Storage Info (SIM):\r\n");
-    UART_Printf("  Used: %d\r\n", info.used);
-    UART_Printf("  Total: %d\r\n", info.total);
-    UART_Printf("  Unread: %d\r\n", info.unReadRecords);
-    UART_Printf("  Read: %d\r\n", info.readRecords);
-    UART_Printf("  Sent: %d\r\n", info.sentRecords);
-    UART_Printf("  Unsent: %d\r\n", info.unsentRecords);
-    UART_Printf("  Unknown: %d\r\n", info.unknownRecords);
-    UART_Printf("  Storage ID: %d\r\n", info.storageId);
+    cmd_printf("SMS Storage Info (SIM):\r\n");
+    cmd_printf("  Used: %d\r\n", info.used);
+    cmd_printf("  Total: %d\r\n", info.total);
+    cmd_printf("  Unread: %d\r\n", info.unReadRecords);
+    cmd_printf("  Read: %d\r\n", info.readRecords);
+    cmd_printf("  Sent: %d\r\n", info.sentRecords);
+    cmd_printf("  Unsent: %d\r\n", info.unsentRecords);
+    cmd_printf("  Unknown: %d\r\n", info.unknownRecords);
+    cmd_printf("  Storage ID: %d\r\n", info.storageId);
     return;
 }
 
@@ -377,11 +603,11 @@ static void HandleSmsLsCommand(char* param)
     } else if (strncmp(param, "unread", 6) == 0) {
         status = SMS_STATUS_UNREAD;
     } else {
-        UART_Printf("Unknown sms ls parameter. Use 'all', 'read', or 'unread'\r\n");
+        cmd_printf("Unknown sms ls parameter. Use 'all', 'read', or 'unread'\r\n");
         return;
     }
     if (!SMS_ListMessageRequst(status, SMS_STORAGE_SIM_CARD)) {
-        UART_Printf("Failed to request SMS list\r\n");
+        cmd_printf("Failed to request SMS list\r\n");
     }
     return;
 }
@@ -390,36 +616,81 @@ static void HandleSmsRmCommand(char* param)
 {
     param = trim_whitespace(param);
     if (*param != '\0') {
-        UART_Printf("incorrect parameter\r\n");
+        cmd_printf("incorrect parameter\r\n");
         return;
     }
     int idx = atoi(param);
     if (idx < 0) {
-        UART_Printf("Invalid index.\r\n");
+        cmd_printf("Invalid index.\r\n");
         return;
     }
     if (SMS_DeleteMessage(idx, SMS_STATUS_ALL, SMS_STORAGE_SIM_CARD)) {
-        UART_Printf("Deleted SMS at index %d\r\n", idx);
+        cmd_printf("Deleted SMS at index %d\r\n", idx);
     } else {
-        UART_Printf("Failed to delete SMS at index %d\r\n", idx);
+        cmd_printf("Failed to delete SMS at index %d\r\n", idx);
     }
 }
 
 
-void HandleUartCommand(char* cmd)
+/**
+ * Looks up the command table entry matching the beginning of the command line.
+ * @param cmd command line with leading and trailing whitespaces removed
+ * @return pointer to the matching entry or NULL if the command is unknown
+ */
+static struct uart_cmd_entry* FindCommand(const char* cmd)
 {
-    cmd = trim_whitespace(cmd);
-    if (uart_cmd_table_size == 0) InitUartCmdTableSortedIdx();
     for (unsigned k = 0; k < uart_cmd_table_size; ++k) {
         unsigned i = uart_cmd_sorted_idx[k];
         const char* c = uart_cmd_table[i].cmd;
         int len = uart_cmd_table[i].cmd_len;
-        if (strncmp(cmd, c, len) == 0 && (cmd[len] == ' ' || cmd[len] == '\0')) {
-            uart_cmd_table[i].handler(cmd + len);
-            return;
-        }
+        if (strncmp(cmd, c, len) == 0 && (cmd[len] == ' ' || cmd[len] == '\0'))
+            return &uart_cmd_table[i];
     }
-    UART_Printf("Unknown command. Type 'help' to see available commands.\r\n");
+    return NULL;
+}
+
+void CommandsInit(void)
+{
+    if (uart_cmd_table_size == 0) InitUartCmdTableSortedIdx();
+    if (!cmd_mutex) cmd_mutex = OS_CreateMutex();
+}
+
+void HandleUartCommand(char* cmd)
+{
+    cmd = trim_whitespace(cmd);
+    if (uart_cmd_table_size == 0) CommandsInit();
+    struct uart_cmd_entry* entry = FindCommand(cmd);
+    if (!entry) {
+        Console_Printf("Unknown command. Type 'help' to see available commands.\r\n");
+        return;
+    }
+    if (cmd_mutex) OS_LockMutex(cmd_mutex);
+    cmd_printf = Console_Printf;
+    entry->handler(cmd + entry->cmd_len);
+    cmd_printf = UART_Printf;
+    if (cmd_mutex) OS_UnlockMutex(cmd_mutex);
+}
+
+t_cmdResult HandleRemoteCommand(char* cmd, CmdOutputFunc output, bool deferred)
+{
+    cmd = trim_whitespace(cmd);
+    if (uart_cmd_table_size == 0) CommandsInit();
+    struct uart_cmd_entry* entry = FindCommand(cmd);
+    if (!entry)
+        return CMD_RESULT_UNKNOWN;
+    if (!(entry->flags & CMD_FLAG_REMOTE))
+        return CMD_RESULT_NOT_ALLOWED;
+    if ((entry->flags & CMD_FLAG_DEFERRED) && !deferred)
+        return CMD_RESULT_DEFERRED;
+
+    if (cmd_mutex) OS_LockMutex(cmd_mutex);
+    cmd_printf = output ? output : UART_Printf;
+    cmd_remote = true;
+    entry->handler(cmd + entry->cmd_len);
+    cmd_remote = false;
+    cmd_printf = UART_Printf;
+    if (cmd_mutex) OS_UnlockMutex(cmd_mutex);
+    return CMD_RESULT_OK;
 }
 
 // Print SMS list message
@@ -3,7 +3,53 @@
 
 #include "config_store.h"
 
+/**
+ * Command table flags
+ * CMD_FLAG_REMOTE   - the command may be executed when received over the reporting link
+ * CMD_FLAG_DEFERRED - a remote command is executed only after its result has been uploaded
+ *                     (e.g. restart, which would otherwise drop the pending results)
+ */
+#define CMD_FLAG_REMOTE    (1 << 0)
+#define CMD_FLAG_DEFERRED  (1 << 1)
+
+typedef enum {
+    CMD_RESULT_OK = 0,
+    CMD_RESULT_UNKNOWN,
+    CMD_RESULT_NOT_ALLOWED,
+    CMD_RESULT_DEFERRED
+} t_cmdResult;
+
+typedef int32_t (*CmdOutputFunc)(const char* fmt, ...);
+
+/**
+ * @brief Initialize the command interpreter.
+ * Sorts the command table and creates the mutex serializing command execution
+ * between the UART console and the remote command channel.
+ * It should be called once during system startup, before any task issues commands.
+ */
+void CommandsInit(void);
+
+/**
+ * @brief Executes a command typed on the console.
+ * Called by the console task; the output goes to the console output buffer
+ * and is written to the UART by the caller (Console_Flush).
+ */
 void HandleUartCommand(char* cmd);
+
+/**
+ * @brief Execute a command received over the reporting link.
+ *
+ * Only commands marked with CMD_FLAG_REMOTE are executed. The output of the handler
+ * is passed to the output function instead of the UART.
+ *
+ * @param cmd      Command line (modified in place).
+ * @param output   printf-like function receiving the command output.
+ * @param deferred true if the caller executes a previously deferred command.
+ * @return CMD_RESULT_OK if the command was executed, CMD_RESULT_DEFERRED if it has to be
+ *         executed later with deferred set to true, or an error code.
+ */
+t_cmdResult HandleRemoteCommand(char* cmd, CmdOutputFunc output, bool deferred);
+
 void SmsListMessageCallback(SMS_Message_Info_t* msg);
 
 #endif
@@ -29,7 +29,7 @@ static bool parse_line(char* line)
     line  = trim_whitespace(line);
     value = trim_whitespace(++value);
 
-    t_config_map* entry = getConfigMap(line);
+    const t_config_map* entry = getConfigMap(line);
     if (!entry) {
         LOGE("Unknown config key: %s", line);
         return false;
@@ -69,7 +69,7 @@ bool ConfigStore_Load(char* filename)
 
     while (true)
     {
-        int32_t read_bytes = API_FS_Read(fd, buffer + leftover, sizeof(buffer) - leftover - 1);
+        int32_t read_bytes = API_FS_Read(fd, (uint8_t*)buffer + leftover, sizeof(buffer) - leftover - 1);
         if (read_bytes < 0)
         {
             LOGD("Read error: %d", read_bytes);
@@ -90,7 +90,7 @@ bool ConfigStore_Load(char* filename)
         
         // if there is no new line character in the full buffer set to skip the next line 
         // and read the next part of the file
-        if ((line_end == NULL) &&  (leftover >= sizeof(buffer) - 1))
+        if ((line_end == NULL) &&  (leftover >= (int)sizeof(buffer) - 1))
         {
             LOGD("Buffer overflow, skipping long line");
             skip_next_line = true; // Skip the entire line if it does not fit into the buffer
@@ -168,7 +168,7 @@ bool ConfigStore_Save(char* filename)
                  g_config_map[i].param_name, value_str);
         line_to_save[len] = '\0'; // Ensure null termination
         
-        if (API_FS_Write(fd, line_to_save, len) != len) {
+        if (API_FS_Write(fd, (uint8_t*)line_to_save, len) != len) {
             LOGE("Write failed for %s", g_config_map[i].param_name);
             continue;
         }
@@ -182,21 +182,23 @@ bool ConfigStore_Save(char* filename)
 void ConfigStore_Init()
 {
     memset(g_ConfigStore.imei, 0, sizeof(g_ConfigStore.imei));
-    t_config_map* entry = getConfigMap(PARAM_DEVICE_NAME);
-    if(entry && INFO_GetIMEI(g_ConfigStore.imei))
-        entry->default_value = g_ConfigStore.imei;
-    else
+    bool imei = INFO_GetIMEI((uint8_t*)g_ConfigStore.imei);
+    if (!imei)
         UART_Printf("Failed to get imei, using default device name: %s", DEFAULT_DEVICE_NAME);
 
     // For each config entry, validate and set default value
     for (size_t index = 0; index < g_config_map_size; ++index) {
-        entry = (t_config_map*)&g_config_map[index];
+        const t_config_map* entry = &g_config_map[index];
+        // the device name defaults to the IMEI
+        const char* default_value = entry->default_value;
+        if (imei && strcmp(entry->param_name, PARAM_DEVICE_NAME) == 0)
+            default_value = g_ConfigStore.imei;
         if (!entry->validator) {
             UART_Printf("No validator for config map entry: %s\r\n", entry->param_name);
             continue; // Skip if no validator is defined
         }
-        if (!entry->validator(entry->default_value)) {
-            UART_Printf("Invalid default value for %s: %s\r\n", entry->param_name, entry->default_value);
+        if (!entry->validator(default_value)) {
+            UART_Printf("Invalid default value for %s: %s\r\n", entry->param_name, default_value);
             continue; // Skip if default value is invalid
         }
     }
@@ -9,6 +9,8 @@
 #define MAX_DEVICE_NAME_LENGTH      32
 #define MAX_IMEI_LENGTH             16
 #define MAX_GPS_LOG_PATH_LENGTH     128
+#define MAX_SMS_WHITELIST_LENGTH    128
+#define MAX_PHONE_NUMBER_LENGTH     24
 
 #define PARAM_DEVICE_NAME           "device_name"
 #define PARAM_SERVER_ADDR           "server"
@@ -20,9 +22,27 @@
 #define PARAM_LOG_LEVEL             "log_level"
 #define PARAM_LOG_OUTPUT            "log_output"
 #define PARAM_GPS_UERE              "gps_uere"
+#define PARAM_GPS_FILTER            "gps_filter"
+#define PARAM_GPS_FILTER_ACCEL      "gps_filter_accel"
 #define PARAM_GPS_LOGS              "gps_logging"
 #define PARAM_GPS_LOG_FILE          "gps_log_file"
 #define PARAM_GPS_PRINT_POS         "gps_print_pos"
+#define PARAM_REPORT_INTERVAL       "report_interval"
+#define PARAM_REMOTE_COMMANDS       "remote_commands"
+#define PARAM_TRACKING              "tracking"
+#define PARAM_SMS_WHITELIST         "sms_whitelist"
+#define PARAM_SMS_REPORT_NUMBER     "sms_report_number"
+#define PARAM_SMS_REPORT_INTERVAL   "sms_report_interval"
+#define PARAM_TRACK_TOLERANCE       "track_tolerance"
+#define PARAM_GEOFENCE_MARGIN       "geofence_margin"
+#define PARAM_TRIP_STOP_TIME        "trip_stop_time"
+#define PARAM_STATS_INTERVAL        "stats_interval"
+#define PARAM_LOW_POWER             "low_power"
+#define PARAM_SLEEP_INTERVAL        "sleep_interval"
+#define PARAM_FIX_TIMEOUT           "fix_timeout"
+#define PARAM_AGPS                  "agps"
+#define PARAM_NTP_SERVER            "ntp_server"
+#define PARAM_LBS_FALLBACK          "lbs_fallback"
 
 typedef struct {
     char        imei[MAX_IMEI_LENGTH];
@@ -34,9 +54,27 @@ typedef struct {
     char        apn_user[MAX_APN_USER_LENGTH];
     char        apn_pass[MAX_APN_USER_LENGTH];
     float       gps_uere;
+    bool        gps_filter;
+    float       gps_filter_accel;
     bool        gps_print_pos;
     bool        gps_logging;
     char        gps_log_file[MAX_GPS_LOG_PATH_LENGTH];
+    uint32_t    report_interval;
+    bool        remote_commands;
+    bool        tracking;
+    char        sms_whitelist[MAX_SMS_WHITELIST_LENGTH];
+    char        sms_report_number[MAX_PHONE_NUMBER_LENGTH];
+    uint32_t    sms_report_interval;
+    float       track_tolerance;
+    float       geofence_margin;
+    uint32_t    trip_stop_time;
+    uint32_t    stats_interval;
+    bool        low_power;
+    uint32_t    sleep_interval;
+    uint32_t    fix_timeout;
+    bool        agps;
+    char        ntp_server[MAX_SERVER_ADDR_LENGTH];
+    uint32_t    lbs_fallback;
     t_logLevel  logLevel;
     t_logOutput logOutput;
 } t_Config;
@@ -16,9 +16,27 @@ bool ApnPassValidate(const char* value);
 bool LogLevelValidate(const char* value);
 bool LogOutputValidate(const char* value);
 bool GpsUereValidate(const char* value);
+bool GpsFilterValidate(const char* value);
+bool GpsFilterAccelValidate(const char* value);
 bool GpsPrintPosValidate(const char* value);
 bool GpsLoggingValidate(const char* value);
 bool GpsLogFileValidate(const char* value);
+bool ReportIntervalValidate(const char* value);
+bool RemoteCommandsValidate(const char* value);
+bool TrackingValidate(const char* value);
+bool SmsWhitelistValidate(const char* value);
+bool SmsReportNumberValidate(const char* value);
+bool SmsReportIntervalValidate(const char* value);
+bool TrackToleranceValidate(const char* value);
+bool GeofenceMarginValidate(const char* value);
+bool TripStopTimeValidate(const char* value);
+bool StatsIntervalValidate(const char* value);
+bool LowPowerValidate(const char* value);
+bool SleepIntervalValidate(const char* value);
+bool FixTimeoutValidate(const char* value);
+bool AgpsValidate(const char* value);
+bool NtpServerValidate(const char* value);
+bool LbsFallbackValidate(const char* value);
 
 // Serializers
 const char* StringSerializer(const void* value);
@@ -26,6 +44,7 @@ const char* FloatSerializer(const void* value);
 const char* ProtocolSerializer(const void* value);
 const char* LogOutputSerializer(const void* value);
 const char* BoolSerializer(const void* value);
+const char* UIntSerializer(const void* value);
 
 const t_config_map g_config_map[] = {
     {PARAM_DEVICE_NAME,     DEFAULT_DEVICE_NAME,     DeviceNameValidate,  StringSerializer,    &g_ConfigStore.device_name},
@@ -38,19 +57,37 @@ const t_config_map g_config_map[] = {
     {PARAM_LOG_LEVEL,       DEFAULT_LOG_LEVEL,       LogLevelValidate,    LogLevelSerializer,  &g_ConfigStore.logLevel},
     {PARAM_LOG_OUTPUT,      DEFAULT_LOG_OUTPUT,      LogOutputValidate,   LogOutputSerializer, &g_ConfigStore.logOutput},
     {PARAM_GPS_UERE,        DEFAULT_GPS_UERE,        GpsUereValidate,     FloatSerializer,     &g_ConfigStore.gps_uere},
+    {PARAM_GPS_FILTER,      DEFAULT_GPS_FILTER,      GpsFilterValidate,   BoolSerializer,      &g_ConfigStore.gps_filter},
+    {PARAM_GPS_FILTER_ACCEL, DEFAULT_GPS_FILTER_ACCEL, GpsFilterAccelValidate, FloatSerializer, &g_ConfigStore.gps_filter_accel},
     {PARAM_GPS_LOGS,        DEFAULT_GPS_LOGS,        GpsLoggingValidate,  BoolSerializer,      &g_ConfigStore.gps_logging},
     {PARAM_GPS_LOG_FILE,    DEFAULT_GPS_LOG_FILE,    GpsLogFileValidate,  StringSerializer,    &g_ConfigStore.gps_log_file},
     {PARAM_GPS_PRINT_POS,   DEFAULT_GPS_PRINT_POS,   GpsPrintPosValidate, BoolSerializer,      &g_ConfigStore.gps_print_pos},
+    {PARAM_REPORT_INTERVAL, DEFAULT_REPORT_INTERVAL, ReportIntervalValidate, UIntSerializer,   &g_ConfigStore.report_interval},
+    {PARAM_REMOTE_COMMANDS, DEFAULT_REMOTE_COMMANDS, RemoteCommandsValidate, BoolSerializer,   &g_ConfigStore.remote_commands},
+    {PARAM_TRACKING,        DEFAULT_TRACKING,        TrackingValidate,    BoolSerializer,      &g_ConfigStore.tracking},
+    {PARAM_SMS_WHITELIST,   DEFAULT_SMS_WHITELIST,   SmsWhitelistValidate, StringSerializer,   &g_ConfigStore.sms_whitelist},
+    {PARAM_SMS_REPORT_NUMBER,   DEFAULT_SMS_REPORT_NUMBER,   SmsReportNumberValidate,   StringSerializer, &g_ConfigStore.sms_report_number},
+    {PARAM_SMS_REPORT_INTERVAL, DEFAULT_SMS_REPORT_INTERVAL, SmsReportIntervalValidate, UIntSerializer,   &g_ConfigStore.sms_report_interval},
+    {PARAM_TRACK_TOLERANCE,     DEFAULT_TRACK_TOLERANCE,     TrackToleranceValidate,    FloatSerializer,  &g_ConfigStore.track_tolerance},
+    {PARAM_GEOFENCE_MARGIN,     DEFAULT_GEOFENCE_MARGIN,     GeofenceMarginValidate,    FloatSerializer,  &g_ConfigStore.geofence_margin},
+    {PARAM_TRIP_STOP_TIME,      DEFAULT_TRIP_STOP_TIME,      TripStopTimeValidate,      UIntSerializer,   &g_ConfigStore.trip_stop_time},
+    {PARAM_STATS_INTERVAL,  DEFAULT_STATS_INTERVAL,  StatsIntervalValidate, UIntSerializer,    &g_ConfigStore.stats_interval},
+    {PARAM_LOW_POWER,       DEFAULT_LOW_POWER,       LowPowerValidate,    BoolSerializer,      &g_ConfigStore.low_power},
+    {PARAM_SLEEP_INTERVAL,  DEFAULT_SLEEP_INTERVAL,  SleepIntervalValidate, UIntSerializer,    &g_ConfigStore.sleep_interval},
+    {PARAM_FIX_TIMEOUT,     DEFAULT_FIX_TIMEOUT,     FixTimeoutValidate,  UIntSerializer,      &g_ConfigStore.fix_timeout},
+    {PARAM_AGPS,            DEFAULT_AGPS,            AgpsValidate,        BoolSerializer,      &g_ConfigStore.agps},
+    {PARAM_NTP_SERVER,      DEFAULT_NTP_SERVER,      NtpServerValidate,   StringSerializer,    &g_ConfigStore.ntp_server},
+    {PARAM_LBS_FALLBACK,    DEFAULT_LBS_FALLBACK,    LbsFallbackValidate, UIntSerializer,      &g_ConfigStore.lbs_fallback},
 };
 
 const size_t g_config_map_size = sizeof(g_config_map)/sizeof(g_config_map[0]);
 
 // Returns a pointer to the config map entry for a given argument name (key)
-t_config_map* getConfigMap(const char* arg_name) {
+const t_config_map* getConfigMap(const char* arg_name) {
     if (!arg_name) return NULL;
     for (size_t i = 0; i < g_config_map_size; ++i) {
         if (strcmp(g_config_map[i].param_name, arg_name) == 0) {
-            return (t_config_map*)&g_config_map[i];
+            return &g_config_map[i];
         }
     }
     return NULL;
@@ -274,6 +311,249 @@ bool GpsLogFileValidate(const char* value)
     return false;
 }
 
+// Report interval: number of seconds between two location reports, 1-86400
+bool ReportIntervalValidate(const char* value)
+{
+    if (!value) return false;
+    char* endptr;
+    long interval = strtol(value, &endptr, 10);
+    if (endptr != value && *endptr == '\0' && interval > 0 && interval <= 86400) {
+        g_ConfigStore.report_interval = (uint32_t)interval;
+        Tracker_Notify(TRACKER_EVENT_CONFIG);
+        return true;
+    }
+    return false;
+}
+
+// Parses enabled/disabled style boolean values
+static bool ParseBoolValue(const char* value, bool* result)
+{
+    if ((str_case_cmp(value, "0") == 0) ||
+        (str_case_cmp(value, "disable") == 0) ||
+        (str_case_cmp(value, "disabled") == 0) ||
+        (str_case_cmp(value, "off") == 0) ||
+        (str_case_cmp(value, "false") == 0))
+    {
+        *result = false;
+        return true;
+    }
+    if ((str_case_cmp(value, "1") == 0) ||
+        (str_case_cmp(value, "enable") == 0) ||
+        (str_case_cmp(value, "enabled") == 0) ||
+        (str_case_cmp(value, "on") == 0) ||
+        (str_case_cmp(value, "true") == 0))
+    {
+        *result = true;
+        return true;
+    }
+    return false;
+}
+
+// GPS filter: Kalman smoothing of the reported position, enabled/disabled
+bool GpsFilterValidate(const char* value)
+{
+    if (!value) return false;
+    return ParseBoolValue(value, &g_ConfigStore.gps_filter);
+}
+
+// GPS filter acceleration noise: float, m/s^2, >0 and <=20
+bool GpsFilterAccelValidate(const char* value)
+{
+    if (!value) return false;
+
+    float accel = atof(value);
+    if (accel > 0.0f && accel <= 20.0f) {
+        g_ConfigStore.gps_filter_accel = accel;
+        return true;
+    }
+    return false;
+}
+
+// Remote commands: enabled/disabled
+bool RemoteCommandsValidate(const char* value)
+{
+    if (!value) return false;
+    return ParseBoolValue(value, &g_ConfigStore.remote_commands);
+}
+
+// Tracking (periodic location reports): enabled/disabled
+bool TrackingValidate(const char* value)
+{
+    if (!value) return false;
+    if (!ParseBoolValue(value, &g_ConfigStore.tracking)) return false;
+    Tracker_Notify(TRACKER_EVENT_CONFIG);
+    return true;
+}
+
+// SMS whitelist: comma separated phone numbers, can be empty
+bool SmsWhitelistValidate(const char* value)
+{
+    if (!value) {
+        g_ConfigStore.sms_whitelist[0] = '\0';
+        return true;
+    }
+    if (strlen(value) >= MAX_SMS_WHITELIST_LENGTH) return false;
+    for (const char* c = value; *c; ++c) {
+        if (!isdigit((unsigned char)*c) && *c != '+' && *c != ',' && *c != ' ')
+            return false;
+    }
+    strncpy(g_ConfigStore.sms_whitelist, value, MAX_SMS_WHITELIST_LENGTH-1);
+    g_ConfigStore.sms_whitelist[MAX_SMS_WHITELIST_LENGTH-1] = '\0';
+    return true;
+}
+
+// SMS report number: phone number ('+' and digits), empty disables SMS fallback reports
+bool SmsReportNumberValidate(const char* value)
+{
+    if (!value) {
+        g_ConfigStore.sms_report_number[0] = '\0';
+        return true;
+    }
+    size_t len = strlen(value);
+    if (len >= MAX_PHONE_NUMBER_LENGTH) return false;
+    for (size_t i = 0; i < len; ++i) {
+        if (!isdigit((unsigned char)value[i]) && !(value[i] == '+' && i == 0))
+            return false;
+    }
+    strncpy(g_ConfigStore.sms_report_number, value, MAX_PHONE_NUMBER_LENGTH-1);
+    g_ConfigStore.sms_report_number[MAX_PHONE_NUMBER_LENGTH-1] = '\0';
+    return true;
+}
+
+// SMS report interval: seconds between two SMS fallback reports, 60-86400
+bool SmsReportIntervalValidate(const char* value)
+{
+    if (!value) return false;
+    char* endptr;
+    long interval = strtol(value, &endptr, 10);
+    if (endptr != value && *endptr == '\0' && interval >= 60 && interval <= 86400) {
+        g_ConfigStore.sms_report_interval = (uint32_t)interval;
+        return true;
+    }
+    return false;
+}
+
+// Track tolerance: metres the SMS report track may deviate from the sampled fixes, 0 (keep all) to 1000
+bool TrackToleranceValidate(const char* value)
+{
+    if (!value) return false;
+
+    float tolerance = atof(value);
+    if (tolerance >= 0.0f && tolerance <= 1000.0f) {
+        g_ConfigStore.track_tolerance = tolerance;
+        return true;
+    }
+    return false;
+}
+
+// Geofence margin: metres outside a fence before it is left, 0 to 1000
+bool GeofenceMarginValidate(const char* value)
+{
+    if (!value) return false;
+
+    float margin = atof(value);
+    if (margin >= 0.0f && margin <= 1000.0f) {
+        g_ConfigStore.geofence_margin = margin;
+        return true;
+    }
+    return false;
+}
+
+// Trip stop time: seconds standing that end a trip, 30-3600
+bool TripStopTimeValidate(const char* value)
+{
+    if (!value) return false;
+    char* endptr;
+    long seconds = strtol(value, &endptr, 10);
+    if (endptr != value && *endptr == '\0' && seconds >= 30 && seconds <= 3600) {
+        g_ConfigStore.trip_stop_time = (uint32_t)seconds;
+        return true;
+    }
+    return false;
+}
+
+// Stats interval: seconds between reports carrying the performance counters, 0 (off) or 60-86400
+bool StatsIntervalValidate(const char* value)
+{
+    if (!value) return false;
+    char* endptr;
+    long interval = strtol(value, &endptr, 10);
+    if (endptr != value && *endptr == '\0' && (interval == 0 || (interval >= 60 && interval <= 86400))) {
+        g_ConfigStore.stats_interval = (uint32_t)interval;
+        return true;
+    }
+    return false;
+}
+
+// Low power: park the GPS and the CPU while the device stands still, enabled/disabled
+bool LowPowerValidate(const char* value)
+{
+    if (!value) return false;
+    if (!ParseBoolValue(value, &g_ConfigStore.low_power)) return false;
+    Tracker_Notify(TRACKER_EVENT_CONFIG);
+    return true;
+}
+
+// Sleep interval: seconds between reports while parked, 60-86400
+bool SleepIntervalValidate(const char* value)
+{
+    if (!value) return false;
+    char* endptr;
+    long interval = strtol(value, &endptr, 10);
+    if (endptr != value && *endptr == '\0' && interval >= 60 && interval <= 86400) {
+        g_ConfigStore.sleep_interval = (uint32_t)interval;
+        Tracker_Notify(TRACKER_EVENT_CONFIG);
+        return true;
+    }
+    return false;
+}
+
+// Fix timeout: seconds to wait for a fix after waking up, 10-600
+bool FixTimeoutValidate(const char* value)
+{
+    if (!value) return false;
+    char* endptr;
+    long timeout = strtol(value, &endptr, 10);
+    if (endptr != value && *endptr == '\0' && timeout >= 10 && timeout <= 600) {
+        g_ConfigStore.fix_timeout = (uint32_t)timeout;
+        return true;
+    }
+    return false;
+}
+
+// AGPS: assistance data and LBS position for the GPS at startup, enabled/disabled
+bool AgpsValidate(const char* value)
+{
+    if (!value) return false;
+    return ParseBoolValue(value, &g_ConfigStore.agps);
+}
+
+// NTP server: the time source without GPS, less than MAX_SERVER_ADDR_LENGTH, empty: none
+bool NtpServerValidate(const char* value)
+{
+    if (!value) return false;
+    size_t len = strlen(value);
+    if (len < MAX_SERVER_ADDR_LENGTH) {
+        strncpy(g_ConfigStore.ntp_server, value, MAX_SERVER_ADDR_LENGTH-1);
+        g_ConfigStore.ntp_server[MAX_SERVER_ADDR_LENGTH-1] = '\0';
+        return true;
+    }
+    return false;
+}
+
+// LBS fallback: seconds without a fix before the cell position is reported, 0 (never) or 30-86400
+bool LbsFallbackValidate(const char* value)
+{
+    if (!value) return false;
+    char* endptr;
+    long seconds = strtol(value, &endptr, 10);
+    if (endptr != value && *endptr == '\0' && (seconds == 0 || (seconds >= 30 && seconds <= 86400))) {
+        g_ConfigStore.lbs_fallback = (uint32_t)seconds;
+        return true;
+    }
+    return false;
+}
+
 // Serializers: return a static buffer with the string representation of the value
 static char serializer_buf[MAX_LINE_LENGTH];
 
@@ -331,3 +611,10 @@ const char* BoolSerializer(const void* value)
     snprintf(serializer_buf, sizeof(serializer_buf), "%s", (*(const unsigned char*)value) ? "true" : "false");
     return serializer_buf;
 }
+
+const char* UIntSerializer(const void* value)
+{
+    if (!value) return NULL;
+    snprintf(serializer_buf, sizeof(serializer_buf), "%u", (unsigned)*(const uint32_t*)value);
+    return serializer_buf;
+}
@@ -21,7 +21,7 @@ extern const size_t       g_config_map_size;
  * @param arg_name The name of the configuration parameter.
  * @return Pointer to the t_config_map if found, or NULL if not found.
  */
-t_config_map* getConfigMap(const char* arg_name);
+const t_config_map* getConfigMap(const char* arg_name);
 
 const char* LogLevelSerializer(const void* value);
 
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include <api_os.h>
+#include <api_hal_uart.h>
+
+#include "utils.h"
+#include "config_commands.h"
+#include "console.h"
+#include "debug.h"
+#include "perf_stats.h"
+#include "task_profiler.h"
+
+#define MODULE_TAG "Console"
+
+#define CONSOLE_TASK_STACK_SIZE   (4096)
+#define CONSOLE_TASK_PRIORITY     (1)
+#define CONSOLE_TASK_NAME         "Console Task"
+
+#define CHAR_BACKSPACE  0x08
+#define CHAR_CTRL_U     0x15
+#define CHAR_DELETE     0x7F
+
+static HANDLE consoleTaskHandle = 0;
+static HANDLE console_mutex     = 0;   // protects the line buffer and the command queue
+static HANDLE console_sem       = 0;   // released for every queued line and a new partial line
+
+// line being assembled from the received fragments
+static char     line_buf[CONSOLE_LINE_MAX_LEN + 1];
+static uint16_t line_len      = 0;
+static bool     line_overflow = false;
+static clock_t  line_last_rx  = 0;
+
+// complete lines waiting for the console task
+static char     cmd_queue[CONSOLE_QUEUE_SIZE][CONSOLE_LINE_MAX_LEN + 1];
+static uint8_t  cmd_queue_head  = 0;
+static uint8_t  cmd_queue_count = 0;
+
+// output of the running command, owned by the console task
+static char     out_buf[CONSOLE_OUTPUT_BUFFER_SIZE];
+static uint16_t out_len = 0;
+
+/**
+ * Moves the assembled line to the command queue. Called with console_mutex held.
+ * @return true if a line was queued
+ */
+static bool QueueLine(void)
+{
+    bool queued = false;
+    line_buf[line_len] = '\0';
+
+    if (line_overflow) {
+        UART_Printf("command too long (max %d characters)\r\n", CONSOLE_LINE_MAX_LEN);
+    } else if (line_len > 0) {
+        if (cmd_queue_count < CONSOLE_QUEUE_SIZE) {
+            uint8_t slot = (cmd_queue_head + cmd_queue_count) % CONSOLE_QUEUE_SIZE;
+            memcpy(cmd_queue[slot], line_buf, line_len + 1);
+            cmd_queue_count++;
+            queued = true;
+        } else {
+            UART_Printf("console busy, command dropped: %s\r\n", line_buf);
+        }
+    }
+    line_len = 0;
+    line_overflow = false;
+    return queued;
+}
+
+void Console_RxData(const uint8_t* data, uint32_t len)
+{
+    if (!console_mutex) return;
+
+    int queued = 0;
+    OS_LockMutex(console_mutex);
+    bool partial = line_len > 0 || line_overflow;
+    for (uint32_t i = 0; i < len; ++i) {
+        char c = (char)data[i];
+        switch (c) {
+            case '\r':
+            case '\n':
+                if (QueueLine()) queued++;
+                break;
+            case CHAR_BACKSPACE:
+            case CHAR_DELETE:
+                if (line_len > 0) line_len--;
+                break;
+            case CHAR_CTRL_U:
+                line_len = 0;
+                line_overflow = false;
+                break;
+            default:
+                if ((uint8_t)c < ' ') break;   // ignore other control characters
+                if (line_len < CONSOLE_LINE_MAX_LEN)
+                    line_buf[line_len++] = c;
+                else
+                    line_overflow = true;
+                break;
+        }
+    }
+    line_last_rx = clock();
+    // the task waits without a timeout until a partial line exists
+    if (!partial && (line_len > 0 || line_overflow)) queued++;
+    OS_UnlockMutex(console_mutex);
+
+    while (queued--) OS_ReleaseSemaphore(console_sem);
+}
+
+/**
+ * Takes the oldest queued command line. A partial line idle for CONSOLE_IDLE_FLUSH_MS
+ * is queued first, so commands sent without a line ending are executed too.
+ * @param wait set to the milliseconds until the partial line is idle long enough,
+ *             or OS_WAIT_FOREVER if there is none
+ * @return true if a line was copied to cmd
+ */
+static bool TakeLine(char* cmd, uint32_t* wait)
+{
+    bool taken = false;
+    *wait = OS_WAIT_FOREVER;
+    OS_LockMutex(console_mutex);
+    if (cmd_queue_count == 0 && (line_len > 0 || line_overflow)) {
+        uint32_t idle = (clock() - line_last_rx) / CLOCKS_PER_MSEC;
+        if (idle >= CONSOLE_IDLE_FLUSH_MS)
+            QueueLine();
+        else
+            *wait = CONSOLE_IDLE_FLUSH_MS - idle;
+    }
+    if (cmd_queue_count > 0) {
+        memcpy(cmd, cmd_queue[cmd_queue_head], CONSOLE_LINE_MAX_LEN + 1);
+        cmd_queue_head = (cmd_queue_head + 1) % CONSOLE_QUEUE_SIZE;
+        cmd_queue_count--;
+        taken = true;
+    }
+    OS_UnlockMutex(console_mutex);
+    return taken;
+}
+
+int32_t Console_Printf(const char* fmt, ...)
+{
+    char buffer[LOG_LEVEL_BUFFER_SIZE];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+
+    if (len <= 0) return 0;
+    // Clamp to max buffer size
+    if ((size_t)len >= sizeof(buffer))
+        len = sizeof(buffer) - 1;
+
+    if (out_len + len > (int)sizeof(out_buf))
+        Console_Flush();
+    memcpy(out_buf + out_len, buffer, len);
+    out_len += len;
+    return len;
+}
+
+void Console_Flush(void)
+{
+    if (out_len == 0) return;
+    UART_Write(UART1, (uint8_t*)out_buf, out_len);
+    out_len = 0;
+}
+
+static void ConsoleTask(void* pData)
+{
+    static char cmd[CONSOLE_LINE_MAX_LEN + 1];
+    int profilerSlot = Profiler_TaskStart();
+    uint32_t wait = OS_WAIT_FOREVER;
+
+    while (true)
+    {
+        // wake up on a new line, or when a partial line has been idle long enough
+        OS_WaitForSemaphore(console_sem, wait);
+        uint32_t start = Perf_Start();
+        while (TakeLine(cmd, &wait)) {
+            HandleUartCommand(cmd);
+            Console_Flush();
+        }
+        Profiler_TaskBusy(profilerSlot, start);
+    }
+}
+
+void Console_Init(void)
+{
+    console_mutex = OS_CreateMutex();
+    console_sem   = OS_CreateSemaphore(0);
+    consoleTaskHandle = OS_CreateTask(
+        ConsoleTask, NULL, NULL,
+        CONSOLE_TASK_STACK_SIZE,
+        CONSOLE_TASK_PRIORITY,
+        0, 0, CONSOLE_TASK_NAME);
+    Profiler_TaskAdd(consoleTaskHandle);
+}
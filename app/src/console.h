@@ -0,0 +1,36 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+
+#define CONSOLE_LINE_MAX_LEN        256    // longest accepted command line
+#define CONSOLE_QUEUE_SIZE          4      // command lines waiting for execution
+#define CONSOLE_OUTPUT_BUFFER_SIZE  1024   // command output is written to UART in blocks of this size
+#define CONSOLE_IDLE_FLUSH_MS       1000   // a partial line is executed after this much idle time
+
+/**
+ * UART command console.
+ *
+ * Data received on UART1 is assembled into lines by Console_RxData() on the main event task
+ * and the complete lines are queued for the console task, which executes them and streams
+ * the output in large UART_Write blocks. A slow command therefore never delays GPS event
+ * processing.
+ *
+ * Line editing: backspace/DEL removes the last character, Ctrl-U discards the line.
+ * A line is complete on CR or LF, or after CONSOLE_IDLE_FLUSH_MS without new data
+ * (for terminals which send commands without a line ending).
+ */
+
+// Creates the console task and its command queue
+void Console_Init(void);
+
+// Feeds data received on the UART, may be called with any fragment of a command line
+void Console_RxData(const uint8_t* data, uint32_t len);
+
+// printf-like output buffered by the console task, used as the output of console commands
+int32_t Console_Printf(const char* fmt, ...);
+
+// Writes the buffered console output to the UART
+void Console_Flush(void);
+
+#endif // CONSOLE_H
@@ -5,6 +5,8 @@
 #include "config_store.h"
 #include "config_validation.h"
 #include "debug.h"
+#include "perf_stats.h"
+#include "time_sync.h"
 
 int32_t g_log_file;
 
@@ -21,7 +23,7 @@ int32_t UART_Printf(const char* fmt, ...)
         if ((size_t)len >= sizeof(buffer))
             len = sizeof(buffer) - 1;  
 
-        UART_Write(UART1, buffer, (size_t)len);
+        UART_Write(UART1, (uint8_t*)buffer, (size_t)len);
     }
     return 0;
 }
@@ -39,9 +41,11 @@ int32_t FILE_Printf(const char* fmt, ...)
         if ((size_t)len >= sizeof(buffer))
             len = sizeof(buffer) - 1;  
 
-        int ret = API_FS_Write(g_log_file, buffer, (size_t)len);
-        if (ret <= 0)
-            UART_Write(UART1, buffer, (size_t)len);
+        int ret = API_FS_Write(g_log_file, (uint8_t*)buffer, (size_t)len);
+        if (ret <= 0) {
+            Perf_Inc(PERF_LOG_WRITE_FAILURES);
+            UART_Write(UART1, (uint8_t*)buffer, (size_t)len);
+        }
     }
     return 0;
 }
@@ -51,6 +55,10 @@ void log_message_internal(t_logLevel level, const char *tag, const char *format,
     if (level > g_ConfigStore.logLevel || level == LOG_LEVEL_NONE)
         return;
 
+    Perf_Inc(PERF_LOG_MESSAGES);
+    if (level == LOG_LEVEL_ERROR)
+        Perf_Inc(PERF_LOG_ERRORS);
+
     char message[LOG_LEVEL_BUFFER_SIZE];
     va_list args;
     va_start(args, format);
@@ -58,11 +66,8 @@ void log_message_internal(t_logLevel level, const char *tag, const char *format,
     message[sizeof(message) - 1] = '\0';
     va_end(args);
 
-    RTC_Time_t time;
-    TIME_GetRtcTime(&time);
-
     char timebuf[16];
-    snprintf(timebuf, sizeof(timebuf), "%02u:%02u.%02u", time.hour,time.minute,time.second);
+    TimeSync_Format(TimeSync_NowMs(), timebuf, sizeof(timebuf));
 
     // Get logger output type from ConfigStore
     switch (g_ConfigStore.logOutput) {
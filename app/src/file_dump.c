@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <api_os.h>
+#include <api_fs.h>
+#include <api_hal_uart.h>
+
+#include "utils.h"
+#include "file_dump.h"
+#include "debug.h"
+
+#define MODULE_TAG "Dump"
+
+#define FRAME_HEADER_SIZE   8    // sync (2), offset (4), length (2)
+#define FRAME_CRC_SIZE      4
+
+static uint8_t frame[FRAME_HEADER_SIZE + FILE_DUMP_BLOCK_SIZE + FRAME_CRC_SIZE];
+
+static inline void PutLE(uint8_t* p, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) p[i] = (value >> (8 * i)) & 0xFF;
+}
+
+// Writes the whole buffer, waiting while the UART driver buffer is full
+static bool WriteAll(const uint8_t* data, uint32_t len)
+{
+    int retries = 0;
+    while (len > 0) {
+        uint32_t written = UART_Write(UART1, (uint8_t*)data, len);
+        if (written == 0) {
+            if (++retries > 1000) return false;
+            OS_Sleep(1);
+            continue;
+        }
+        retries = 0;
+        data += written;
+        len  -= written;
+    }
+    return true;
+}
+
+int32_t FileDump_Send(const char* path, int32_t offset, int32_t length)
+{
+    if (offset < 0 || length < 0) {
+        UART_Printf("DUMP ERROR invalid range\r\n");
+        return -1;
+    }
+
+    int32_t fd = API_FS_Open(path, FS_O_RDONLY, 0);
+    if (fd < 0) {
+        UART_Printf("DUMP ERROR cannot open %s\r\n", path);
+        return -1;
+    }
+    int32_t file_size = (int32_t)API_FS_GetFileSize(fd);
+    if (file_size < 0 || offset > file_size) {
+        UART_Printf("DUMP ERROR offset %d beyond file size %d\r\n", offset, file_size);
+        API_FS_Close(fd);
+        return -1;
+    }
+    if (length == 0 || length > file_size - offset)
+        length = file_size - offset;
+    if (API_FS_Seek(fd, offset, FS_SEEK_SET) < 0) {
+        UART_Printf("DUMP ERROR seek failed\r\n");
+        API_FS_Close(fd);
+        return -1;
+    }
+
+    UART_Printf("DUMP BEGIN %d %d %d\r\n", file_size, offset, length);
+
+    uint32_t total_crc = 0;
+    int32_t  sent = 0;
+    while (sent < length)
+    {
+        int32_t chunk = length - sent;
+        if (chunk > FILE_DUMP_BLOCK_SIZE) chunk = FILE_DUMP_BLOCK_SIZE;
+        int32_t n = API_FS_Read(fd, frame + FRAME_HEADER_SIZE, chunk);
+        if (n <= 0) break;
+
+        frame[0] = FILE_DUMP_SYNC1;
+        frame[1] = FILE_DUMP_SYNC2;
+        PutLE(frame + 2, offset + sent, 4);
+        PutLE(frame + 6, n, 2);
+        uint32_t crc = crc32_update(0, frame + 2, FRAME_HEADER_SIZE - 2 + n);
+        PutLE(frame + FRAME_HEADER_SIZE + n, crc, 4);
+        total_crc = crc32_update(total_crc, frame + FRAME_HEADER_SIZE, n);
+
+        if (!WriteAll(frame, FRAME_HEADER_SIZE + n + FRAME_CRC_SIZE)) {
+            LOGE("UART write stalled at offset %d", offset + sent);
+            break;
+        }
+        sent += n;
+    }
+    API_FS_Close(fd);
+
+    if (sent != length) {
+        UART_Printf("\r\nDUMP ERROR read stopped at %d\r\n", offset + sent);
+        return -1;
+    }
+    UART_Printf("\r\nDUMP END %d %08x\r\n", sent, total_crc);
+    return sent;
+}
@@ -0,0 +1,36 @@
+#ifndef FILE_DUMP_H
+#define FILE_DUMP_H
+
+#include <stdint.h>
+
+/**
+ * Bulk file export over UART1.
+ *
+ * The dump starts with a text line, followed by binary frames and an end line:
+ *
+ *   DUMP BEGIN <file size> <offset> <length>\r\n
+ *   frame: 0xA5 0x5A | offset uint32 LE | length uint16 LE | data | crc32 uint32 LE
+ *   ...
+ *   DUMP END <bytes sent> <crc32 of all data, hex>\r\n
+ *
+ * or "DUMP ERROR <reason>\r\n" on failure. The frame CRC (CRC-32, as zlib.crc32) covers
+ * the offset, length and data fields. Each frame is written by a single UART_Write, so
+ * log lines from other tasks can only appear between frames; they never contain the 0xA5
+ * sync byte. A receiver re-requests the ranges of lost or corrupted frames with
+ * "dump <file> <offset> <length>" (app/tool/uart_dump.py).
+ */
+
+#define FILE_DUMP_SYNC1        0xA5
+#define FILE_DUMP_SYNC2        0x5A
+#define FILE_DUMP_BLOCK_SIZE   512
+
+/**
+ * @brief Stream a file, or a byte range of it, over UART1 in CRC protected frames.
+ * @param path   file to send
+ * @param offset first byte to send
+ * @param length number of bytes to send, 0 for everything up to the end of the file
+ * @return number of bytes sent, negative on error
+ */
+int32_t FileDump_Send(const char* path, int32_t offset, int32_t length);
+
+#endif // FILE_DUMP_H
@@ -0,0 +1,777 @@
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <api_os.h>
+#include <api_fs.h>
+#include <api_sys.h>
+
+#include "utils.h"
+#include "config_store.h"
+#include "gps_tracker.h"
+#include "geofence.h"
+#include "debug.h"
+
+#define MODULE_TAG "Fence"
+
+#define METRES_PER_UDEG      0.11132f      // 1e-6 degree of latitude
+#define DEG_TO_RAD           0.017453292519943295
+#define MAX_RADIUS           100000        // m
+// Save() writes here, then renames it over GEOFENCE_FILE
+#define GEOFENCE_TEMP        "/geofence.tmp"
+
+// ---------------------------------------------------------------------------
+// fence set
+// ---------------------------------------------------------------------------
+
+void GeofenceSet_Init(GeofenceSet_t* set, Geofence_t* fences, uint16_t maxFences,
+                      GeofencePoint_t* points, uint16_t maxPoints,
+                      uint32_t* cells, uint32_t maxCells, uint16_t* items, uint32_t maxItems)
+{
+    memset(set, 0, sizeof(*set));
+    set->fences    = fences;
+    set->maxFences = maxFences;
+    set->points    = points;
+    set->maxPoints = maxPoints;
+    set->cells     = cells;
+    set->maxCells  = maxCells;
+    set->items     = items;
+    set->maxItems  = maxItems;
+}
+
+void GeofenceSet_Clear(GeofenceSet_t* set)
+{
+    set->count = 0;
+    set->pointCount = 0;
+    set->activeCount = 0;
+    set->indexed = false;
+}
+
+static bool Usable(const Geofence_t* fence)
+{
+    return fence->type == GEOFENCE_CIRCLE || fence->count >= 3;
+}
+
+static int Find(const GeofenceSet_t* set, const char* name)
+{
+    for (int i = 0; i < set->count; ++i)
+        if (strcmp(set->fences[i].name, name) == 0) return i;
+    return -1;
+}
+
+// removes the vertices of a fence, the later ones move down
+static void RemovePoints(GeofenceSet_t* set, Geofence_t* fence)
+{
+    uint16_t end = fence->first + fence->count;
+    memmove(&set->points[fence->first], &set->points[end], (set->pointCount - end) * sizeof(GeofencePoint_t));
+    set->pointCount -= fence->count;
+    for (int i = 0; i < set->count; ++i)
+        if (set->fences[i].first >= end) set->fences[i].first -= fence->count;
+    fence->first = set->pointCount;
+    fence->count = 0;
+}
+
+static void Reverse(GeofencePoint_t* points, int count)
+{
+    for (int i = 0, j = count - 1; i < j; ++i, --j) {
+        GeofencePoint_t t = points[i];
+        points[i] = points[j];
+        points[j] = t;
+    }
+}
+
+bool GeofenceSet_Remove(GeofenceSet_t* set, const char* name)
+{
+    int index = Find(set, name);
+    if (index < 0) return false;
+    RemovePoints(set, &set->fences[index]);
+    memmove(&set->fences[index], &set->fences[index + 1], (set->count - index - 1) * sizeof(Geofence_t));
+    set->count--;
+    set->indexed = false;
+    return true;
+}
+
+static const char* SkipSpaces(const char* p)
+{
+    while (*p == ' ' || *p == '\t') p++;
+    return p;
+}
+
+// "[-]ddd[.dddddd]" in 1e-6 units, digits beyond the sixth decimal are ignored
+static bool ParseMicro(const char** text, int32_t limit, int32_t* value)
+{
+    const char* p = *text;
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+') p++;
+    if (*p < '0' || *p > '9') return false;
+    int32_t whole = 0;
+    while (*p >= '0' && *p <= '9') {
+        whole = whole * 10 + (*p++ - '0');
+        if (whole > limit) return false;
+    }
+    int32_t fraction = 0, scale = 1000000;
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (*p - '0') * scale;
+            }
+            p++;
+        }
+    }
+    int64_t v = (int64_t)whole * 1000000 + fraction;
+    if (v > (int64_t)limit * 1000000) return false;
+    *value = negative ? -(int32_t)v : (int32_t)v;
+    *text = p;
+    return true;
+}
+
+/**
+ * Parses a radius in whole or decimal metres, up to MAX_RADIUS, into millimetres.
+ * Micro units would overflow 32 bits above 2147 m.
+ */
+static bool ParseRadius(const char** text, int32_t* millimetres)
+{
+    const char* p = *text;
+    if (*p < '0' || *p > '9') return false;
+    int32_t whole = 0;
+    while (*p >= '0' && *p <= '9') {
+        whole = whole * 10 + (*p++ - '0');
+        if (whole > MAX_RADIUS) return false;
+    }
+    int32_t fraction = 0, scale = 1000;
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (*p - '0') * scale;
+            }
+            p++;
+        }
+    }
+    if (whole == MAX_RADIUS && fraction > 0) return false;
+    *millimetres = whole * 1000 + fraction;
+    *text = p;
+    return true;
+}
+
+// "<lat>,<lon>"
+static bool ParsePoint(const char** text, GeofencePoint_t* point)
+{
+    const char* p = *text;
+    if (!ParseMicro(&p, 90, &point->lat) || *p++ != ',') return false;
+    if (!ParseMicro(&p, 180, &point->lon)) return false;
+    *text = p;
+    return true;
+}
+
+// the next word, at most size - 1 characters
+static bool ParseWord(const char** text, char* word, int size)
+{
+    const char* p = SkipSpaces(*text);
+    int n = 0;
+    while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+        if (n >= size - 1) return false;
+        word[n++] = *p++;
+    }
+    word[n] = '\0';
+    *text = p;
+    return n > 0;
+}
+
+static bool ValidName(const char* name)
+{
+    for (const char* p = name; *p; ++p)
+        if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') ||
+              *p == '_' || *p == '-' || *p == '.'))
+            return false;
+    return strcmp(name, "all") != 0;
+}
+
+static void UpdateBounds(const GeofenceSet_t* set, Geofence_t* fence)
+{
+    const GeofencePoint_t* v = &set->points[fence->first];
+    if (fence->type == GEOFENCE_CIRCLE) {
+        int32_t dLat = (int32_t)(fence->radius / METRES_PER_UDEG) + 1;
+        float   c    = (float)cos(v->lat * 1e-6 * DEG_TO_RAD);
+        int32_t dLon = c > 0.01f ? (int32_t)(dLat / c) + 1 : 180000000;
+        fence->min.lat = v->lat - dLat;
+        fence->max.lat = v->lat + dLat;
+        fence->min.lon = v->lon - dLon;
+        fence->max.lon = v->lon + dLon;
+        return;
+    }
+    fence->min = fence->max = v[0];
+    for (int i = 1; i < fence->count; ++i) {
+        if (v[i].lat < fence->min.lat) fence->min.lat = v[i].lat;
+        if (v[i].lat > fence->max.lat) fence->max.lat = v[i].lat;
+        if (v[i].lon < fence->min.lon) fence->min.lon = v[i].lon;
+        if (v[i].lon > fence->max.lon) fence->max.lon = v[i].lon;
+    }
+}
+
+bool GeofenceSet_Add(GeofenceSet_t* set, const char* line)
+{
+    char name[GEOFENCE_NAME_LENGTH], type[8];
+    const char* p = line;
+    if (!ParseWord(&p, name, sizeof(name)) || !ValidName(name) || !ParseWord(&p, type, sizeof(type)))
+        return false;
+
+    GeofencePoint_t vertices[GEOFENCE_MAX_VERTICES];
+    int    count = 0;
+    int32_t radius = 0;     // mm
+    bool   circle = strcmp(type, "circle") == 0;
+    if (!circle && strcmp(type, "poly") != 0) return false;
+
+    if (circle) {
+        p = SkipSpaces(p);
+        if (!ParsePoint(&p, &vertices[0])) return false;
+        p = SkipSpaces(p);
+        if (!ParseRadius(&p, &radius) || radius <= 0) return false;
+        count = 1;
+    } else {
+        for (p = SkipSpaces(p); *p && *p != '\r' && *p != '\n'; p = SkipSpaces(p)) {
+            if (count == GEOFENCE_MAX_VERTICES || !ParsePoint(&p, &vertices[count++])) return false;
+        }
+        if (count == 0) return false;
+    }
+    p = SkipSpaces(p);
+    if (*p && *p != '\r' && *p != '\n') return false;
+
+    int index = Find(set, name);
+    Geofence_t* fence;
+    if (index >= 0 && !circle && set->fences[index].type == GEOFENCE_POLYGON) {
+        // more vertices of a polygon: its vertices move to the end of the table
+        fence = &set->fences[index];
+        if (fence->count + count > GEOFENCE_MAX_VERTICES || set->pointCount + count > set->maxPoints)
+            return false;
+        uint16_t end = fence->first + fence->count;
+        if (end != set->pointCount) {
+            // rotate [first, pointCount) left by the polygon, in place
+            Reverse(&set->points[fence->first], fence->count);
+            Reverse(&set->points[end], set->pointCount - end);
+            Reverse(&set->points[fence->first], set->pointCount - fence->first);
+            for (int i = 0; i < set->count; ++i)
+                if (set->fences[i].first >= end) set->fences[i].first -= fence->count;
+            fence->first = set->pointCount - fence->count;
+        }
+    } else {
+        if (index >= 0) GeofenceSet_Remove(set, name);
+        if (set->count == set->maxFences || set->pointCount + count > set->maxPoints) return false;
+        fence = &set->fences[set->count++];
+        memset(fence, 0, sizeof(*fence));
+        strcpy(fence->name, name);
+        fence->type   = circle ? GEOFENCE_CIRCLE : GEOFENCE_POLYGON;
+        fence->state  = GEOFENCE_OUTSIDE;
+        fence->radius = (float)radius / 1000.0f;
+        fence->first  = set->pointCount;
+    }
+    memcpy(&set->points[set->pointCount], vertices, count * sizeof(GeofencePoint_t));
+    set->pointCount += count;
+    fence->count += count;
+    UpdateBounds(set, fence);
+    set->indexed = false;
+    return true;
+}
+
+// " <lat>,<lon>"
+static int FormatPoint(char* buffer, int size, const GeofencePoint_t* point)
+{
+    uint32_t lat = point->lat < 0 ? -(uint32_t)point->lat : (uint32_t)point->lat;
+    uint32_t lon = point->lon < 0 ? -(uint32_t)point->lon : (uint32_t)point->lon;
+    return snprintf(buffer, size, " %s%u.%06u,%s%u.%06u",
+                    point->lat < 0 ? "-" : "", (unsigned)(lat / 1000000), (unsigned)(lat % 1000000),
+                    point->lon < 0 ? "-" : "", (unsigned)(lon / 1000000), (unsigned)(lon % 1000000));
+}
+
+int GeofenceSet_Format(const GeofenceSet_t* set, uint16_t index, char* buffer, int size)
+{
+    const Geofence_t* fence = &set->fences[index];
+    char text[32];
+    int  n = snprintf(buffer, size, "%s %s", fence->name, fence->type == GEOFENCE_CIRCLE ? "circle" : "poly");
+
+    for (int i = 0; i <= fence->count; ++i) {
+        int length;
+        if (i < fence->count)
+            length = FormatPoint(text, sizeof(text), &set->points[fence->first + i]);
+        else if (fence->type == GEOFENCE_CIRCLE)
+            length = snprintf(text, sizeof(text), " %u", (unsigned)(fence->radius + 0.5f));
+        else
+            break;
+        if (n + length < size) memcpy(buffer + n, text, length + 1);
+        n += length;
+    }
+    return n;
+}
+
+// rebuilds the list of fences inside or about to change state
+static void RebuildActive(GeofenceSet_t* set)
+{
+    set->activeCount = 0;
+    for (int i = 0; i < set->count; ++i) {
+        Geofence_t* fence = &set->fences[i];
+        fence->active = (fence->state == GEOFENCE_INSIDE || fence->pending) &&
+                        set->activeCount < GEOFENCE_MAX_ACTIVE;
+        if (fence->active) set->active[set->activeCount++] = i;
+    }
+}
+
+static int32_t CellSpan(int32_t span, int cells)
+{
+    return (int32_t)(((int64_t)span + cells - 1) / cells);
+}
+
+// cells covered by a box, clamped to the grid
+static void CellRange(const GeofenceSet_t* set, const GeofencePoint_t* min, const GeofencePoint_t* max,
+                      int* x0, int* y0, int* x1, int* y1)
+{
+    *x0 = (int)(((int64_t)min->lon - set->gridOrigin.lon) / set->cellLon);
+    *x1 = (int)(((int64_t)max->lon - set->gridOrigin.lon) / set->cellLon);
+    *y0 = (int)(((int64_t)min->lat - set->gridOrigin.lat) / set->cellLat);
+    *y1 = (int)(((int64_t)max->lat - set->gridOrigin.lat) / set->cellLat);
+    if (*x1 >= set->gridWidth)  *x1 = set->gridWidth - 1;
+    if (*y1 >= set->gridHeight) *y1 = set->gridHeight - 1;
+}
+
+void GeofenceSet_BuildIndex(GeofenceSet_t* set)
+{
+    set->indexed = true;
+    set->gridWidth = set->gridHeight = 0;
+    RebuildActive(set);
+
+    GeofencePoint_t min = {0, 0}, max = {0, 0};
+    int usable = 0;
+    for (int i = 0; i < set->count; ++i) {
+        const Geofence_t* fence = &set->fences[i];
+        if (!Usable(fence)) continue;
+        if (usable++ == 0) {
+            min = fence->min;
+            max = fence->max;
+            continue;
+        }
+        if (fence->min.lat < min.lat) min.lat = fence->min.lat;
+        if (fence->min.lon < min.lon) min.lon = fence->min.lon;
+        if (fence->max.lat > max.lat) max.lat = fence->max.lat;
+        if (fence->max.lon > max.lon) max.lon = fence->max.lon;
+    }
+    if (usable == 0 || set->maxCells < 2) return;
+
+    // about two cells per fence, shaped after the area in metres
+    int32_t spanLat = max.lat - min.lat + 1;
+    int32_t spanLon = max.lon - min.lon + 1;
+    float   aspect  = (float)spanLon * (float)cos((min.lat + spanLat / 2) * 1e-6 * DEG_TO_RAD) / (float)spanLat;
+    int     target  = usable * 2;
+    if (target > (int)set->maxCells - 1) target = set->maxCells - 1;
+    int width = (int)(sqrt(target * aspect) + 0.5);
+    if (width < 1) width = 1;
+    if (width > target) width = target;
+    int height = target / width;
+    if (height < 1) height = 1;
+
+    set->gridOrigin = min;
+    for (;;) {
+        set->gridWidth  = width;
+        set->gridHeight = height;
+        set->cellLat = CellSpan(spanLat, height);
+        set->cellLon = CellSpan(spanLon, width);
+        uint32_t items = 0;
+        for (int i = 0; i < set->count; ++i) {
+            const Geofence_t* fence = &set->fences[i];
+            if (!Usable(fence)) continue;
+            int x0, y0, x1, y1;
+            CellRange(set, &fence->min, &fence->max, &x0, &y0, &x1, &y1);
+            items += (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+        }
+        if (items <= set->maxItems) break;
+        if (width == 1 && height == 1) {
+            // not even one item per fence: no grid, every fence is tested
+            set->gridWidth = set->gridHeight = 0;
+            return;
+        }
+        width  = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+
+    // counts, then offsets, then the items (compressed rows)
+    uint32_t cells = (uint32_t)width * height;
+    memset(set->cells, 0, (cells + 1) * sizeof(uint32_t));
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < set->count; ++i) {
+            const Geofence_t* fence = &set->fences[i];
+            if (!Usable(fence)) continue;
+            int x0, y0, x1, y1;
+            CellRange(set, &fence->min, &fence->max, &x0, &y0, &x1, &y1);
+            for (int y = y0; y <= y1; ++y)
+                for (int x = x0; x <= x1; ++x) {
+                    uint32_t c = (uint32_t)y * width + x;
+                    if (pass == 0) set->cells[c + 1]++;
+                    else set->items[set->cells[c]++] = i;
+                }
+        }
+        if (pass == 0) {
+            for (uint32_t c = 0; c < cells; ++c) set->cells[c + 1] += set->cells[c];
+        }
+    }
+    // the fill moved every offset to the start of the next cell
+    for (uint32_t c = cells; c > 0; --c) set->cells[c] = set->cells[c - 1];
+    set->cells[0] = 0;
+}
+
+typedef struct {
+    int32_t lat, lon;
+    float   metresPerUdegLon;
+} Fix_t;
+
+static bool InsidePolygon(const GeofencePoint_t* v, int count, const Fix_t* fix)
+{
+    bool inside = false;
+    for (int i = 0, j = count - 1; i < count; j = i++) {
+        const GeofencePoint_t* a = &v[j];
+        const GeofencePoint_t* b = &v[i];
+        if ((a->lat > fix->lat) == (b->lat > fix->lat)) continue;
+        // the side of the fix against the edge, crossings to the east count
+        int64_t cross = (int64_t)(b->lon - a->lon) * (fix->lat - a->lat) -
+                        (int64_t)(fix->lon - a->lon) * (b->lat - a->lat);
+        if ((b->lat > a->lat) ? cross > 0 : cross < 0) inside = !inside;
+    }
+    return inside;
+}
+
+// metres from the fix to the nearest edge of a polygon
+static float PolygonDistance(const GeofencePoint_t* v, int count, const Fix_t* fix)
+{
+    float best = -1.0f;
+    for (int i = 0, j = count - 1; i < count; j = i++) {
+        float ax = (v[j].lon - fix->lon) * fix->metresPerUdegLon;
+        float ay = (v[j].lat - fix->lat) * METRES_PER_UDEG;
+        float bx = (v[i].lon - fix->lon) * fix->metresPerUdegLon;
+        float by = (v[i].lat - fix->lat) * METRES_PER_UDEG;
+        float dx = bx - ax, dy = by - ay;
+        float length = dx * dx + dy * dy;
+        float t = length > 0.0f ? -(ax * dx + ay * dy) / length : 0.0f;
+        if (t < 0.0f) t = 0.0f;
+        if (t > 1.0f) t = 1.0f;
+        float px = ax + t * dx, py = ay + t * dy;
+        float d = px * px + py * py;
+        if (best < 0.0f || d < best) best = d;
+    }
+    return (float)sqrt(best);
+}
+
+static bool InBox(const Geofence_t* fence, int32_t lat, int32_t lon, int32_t marginLat, int32_t marginLon)
+{
+    return lat >= fence->min.lat - marginLat && lat <= fence->max.lat + marginLat &&
+           lon >= fence->min.lon - marginLon && lon <= fence->max.lon + marginLon;
+}
+
+/**
+ * @return true if the fix is inside the fence; outside (and inside the margin when the
+ *         fence is entered) is false, beyond the margin is false with far set
+ */
+static bool Contains(const GeofenceSet_t* set, const Geofence_t* fence, const Fix_t* fix, float margin, bool* far)
+{
+    const GeofencePoint_t* v = &set->points[fence->first];
+    *far = true;
+    if (fence->type == GEOFENCE_CIRCLE) {
+        float dx = (fix->lon - v->lon) * fix->metresPerUdegLon;
+        float dy = (fix->lat - v->lat) * METRES_PER_UDEG;
+        float d2 = dx * dx + dy * dy;
+        float r  = fence->radius + margin;
+        *far = d2 > r * r;
+        return d2 <= fence->radius * fence->radius;
+    }
+    if (InsidePolygon(v, fence->count, fix)) return true;
+    *far = margin <= 0.0f || PolygonDistance(v, fence->count, fix) > margin;
+    return false;
+}
+
+static void Evaluate(GeofenceSet_t* set, uint16_t index, const Fix_t* fix, float margin,
+                     Geofence_Callback_t callback, void* param)
+{
+    Geofence_t* fence = &set->fences[index];
+    int32_t marginLat = fence->state == GEOFENCE_INSIDE ? (int32_t)(margin / METRES_PER_UDEG) + 1 : 0;
+    int32_t marginLon = fence->state == GEOFENCE_INSIDE ? (int32_t)(margin / fix->metresPerUdegLon) + 1 : 0;
+    bool inside = false, far = true;
+    if (InBox(fence, fix->lat, fix->lon, marginLat, marginLon))
+        inside = Contains(set, fence, fix, fence->state == GEOFENCE_INSIDE ? margin : 0.0f, &far);
+
+    if (!set->primed) {
+        fence->state   = inside ? GEOFENCE_INSIDE : GEOFENCE_OUTSIDE;
+        fence->pending = 0;
+    } else if (fence->state == GEOFENCE_OUTSIDE) {
+        fence->pending = inside ? fence->pending + 1 : 0;
+        if (fence->pending >= GEOFENCE_CONFIRM) {
+            fence->state   = GEOFENCE_INSIDE;
+            fence->pending = 0;
+            callback(param, fence, true);
+        }
+    } else {
+        fence->pending = (!inside && far) ? fence->pending + 1 : 0;
+        if (fence->pending >= GEOFENCE_CONFIRM) {
+            fence->state   = GEOFENCE_OUTSIDE;
+            fence->pending = 0;
+            callback(param, fence, false);
+        }
+    }
+
+    bool active = fence->state == GEOFENCE_INSIDE || fence->pending;
+    if (active && !fence->active && set->activeCount < GEOFENCE_MAX_ACTIVE) {
+        set->active[set->activeCount++] = index;
+        fence->active = true;
+    } else if (!active && fence->active) {
+        for (int i = 0; i < set->activeCount; ++i) {
+            if (set->active[i] != index) continue;
+            set->active[i] = set->active[--set->activeCount];
+            break;
+        }
+        fence->active = false;
+    }
+}
+
+int GeofenceSet_Check(GeofenceSet_t* set, int32_t lat, int32_t lon, float margin,
+                      Geofence_Callback_t callback, void* param)
+{
+    if (!set->indexed) GeofenceSet_BuildIndex(set);
+    if (set->count == 0) return 0;
+
+    Fix_t fix = {lat, lon, METRES_PER_UDEG * (float)cos(lat * 1e-6 * DEG_TO_RAD)};
+    if (fix.metresPerUdegLon < 1e-4f) fix.metresPerUdegLon = 1e-4f;
+    int tested = 0;
+
+    // fences inside or about to change first: a fix outside their cells still counts.
+    // The list changes under the loop, a fence swapped in from the end is already done
+    uint16_t active[GEOFENCE_MAX_ACTIVE];
+    int activeCount = set->activeCount;
+    memcpy(active, set->active, activeCount * sizeof(uint16_t));
+    for (int i = 0; i < activeCount; ++i, ++tested)
+        Evaluate(set, active[i], &fix, margin, callback, param);
+
+    if (set->gridWidth == 0) {
+        // no grid: every fence
+        for (int i = 0; i < set->count; ++i) {
+            if (set->fences[i].active || !Usable(&set->fences[i])) continue;
+            Evaluate(set, i, &fix, margin, callback, param);
+            tested++;
+        }
+    } else {
+        int64_t x = ((int64_t)lon - set->gridOrigin.lon) / set->cellLon;
+        int64_t y = ((int64_t)lat - set->gridOrigin.lat) / set->cellLat;
+        if (lon >= set->gridOrigin.lon && lat >= set->gridOrigin.lat && x < set->gridWidth && y < set->gridHeight) {
+            uint32_t c = (uint32_t)y * set->gridWidth + (uint32_t)x;
+            for (uint32_t i = set->cells[c]; i < set->cells[c + 1]; ++i) {
+                uint16_t index = set->items[i];
+                if (set->fences[index].active) continue;
+                Evaluate(set, index, &fix, margin, callback, param);
+                tested++;
+            }
+        }
+    }
+    set->primed = true;
+    return tested;
+}
+
+// ---------------------------------------------------------------------------
+// the tracker's fences
+// ---------------------------------------------------------------------------
+
+static Geofence_t      fences[GEOFENCE_MAX_FENCES];
+static GeofencePoint_t points[GEOFENCE_MAX_POINTS];
+static uint32_t        cells[GEOFENCE_MAX_CELLS + 1];
+static uint16_t        items[GEOFENCE_MAX_ITEMS];
+static GeofenceSet_t   geofences;
+static HANDLE          geofenceMutex = NULL;
+static char            line[GEOFENCE_LINE_MAX];    // file lines, under the mutex
+// Geofence_Add(): the fence it replaces or extends, under the mutex
+static Geofence_t      undoFence;
+static GeofencePoint_t undoPoints[GEOFENCE_MAX_VERTICES];
+
+static GeofenceEvent_t events[GEOFENCE_EVENT_QUEUE];
+static uint8_t         eventHead = 0, eventCount = 0;
+
+static void Load(void)
+{
+    int32_t fd = API_FS_Open(GEOFENCE_FILE, FS_O_RDONLY, 0);
+    if (fd < 0) {
+        // power lost between the delete and the rename in Save(): the new file is complete
+        if (API_FS_Rename(GEOFENCE_TEMP, GEOFENCE_FILE) != 0) return;
+        LOGW("%s recovered from %s", GEOFENCE_FILE, GEOFENCE_TEMP);
+        fd = API_FS_Open(GEOFENCE_FILE, FS_O_RDONLY, 0);
+        if (fd < 0) return;
+    }
+
+    int  length = 0, errors = 0;
+    bool skip = false;      // the rest of a line too long for the buffer
+    for (;;) {
+        int32_t n = API_FS_Read(fd, (uint8_t*)line + length, sizeof(line) - 1 - length);
+        if (n > 0) length += n;
+        line[length] = '\0';
+
+        char* start = line;
+        char* end;
+        while ((end = strchr(start, '\n')) || (n <= 0 && *start)) {
+            if (end) *end = '\0';
+            if (!skip && *start && *start != '#' && *start != '\r' && !GeofenceSet_Add(&geofences, start)) {
+                LOGW("Bad fence: %s", start);
+                errors++;
+            }
+            skip = false;
+            start = end ? end + 1 : line + length;
+        }
+        length -= start - line;
+        memmove(line, start, length);
+        if (n <= 0) break;
+        if (length == sizeof(line) - 1) {
+            LOGW("Fence line too long");
+            errors++;
+            skip = true;
+            length = 0;
+        }
+    }
+    API_FS_Close(fd);
+    LOGI("%d fences loaded, %d errors", geofences.count, errors);
+}
+
+// writes the set to a temporary file and renames it, GEOFENCE_FILE is never half written
+static bool Save(void)
+{
+    int32_t fd = API_FS_Open(GEOFENCE_TEMP, FS_O_RDWR | FS_O_CREAT | FS_O_TRUNC, 0);
+    if (fd < 0) {
+        LOGE("Open %s failed: %d", GEOFENCE_TEMP, fd);
+        return false;
+    }
+    bool ok = true;
+    for (int i = 0; i < geofences.count && ok; ++i) {
+        int length = GeofenceSet_Format(&geofences, i, line, sizeof(line) - 2);
+        if (length >= (int)sizeof(line) - 2) {
+            LOGE("Fence %s does not fit in a line", geofences.fences[i].name);
+            ok = false;
+            break;
+        }
+        memcpy(line + length, "\r\n", 3);
+        ok = API_FS_Write(fd, (uint8_t*)line, length + 2) == length + 2;
+    }
+    API_FS_Flush(fd);
+    API_FS_Close(fd);
+    if (ok) {
+        API_FS_Delete(GEOFENCE_FILE);
+        ok = API_FS_Rename(GEOFENCE_TEMP, GEOFENCE_FILE) == 0;
+    }
+    if (!ok) {
+        API_FS_Delete(GEOFENCE_TEMP);
+        LOGE("Write %s failed", GEOFENCE_FILE);
+    }
+    return ok;
+}
+
+// puts back a fence saved by Geofence_Add(), at the end of the set; its room was freed
+static void RestoreFence(const Geofence_t* fence, const GeofencePoint_t* vertices)
+{
+    Geofence_t* restored = &geofences.fences[geofences.count++];
+    *restored = *fence;
+    restored->first = geofences.pointCount;
+    memcpy(&geofences.points[restored->first], vertices, fence->count * sizeof(GeofencePoint_t));
+    geofences.pointCount += fence->count;
+    geofences.indexed = false;
+}
+
+void Geofence_Init(void)
+{
+    geofenceMutex = OS_CreateMutex();
+    GeofenceSet_Init(&geofences, fences, GEOFENCE_MAX_FENCES, points, GEOFENCE_MAX_POINTS,
+                     cells, GEOFENCE_MAX_CELLS, items, GEOFENCE_MAX_ITEMS);
+    Load();
+}
+
+static void QueueEvent(void* param, const Geofence_t* fence, bool entered)
+{
+    GeofenceEvent_t* event = (GeofenceEvent_t*)param;
+    strcpy(event->name, fence->name);
+    event->entered = entered;
+    LOGI("%s %s", entered ? "Entered" : "Left", fence->name);
+
+    uint32_t status = SYS_EnterCriticalSection();
+    if (eventCount == GEOFENCE_EVENT_QUEUE) {
+        // the oldest is lost
+        eventHead = (eventHead + 1) % GEOFENCE_EVENT_QUEUE;
+        eventCount--;
+    }
+    events[(eventHead + eventCount++) % GEOFENCE_EVENT_QUEUE] = *event;
+    SYS_ExitCriticalSection(status);
+}
+
+void Geofence_Check(uint32_t timestamp, float latitude, float longitude)
+{
+    if (!geofenceMutex || geofences.count == 0) return;
+
+    GeofenceEvent_t event = {"", false, timestamp, latitude, longitude};
+    uint8_t queued = eventCount;
+    OS_LockMutex(geofenceMutex);
+    GeofenceSet_Check(&geofences, (int32_t)(latitude * 1e6), (int32_t)(longitude * 1e6),
+                      g_ConfigStore.geofence_margin, QueueEvent, &event);
+    OS_UnlockMutex(geofenceMutex);
+    if (eventCount != queued) Tracker_Notify(TRACKER_EVENT_GEOFENCE);
+}
+
+bool Geofence_PopEvent(GeofenceEvent_t* event)
+{
+    bool found = false;
+    uint32_t status = SYS_EnterCriticalSection();
+    if (eventCount) {
+        *event = events[eventHead];
+        eventHead = (eventHead + 1) % GEOFENCE_EVENT_QUEUE;
+        eventCount--;
+        found = true;
+    }
+    SYS_ExitCriticalSection(status);
+    return found;
+}
+
+bool Geofence_Add(const char* text)
+{
+    OS_LockMutex(geofenceMutex);
+    char name[GEOFENCE_NAME_LENGTH] = "";
+    const char* p = text;
+    int index = ParseWord(&p, name, sizeof(name)) ? Find(&geofences, name) : -1;
+    if (index >= 0) {
+        undoFence = geofences.fences[index];
+        memcpy(undoPoints, &geofences.points[undoFence.first], undoFence.count * sizeof(GeofencePoint_t));
+    }
+    bool added = GeofenceSet_Add(&geofences, text);
+    bool ok = added && Save();
+    // the set follows the file: undo the change, or the replaced fence a failed add removed
+    if (!ok && (added || (index >= 0 && Find(&geofences, name) < 0))) {
+        GeofenceSet_Remove(&geofences, name);
+        if (index >= 0) RestoreFence(&undoFence, undoPoints);
+    }
+    OS_UnlockMutex(geofenceMutex);
+    return ok;
+}
+
+bool Geofence_Remove(const char* name)
+{
+    OS_LockMutex(geofenceMutex);
+    bool ok = true;
+    if (strcmp(name, "all") == 0) GeofenceSet_Clear(&geofences);
+    else ok = GeofenceSet_Remove(&geofences, name);
+    ok = ok && Save();
+    OS_UnlockMutex(geofenceMutex);
+    return ok;
+}
+
+void Geofence_List(CmdOutputFunc output)
+{
+    OS_LockMutex(geofenceMutex);
+    for (int i = 0; i < geofences.count; ++i) {
+        const Geofence_t* fence = &geofences.fences[i];
+        if (fence->type == GEOFENCE_CIRCLE)
+            output("%-16s circle %u m %s\r\n", fence->name, (unsigned)(fence->radius + 0.5f),
+                   fence->state == GEOFENCE_INSIDE ? "inside" : "outside");
+        else
+            output("%-16s poly %u points %s\r\n", fence->name, fence->count,
+                   fence->count < 3 ? "incomplete" : fence->state == GEOFENCE_INSIDE ? "inside" : "outside");
+    }
+    output("%u fences, %u points\r\n", geofences.count, geofences.pointCount);
+    OS_UnlockMutex(geofenceMutex);
+}
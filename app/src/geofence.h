@@ -0,0 +1,191 @@
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config_commands.h"
+
+/**
+ * On-device geofences (config geofence_margin).
+ *
+ * Circles and polygons, kept in GEOFENCE_FILE one per line:
+ *
+ *   <name> circle <lat>,<lon> <radius m>
+ *   <name> poly <lat>,<lon> <lat>,<lon> <lat>,<lon> ...
+ *
+ * and edited with the "fence" commands, on the console or from the server. Every new
+ * fix is checked in gps_Process(): a uniform grid over the fences lists, per cell, the
+ * fences whose bounding box overlaps it, so a fix is tested against a handful of fences
+ * whatever their number. A fence is entered after GEOFENCE_CONFIRM fixes inside it and
+ * left after as many fixes more than geofence_margin metres outside; the first fix
+ * after boot sets the states without alerts.
+ *
+ * Enter and exit events wake the tracker, which reports them at once: in a position
+ * report ("geofence=enter:home,exit:depot") or, without GPRS, by SMS to
+ * sms_report_number.
+ *
+ * Coordinates are held in 1e-6 degree integers; the point in polygon test runs in
+ * integers, the distances in float metres.
+ */
+
+#define GEOFENCE_FILE             "/geofence.txt"
+#define GEOFENCE_NAME_LENGTH      16
+#define GEOFENCE_MAX_VERTICES     48      // per polygon
+// longest line of GEOFENCE_FILE, with its \r\n: the name, the type and the vertices of the
+// largest polygon at 23 characters each (" -33.123456,-151.123456")
+#define GEOFENCE_LINE_MAX         (GEOFENCE_NAME_LENGTH + 8 + GEOFENCE_MAX_VERTICES * 23 + 3)
+#define GEOFENCE_CONFIRM          2
+// fences inside or about to change, checked whatever the cell of the fix
+#define GEOFENCE_MAX_ACTIVE       16
+// the fences of the tracker
+#define GEOFENCE_MAX_FENCES       256
+#define GEOFENCE_MAX_POINTS       2048
+#define GEOFENCE_MAX_CELLS        1024
+#define GEOFENCE_MAX_ITEMS        4096
+// events waiting for the tracker
+#define GEOFENCE_EVENT_QUEUE      8
+
+typedef enum {
+    GEOFENCE_CIRCLE = 0,
+    GEOFENCE_POLYGON,
+} Geofence_Type_t;
+
+typedef enum {
+    GEOFENCE_OUTSIDE = 0,
+    GEOFENCE_INSIDE,
+} Geofence_State_t;
+
+// 1e-6 degree
+typedef struct {
+    int32_t lat;
+    int32_t lon;
+} GeofencePoint_t;
+
+typedef struct {
+    char     name[GEOFENCE_NAME_LENGTH];
+    uint8_t  type;              // Geofence_Type_t
+    uint8_t  state;             // Geofence_State_t
+    uint8_t  pending;           // fixes in a row against the state
+    uint8_t  active;            // in the active list
+    uint16_t first;             // vertices, the centre of a circle
+    uint16_t count;
+    float    radius;            // m, circles
+    GeofencePoint_t min, max;   // bounding box
+} Geofence_t;
+
+/**
+ * The fences and their grid. The storage is supplied by the owner: the tracker's set is
+ * static, the benchmark's much larger.
+ */
+typedef struct {
+    Geofence_t*      fences;
+    uint16_t         maxFences;
+    uint16_t         count;
+    GeofencePoint_t* points;
+    uint16_t         maxPoints;
+    uint16_t         pointCount;
+    // grid: fences of cell i are items[cells[i]] .. items[cells[i + 1] - 1]
+    uint32_t*        cells;
+    uint32_t         maxCells;
+    uint16_t*        items;
+    uint32_t         maxItems;
+    uint16_t         gridWidth, gridHeight;
+    GeofencePoint_t  gridOrigin;
+    int32_t          cellLat, cellLon;
+    bool             indexed;
+    bool             primed;    // the states were set by a first fix
+    uint8_t          activeCount;
+    uint16_t         active[GEOFENCE_MAX_ACTIVE];
+} GeofenceSet_t;
+
+// GeofenceSet_Check() callback, for every enter and exit
+typedef void (*Geofence_Callback_t)(void* param, const Geofence_t* fence, bool entered);
+
+typedef struct {
+    char     name[GEOFENCE_NAME_LENGTH];
+    bool     entered;
+    uint32_t timestamp;
+    float    latitude;
+    float    longitude;
+} GeofenceEvent_t;
+
+/**
+ * @brief Set up an empty set on the given storage.
+ * @param cells room for the grid offsets, one more than the cells of the grid
+ */
+void GeofenceSet_Init(GeofenceSet_t* set, Geofence_t* fences, uint16_t maxFences,
+                      GeofencePoint_t* points, uint16_t maxPoints,
+                      uint32_t* cells, uint32_t maxCells, uint16_t* items, uint32_t maxItems);
+
+/**
+ * @brief Remove every fence.
+ */
+void GeofenceSet_Clear(GeofenceSet_t* set);
+
+/**
+ * @brief Add a fence from its text form (see above). A polygon line naming an existing
+ *        polygon appends its vertices, so long polygons fit in several commands.
+ * @return false on a syntax error or when the set is full
+ */
+bool GeofenceSet_Add(GeofenceSet_t* set, const char* line);
+
+/**
+ * @brief Remove the fence with the given name.
+ * @return false if there is none
+ */
+bool GeofenceSet_Remove(GeofenceSet_t* set, const char* name);
+
+/**
+ * @brief Write the text form of a fence, without the line end.
+ * @return the length, or the length needed if it did not fit
+ */
+int GeofenceSet_Format(const GeofenceSet_t* set, uint16_t index, char* buffer, int size);
+
+/**
+ * @brief Build the grid; GeofenceSet_Check() builds it when the fences changed.
+ */
+void GeofenceSet_BuildIndex(GeofenceSet_t* set);
+
+/**
+ * @brief Check a fix against the fences.
+ * @param margin distance outside a fence (m) before it is left
+ * @return the number of fences tested
+ */
+int GeofenceSet_Check(GeofenceSet_t* set, int32_t lat, int32_t lon, float margin,
+                      Geofence_Callback_t callback, void* param);
+
+/**
+ * @brief Load GEOFENCE_FILE into the tracker's set.
+ */
+void Geofence_Init(void);
+
+/**
+ * @brief Check the tracker's fences with a new fix; queues the events and wakes the tracker.
+ */
+void Geofence_Check(uint32_t timestamp, float latitude, float longitude);
+
+/**
+ * @brief Take the oldest queued event.
+ * @return false if there is none
+ */
+bool Geofence_PopEvent(GeofenceEvent_t* event);
+
+/**
+ * @brief Add a fence (GeofenceSet_Add()) and save the file.
+ * @return false if the fence is invalid, there is no room for it or the file was not written;
+ *         the fences are then left as they were
+ */
+bool Geofence_Add(const char* line);
+
+/**
+ * @brief Remove a fence, or all of them with "all", and save the file.
+ */
+bool Geofence_Remove(const char* name);
+
+/**
+ * @brief Print the fences and their states.
+ */
+void Geofence_List(CmdOutputFunc output);
+
+#endif // GEOFENCE_H
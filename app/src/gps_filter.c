@@ -0,0 +1,169 @@
+#include <math.h>
+
+#include "gps_filter.h"
+
+#define METRES_PER_DEG_LAT   111320.0
+#define METRES_PER_KNOT      0.514444f
+#define DEG_TO_RAD           0.017453292519943295
+// below this speed (m/s) the receiver's course carries no information
+#define STILL_SPEED          0.1f
+
+void GpsFilter_Init(GpsFilter_t* filter, float accel)
+{
+    filter->accel = accel;
+    GpsFilter_Reset(filter);
+}
+
+void GpsFilter_Reset(GpsFilter_t* filter)
+{
+    filter->started = false;
+    filter->rejects = 0;
+}
+
+static void SetOrigin(GpsFilter_t* filter, double latitude, double longitude)
+{
+    filter->lat0 = latitude;
+    filter->lon0 = longitude;
+    filter->metresPerDegLon = (float)(METRES_PER_DEG_LAT * cos(latitude * DEG_TO_RAD));
+    if (filter->metresPerDegLon < 1.0f) filter->metresPerDegLon = 1.0f;     // at the poles
+}
+
+static void Predict(GpsFilter_Axis_t* a, float dt, float q)
+{
+    float dt2 = dt * dt;
+    a->p  += a->v * dt;
+    a->pp += dt * (2.0f * a->pv + dt * a->vv) + q * dt2 * dt2 * 0.25f;
+    a->pv += dt * a->vv + q * dt2 * dt * 0.5f;
+    a->vv += q * dt2;
+}
+
+static void CorrectPosition(GpsFilter_Axis_t* a, float z, float r)
+{
+    float s  = a->pp + r;
+    float kp = a->pp / s;
+    float kv = a->pv / s;
+    float y  = z - a->p;
+    a->p  += kp * y;
+    a->v  += kv * y;
+    a->vv -= kv * a->pv;
+    a->pv -= kp * a->pv;
+    a->pp -= kp * a->pp;
+}
+
+static void CorrectVelocity(GpsFilter_Axis_t* a, float z, float r)
+{
+    float s  = a->vv + r;
+    float kp = a->pv / s;
+    float kv = a->vv / s;
+    float y  = z - a->v;
+    a->p  += kp * y;
+    a->v  += kv * y;
+    a->pp -= kp * a->pv;
+    a->pv -= kv * a->pv;
+    a->vv -= kv * a->vv;
+}
+
+// the receiver's Doppler velocity, false if the RMC carries none
+static bool Velocity(const GpsFilter_Fix_t* fix, float* east, float* north)
+{
+    float speed = fix->speed * METRES_PER_KNOT;
+    if (isnan(speed) || speed > GPS_FILTER_MAX_SPEED) return false;
+    if (speed < STILL_SPEED) {
+        *east = *north = 0.0f;
+        return true;
+    }
+    if (isnan(fix->bearing)) return false;
+    double course = fix->bearing * DEG_TO_RAD;
+    *east  = speed * (float)sin(course);
+    *north = speed * (float)cos(course);
+    return true;
+}
+
+static GpsFilter_Result_t Start(GpsFilter_t* filter, double time, GpsFilter_Fix_t* fix, float r, float rv)
+{
+    SetOrigin(filter, fix->latitude, fix->longitude);
+    float east, north;
+    if (!Velocity(fix, &east, &north)) {
+        east = north = 0.0f;
+        rv = GPS_FILTER_MAX_SPEED * GPS_FILTER_MAX_SPEED;
+    }
+    GpsFilter_Axis_t e = { 0.0f, east,  r, 0.0f, rv };
+    GpsFilter_Axis_t n = { 0.0f, north, r, 0.0f, rv };
+    filter->east    = e;
+    filter->north   = n;
+    filter->time    = time;
+    filter->rejects = 0;
+    filter->started = true;
+    fix->accuracy = (float)sqrt(2.0f * r);
+    return GPS_FILTER_STARTED;
+}
+
+// the state as a fix
+static void Output(const GpsFilter_t* filter, GpsFilter_Fix_t* fix)
+{
+    const GpsFilter_Axis_t* e = &filter->east;
+    const GpsFilter_Axis_t* n = &filter->north;
+    fix->latitude  = filter->lat0 + n->p / METRES_PER_DEG_LAT;
+    fix->longitude = filter->lon0 + e->p / filter->metresPerDegLon;
+    float speed = (float)sqrt(e->v * e->v + n->v * n->v);
+    fix->speed = speed / METRES_PER_KNOT;
+    // the receiver's course is kept while standing still
+    if (speed >= STILL_SPEED) {
+        fix->bearing = (float)(atan2(e->v, n->v) / DEG_TO_RAD);
+        if (fix->bearing < 0.0f) fix->bearing += 360.0f;
+    }
+    fix->accuracy = (float)sqrt(e->pp + n->pp);
+}
+
+GpsFilter_Result_t GpsFilter_Update(GpsFilter_t* filter, double time, GpsFilter_Fix_t* fix)
+{
+    float sigma = fix->accuracy > GPS_FILTER_MIN_SIGMA ? fix->accuracy : GPS_FILTER_MIN_SIGMA;
+    float r  = sigma * sigma;
+    // Doppler speed errors grow with the geometry like the position errors, about 20x smaller
+    float sigmaV = sigma * 0.05f > GPS_FILTER_MIN_SPEED_SIGMA ? sigma * 0.05f : GPS_FILTER_MIN_SPEED_SIGMA;
+    float rv = sigmaV * sigmaV;
+
+    double dt = time - filter->time;
+    if (!filter->started || dt <= 0.0 || dt > GPS_FILTER_MAX_GAP)
+        return Start(filter, time, fix, r, rv);
+
+    float ze = (float)((fix->longitude - filter->lon0) * filter->metresPerDegLon);
+    float zn = (float)((fix->latitude - filter->lat0) * METRES_PER_DEG_LAT);
+    // speed implied by the jump from the last position
+    float de = ze - filter->east.p;
+    float dn = zn - filter->north.p;
+    bool jump = de * de + dn * dn > (float)(GPS_FILTER_MAX_SPEED * GPS_FILTER_MAX_SPEED * dt * dt);
+
+    float q = filter->accel * filter->accel;
+    Predict(&filter->east,  (float)dt, q);
+    Predict(&filter->north, (float)dt, q);
+    filter->time = time;
+
+    // normalised innovation of the position
+    float ye = ze - filter->east.p;
+    float yn = zn - filter->north.p;
+    float d2 = ye * ye / (filter->east.pp + r) + yn * yn / (filter->north.pp + r);
+    bool reject = jump || d2 > GPS_FILTER_GATE;
+    if (reject && ++filter->rejects >= GPS_FILTER_MAX_REJECTS)
+        return Start(filter, time, fix, r, rv);
+
+    if (!reject) {
+        filter->rejects = 0;
+        CorrectPosition(&filter->east,  ze, r);
+        CorrectPosition(&filter->north, zn, r);
+    }
+    // multipath shifts the position, the Doppler speed of a rejected fix is still used
+    float ve, vn;
+    if (Velocity(fix, &ve, &vn)) {
+        CorrectVelocity(&filter->east,  ve, rv);
+        CorrectVelocity(&filter->north, vn, rv);
+    }
+
+    if (fabs(filter->east.p) > GPS_FILTER_ORIGIN_RANGE || fabs(filter->north.p) > GPS_FILTER_ORIGIN_RANGE) {
+        SetOrigin(filter, filter->lat0 + filter->north.p / METRES_PER_DEG_LAT,
+                          filter->lon0 + filter->east.p / filter->metresPerDegLon);
+        filter->east.p = filter->north.p = 0.0f;
+    }
+    Output(filter, fix);
+    return reject ? GPS_FILTER_REJECTED : GPS_FILTER_ACCEPTED;
+}
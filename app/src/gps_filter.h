@@ -0,0 +1,87 @@
+#ifndef GPS_FILTER_H
+#define GPS_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Position smoothing between the NMEA parser and the reports (config gps_filter).
+ *
+ * A constant-velocity Kalman filter with two independent axes, east and north, each
+ * holding a position and a velocity in metres from an origin near the device. Every
+ * new RMC epoch is one step: the state is predicted over the time since the last fix,
+ * with the acceleration noise gps_filter_accel (m/s^2) as process noise, and corrected
+ * with the reported position (variance (HDOP x gps_uere)^2) and the Doppler speed and
+ * course of the receiver.
+ *
+ * Fixes are rejected as outliers when they imply a speed above GPS_FILTER_MAX_SPEED or
+ * fall outside the GPS_FILTER_GATE innovation gate; the prediction, still corrected
+ * with the Doppler velocity, is reported instead.
+ * The filter starts again from the next fix after GPS_FILTER_MAX_REJECTS rejects in a
+ * row (the device really is elsewhere) and after a gap longer than GPS_FILTER_MAX_GAP.
+ *
+ * The state is single precision; the origin moves with the device, so the offsets stay
+ * small enough for float resolution.
+ */
+
+#define GPS_FILTER_MAX_SPEED      70.0f     // m/s, 250 km/h
+// chi-square, 2 degrees of freedom, 99.9%
+#define GPS_FILTER_GATE           13.8f
+// multipath episodes last a few seconds
+#define GPS_FILTER_MAX_REJECTS    8
+#define GPS_FILTER_MAX_GAP        30.0      // s
+// the origin follows the device beyond this distance (m)
+#define GPS_FILTER_ORIGIN_RANGE   5000.0f
+// lower bounds of the measurement noise: 1 m position, 0.2 m/s Doppler speed
+#define GPS_FILTER_MIN_SIGMA      1.0f
+#define GPS_FILTER_MIN_SPEED_SIGMA 0.2f
+
+typedef enum {
+    GPS_FILTER_STARTED = 0,     // first fix, or the filter was restarted with this one
+    GPS_FILTER_ACCEPTED,
+    GPS_FILTER_REJECTED,        // outlier, the fix holds the prediction
+} GpsFilter_Result_t;
+
+// a fix in and out of the filter
+typedef struct {
+    double latitude;            // degrees
+    double longitude;
+    float  speed;               // knots
+    float  bearing;             // degrees
+    float  accuracy;            // m, HDOP x UERE in, the filter's estimate out
+} GpsFilter_Fix_t;
+
+// one axis: position, velocity and their covariance
+typedef struct {
+    float p, v;
+    float pp, pv, vv;
+} GpsFilter_Axis_t;
+
+typedef struct {
+    float            accel;     // process noise, m/s^2
+    bool             started;
+    uint8_t          rejects;   // in a row
+    double           time;      // of the last step, s
+    double           lat0, lon0;
+    float            metresPerDegLon;
+    GpsFilter_Axis_t east, north;
+} GpsFilter_t;
+
+/**
+ * @brief Set up a filter with the acceleration noise accel (m/s^2).
+ */
+void GpsFilter_Init(GpsFilter_t* filter, float accel);
+
+/**
+ * @brief Forget the state; the next fix starts the filter again.
+ */
+void GpsFilter_Reset(GpsFilter_t* filter);
+
+/**
+ * @brief Filter one fix.
+ * @param time fix time in seconds, increasing from step to step
+ * @param fix  the receiver's fix, replaced by the filtered one
+ */
+GpsFilter_Result_t GpsFilter_Update(GpsFilter_t* filter, double time, GpsFilter_Fix_t* fix);
+
+#endif // GPS_FILTER_H
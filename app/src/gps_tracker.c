@@ -2,6 +2,7 @@
 #include <api_gps.h>
 #include <api_event.h>
 #include <api_hal_pm.h>
+#include <api_sys.h>
 
 #include "system.h"
 #include "utils.h"
@@ -12,10 +13,28 @@
 #include "config_commands.h"
 #include "network.h"
 #include "http.h"
+#include "remote_commands.h"
+#include "sms_report.h"
+#include "perf_stats.h"
+#include "task_profiler.h"
+#include "power.h"
+#include "time_sync.h"
+#include "lbs_cache.h"
+#include "link_manager.h"
+#include "agps.h"
+#include "gps_filter.h"
+#include "geofence.h"
+#include "trip.h"
+#include "sms_service.h"
 #include "debug.h"
 
 #define MODULE_TAG "GPS"
 
+// "enter:home,exit:depot" field of the report
+#define GEOFENCE_ALERTS_LENGTH   128
+// "&odometer=...&trip=end&trip_distance=..." fields of the report
+#define TRIP_FIELDS_LENGTH       112
+
 GPS_Info_t* gpsInfo = NULL;
 
 void gps_Init() 
@@ -26,7 +45,8 @@ void gps_Init()
 }
 
 typedef struct {
-    time_t timestamp;
+    time_t   timestamp;
+    uint16_t milliseconds;
     float  latitude;
     float  longitude;
     float  speed;
@@ -36,6 +56,45 @@ typedef struct {
 } GpsTrackerData_t;
 
 GpsTrackerData_t GpsTrackerData;
+// TimeSync_Uptime() of the last valid fix
+static uint32_t fix_tick = 0;
+
+// time of the last RMC epoch with a fix; gps_Process() is called for every UART event
+static double gpsEpoch = -1.0;
+// the last RMC epoch given to the system time
+static double gpsTimeEpoch = -1.0;
+
+static GpsFilter_t gpsFilter;
+// the filtered fix of the last RMC epoch, reported until the next one
+static GpsFilter_Fix_t gpsFiltered;
+static double gpsFilterEpoch = -1.0;
+
+// runs the filter on a new RMC epoch
+static void gps_Filter(double epoch)
+{
+    if (!g_ConfigStore.gps_filter || !gpsInfo->rmc.valid || isnan(GpsTrackerData.latitude) ||
+        isnan(GpsTrackerData.longitude)) {
+        if (!g_ConfigStore.gps_filter) GpsFilter_Reset(&gpsFilter);
+        gpsFilterEpoch = -1.0;
+        return;
+    }
+    if (epoch != gpsFilterEpoch) {
+        gpsFilterEpoch = epoch;
+        gpsFiltered.latitude  = GpsTrackerData.latitude;
+        gpsFiltered.longitude = GpsTrackerData.longitude;
+        gpsFiltered.speed     = GpsTrackerData.speed;
+        gpsFiltered.bearing   = GpsTrackerData.bearing;
+        gpsFiltered.accuracy  = GpsTrackerData.accuracy;
+        gpsFilter.accel = g_ConfigStore.gps_filter_accel;
+        if (GpsFilter_Update(&gpsFilter, epoch, &gpsFiltered) == GPS_FILTER_REJECTED)
+            Perf_Inc(PERF_GPS_FILTER_REJECTS);
+    }
+    GpsTrackerData.latitude  = gpsFiltered.latitude;
+    GpsTrackerData.longitude = gpsFiltered.longitude;
+    GpsTrackerData.speed     = gpsFiltered.speed;
+    GpsTrackerData.bearing   = gpsFiltered.bearing;
+    GpsTrackerData.accuracy  = gpsFiltered.accuracy;
+}
 
 void gps_Process(void)
 {
@@ -52,30 +111,37 @@ void gps_Process(void)
     GpsTrackerData.accuracy  = minmea_tofloat(&gpsInfo->gsa[0].hdop) * 
                                                g_ConfigStore.gps_uere; // User Equivalent Range Error (UERE) in meters 
 
-    if (!gpsInfo->rmc.valid)
-        GpsTrackerData.timestamp = time(NULL);
+    if (!gpsInfo->rmc.valid) {
+        uint64_t now = TimeSync_NowMs();
+        GpsTrackerData.timestamp    = (time_t)(now / 1000);
+        GpsTrackerData.milliseconds = (uint16_t)(now % 1000);
+    } else {
+        GpsTrackerData.milliseconds = (uint16_t)(gpsInfo->rmc.time.microseconds / 1000);
+        fix_tick = TimeSync_Uptime();
+    }
+
+    double epoch = GpsTrackerData.timestamp + gpsInfo->rmc.time.microseconds / 1e6;
+    gps_Filter(epoch);
 
-    return;    
-}
+    // the first pass over a new epoch is the closest to its arrival
+    if (gpsInfo->rmc.valid && GpsTrackerData.timestamp && epoch != gpsTimeEpoch) {
+        gpsTimeEpoch = epoch;
+        TimeSync_GpsSample((uint64_t)(uint32_t)GpsTrackerData.timestamp * 1000 + GpsTrackerData.milliseconds);
+    }
 
-void gps_PrintLocation(t_logOutput output)
-{
-    int (*print_func)(const char*, ...) = NULL;
-    switch (output) {
-        case LOGGER_OUTPUT_UART:
-            print_func = UART_Printf;
-            break;
-        case LOGGER_OUTPUT_FILE:
-            print_func = FILE_Printf;
-            break;
-        case LOGGER_OUTPUT_TRACE:
-            Trace(1, "LOGGER_OUTPUT_TRACE is not supported in gps_PrintLocation.\r\n");
-            return;
-        default:
-            LOGE("output type: %d", output);
-            return;
+    // the fences see every fix once, filtered
+    if (gpsInfo->rmc.valid && epoch != gpsEpoch && !isnan(GpsTrackerData.latitude) &&
+        !isnan(GpsTrackerData.longitude)) {
+        gpsEpoch = epoch;
+        Geofence_Check(GpsTrackerData.timestamp, GpsTrackerData.latitude, GpsTrackerData.longitude);
+        Trip_Update(GpsTrackerData.timestamp, GpsTrackerData.latitude, GpsTrackerData.longitude,
+                    GpsTrackerData.speed, GpsTrackerData.accuracy);
     }
+    return;    
+}
 
+void gps_PrintLocation(CmdOutputFunc print_func)
+{
     if (!gpsInfo->rmc.valid) {
         print_func("INVALID, ");
     } else {
@@ -99,6 +165,16 @@ float gps_GetLastLongitude(void)
     return GpsTrackerData.longitude;
 }
 
+float gps_GetLastSpeed(void)
+{
+    return GpsTrackerData.speed;
+}
+
+float gps_GetLastAccuracy(void)
+{
+    return GpsTrackerData.accuracy;
+}
+
 bool  gps_isValid(void) 
 {
     return gpsInfo->rmc.valid && 
@@ -107,28 +183,228 @@ bool  gps_isValid(void)
 }
 
 uint32_t g_trackerloop_tick = 0;
-uint8_t  requestBuffer[400];
-uint8_t  responseBuffer[1024];
+char     requestBuffer[400 + REMOTE_RESULT_BUFFER_SIZE * 3 + PERF_FORMAT_MAX_LENGTH + GEOFENCE_ALERTS_LENGTH +
+                       TRIP_FIELDS_LENGTH + NETWORK_CELLS_LENGTH];
+// "&stats=" field of the report, see Perf_Format()
+static char statsBuffer[8 + PERF_FORMAT_MAX_LENGTH];
+// "&cell=" and "&cells=" fields of the report, the serving cell in the OsmAnd form and the set
+static char cellsBuffer[16 + 128 + NETWORK_CELLS_LENGTH];
+// geofence events not reported yet, "enter:home,exit:depot", and the last of them
+static char            geofenceAlerts[GEOFENCE_ALERTS_LENGTH];
+static GeofenceEvent_t geofenceLast;
+char     responseBuffer[1024];
+
+// events not handled by the tracker task yet, and those it is waiting for
+static volatile uint32_t tracker_pending  = 0;
+static uint32_t          tracker_wakeMask = 0;
+// true while a wake-up event sits in the tracker's queue
+static bool              tracker_wakePosted = false;
+// the event posted to the tracker; only its address is passed, it is never freed
+static const uint32_t    tracker_wakeEvent = 0;
+
+void Tracker_Notify(uint32_t events)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    tracker_pending |= events;
+    bool post = (tracker_pending & tracker_wakeMask) && !tracker_wakePosted && trackerTaskHandle;
+    if (post) tracker_wakePosted = true;
+    SYS_ExitCriticalSection(status);
+
+    if (post && !OS_SendEvent(trackerTaskHandle, (void*)&tracker_wakeEvent, OS_TIME_OUT_NO_WAIT, OS_EVENT_PRI_NORMAL)) {
+        status = SYS_EnterCriticalSection();
+        tracker_wakePosted = false;
+        SYS_ExitCriticalSection(status);
+    }
+}
+
+/**
+ * Sleeps until one of the events in mask is notified or timeoutMs passed.
+ * @return the pending events, which are cleared
+ */
+static uint32_t Tracker_Wait(uint32_t mask, uint32_t timeoutMs)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    tracker_wakeMask = mask;
+    bool ready = (tracker_pending & mask) != 0;
+    SYS_ExitCriticalSection(status);
+
+    bool woken = false;
+    if (!ready) {
+        void* event = NULL;
+        if (OS_WaitEvent(trackerTaskHandle, &event, timeoutMs)) {
+            woken = (event == &tracker_wakeEvent);
+            if (!woken) OS_Free(event);
+        }
+    }
+
+    status = SYS_EnterCriticalSection();
+    // a wake-up posted after a timeout stays queued and ends a later wait early
+    if (woken) tracker_wakePosted = false;
+    uint32_t events = tracker_pending;
+    tracker_pending = 0;
+    tracker_wakeMask = 0;
+    SYS_ExitCriticalSection(status);
+    return events;
+}
+
+// moves the queued geofence events to geofenceAlerts
+static void CollectGeofenceEvents(void)
+{
+    GeofenceEvent_t event;
+    while (Geofence_PopEvent(&event)) {
+        int length = strlen(geofenceAlerts);
+        int needed = snprintf(geofenceAlerts + length, sizeof(geofenceAlerts) - length, "%s%s:%s",
+                              length ? "," : "", event.entered ? "enter" : "exit", event.name);
+        if (length + needed >= (int)sizeof(geofenceAlerts)) {
+            geofenceAlerts[length] = '\0';
+            LOGW("Geofence alert %s dropped", event.name);
+            continue;
+        }
+        geofenceLast = event;
+    }
+}
+
+// SMS to sms_report_number with the geofence alerts, without GPRS
+static bool SendGeofenceSms(void)
+{
+    char text[GEOFENCE_ALERTS_LENGTH + 40];
+    snprintf(text, sizeof(text), "GEOFENCE %s %.5f,%.5f", geofenceAlerts,
+             geofenceLast.latitude, geofenceLast.longitude);
+    return Sms_QueueReply(g_ConfigStore.sms_report_number, text);
+}
+
+/**
+ * Uploads the current position.
+ * @param trip trip event to report, or NULL
+ * @param cell position of the cells to report in place of the GPS one, or NULL
+ * @return true if the server received it
+ */
+static bool SendReport(uint32_t now, uint32_t* statsSentTime, const TripEvent_t* trip, const LbsPosition_t* cell)
+{
+    uint8_t percent;
+    PM_Voltage(&percent);
+
+    if (g_ConfigStore.gps_print_pos)
+        gps_PrintLocation(UART_Printf);
+
+    // the cells go out when the set changed, with the serving cell in the OsmAnd form
+    char     cells[NETWORK_CELLS_LENGTH];
+    uint32_t cellsVersion;
+    bool     cellsUpdate = Network_GetCellsUpdate(cells, &cellsVersion);
+    cellsBuffer[0] = '\0';
+    const char* cellInfoStr = Network_GetCellInfoString();
+    // without the serving cell (a failed cell info request) the set waits for the next report
+    if (cellsUpdate && cellInfoStr && strlen(cellInfoStr) != 0)
+        snprintf(cellsBuffer, sizeof(cellsBuffer), "&cell=%s&cells=%s", cellInfoStr, cells);
+
+    statsBuffer[0] = '\0';
+    if (g_ConfigStore.stats_interval &&
+        (*statsSentTime == 0 || now - *statsSentTime >= g_ConfigStore.stats_interval)) {
+        strcpy(statsBuffer, "&stats=");
+        Perf_Format(statsBuffer + 7, sizeof(statsBuffer) - 7);
+    }
+
+    char tripFields[TRIP_FIELDS_LENGTH];
+    int  length = snprintf(tripFields, sizeof(tripFields), "&odometer=%u", (unsigned)Trip_GetOdometer());
+    if (trip && trip->type == TRIP_EVENT_START)
+        snprintf(tripFields + length, sizeof(tripFields) - length, "&trip=start");
+    else if (trip)
+        snprintf(tripFields + length, sizeof(tripFields) - length,
+                 "&trip=end&trip_start=%u&trip_distance=%u&trip_duration=%u&trip_max_speed=%.1f",
+                 (unsigned)trip->startTime, (unsigned)trip->distance,
+                 (unsigned)(trip->endTime - trip->startTime), trip->maxSpeed);
+
+    float latitude  = cell ? cell->latitude  : GpsTrackerData.latitude;
+    float longitude = cell ? cell->longitude : GpsTrackerData.longitude;
+    float accuracy  = cell ? cell->accuracy  : GpsTrackerData.accuracy;
+
+    const char* remoteResults = RemoteCmd_GetResults();
+    snprintf(requestBuffer, sizeof(requestBuffer),
+        "id=%s&valid=%d&timestamp=%u%03u&lat=%f&lon=%f&speed=%1.f&bearing=%.1f&altitude=%.1f&accuracy=%.1f%s%s&batt=%d%s%s%s%s%s%s",
+        g_ConfigStore.device_name, gpsInfo->rmc.valid, 
+        (unsigned)GpsTrackerData.timestamp, GpsTrackerData.milliseconds,
+        latitude,                 longitude,
+        GpsTrackerData.speed,     GpsTrackerData.bearing,  GpsTrackerData.altitude, 
+        accuracy, (cell ? "&source=lbs" : ""), cellsBuffer, percent, tripFields, statsBuffer,
+        (*geofenceAlerts ? "&geofence=" : ""), geofenceAlerts,
+        (*remoteResults ? "&result=" : ""), remoteResults);
+    requestBuffer[sizeof(requestBuffer) - 1] = '\0';
+
+    const char* serverName = g_ConfigStore.server_addr;
+    const char* serverPort = g_ConfigStore.server_port;
+    const bool  secure = (g_ConfigStore.server_protocol == PROT_HTTPS);
+    int result = Http_Post(secure, serverName, serverPort, "/", 
+                           requestBuffer, strlen(requestBuffer),
+                           responseBuffer, sizeof(responseBuffer) - 1);
+    Link_Upload(result >= 0);
+    if (result < 0) {
+        LOGE("FAILED to send the location to the server. err: %d", result);
+        return false;
+    }
+
+    LOGI("Sent location to %s://%s:%s", (secure ? "https":"http"), serverName, serverPort);
+    Perf_Inc(PERF_REPORTS_SENT);
+    if (statsBuffer[0])
+        *statsSentTime = now;
+    if (cellsBuffer[0])
+        Network_CellsDelivered(cellsVersion);
+    geofenceAlerts[0] = '\0';
+    int status = 0;
+    responseBuffer[result] = '\0';
+    const char* body = Http_GetResponseBody(responseBuffer, result, &status);
+    if (status == 200) {
+        RemoteCmd_ResultsSent();
+        RemoteCmd_ProcessResponse(body);
+    } else {
+        LOGE("server response status: %d", status);
+    }
+    return true;
+}
+
+// completion of a configuration command queued by GpsQueue(), in the main task
+static void GpsQueueDone(void* param, GPS_CMD_t cmd, GPS_CMD_Ack_t result, const char* ack)
+{
+    if (result != GPS_CMD_ACK_EXEC_SUCCESS)
+        LOGE("%s failed: %d", (const char*)param, result);
+    else if (cmd == GPS_CMD_GET_VERSION && strchr(ack, ','))
+        LOGW("GPS firmware version: %s", strchr(ack, ',') + 1);
+}
+
+static void GpsQueue(GPS_CMD_t cmd, const char* args, const char* what)
+{
+    if (!GPS_CMDQueue(cmd, args, GPS_TIME_OUT_CMD, GpsQueueDone, (void*)what))
+        LOGE("%s: GPS command queue full", what);
+}
+
+// the system time helps the GPS to its first fix
+static void GpsSetTime(void)
+{
+    RTC_Time_t time;
+    char args[40];
+    time_to_rtc(TimeSync_Now(), &time);
+    snprintf(args, sizeof(args), "%d,%d,%d,%d,%d,%d",
+             time.year, time.month, time.day, time.hour, time.minute, time.second);
+    GpsQueue(GPS_CMD_SET_RTC_TIME, args, "set GPS time");
+}
 
 void gps_TrackerTask(void *pData)
 {
-    while (!IS_INITIALIZED() || !IS_GSM_ACTIVE()) OS_Sleep(2000);
+    int profilerSlot = Profiler_TaskStart();
+
+    while (!IS_INITIALIZED() || !IS_GSM_ACTIVE())
+        Tracker_Wait(TRACKER_EVENT_STATUS, OS_TIME_OUT_WAIT_FOREVER);
 
     // open GPS hardware(UART2 open either)
     GPS_Open(NULL);
     LOGI("Waiting for GPS");
-    while(!IS_GPS_STATUS_ON()) OS_Sleep(2000);
+    while(!IS_GPS_STATUS_ON())
+        Tracker_Wait(TRACKER_EVENT_STATUS, OS_TIME_OUT_WAIT_FOREVER);
 
-    RTC_Time_t time;
-    TIME_GetRtcTime(&time);
-    if(!GPS_SetRtcTime(&time)) LOGE("set gps time failed");
-
-    if(!GPS_GetVersion(responseBuffer, 255))
-        LOGE("get GPS firmware version failed");
-    else
-        LOGW("GPS firmware version: %s", responseBuffer);
-
-    GPS_SetSearchMode(true, false, true, true);
+    // the configuration is queued at once: the GPS acks it while its NMEA output is parsed
+    GpsSetTime();
+    GpsQueue(GPS_CMD_GET_VERSION, NULL, "get GPS firmware version");
+    GpsQueue(GPS_CMD_SEARCH_MODE, "1,0,1,1", "set GPS search mode");
+    char args[40];
 
     // if(!GPS_ClearLog())
     //    LOGE("open file failed, please check tf card");
@@ -142,71 +418,156 @@ void gps_TrackerTask(void *pData)
     //if(!GPS_SetSBASEnable(true))
     //     LOGE("enable sbas fail");
 
-    LOGI("setting GPS fix mode to MODE_NORMAL");
-    if(!GPS_SetFixMode(GPS_FIX_MODE_NORMAL))
-        LOGE("set fix mode fail");
-
-    LOGI("setting GPS LP Mode to GPS_LP_MODE_NORMAL");
-    if(!GPS_SetLpMode(GPS_LP_MODE_NORMAL))
-        LOGE("set GPS LP mode failed");
-
-    LOGI("setting GPS interval to 1000 ms");
-    if(!GPS_SetOutputInterval(1000))
-        LOGE("set GPS interval failed");
-
-    // Target loop period in seconds. It is set to:
-    // 10s when sending data to server 
-    // 1s when waiting for the internet connection or a GPS fix
-    uint32_t desired_interval = 0;
+    LOGI("setting GPS fix mode to MODE_NORMAL, LP mode to GPS_LP_MODE_NORMAL, interval to 1000 ms");
+    snprintf(args, sizeof(args), "%d", GPS_FIX_MODE_NORMAL);
+    GpsQueue(GPS_CMD_FIX_MODE, args, "set fix mode");
+    snprintf(args, sizeof(args), "%d", GPS_LP_MODE_NORMAL);
+    GpsQueue(GPS_CMD_LP_MODE, args, "set GPS LP mode");
+    GpsQueue(GPS_CMD_NMEA_OUTPUT_INTERVAL, "1000", "set GPS interval");
+
+    // GPRS is active here: ephemeris and position from the network shorten the first fix
+    Agps_Start();
+
+    // start of the last upload attempt, uploads are report_interval apart
+    uint32_t report_time = 0;
+    // the last wake-up found GPRS up: a report goes out as soon as the link comes back
+    bool     was_online = false;
+    // time of the last fix queued for the SMS fallback report
+    uint32_t sms_sample_time = 0;
+    // time of the last upload carrying the performance counters
+    uint32_t stats_sent_time = 0;
+    // low power: consecutive reports without movement, when the device was parked, and
+    // when it woke up to get a fix (0: not waiting for one)
+    uint32_t still_reports = 0;
+    uint32_t park_time = 0;
+    uint32_t wake_time = 0;
+    uint32_t events = 0;
     
     while(1)
     {
-        g_trackerloop_tick = time(NULL);
+        uint32_t now = TimeSync_Uptime();
+        g_trackerloop_tick = now;
+        uint32_t busyStart = Perf_Start();
+        Perf_SampleHeap();
+
+        if (IS_SLEEPING()) {
+            uint32_t parked = now - park_time;
+            if (g_ConfigStore.low_power && g_ConfigStore.tracking && !(events & TRACKER_EVENT_MOTION) &&
+                parked < g_ConfigStore.sleep_interval) {
+                Profiler_TaskBusy(profilerSlot, busyStart);
+                events = Tracker_Wait(TRACKER_EVENT_MOTION | TRACKER_EVENT_CONFIG,
+                                      (g_ConfigStore.sleep_interval - parked) * 1000);
+                continue;
+            }
+            Power_Wake();
+            wake_time = now;
+        }
 
-        if(IS_GPS_STATUS_ON() && IS_GSM_ACTIVE())
+        uint32_t interval = g_ConfigStore.report_interval;
+        // events that end the wait, and the longest wait in seconds; the network
+        // watchdog expects a tick at least every report_interval
+        uint32_t wake_on = TRACKER_EVENT_STATUS | TRACKER_EVENT_CONFIG | TRACKER_EVENT_GEOFENCE | TRACKER_EVENT_TRIP;
+        uint32_t wait = interval;
+        // after waking up, the fix from before the standby is stale
+        bool fresh_fix = (wake_time == 0 || fix_tick >= wake_time);
+        bool fix_timeout = (wake_time != 0 && now - wake_time >= g_ConfigStore.fix_timeout);
+        // a position was reported or queued in this round
+        bool reported = false;
+        CollectGeofenceEvents();
+        // a trip without fixes for trip_stop_time has ended
+        Trip_Timeout(now - fix_tick);
+        TripEvent_t trip;
+        bool trip_event = Trip_PeekEvent(&trip);
+
+        bool online = IS_GPS_STATUS_ON() && IS_GSM_ACTIVE() && g_ConfigStore.tracking;
+        if (online)
         {
-            uint8_t percent;
-            PM_Voltage(&percent);
-
-            if (g_ConfigStore.gps_print_pos)
-                gps_PrintLocation(LOGGER_OUTPUT_UART);
-
-            responseBuffer[0] = '\0';
-            const char* cellInfoStr = Network_GetCellInfoString();
-            if (cellInfoStr && strlen(cellInfoStr) != 0)
-                snprintf(responseBuffer, sizeof(responseBuffer),"&cell=%s", cellInfoStr);
-
-            snprintf(requestBuffer, sizeof(requestBuffer),
-                "id=%s&valid=%d&timestamp=%d&lat=%f&lon=%f&speed=%1.f&bearing=%.1f&altitude=%.1f&accuracy=%.1f%s&batt=%d",
-                g_ConfigStore.device_name, gpsInfo->rmc.valid, 
-                GpsTrackerData.timestamp, GpsTrackerData.latitude, GpsTrackerData.longitude, 
-                GpsTrackerData.speed,     GpsTrackerData.bearing,  GpsTrackerData.altitude, 
-                GpsTrackerData.accuracy, responseBuffer, percent);
-            requestBuffer[sizeof(requestBuffer) - 1] = '\0';
-
-            const char* serverName = g_ConfigStore.server_addr;
-            const char* serverPort = g_ConfigStore.server_port;
-            const bool  secure = (g_ConfigStore.server_protocol == PROT_HTTPS);
-            int result = Http_Post(secure, serverName, serverPort, "/", 
-                                   requestBuffer, strlen(requestBuffer),
-                                   responseBuffer, sizeof(responseBuffer));
-            if (result < 0)
-                LOGE("FAILED to send the location to the server. err: %d", result);
-            else
-                LOGI("Sent location to %s://%s:%s", (secure ? "https":"http"), serverName, serverPort);
-            
-            // wait 10 seconds before next loop iteration
-            desired_interval = 10; 
+            // GPRS is up, positions go to the server
+            SmsReport_Reset();
+            // geofence alerts and trip events go out at once
+            bool urgent = geofenceAlerts[0] || trip_event;
+            bool due = wake_time ? (fresh_fix || fix_timeout)
+                                 : (!was_online || report_time == 0 || now - report_time >= interval || urgent);
+            // a poor link holds routine reports back, up to LINK_DEFER_MAX seconds
+            bool held = due && !wake_time && !urgent && report_time != 0 && Link_Defer(now - report_time);
+            if (held) due = false;
+            bool more = false;
+            if (due) {
+                report_time = now;
+                // lbs_fallback seconds without a fix: the cells give the position
+                LbsPosition_t cell;
+                bool use_cell = !gps_isValid() && g_ConfigStore.lbs_fallback &&
+                                now - fix_tick >= g_ConfigStore.lbs_fallback && LbsCache_Locate(&cell);
+                if (SendReport(now, &stats_sent_time, trip_event ? &trip : NULL, use_cell ? &cell : NULL) &&
+                    trip_event) {
+                    Trip_PopEvent();
+                    more = Trip_PeekEvent(&trip);
+                }
+                reported = true;
+            }
+            // without a recent GPS time the clock follows the network and NTP
+            if (TimeSync_Poll() && !gps_isValid())
+                GpsSetTime();
+            if (!wake_time || due) {
+                uint32_t elapsed = TimeSync_Uptime() - report_time;
+                wait = elapsed < interval && !more ? interval - elapsed : 0;
+                // held back: look at the link again a report interval later
+                if (held) wait = interval;
+            }
         }
-        else
+        else if (IS_GPS_STATUS_ON() && g_ConfigStore.tracking)
         {
-            // if there is no internet do not wait too long for the next loop
-            desired_interval = 1;
+            // no GPRS: queue fixes for the SMS fallback report
+            if (wake_time || sms_sample_time == 0 || now - sms_sample_time >= interval) {
+                if (gps_isValid() && fresh_fix) {
+                    uint8_t percent;
+                    PM_Voltage(&percent);
+                    sms_sample_time = now;
+                    SmsReport_AddFix(GpsTrackerData.timestamp, GpsTrackerData.latitude, GpsTrackerData.longitude,
+                                     GpsTrackerData.speed, GpsTrackerData.bearing);
+                    // SMS needs only the GSM registration
+                    if (IS_GSM_REGISTERED())
+                        SmsReport_Process(now, percent);
+                    reported = true;
+                } else if (fix_timeout) {
+                    reported = true;
+                } else {
+                    // sample the first valid fix
+                    wake_on |= TRACKER_EVENT_FIX;
+                }
+            }
+            if (sms_sample_time != 0 && now - sms_sample_time < interval)
+                wait = interval - (now - sms_sample_time);
+        }
+        // an alert does not wait out the whole reconnect backoff
+        if (!online && (geofenceAlerts[0] || trip_event))
+            Link_Urgent();
+        if (!online && geofenceAlerts[0] && IS_GSM_REGISTERED() && g_ConfigStore.sms_report_number[0] &&
+            SendGeofenceSms())
+            geofenceAlerts[0] = '\0';
+        was_online = online;
+
+        if (reported) {
+            wake_time = 0;
+            // no fix counts as standing still: a car in a garage should park too
+            if (gps_isValid() && fresh_fix && GpsTrackerData.speed >= POWER_STILL_SPEED)
+                still_reports = 0;
+            else if (still_reports < POWER_STILL_REPORTS)
+                still_reports++;
+            if (g_ConfigStore.low_power && still_reports >= POWER_STILL_REPORTS) {
+                Power_Park();
+                park_time = TimeSync_Uptime();
+                wait = 0;
+            }
+        } else if (wake_time) {
+            // woken up: wait for a fresh fix, at most fix_timeout
+            wake_on |= TRACKER_EVENT_FIX;
+            uint32_t waited = now - wake_time;
+            if (waited < g_ConfigStore.fix_timeout && g_ConfigStore.fix_timeout - waited < wait)
+                wait = g_ConfigStore.fix_timeout - waited;
         }
 
-        uint32_t loop_duration = (time(NULL) - g_trackerloop_tick);
-        if (loop_duration > desired_interval) loop_duration = desired_interval;
-        OS_Sleep((desired_interval - loop_duration) * 1000);
+        Profiler_TaskBusy(profilerSlot, busyStart);
+        events = (wait > 0) ? Tracker_Wait(wake_on, wait * 1000) : 0;
     }
 }
-
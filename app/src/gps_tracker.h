@@ -1,6 +1,8 @@
 #ifndef GPS_TRACKER_H
 #define GPS_TRACKER_H
 
+#include "config_commands.h"
+
 #define CONFIG_FILE_PATH          "/config.ini"
 #define DEFAULT_APN_VALUE         "internet"
 #define DEFAULT_APN_PASS_VALUE    ""
@@ -10,16 +12,56 @@
 #define DEFAULT_SERVER_PROTOCOL   "https"
 #define DEFAULT_DEVICE_NAME       "IMEI"
 #define DEFAULT_GPS_UERE          "5"
+#define DEFAULT_GPS_FILTER        "enabled"
+#define DEFAULT_GPS_FILTER_ACCEL  "1.5"
 #define DEFAULT_GPS_LOGS          "disabled"
 #define DEFAULT_GPS_LOG_FILE      "/t/gps_nmea.log"
 #define DEFAULT_GPS_PRINT_POS     "disabled"
 #define DEFAULT_LOG_LEVEL         "info"
 #define DEFAULT_LOG_OUTPUT        "uart"
+#define DEFAULT_REPORT_INTERVAL   "10"
+#define DEFAULT_REMOTE_COMMANDS   "enabled"
+#define DEFAULT_TRACKING          "enabled"
+#define DEFAULT_SMS_WHITELIST     ""
+#define DEFAULT_SMS_REPORT_NUMBER ""
+#define DEFAULT_SMS_REPORT_INTERVAL "900"
+#define DEFAULT_TRACK_TOLERANCE   "20"
+#define DEFAULT_GEOFENCE_MARGIN   "25"
+#define DEFAULT_TRIP_STOP_TIME    "180"
+#define DEFAULT_STATS_INTERVAL    "0"
+#define DEFAULT_LOW_POWER         "disabled"
+#define DEFAULT_SLEEP_INTERVAL    "900"
+#define DEFAULT_FIX_TIMEOUT       "90"
+#define DEFAULT_AGPS              "enabled"
+#define DEFAULT_NTP_SERVER        "pool.ntp.org"
+#define DEFAULT_LBS_FALLBACK      "120"
+
+#define TRACKER_TASK_STACK_SIZE   (4096 * 2)   // words
+#define TRACKER_TASK_PRIORITY     (0)
+#define TRACKER_TASK_NAME         "Reporting Task"
+
+/**
+ * Events that wake the tracker task. They are kept as pending bits, so any number of
+ * notifications costs at most one queued OS event and no allocation.
+ */
+typedef enum {
+    TRACKER_EVENT_STATUS = 1 << 0,  // a system status flag changed (network, GPS)
+    TRACKER_EVENT_FIX    = 1 << 1,  // GPS data was processed
+    TRACKER_EVENT_CONFIG = 1 << 2,  // report_interval, tracking or the low power settings changed
+    TRACKER_EVENT_MOTION = 1 << 3,  // the serving cell changed, the device may be moving
+    TRACKER_EVENT_GEOFENCE = 1 << 4,  // a geofence was entered or left
+    TRACKER_EVENT_TRIP   = 1 << 5,  // a trip started or ended
+} TrackerEvent_t;
+
+/**
+ * @brief Notify the tracker task of events; safe from any task or callback.
+ * The task is only woken if it currently waits for one of the events.
+ */
+void  Tracker_Notify(uint32_t events);
 
 /**
- * @brief Timestamp of the last tracker loop tick
- * It is set to the timestamp of the last GPS update update loop cycle in gps_trackerTask()
- * it is used to keep even spaces between GPS updates
+ * @brief TimeSync_Uptime() of the last tracker loop tick
+ * It is set each time gps_TrackerTask() wakes up, at least every report_interval seconds.
  * network module uses it to detect if the GPS tracker is stuck on connect function
  * and if so it will try to reactivate GPRS connection
  */ 
@@ -53,6 +95,18 @@ float gps_GetLastLatitude(void);
  */
 float gps_GetLastLongitude(void);
 
+/**
+ * @brief Get the last known GPS speed.
+ * @return the speed in knots
+ */
+float gps_GetLastSpeed(void);
+
+/**
+ * @brief Get the accuracy of the last known position.
+ * @return the estimated horizontal error in metres
+ */
+float gps_GetLastAccuracy(void);
+
 /**
  * @brief Process the GPS data.
  * This function updates the GpsTrackerData structure with the latest GPS information.
@@ -62,16 +116,18 @@ float gps_GetLastLongitude(void);
 void  gps_Process(void);
 
 /**
- * @brief Print the current GPS location to the selected output.
- * This function prints the formatted GPS information to UART, Trace, or file depending on the output argument.
- * @param output The log output type (UART, TRACE, or FILE)
+ * @brief Print the current GPS location.
+ * This function prints the formatted GPS information through the given output.
+ * @param output the command output, e.g. cmd_printf, or UART_Printf
  */
-void  gps_PrintLocation(t_logOutput output);
+void  gps_PrintLocation(CmdOutputFunc output);
 
 /**
  * @brief The main task for the GPS tracker.
- * This function runs in a loop, checking for GPS and GSM status,
- * and sending location updates to the server at specified intervals.
+ * It sleeps until a status change, a GPS fix it is waiting for or its report time,
+ * sends location updates to the server every report_interval seconds (and at once
+ * when the GPRS link comes up), and queues fixes for the SMS report while it is down.
+ * With low_power enabled it parks the device while it stands still (see power.h).
  * It should be started as a separate task in the system.
  * @param pData Pointer to task data (not used)
  */
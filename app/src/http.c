@@ -5,11 +5,13 @@
 #include <api_socket.h>
 #include <api_ssl.h>
 
+#include "mem_pool.h"
 
 #include "utils.h"
 #include "http.h"
 #include "config_store.h"
 #include "debug.h"
+#include "perf_stats.h"
 
 #define MODULE_TAG "Network"
 
@@ -32,6 +34,59 @@ IQDspFWa3fj7nLgouSdkcPy1SdOR2AGm9OQWs7veyXsBwA==\n\
 
 static SSL_Config_t SSLconfig;
 
+// a position report with remote command results and stats fits one block
+MEM_POOL_DEFINE(postPool, "http post", HTTP_POST_BLOCK_SIZE, 1);
+
+/**
+ * Finds the end of the HTTP response header ("\r\n\r\n") in the received data.
+ * @return offset of the first body byte or -1 if the header is not complete yet
+ */
+static int http_header_length(const char* response, int len)
+{
+    for (int i = 0; i + 3 < len; ++i) {
+        if (response[i] == '\r' && response[i+1] == '\n' && response[i+2] == '\r' && response[i+3] == '\n')
+            return i + 4;
+    }
+    return -1;
+}
+
+/**
+ * Checks if the whole response has been received, so the caller does not have to wait
+ * for the server to close a keep-alive connection.
+ * @return true if the header and Content-Length bytes of the body were received
+ */
+static bool http_response_complete(const char* response, int len)
+{
+    int headerLen = http_header_length(response, len);
+    if (headerLen < 0) return false;
+
+    const char* field = "\r\ncontent-length:";
+    const int   fieldLen = strlen(field);
+    for (int i = 0; i + fieldLen < headerLen; ++i) {
+        if (strnicmp(response + i, field, fieldLen) == 0) {
+            int contentLen = atoi(response + i + fieldLen);
+            return (len - headerLen) >= contentLen;
+        }
+    }
+    return false;
+}
+
+const char* Http_GetResponseBody(const char* response, int len, int* status)
+{
+    if (!response || len <= 0) return NULL;
+
+    if (status) {
+        *status = -1;
+        const char* code = strchr(response, ' ');
+        if (code && strncmp(response, "HTTP/", 5) == 0)
+            *status = atoi(code + 1);
+    }
+
+    int headerLen = http_header_length(response, len);
+    if (headerLen < 0) return NULL;
+    return response + headerLen;
+}
+
 static inline int http_send_receive(const char *hostName,
                                     const char *port,
                                     char       *sendBuffer,
@@ -47,7 +102,8 @@ static inline int http_send_receive(const char *hostName,
     // Get IP from DNS server.
     char IPAddr[INET_ADDRSTRLEN];
     memset(IPAddr, 0, sizeof(IPAddr));
-    if(DNS_GetHostByName2(hostName, IPAddr) != 0) {
+    if(DNS_GetHostByName2((const uint8_t*)hostName, (uint8_t*)IPAddr) != 0) {
+        Perf_Inc(PERF_HTTP_DNS_FAILURES);
         LOGE("Cannot resolve the hostName name");
         return -1;
     }
@@ -74,6 +130,7 @@ static inline int http_send_receive(const char *hostName,
 
     int ret = connect(fd, (struct sockaddr*)&sockaddr, sizeof(struct sockaddr_in));
     if(ret < 0){
+        Perf_Inc(PERF_HTTP_CONN_FAILURES);
         LOGE("socket connect fail");
         close(fd);
         return -1;
@@ -89,6 +146,7 @@ static inline int http_send_receive(const char *hostName,
         }
         totalSent += ret;
     }
+    Perf_Add(PERF_HTTP_BYTES_SENT, totalSent);
 
     uint16_t recvLen = 0;
     while (recvLen < retBufferSize)
@@ -105,6 +163,7 @@ static inline int http_send_receive(const char *hostName,
             return -1;
         }
         if (ret == 0) {
+            Perf_Inc(PERF_HTTP_TIMEOUTS);
             LOGE("HTTP response timeout");
             close(fd);
             return -1;
@@ -125,6 +184,8 @@ static inline int http_send_receive(const char *hostName,
                 break;
             }
             recvLen += ret;
+            if (http_response_complete(retBuffer, recvLen))
+                break;
         }
     }
     close(fd);
@@ -163,25 +224,28 @@ static inline int https_send_receive(const char   *hostName,
     // Connect to server using IP address
     error = SSL_Connect(&SSLconfig, hostName, port);
     if(error != SSL_ERROR_NONE) {
+        Perf_Inc(PERF_HTTP_CONN_FAILURES);
         LOGI("SSL connect error: %d", error);
         goto err_ssl_destroy;
     }
 
     // Send package
-    error = SSL_Write(&SSLconfig, buffer, bufferLen, SSL_WRITE_TIMEOUT);
+    error = SSL_Write(&SSLconfig, (uint8_t*)buffer, bufferLen, SSL_WRITE_TIMEOUT);
     if(error <= 0) {
         LOGI("SSL Write error: %d", error);
         goto err_ssl_close;
     }
+    Perf_Add(PERF_HTTP_BYTES_SENT, error);
 
     // Read response
     memset(retBuffer, 0, retBufferSize);
-    error = SSL_Read(&SSLconfig, retBuffer, retBufferSize, SSL_READ_TIMEOUT);
+    error = SSL_Read(&SSLconfig, (uint8_t*)retBuffer, retBufferSize, SSL_READ_TIMEOUT);
     if(error < 0) {
         LOGI("SSL Read error: %d", error);
         goto err_ssl_close;
     }
     if(error == 0) {
+        Perf_Inc(PERF_HTTP_TIMEOUTS);
         LOGI("SSL no receive response");
         error = SSL_ERROR_INTERNAL;
         goto err_ssl_close;
@@ -230,7 +294,7 @@ int Http_Post(bool          secure,
     }
 
     // Allocate the buffer dynamically
-    char* buffer = (char*)OS_Malloc(bufferLen + 1);
+    char* buffer = (char*)MemPool_Alloc(&postPool, bufferLen + 1);
     if (!buffer) {
         LOGE("Failed to allocate memory for HTTP package");
         return -1;
@@ -247,6 +311,8 @@ int Http_Post(bool          secure,
 #endif
 
     int returnVal =  -1;
+    uint32_t start = Perf_Start();
+    Perf_Inc(PERF_HTTP_ATTEMPTS);
 
     if (!secure)
         // Use HTTP for non-secure connection
@@ -265,6 +331,12 @@ int Http_Post(bool          secure,
                                        retBuffer,
                                        retBufferSize);
         
-    OS_Free(buffer);
+    MemPool_Free(&postPool, buffer);
+    if (returnVal < 0) {
+        Perf_Inc(PERF_HTTP_FAILURES);
+    } else {
+        Perf_Add(PERF_HTTP_BYTES_RECV, returnVal);
+        Perf_Record(PERF_HIST_HTTP_MS, Perf_ElapsedMs(start));
+    }
     return returnVal;
 }
@@ -4,6 +4,9 @@
 #define SSL_WRITE_TIMEOUT 3000
 #define SSL_READ_TIMEOUT  3000
 
+// request buffer of Http_Post() taken from a static pool, larger requests use the heap
+#define HTTP_POST_BLOCK_SIZE 2048
+
 /**
  * @brief Sends an HTTP/HTTPs POST request to the specified server.
  * 
@@ -26,4 +29,14 @@ int Http_Post(const bool    secure,
               char*         retBuffer,
               int           retBufferSize);
 
+/**
+ * @brief Locates the body of a received HTTP response.
+ *
+ * @param response The response received by Http_Post().
+ * @param len      The number of bytes received.
+ * @param status   Optional pointer receiving the HTTP status code (-1 if it cannot be parsed).
+ * @return Pointer to the first byte of the body or NULL if the response header is incomplete.
+ */
+const char* Http_GetResponseBody(const char* response, int len, int* status);
+
 #endif // HTTP_H
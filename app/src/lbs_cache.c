@@ -0,0 +1,231 @@
+#include <string.h>
+#include <stdio.h>
+
+#include <api_os.h>
+#include <api_fs.h>
+#include <api_network.h>
+
+#include "system.h"
+#include "utils.h"
+#include "config_store.h"
+#include "network.h"
+#include "lbs_cache.h"
+#include "time_sync.h"
+#include "debug.h"
+
+#define MODULE_TAG "LBS"
+
+#define LBS_CACHE_MAGIC           0x4353424C   // "LBSC"
+
+typedef struct {
+    uint8_t  mcc[3];
+    uint8_t  mnc[3];
+    uint16_t lac;
+    uint16_t cellId;
+    int32_t  latitude;      // 1e-6 degrees
+    int32_t  longitude;
+    uint32_t used;          // use order, the highest is the most recent
+} LbsCacheEntry_t;
+
+// in front of the entries in LBS_CACHE_FILE
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    uint32_t crc;           // CRC-32 of the entries
+} LbsCacheHeader_t;
+
+static HANDLE          cacheMutex = NULL;
+static LbsCacheEntry_t entries[LBS_CACHE_SIZE];
+static uint32_t        entryCount = 0;
+static uint32_t        useCounter = 0;
+
+// the serving cell of the last failed lookup
+static LbsCacheEntry_t failedCell;
+static uint32_t        failedUptime = 0;
+static bool            failed = false;
+
+static uint32_t        hits = 0;
+static uint32_t        lookups = 0;
+static uint32_t        lookupFailures = 0;
+
+static bool SameCell(const LbsCacheEntry_t* entry, const Network_Location_t* cell)
+{
+    return entry->lac == cell->sLac && entry->cellId == cell->sCellID &&
+           memcmp(entry->mcc, cell->sMcc, 3) == 0 && memcmp(entry->mnc, cell->sMnc, 3) == 0;
+}
+
+static void SetCell(LbsCacheEntry_t* entry, const Network_Location_t* cell)
+{
+    memcpy(entry->mcc, cell->sMcc, 3);
+    memcpy(entry->mnc, cell->sMnc, 3);
+    entry->lac    = cell->sLac;
+    entry->cellId = cell->sCellID;
+}
+
+static LbsCacheEntry_t* Find(const Network_Location_t* cell)
+{
+    for (uint32_t i = 0; i < entryCount; ++i)
+        if (SameCell(&entries[i], cell)) return &entries[i];
+    return NULL;
+}
+
+static void Save(void)
+{
+    LbsCacheHeader_t header = { LBS_CACHE_MAGIC, entryCount,
+                                crc32_update(0, (const uint8_t*)entries, entryCount * sizeof(entries[0])) };
+    int32_t fd = API_FS_Open(LBS_CACHE_FILE, FS_O_RDWR | FS_O_CREAT | FS_O_TRUNC, 0);
+    if (fd < 0) {
+        LOGE("Open %s failed: %d", LBS_CACHE_FILE, fd);
+        return;
+    }
+    int32_t length = entryCount * sizeof(entries[0]);
+    bool ok = API_FS_Write(fd, (uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              (length == 0 || API_FS_Write(fd, (uint8_t*)entries, length) == length);
+    API_FS_Flush(fd);
+    API_FS_Close(fd);
+    if (!ok) LOGE("Write %s failed", LBS_CACHE_FILE);
+}
+
+static void Load(void)
+{
+    int32_t fd = API_FS_Open(LBS_CACHE_FILE, FS_O_RDONLY, 0);
+    if (fd < 0) return;
+    LbsCacheHeader_t header;
+    bool ok = API_FS_Read(fd, (uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              header.magic == LBS_CACHE_MAGIC && header.count <= LBS_CACHE_SIZE;
+    int32_t length = ok ? header.count * sizeof(entries[0]) : 0;
+    if (ok && length > 0)
+        ok = API_FS_Read(fd, (uint8_t*)entries, length) == length;
+    API_FS_Close(fd);
+    if (!ok || crc32_update(0, (const uint8_t*)entries, length) != header.crc) {
+        LOGW("%s is damaged, the cell cache starts empty", LBS_CACHE_FILE);
+        return;
+    }
+    entryCount = header.count;
+    for (uint32_t i = 0; i < entryCount; ++i)
+        if (entries[i].used > useCounter) useCounter = entries[i].used;
+}
+
+void LbsCache_Init(void)
+{
+    cacheMutex = OS_CreateMutex();
+    Load();
+    LOGI("%u cells cached", (unsigned)entryCount);
+}
+
+// a new cell, in place of the least recently used one when full; under the mutex
+static void Add(const Network_Location_t* cell, float latitude, float longitude)
+{
+    LbsCacheEntry_t* entry = Find(cell);
+    if (!entry && entryCount < LBS_CACHE_SIZE) entry = &entries[entryCount++];
+    if (!entry) {
+        entry = &entries[0];
+        for (uint32_t i = 1; i < entryCount; ++i)
+            if (entries[i].used < entry->used) entry = &entries[i];
+    }
+    SetCell(entry, cell);
+    entry->latitude  = (int32_t)(latitude * 1e6f);
+    entry->longitude = (int32_t)(longitude * 1e6f);
+    entry->used      = ++useCounter;
+    Save();
+}
+
+// the serving cell, else the strongest cached neighbour; under the mutex
+static bool FromCache(const Network_Location_t* cells, int count, bool neighbours, LbsPosition_t* position)
+{
+    LbsCacheEntry_t* found = Find(&cells[0]);
+    position->source   = LBS_SOURCE_CACHE;
+    position->accuracy = LBS_ACCURACY;
+    if (!found && neighbours) {
+        int8_t strongest = 0;
+        for (int i = 1; i < count; ++i) {
+            LbsCacheEntry_t* entry = Find(&cells[i]);
+            if (entry && (!found || cells[i].iRxLev > strongest)) {
+                found = entry;
+                strongest = cells[i].iRxLev;
+            }
+        }
+        position->source   = LBS_SOURCE_NEIGHBOUR;
+        position->accuracy = 2 * LBS_ACCURACY;
+    }
+    if (!found) return false;
+    found->used = ++useCounter;
+    position->latitude  = found->latitude / 1e6f;
+    position->longitude = found->longitude / 1e6f;
+    return true;
+}
+
+bool LbsCache_Locate(LbsPosition_t* position)
+{
+    Network_Location_t cells[NETWORK_MAX_CELLS];
+    int count = Network_GetCells(cells);
+    if (count == 0) return false;
+
+    OS_LockMutex(cacheMutex);
+    bool found = FromCache(cells, count, false, position);
+    if (found) hits++;
+    bool retry = !failed || !SameCell(&failedCell, &cells[0]) ||
+                 TimeSync_Uptime() - failedUptime >= LBS_RETRY;
+    OS_UnlockMutex(cacheMutex);
+    if (found) return true;
+
+    // the lookup blocks, the cache stays usable meanwhile
+    if (retry && IS_GSM_ACTIVE()) {
+        float latitude, longitude;
+        bool ok = Network_GetLbsLocation(cells, count, &latitude, &longitude);
+        OS_LockMutex(cacheMutex);
+        lookups++;
+        if (ok) {
+            Add(&cells[0], latitude, longitude);
+            failed = false;
+        } else {
+            lookupFailures++;
+            SetCell(&failedCell, &cells[0]);
+            failedUptime = TimeSync_Uptime();
+            failed = true;
+        }
+        OS_UnlockMutex(cacheMutex);
+        if (ok) {
+            position->latitude  = latitude;
+            position->longitude = longitude;
+            position->accuracy  = LBS_ACCURACY;
+            position->source    = LBS_SOURCE_NETWORK;
+            return true;
+        }
+    }
+
+    OS_LockMutex(cacheMutex);
+    found = FromCache(cells, count, true, position);
+    if (found) hits++;
+    OS_UnlockMutex(cacheMutex);
+    return found;
+}
+
+void LbsCache_Clear(void)
+{
+    OS_LockMutex(cacheMutex);
+    entryCount = 0;
+    failed = false;
+    API_FS_Delete(LBS_CACHE_FILE);
+    OS_UnlockMutex(cacheMutex);
+}
+
+void LbsCache_Print(CmdOutputFunc output)
+{
+    OS_LockMutex(cacheMutex);
+    output("Cells cached: %u of %u; %u hits, %u lookups, %u failed\r\n", (unsigned)entryCount,
+           LBS_CACHE_SIZE, (unsigned)hits, (unsigned)lookups, (unsigned)lookupFailures);
+    // most recent first: entries with a lower use order than the last printed
+    uint32_t below = UINT32_MAX;
+    for (uint32_t n = 0; n < entryCount; ++n) {
+        const LbsCacheEntry_t* next = NULL;
+        for (uint32_t i = 0; i < entryCount; ++i)
+            if (entries[i].used < below && (!next || entries[i].used > next->used)) next = &entries[i];
+        if (!next) break;
+        below = next->used;
+        output("  %u%u%u,%u%u%u,%u,%u: %.6f, %.6f\r\n", next->mcc[0], next->mcc[1], next->mcc[2],
+               next->mnc[0], next->mnc[1], next->mnc[2], next->lac, next->cellId,
+               next->latitude / 1e6, next->longitude / 1e6);
+    }
+    OS_UnlockMutex(cacheMutex);
+}
@@ -0,0 +1,68 @@
+#ifndef LBS_CACHE_H
+#define LBS_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config_commands.h"
+
+/**
+ * Cell tower position fallback (config lbs_fallback).
+ *
+ * Indoors and in a garage the GPS may not get a fix for hours. After lbs_fallback seconds
+ * without one the reports carry the position of the cells seen instead, flagged
+ * source=lbs with the accuracy of a cell position.
+ *
+ * The LBS service (LBS_GetLocation(), a GPRS round trip of up to NETWORK_LBS_TIMEOUT_S)
+ * locates the whole cell set; the answer is cached under the serving cell in
+ * LBS_CACHE_FILE, up to LBS_CACHE_SIZE cells, the least recently used one replaced. A
+ * cached serving cell costs no lookup, so a vehicle parked under the same tower asks the
+ * network once. A failed lookup is not repeated for the same serving cell within
+ * LBS_RETRY seconds; meanwhile, and without GPRS, a cached neighbour cell stands in with
+ * twice the radius.
+ *
+ * The use order is kept in RAM and saved with the next new cell, so hits do not write
+ * to flash.
+ */
+
+#define LBS_CACHE_FILE            "/lbs_cache.bin"
+#define LBS_CACHE_SIZE            64
+#define LBS_ACCURACY              1000    // m, of a position of the serving cell
+#define LBS_RETRY                 600     // s
+
+typedef enum {
+    LBS_SOURCE_NETWORK = 0,     // looked up now
+    LBS_SOURCE_CACHE,           // the serving cell was cached
+    LBS_SOURCE_NEIGHBOUR,       // a neighbour cell was cached
+} LbsSource_t;
+
+typedef struct {
+    float       latitude;
+    float       longitude;
+    float       accuracy;       // m
+    LbsSource_t source;
+} LbsPosition_t;
+
+/**
+ * @brief Load the cache from LBS_CACHE_FILE.
+ */
+void LbsCache_Init(void);
+
+/**
+ * @brief Position of the cells last seen, from the cache or the LBS service.
+ *        Blocks for a lookup, up to NETWORK_LBS_TIMEOUT_S seconds.
+ * @return false if the cells are unknown and could not be looked up
+ */
+bool LbsCache_Locate(LbsPosition_t* position);
+
+/**
+ * @brief Forget all cells, in RAM and on flash.
+ */
+void LbsCache_Clear(void);
+
+/**
+ * @brief Print the cache use and the cells, the most recently used first.
+ */
+void LbsCache_Print(CmdOutputFunc output);
+
+#endif // LBS_CACHE_H
@@ -1,4 +1,5 @@
 #include <api_os.h>
+#include <api_sys.h>
 #include <api_hal_gpio.h>
 
 #include "system.h"
@@ -18,11 +19,15 @@ static GPIO_config_t gpioLedGsm = {
     .defaultLevel = GPIO_LEVEL_LOW
 };
 
+static HANDLE ledTaskHandle = NULL;
+// the timer was not rearmed because the tracker parked
+static bool   ledStopped    = false;
+
 void LED_Blink(void* param);
 
 void LED_BlinkingTimer(HANDLE taskHandle)
 {  
-    OS_StartCallbackTimer(taskHandle, 500, LED_Blink, (void*)taskHandle);
+    OS_StartCallbackTimer(taskHandle, 500, LED_Blink, (void*)(unsigned long)taskHandle);
 }
 
 static void handle_led_blink(bool status_on, int count, int pin)
@@ -40,9 +45,21 @@ static void handle_led_blink(bool status_on, int count, int pin)
 void LED_Blink(void* param)
 {
     static int count = 0;
-    HANDLE taskHandle = (HANDLE)param;
+    HANDLE taskHandle = (HANDLE)(unsigned long)param;
     if (taskHandle == NULL) return;
 
+    // the check and the flag are one step for LED_Resume(), which runs after SLEEPING_OFF()
+    uint32_t status = SYS_EnterCriticalSection();
+    bool parked = IS_SLEEPING();
+    if (parked) ledStopped = true;
+    SYS_ExitCriticalSection(status);
+    if (parked) {
+        // parked: LEDs off and no timer, the CPU sleeps until Power_Wake() resumes it
+        GPIO_Set(GPS_STATUS_LED, GPIO_LEVEL_LOW);
+        GPIO_Set(GSM_STATUS_LED, GPIO_LEVEL_LOW);
+        return;
+    }
+
     if (IS_INITIALIZED()) {
         handle_led_blink(gps_isValid(), count, GPS_STATUS_LED);
         handle_led_blink(IS_GSM_ACTIVE(), count, GSM_STATUS_LED);
@@ -60,5 +77,16 @@ void LED_init(HANDLE taskHandle)
 {  
     GPIO_Init(gpioLedGps);
     GPIO_Init(gpioLedGsm);
+    ledTaskHandle = taskHandle;
     LED_BlinkingTimer(taskHandle);
 }
+
+void LED_Resume(void)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    bool resume = ledStopped;
+    ledStopped = false;
+    SYS_ExitCriticalSection(status);
+    if (resume && ledTaskHandle)
+        LED_BlinkingTimer(ledTaskHandle);
+}
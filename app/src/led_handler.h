@@ -5,5 +5,7 @@
 #define GSM_STATUS_LED   GPIO_PIN28
 
 void LED_init(HANDLE taskHandle);
+// Restart the blinking after the tracker was parked; the LED timer stops while parked
+void LED_Resume(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <api_os.h>
+#include <api_sys.h>
+
+#include "utils.h"
+#include "config_store.h"
+#include "link_manager.h"
+#include "time_sync.h"
+#include "perf_stats.h"
+#include "debug.h"
+
+#define MODULE_TAG "Link"
+
+#define UPLOAD_SHIFT              1       // each upload moves the delivered share by half
+
+static LinkManager_t deviceLink;
+
+// 0..range
+static uint32_t Jitter(LinkManager_t* link, uint32_t range)
+{
+    link->seed = link->seed * 1103515245u + 12345u;
+    return (link->seed >> 8) % (range + 1);
+}
+
+// the wait after a reconnect, the more the longer it did not hold
+static uint32_t Backoff(LinkManager_t* link)
+{
+    if (link->failures == 0) return 0;
+    uint32_t delay = LINK_BACKOFF_MAX;
+    if (link->failures < 16 && (LINK_BACKOFF_MIN << (link->failures - 1)) < LINK_BACKOFF_MAX)
+        delay = LINK_BACKOFF_MIN << (link->failures - 1);
+    return delay / 2 + Jitter(link, delay - delay / 2);
+}
+
+void LinkManager_Init(LinkManager_t* link, uint32_t seed)
+{
+    memset(link, 0, sizeof(*link));
+    link->seed    = seed;
+    link->signal  = -1;
+    link->uploads = 100;
+}
+
+bool LinkManager_MayConnect(LinkManager_t* link, uint32_t now, uint32_t* wait)
+{
+    if ((int32_t)(link->nextAttempt - now) > 0) {
+        *wait = link->nextAttempt - now;
+        link->held++;
+        return false;
+    }
+    *wait = 0;
+    link->attempts++;
+    link->lastAttempt = now;
+    link->nextAttempt = now + Backoff(link);
+    if (link->failures < UINT8_MAX) link->failures++;
+    return true;
+}
+
+void LinkManager_Urgent(LinkManager_t* link)
+{
+    uint32_t soon = link->lastAttempt + LINK_URGENT_BACKOFF;
+    if (link->attempts > 0 && (int32_t)(link->nextAttempt - soon) > 0) link->nextAttempt = soon;
+}
+
+void LinkManager_Up(LinkManager_t* link, uint32_t now)
+{
+    link->up     = true;
+    link->upTime = now;
+}
+
+void LinkManager_Down(LinkManager_t* link, uint32_t now)
+{
+    if (!link->up) return;
+    link->up = false;
+    link->drops++;
+    if (now - link->upTime >= LINK_STABLE_TIME) {
+        link->failures    = 0;
+        link->nextAttempt = now;
+    } else {
+        link->flaps++;
+    }
+}
+
+void LinkManager_Signal(LinkManager_t* link, int percent)
+{
+    link->signal = percent < 0 ? -1 : percent > 100 ? 100 : percent;
+}
+
+void LinkManager_Upload(LinkManager_t* link, bool delivered)
+{
+    int target = delivered ? 100 : 0;
+    link->uploads += (target - link->uploads) >> UPLOAD_SHIFT;
+    // the shift rounds down: a success has to reach 100 at last
+    if (delivered && link->uploads == 99) link->uploads = 100;
+}
+
+uint8_t LinkManager_Score(const LinkManager_t* link)
+{
+    uint8_t score = link->uploads;
+    if (link->signal >= 0 && link->signal < score) score = link->signal;
+    return score;
+}
+
+bool LinkManager_Defer(LinkManager_t* link, uint32_t sinceReport)
+{
+    if (LinkManager_Score(link) >= LINK_POOR_SCORE || sinceReport >= LINK_DEFER_MAX) return false;
+    link->deferred++;
+    return true;
+}
+
+void Link_Init(void)
+{
+    // the IMEI spreads the devices, the boot time the restarts of one
+    uint32_t seed = crc32_update((uint32_t)clock(), (const uint8_t*)g_ConfigStore.imei,
+                                 strlen(g_ConfigStore.imei));
+    LinkManager_Init(&deviceLink, seed);
+}
+
+// the status callbacks and the monitor run on the main task, the uploads on the tracker's
+bool Link_MayConnect(uint32_t* wait)
+{
+    uint32_t now = TimeSync_Uptime();
+    uint32_t status = SYS_EnterCriticalSection();
+    bool may = LinkManager_MayConnect(&deviceLink, now, wait);
+    uint8_t failures = deviceLink.failures;
+    SYS_ExitCriticalSection(status);
+    if (!may)
+        Perf_Inc(PERF_NET_BACKOFF);
+    else if (failures > 1)
+        LOGW("reconnect %u since the link last held", (unsigned)failures);
+    return may;
+}
+
+void Link_Up(void)
+{
+    uint32_t now = TimeSync_Uptime();
+    uint32_t status = SYS_EnterCriticalSection();
+    LinkManager_Up(&deviceLink, now);
+    SYS_ExitCriticalSection(status);
+}
+
+void Link_Down(void)
+{
+    uint32_t now = TimeSync_Uptime();
+    uint32_t status = SYS_EnterCriticalSection();
+    bool     up = deviceLink.up;
+    uint32_t held = now - deviceLink.upTime;
+    LinkManager_Down(&deviceLink, now);
+    SYS_ExitCriticalSection(status);
+    if (up) LOGW("link lost after %u s", (unsigned)held);
+}
+
+void Link_Urgent(void)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    LinkManager_Urgent(&deviceLink);
+    SYS_ExitCriticalSection(status);
+}
+
+uint32_t Link_UpTime(void)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    uint32_t upTime = deviceLink.up ? deviceLink.upTime : 0;
+    SYS_ExitCriticalSection(status);
+    return upTime;
+}
+
+void Link_Signal(int csq)
+{
+    int percent = (csq < 0 || csq == 99) ? -1 : csq_to_percent(csq);
+    uint32_t status = SYS_EnterCriticalSection();
+    LinkManager_Signal(&deviceLink, percent);
+    SYS_ExitCriticalSection(status);
+}
+
+void Link_Upload(bool delivered)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    LinkManager_Upload(&deviceLink, delivered);
+    SYS_ExitCriticalSection(status);
+}
+
+bool Link_Defer(uint32_t sinceReport)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    bool defer = LinkManager_Defer(&deviceLink, sinceReport);
+    uint8_t score = LinkManager_Score(&deviceLink);
+    SYS_ExitCriticalSection(status);
+    if (defer) {
+        Perf_Inc(PERF_REPORTS_DEFERRED);
+        LOGI("link quality %u%%, report held back", (unsigned)score);
+    }
+    return defer;
+}
+
+void Link_Print(CmdOutputFunc output)
+{
+    uint32_t now = TimeSync_Uptime();
+    uint32_t status = SYS_EnterCriticalSection();
+    LinkManager_t copy = deviceLink;
+    SYS_ExitCriticalSection(status);
+
+    char signal[8] = "unknown";
+    if (copy.signal >= 0) snprintf(signal, sizeof(signal), "%d%%", copy.signal);
+    output("Link quality: %u%% (signal %s, uploads %u%%)%s\r\n", LinkManager_Score(&copy), signal,
+           (unsigned)copy.uploads, LinkManager_Score(&copy) < LINK_POOR_SCORE ? ", poor" : "");
+    if (copy.up)
+        output("Link up for %u s\r\n", (unsigned)(now - copy.upTime));
+    else if ((int32_t)(copy.nextAttempt - now) > 0)
+        output("Link down, next reconnect in %u s\r\n", (unsigned)(copy.nextAttempt - now));
+    output("Reconnects: %u, %u in a row; held back %u times; lost %u times, %u within %u s; reports held back %u\r\n",
+           (unsigned)copy.attempts, (unsigned)copy.failures, (unsigned)copy.held, (unsigned)copy.drops,
+           (unsigned)copy.flaps, LINK_STABLE_TIME, (unsigned)copy.deferred);
+}
@@ -0,0 +1,155 @@
+#ifndef LINK_MANAGER_H
+#define LINK_MANAGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config_commands.h"
+
+/**
+ * GPRS link health: reconnect backoff and report deferral.
+ *
+ * At the edge of coverage a tower comes and goes every few seconds. Retrying the attach
+ * and activation on every loss and every monitor round spends power and signalling on
+ * links that drop again before they carry a report. So every reconnect goes through
+ * LinkManager_MayConnect():
+ *
+ *   - the first reconnect after a link that held LINK_STABLE_TIME seconds is immediate;
+ *   - every further one waits twice as long as the one before, from LINK_BACKOFF_MIN up
+ *     to LINK_BACKOFF_MAX seconds, half of it random so that the devices that lost the
+ *     same tower do not come back together;
+ *   - a link that holds LINK_STABLE_TIME seconds ends the backoff;
+ *   - an alert waiting for the link (geofence, trip) shortens the wait to
+ *     LINK_URGENT_BACKOFF seconds after the last reconnect.
+ *
+ * The link quality is the lower of the signal (CSQ in %) and the share of the recent
+ * uploads delivered (each upload counts half). Below LINK_POOR_SCORE routine reports are
+ * held back, up to LINK_DEFER_MAX seconds after the last one; alerts (geofence, trip)
+ * go at once. A held back report is not queued: the next one carries the position then.
+ *
+ * Times are TimeSync_Uptime() seconds.
+ */
+
+#define LINK_BACKOFF_MIN          5       // s, before the second reconnect
+#define LINK_BACKOFF_MAX          120     // s
+#define LINK_STABLE_TIME          120     // s up that make the next loss a new one
+#define LINK_URGENT_BACKOFF       15      // s between reconnects while an alert waits
+#define LINK_POOR_SCORE           20      // %, CSQ 6 is 19 %
+#define LINK_DEFER_MAX            300     // s between reports on a poor link
+
+typedef struct {
+    uint32_t seed;              // of the jitter
+    uint8_t  failures;          // reconnects since the link last held
+    bool     up;
+    uint32_t upTime;            // when it came up
+    uint32_t lastAttempt;       // when the last reconnect started
+    uint32_t nextAttempt;       // no reconnect before
+    int8_t   signal;            // %, -1 unknown
+    uint8_t  uploads;           // % of the recent uploads delivered
+    // counters
+    uint32_t attempts;          // reconnects started
+    uint32_t held;              // reconnects refused by the backoff
+    uint32_t drops;             // losses of the link
+    uint32_t flaps;             // losses within LINK_STABLE_TIME
+    uint32_t deferred;          // reports held back
+} LinkManager_t;
+
+/**
+ * @brief Set up a manager, down, with no backoff and a good quality.
+ * @param seed of the jitter; devices should differ
+ */
+void LinkManager_Init(LinkManager_t* link, uint32_t seed);
+
+/**
+ * @brief A reconnect is due: take it if the backoff allows.
+ * @param wait seconds until it does, when it does not
+ * @return true if the reconnect may start now; it is counted as started
+ */
+bool LinkManager_MayConnect(LinkManager_t* link, uint32_t now, uint32_t* wait);
+
+/**
+ * @brief An alert waits for the link: no reconnect waits longer than LINK_URGENT_BACKOFF.
+ */
+void LinkManager_Urgent(LinkManager_t* link);
+
+/**
+ * @brief The link came up.
+ */
+void LinkManager_Up(LinkManager_t* link, uint32_t now);
+
+/**
+ * @brief The link went down; ends the backoff if it held LINK_STABLE_TIME.
+ */
+void LinkManager_Down(LinkManager_t* link, uint32_t now);
+
+/**
+ * @brief A new signal quality.
+ * @param percent 0-100, -1 unknown
+ */
+void LinkManager_Signal(LinkManager_t* link, int percent);
+
+/**
+ * @brief The result of an upload.
+ */
+void LinkManager_Upload(LinkManager_t* link, bool delivered);
+
+/**
+ * @brief The link quality, 0-100 %.
+ */
+uint8_t LinkManager_Score(const LinkManager_t* link);
+
+/**
+ * @brief Whether a routine report should wait for a better link.
+ * @param sinceReport seconds since the last report
+ * @return true if it should; it is counted
+ */
+bool LinkManager_Defer(LinkManager_t* link, uint32_t sinceReport);
+
+/**
+ * @brief Set up the device's manager.
+ */
+void Link_Init(void);
+
+/**
+ * @brief LinkManager_MayConnect() of the device's manager; counts PERF_NET_BACKOFF.
+ */
+bool Link_MayConnect(uint32_t* wait);
+
+/**
+ * @brief LinkManager_Up() / LinkManager_Down() of the device's manager.
+ */
+void Link_Up(void);
+void Link_Down(void);
+
+/**
+ * @brief LinkManager_Urgent() of the device's manager.
+ */
+void Link_Urgent(void);
+
+/**
+ * @brief When the link came up; 0 while it is down.
+ */
+uint32_t Link_UpTime(void);
+
+/**
+ * @brief A signal quality report.
+ * @param csq 0-31, 99 unknown
+ */
+void Link_Signal(int csq);
+
+/**
+ * @brief LinkManager_Upload() of the device's manager.
+ */
+void Link_Upload(bool delivered);
+
+/**
+ * @brief LinkManager_Defer() of the device's manager; counts PERF_REPORTS_DEFERRED.
+ */
+bool Link_Defer(uint32_t sinceReport);
+
+/**
+ * @brief Print the link quality, the backoff and the counters.
+ */
+void Link_Print(CmdOutputFunc output);
+
+#endif // LINK_MANAGER_H
@@ -1,12 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
 
 #include <api_os.h>
 #include <api_network.h>
 #include <api_hal_uart.h>
 #include <api_lbs.h>
+#include <api_sys.h>
 
 #include "system.h"
 #include "utils.h"
@@ -14,17 +16,29 @@
 #include "config_store.h"
 #include "network.h"
 #include "debug.h"
+#include "perf_stats.h"
+#include "time_sync.h"
+#include "link_manager.h"
 
 #define MODULE_TAG "Network"
 
-static bool apn_workaround_pending = false;  
-#define MAX_CELLINFO_COUNT 8
+// seconds a tracker round may block on top of its wait before the watchdog drops the link:
+// a report (DNS, connect, the 12 s response timeout of http.c), an LBS lookup and an NTP
+// exchange
+#define NETWORK_WATCHDOG_GRACE (30 + NETWORK_LBS_TIMEOUT_S + TIME_NTP_TIMEOUT)
+
+// APN re-activation workaround, see NetworkInit()
+static bool apn_activated = false;          // the real APN was active since boot
+static bool apn_dummy_activating = false;   // the dummy APN goes first, its activation is under way
+static bool apn_dummy_done = false;         // the dummy APN is through, the real one is next
+
+static HANDLE                g_taskHandle = NULL;
+static bool                  g_reconnectScheduled = false;
 
 static Network_Status_t      g_NetworkStatus = 0;
 static Network_PDP_Context_t g_NetContextArr[2]; // Two-element array: [0]=real APN, [1]=dummy APN
-static Network_Location_t    g_CellInfo[MAX_CELLINFO_COUNT];
+static Network_Location_t    g_CellInfo[NETWORK_MAX_CELLS];
 static uint8_t               g_CellInfoCount = 0;
-static uint8_t               g_RSSI = 0;
 
 /*
  * @brief Global variable to store cell information.
@@ -34,7 +48,36 @@ static uint8_t               g_RSSI = 0;
  */
 static char g_cellInfoStr[128] = "\0";
 
+// the cell set encoded for the report, its version and the version the server has
+static char     g_cellsStr[NETWORK_CELLS_LENGTH] = "";
+static uint32_t g_cellsVersion = 0;
+static uint32_t g_cellsDelivered = 0;
+static uint32_t g_cellsDeliveredTime = 0;     // TimeSync_Uptime()
+
 static void NetworkMonitorTimer(HANDLE);
+static void NetworkReconnect(void);
+
+static void NetworkReconnectTimer(void* param)
+{
+    g_reconnectScheduled = false;
+    NetworkReconnect();
+}
+
+// attach and activate when the link manager's backoff allows, else once it does
+static void NetworkReconnect(void)
+{
+    uint32_t wait;
+    if (IS_GSM_ACTIVE() || !IS_GSM_REGISTERED() || g_NetworkStatus == NETWORK_STATUS_ATTACHING ||
+        g_NetworkStatus == NETWORK_STATUS_ACTIVATING)
+        return;
+    if (Link_MayConnect(&wait)) {
+        NetworkAttachActivate();
+    } else if (!g_reconnectScheduled) {
+        LOGI("reconnect in %u s", (unsigned)wait);
+        g_reconnectScheduled = true;
+        OS_StartCallbackTimer(g_taskHandle, wait * 1000, NetworkReconnectTimer, NULL);
+    }
+}
 
 static void NetworkMonitor(void* param)
 {
@@ -43,13 +86,19 @@ static void NetworkMonitor(void* param)
     if (g_trackerloop_tick > 0) {
         if (IS_GSM_ACTIVE())
         {
-            uint32_t now = time(NULL);
-            if (now - g_trackerloop_tick > 20) {
+            uint32_t now = TimeSync_Uptime();
+            // the tracker loop sleeps report_interval between uploads, sleep_interval when parked;
+            // a new link gets a whole period, the tracker may still be stuck on the old one
+            uint32_t period = IS_SLEEPING() ? g_ConfigStore.sleep_interval : g_ConfigStore.report_interval;
+            uint32_t since = g_trackerloop_tick;
+            if (Link_UpTime() > since) since = Link_UpTime();
+            if (now - since > period + NETWORK_WATCHDOG_GRACE) {
                 LOGE("watchdog: connection is taking too long, deactivating network!");
+                Perf_Inc(PERF_NET_WATCHDOG);
                 Network_StartDeactive(1);
             }
         } else {
-            NetworkAttachActivate();
+            NetworkReconnect();
         }
     }
 
@@ -61,32 +110,98 @@ static void NetworkMonitor(void* param)
     } else {
         g_cellInfoStr[0] = '\0';
     }
-    HANDLE taskHandle = (HANDLE)param;
+    HANDLE taskHandle = (HANDLE)(unsigned long)param;
     NetworkMonitorTimer(taskHandle);
 }
 
 static void NetworkMonitorTimer(HANDLE taskHandle)
 {  
-    OS_StartCallbackTimer(taskHandle, NETWORK_MONITOR_INTERVAL_MS, NetworkMonitor, (void*)taskHandle);
+    OS_StartCallbackTimer(taskHandle, NETWORK_MONITOR_INTERVAL_MS, NetworkMonitor, (void*)(unsigned long)taskHandle);
 }
 
 void NetworkSigQualityCallback(int CSQ)
 {
-    g_RSSI = csq_to_percent(CSQ);
-    LOGD("Signal Quality: %d%%", g_RSSI);
+    Link_Signal(CSQ);
+    LOGD("Signal Quality: %d%%", csq_to_percent(CSQ));
     return;
 }
 
+static bool SamePlmn(const Network_Location_t* a, const Network_Location_t* b)
+{
+    return memcmp(a->sMcc, b->sMcc, 3) == 0 && memcmp(a->sMnc, b->sMnc, 3) == 0;
+}
+
+static bool SameCell(const Network_Location_t* a, const Network_Location_t* b)
+{
+    return a->sLac == b->sLac && a->sCellID == b->sCellID && SamePlmn(a, b);
+}
+
+// the same serving cell and the same neighbours, in any order
+static bool SameCellSet(const Network_Location_t* a, int countA, const Network_Location_t* b, int countB)
+{
+    if (countA != countB || (countA > 0 && !SameCell(&a[0], &b[0]))) return false;
+    for (int i = 1; i < countA; ++i) {
+        int j = 1;
+        while (j < countB && !SameCell(&a[i], &b[j])) j++;
+        if (j == countB) return false;
+    }
+    return true;
+}
+
+// MCC or MNC digits; a two digit MNC may be padded with 0xF
+static int FormatDigits(char* out, const uint8_t* digits)
+{
+    int n = 0;
+    for (int i = 0; i < 3; ++i)
+        if (digits[i] <= 9) out[n++] = '0' + digits[i];
+    out[n] = '\0';
+    return n;
+}
+
+// see Network_GetCellsUpdate()
+static void EncodeCells(const Network_Location_t* cells, int count, char* out, size_t size)
+{
+    char mcc[4], mnc[4];
+    FormatDigits(mcc, cells[0].sMcc);
+    FormatDigits(mnc, cells[0].sMnc);
+    size_t length = snprintf(out, size, "%s,%s", mcc, mnc);
+    int lac = -1;
+    for (int i = 0; i < count && length < size; ++i) {
+        if (!SamePlmn(&cells[i], &cells[0])) continue;
+        if (cells[i].sLac != lac)
+            length += snprintf(out + length, size - length, ",%x:%x:%d", cells[i].sLac, cells[i].sCellID,
+                               cells[i].iRxLev);
+        else
+            length += snprintf(out + length, size - length, ",:%x:%d", cells[i].sCellID, cells[i].iRxLev);
+        lac = cells[i].sLac;
+    }
+}
+
 void NetworkCellInfoCallback(Network_Location_t* loc, int number)
 {
     g_cellInfoStr[0] = '\0';
-    g_CellInfoCount = 0;
-    if (number <= 0) return;
-    int count = (number > MAX_CELLINFO_COUNT) ? MAX_CELLINFO_COUNT : number;
+    if (number <= 0) {
+        g_CellInfoCount = 0;
+        return;
+    }
+    int count = (number > NETWORK_MAX_CELLS) ? NETWORK_MAX_CELLS : number;
+    // a new serving cell while parked hints that the device is moving
+    if (g_CellInfoCount > 0 &&
+        (loc[0].sLac != g_CellInfo[0].sLac || loc[0].sCellID != g_CellInfo[0].sCellID))
+        Tracker_Notify(TRACKER_EVENT_MOTION);
+    // encoded here, once per update, not for every report; the RxLev values are refreshed
+    // but only a different set is a new version
+    bool changed = !SameCellSet(loc, count, g_CellInfo, g_CellInfoCount);
+    char cells[NETWORK_CELLS_LENGTH];
+    EncodeCells(loc, count, cells, sizeof(cells));
+    uint32_t status = SYS_EnterCriticalSection();
     for (int i = 0; i < count; ++i) {
         g_CellInfo[i] = loc[i];
     }
     g_CellInfoCount = count;
+    memcpy(g_cellsStr, cells, sizeof(cells));
+    if (changed) g_cellsVersion++;
+    SYS_ExitCriticalSection(status);
     // Format the serving cell for UART output (first entry)
     snprintf(g_cellInfoStr, sizeof(g_cellInfoStr), "%u%u%u,%u%u%u,%u,%u,%d",
              g_CellInfo[0].sMcc[0], g_CellInfo[0].sMcc[1], g_CellInfo[0].sMcc[2],
@@ -94,18 +209,67 @@ void NetworkCellInfoCallback(Network_Location_t* loc, int number)
              g_CellInfo[0].sLac, g_CellInfo[0].sCellID, g_CellInfo[0].iRxLev);
 }
 
-void NetworkPrintCellInfo(void)
+bool Network_GetCellsUpdate(char* buffer, uint32_t* version)
+{
+    uint32_t now = TimeSync_Uptime();
+    uint32_t status = SYS_EnterCriticalSection();
+    bool update = g_CellInfoCount > 0 && g_cellsVersion > 0 &&
+                  (g_cellsVersion != g_cellsDelivered || now - g_cellsDeliveredTime >= NETWORK_CELLS_REFRESH);
+    if (update) {
+        memcpy(buffer, g_cellsStr, NETWORK_CELLS_LENGTH);
+        *version = g_cellsVersion;
+    }
+    SYS_ExitCriticalSection(status);
+    return update;
+}
+
+void Network_CellsDelivered(uint32_t version)
+{
+    uint32_t now = TimeSync_Uptime();
+    uint32_t status = SYS_EnterCriticalSection();
+    g_cellsDelivered = version;
+    g_cellsDeliveredTime = now;
+    SYS_ExitCriticalSection(status);
+}
+
+int Network_GetCells(Network_Location_t* cells)
+{
+    // the cell info callback runs on the main task
+    uint32_t status = SYS_EnterCriticalSection();
+    uint8_t count = g_CellInfoCount;
+    memcpy(cells, g_CellInfo, count * sizeof(cells[0]));
+    SYS_ExitCriticalSection(status);
+    return count;
+}
+
+bool Network_GetLbsLocation(Network_Location_t* cells, int count, float* latitude, float* longitude)
+{
+    if (count == 0 || !IS_GSM_ACTIVE()) {
+        LOGW("LBS location needs cells and GPRS");
+        return false;
+    }
+    uint32_t start = TimeSync_Uptime();
+    if (!LBS_GetLocation(cells, count, NETWORK_LBS_TIMEOUT_S, longitude, latitude)) {
+        LOGW("LBS location of %d cells failed", count);
+        return false;
+    }
+    LOGI("LBS location %.5f, %.5f from %d cells in %u s", *latitude, *longitude, count,
+         TimeSync_Uptime() - start);
+    return true;
+}
+
+void NetworkPrintCellInfo(CmdOutputFunc output)
 {
     if (g_CellInfoCount > 0) {
-        UART_Printf("Base stations seen: %d\r\n", g_CellInfoCount);
+        output("Base stations seen: %d\r\n", g_CellInfoCount);
         for (uint8_t i = 0; i < g_CellInfoCount; ++i) {
-            UART_Printf("  [%d] MCC: %u%u%u, MNC: %u%u%u, LAC: %u, CellID: %u, RxLev: %d\r\n", i,
+            output("  [%d] MCC: %u%u%u, MNC: %u%u%u, LAC: %u, CellID: %u, RxLev: %d\r\n", i,
                 g_CellInfo[i].sMcc[0], g_CellInfo[i].sMcc[1], g_CellInfo[i].sMcc[2],
                 g_CellInfo[i].sMnc[0], g_CellInfo[i].sMnc[1], g_CellInfo[i].sMnc[2],
                 g_CellInfo[i].sLac, g_CellInfo[i].sCellID, g_CellInfo[i].iRxLev);
         }
     } else {
-        UART_Printf("Cell info not available\r\n");
+        output("Cell info not available\r\n");
     }
 }
 
@@ -117,6 +281,8 @@ const char* Network_GetCellInfoString(void)
 // the function is called whenever the network state changes
 void NetworkUpdateStatus(Network_Status_t status)
 {
+    // first: the handlers below may start the next step, which sets its own status
+    g_NetworkStatus = status;
     switch (status) {
         case NETWORK_STATUS_OFFLINE:        
             LOGE("network offline");
@@ -128,11 +294,15 @@ void NetworkUpdateStatus(Network_Status_t status)
         case NETWORK_STATUS_REGISTERED:     
             LOGW("state: network registered successfully");
             GSM_REGISTERED_ON();
-            NetworkAttachActivate();
+            // the cells are known before GPRS is up, for the AGPS position
+            if (!Network_GetCellInfoRequst())
+                LOGE("network get cell info fail");
+            NetworkReconnect();
             break;
         case NETWORK_STATUS_DETACHED:
             LOGW("state: network detached");
             GSM_ACTIVE_OFF();
+            Link_Down();
             break;
         case NETWORK_STATUS_ATTACHING:
             LOGI("state: attaching to the network");
@@ -140,34 +310,64 @@ void NetworkUpdateStatus(Network_Status_t status)
             break;
         case NETWORK_STATUS_ATTACHED:       
             LOGW("state: network attached successfully");
+            Perf_Inc(PERF_NET_ATTACHED);
             GSM_ACTIVE_OFF(); 
+            // the same reconnect goes on with the activation
             NetworkAttachActivate();    
             break;
         case NETWORK_STATUS_DEACTIVED:      
+            if (apn_dummy_activating) {
+                // the network refused the dummy APN, now the real one
+                LOGI("state: dummy APN deactivated");
+                apn_dummy_activating = false;
+                apn_dummy_done = true;
+                NetworkAttachActivate();
+                break;
+            }
             LOGE("state: network deactived");
+            Perf_Inc(PERF_NET_DEACTIVATED);
             GSM_ACTIVE_OFF(); 
-            NetworkAttachActivate();
+            Link_Down();
+            NetworkReconnect();
             break;
         case NETWORK_STATUS_ACTIVATING:
             LOGW("state: activating the network");
             GSM_ACTIVE_OFF(); 
             break;        
         case NETWORK_STATUS_ACTIVATED:
+            if (apn_dummy_activating) {
+                // the network took the dummy APN: drop it, the deactivation brings the real one
+                LOGW("state: dummy APN activated, deactivating it");
+                g_NetworkStatus = NETWORK_STATUS_ACTIVATING;
+                Network_StartDeactive(1);
+                break;
+            }
             LOGW("state: network activated successfully");
+            Perf_Inc(PERF_NET_ACTIVATED);
+            apn_activated = true;
+            Link_Up();
             GSM_ACTIVE_ON();
             break;
         case NETWORK_STATUS_ATTACH_FAILED: 
             LOGE("state: network attach failed");
+            Perf_Inc(PERF_NET_FAILURES);
             GSM_ACTIVE_OFF(); 
             break;
         case NETWORK_STATUS_ACTIVATE_FAILED:
+            if (apn_dummy_activating) {
+                LOGI("state: dummy APN activation failed");
+                apn_dummy_activating = false;
+                apn_dummy_done = true;
+                NetworkAttachActivate();
+                break;
+            }
             LOGE("state: network activation failed");
+            Perf_Inc(PERF_NET_FAILURES);
             break;
 
         default:
             break;
     }
-    g_NetworkStatus = status;
 }
 
 Network_Status_t NetworkGetStatus()
@@ -182,15 +382,19 @@ void NetworkInit(HANDLE taskHandle)
     // APN Re-activation Workaround
     //
     // the firmware has a defect where re-activating the same APN after deactivation fails.
-    // To work around this, we:
-    //   1. Attempt to activate a dummy/incorrect APN first (NetContextArr[1]).
-    //   2. Wait for a network deactivation event (which occurs because the dummy APN fails).
-    //   3. Then activate the real APN (NetContextArr[0]).
+    // To work around this, once the real APN was active, every activation:
+    //   1. Attempts to activate a dummy/incorrect APN first (NetContextArr[1]).
+    //   2. Waits for the deactivation or activation failure the dummy APN ends in.
+    //   3. Then activates the real APN (NetContextArr[0]) at once, as part of the same reconnect.
     //
-    // This workaround is managed by the apn_workaround_pending flag and the AttachActivate() function.
+    // The first activation after boot needs no dummy. The dummy's events are not a link loss
+    // for the link manager's backoff, and a network that takes the dummy APN gets it
+    // deactivated again.
     // The dummy APN context is set once at system initialization. The real APN context is set as needed.
-    // All logic for the workaround is centralized in AttachActivate; 
-    apn_workaround_pending = false;
+    apn_activated = false;
+    apn_dummy_activating = false;
+    apn_dummy_done = false;
+    g_taskHandle = taskHandle;
 
     // Dummy APN (index 1) context is set once at system init
     memset(&g_NetContextArr[1], 0, sizeof(g_NetContextArr[1]));
@@ -232,6 +436,8 @@ bool NetworkAttachActivate()
         if(!ret)
         {
             LOGE("network attach failed");
+            // not under way: the next reconnect may try again
+            NetworkUpdateStatus(NETWORK_STATUS_ATTACH_FAILED);
             return false;
         }
         return true;
@@ -250,24 +456,23 @@ bool NetworkAttachActivate()
     }
     if (!status)
     {
-        // Implements the APN re-activation workaround:
-        // - If workaround is pending, activate the real APN (NetContextArr[0]) and clear the flag.
-        // - Otherwise, activate the dummy APN (NetContextArr[1]) and set the flag.
-        // This ensures the modem can recover from the re-activation defect.
-        if (!apn_workaround_pending) {
+        // Implements the APN re-activation workaround (see NetworkInit()): once the real APN
+        // was active, the dummy APN goes first and its end event activates the real one.
+        NetworkUpdateStatus(NETWORK_STATUS_ACTIVATING);
+        if (!apn_activated || apn_dummy_done) {
             LOGI("Using valid APN to activate the network");
             SetApnContext();
-            NetworkUpdateStatus(NETWORK_STATUS_ACTIVATING);
+            apn_dummy_done = false;
             ret = Network_StartActive(g_NetContextArr[0]); // real APN
-            apn_workaround_pending = true;
         } else {
             LOGI("Using dummy APN to workaround re-activation defect");
-            NetworkUpdateStatus(NETWORK_STATUS_ACTIVATING);
+            apn_dummy_activating = true;
             ret = Network_StartActive(g_NetContextArr[1]); // dummy
-            apn_workaround_pending = false;
+            if (!ret) apn_dummy_activating = false;
         }
         if (!ret) {
             LOGE("Failed to activate APN");
+            NetworkUpdateStatus(NETWORK_STATUS_ACTIVATE_FAILED);
             return false;
         }
     }
@@ -1,12 +1,23 @@
 #ifndef NETWORK_H
 #define NETWORK_H
 
+#include "config_commands.h"
+
+#define NETWORK_LBS_TIMEOUT_S 10
+// cells kept from the cell info, the serving cell first
+#define NETWORK_MAX_CELLS     8
+// the encoded cell set, see Network_GetCellsUpdate()
+#define NETWORK_CELLS_LENGTH  160
+// seconds after which a delivered cell set is sent again, for fresh RxLev values
+#define NETWORK_CELLS_REFRESH 3600
+
 /**
  * @brief Setups capturing network state.
  * 
  * This function should be called during system initialization to set up the network status callback.
  * It registers a callback function that will be called whenever the network status changes.
  * It sets up the dummy APN context and initializes the workaround state.
+ * The monitor reconnects a lost link through the link manager's backoff (link_manager.h).
  */
 void NetworkInit(HANDLE taskHandle);
 
@@ -15,7 +26,8 @@ void NetworkInit(HANDLE taskHandle);
  *
  * This function checks the current attach and activate status of the GSM network.
  * If not attached, it attempts to attach. If attached but not activated, it activates the network.
- * It handles the APN re-activation workaround by toggling between a dummy APN and the real APN.
+ * It handles the APN re-activation workaround: once the real APN was active, a dummy APN goes
+ * first. No backoff applies, the network events and the monitor reconnect through it.
  * @return true if the operation was successful, false otherwise.
  */
 bool NetworkAttachActivate(void);
@@ -42,7 +54,7 @@ void NetworkCellInfoCallback(Network_Location_t* loc, int number);
  * 
  * This function converts the CSQ value to a percentage and logs it.
  * it is called whenever the signal quality changes.
- * It updates the global signal strength variable `g_RSSI` based on the received CSQ value.
+ * The link manager scores the link quality with it (Link_Signal()).
  *
  * @param CSQ The received signal quality value (CSQ).
  * @note The CSQ value is typically in the range of 0-31, where 0 indicates no signal and 31 indicates the best signal quality.
@@ -61,11 +73,55 @@ void NetworkSigQualityCallback(int CSQ);
 const char* Network_GetCellInfoString(void);
 
 /**
- * @brief Prints information on all visible BaseStations to the UART.
+ * @brief The cells seen, encoded for the report, when the set differs from the one last
+ *        delivered or that is NETWORK_CELLS_REFRESH seconds old.
+ *
+ * The encoding is made once per cell info update, not per report:
+ * "260,001,4d2:162e:-70,:270f:-80" is the MCC and MNC of the serving cell, then per cell
+ * the LAC and cell ID in hex and the RxLev in dBm, serving cell first. A LAC equal to the
+ * previous cell's is left out; cells of other networks are not included. A change of the
+ * RxLev values alone is not a new set.
+ *
+ * @param buffer  Receives the encoding, NETWORK_CELLS_LENGTH bytes.
+ * @param version Receives the version of the set, for Network_CellsDelivered().
+ * @return false if the server has the current set, or no cell is known.
+ */
+bool Network_GetCellsUpdate(char* buffer, uint32_t* version);
+
+/**
+ * @brief Records that a report carrying the cell set of the given version was delivered.
+ */
+void Network_CellsDelivered(uint32_t version);
+
+/**
+ * @brief Copies the cells last received.
+ *
+ * @param cells Receives up to NETWORK_MAX_CELLS cells, the serving cell first.
+ * @return the number of cells, 0 if none is known.
+ */
+int Network_GetCells(Network_Location_t* cells);
+
+/**
+ * @brief Locates the device from a set of cells, using the LBS service.
+ *
+ * Blocks for the server round trip, up to NETWORK_LBS_TIMEOUT_S seconds. Needs GPRS.
+ * See lbs_cache.h for the cached lookup.
+ *
+ * @param cells     The cells, from Network_GetCells().
+ * @param count     The number of cells.
+ * @param latitude  Receives the latitude in degrees.
+ * @param longitude Receives the longitude in degrees.
+ * @return true if the service returned a location.
+ */
+bool Network_GetLbsLocation(Network_Location_t* cells, int count, float* latitude, float* longitude);
+
+/**
+ * @brief Prints information on all visible BaseStations.
  * 
- * This function prints  to the UART information on all basestations seen by the device.
+ * This function prints information on all basestations seen by the device.
  * It includes details such as MCC, MNC, LAC, Cell ID, and RxLev.
+ * @param output the command output, e.g. cmd_printf
  */
-void NetworkPrintCellInfo(void);
+void NetworkPrintCellInfo(CmdOutputFunc output);
 
 #endif
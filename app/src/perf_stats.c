@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <api_os.h>
+#include <api_sys.h>
+
+#include "utils.h"
+#include "mem_pool.h"
+#include "gps_parse.h"
+#include "time_sync.h"
+#include "perf_stats.h"
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;
+    uint32_t buckets[PERF_HIST_BUCKETS];
+} PerfHistogram_t;
+
+#define PERF_NAME(id, name, ...) name,
+#define PERF_DESC(id, name, desc, ...) desc,
+#define PERF_UNIT(id, name, desc, unit) unit,
+static const char* const counter_names[]  = { PERF_COUNTERS(PERF_NAME) };
+static const char* const counter_descs[]  = { PERF_COUNTERS(PERF_DESC) };
+static const char* const hist_names[]     = { PERF_HISTOGRAMS(PERF_NAME) };
+static const char* const hist_descs[]     = { PERF_HISTOGRAMS(PERF_DESC) };
+static const char* const hist_units[]     = { PERF_HISTOGRAMS(PERF_UNIT) };
+#undef PERF_NAME
+#undef PERF_DESC
+#undef PERF_UNIT
+
+static uint32_t        counters[PERF_COUNTER_MAX];
+static PerfHistogram_t histograms[PERF_HISTOGRAM_MAX];
+static uint32_t        heap_min_free = 0xFFFFFFFF;
+static uint32_t        heap_used     = 0;
+
+void Perf_Add(t_perfCounter counter, uint32_t value)
+{
+    if (counter >= PERF_COUNTER_MAX) return;
+    uint32_t status = SYS_EnterCriticalSection();
+    counters[counter] += value;
+    SYS_ExitCriticalSection(status);
+}
+
+void Perf_Record(t_perfHistogram hist, uint32_t value)
+{
+    if (hist >= PERF_HISTOGRAM_MAX) return;
+    int bucket = 0;
+    while (bucket < PERF_HIST_BUCKETS - 1 && value >= (1u << bucket)) ++bucket;
+
+    PerfHistogram_t* h = &histograms[hist];
+    uint32_t status = SYS_EnterCriticalSection();
+    h->count++;
+    h->buckets[bucket]++;
+    if (value > h->max) h->max = value;
+    SYS_ExitCriticalSection(status);
+}
+
+void Perf_SampleHeap(void)
+{
+    OS_Heap_Status_t heap;
+    if (!OS_GetHeapUsageStatus(&heap)) return;
+    uint32_t status = SYS_EnterCriticalSection();
+    heap_used = heap.usedSize;
+    if (heap.totalSize - heap.usedSize < heap_min_free)
+        heap_min_free = heap.totalSize - heap.usedSize;
+    SYS_ExitCriticalSection(status);
+}
+
+void Perf_Reset(void)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    memset(counters, 0, sizeof(counters));
+    memset(histograms, 0, sizeof(histograms));
+    heap_min_free = 0xFFFFFFFF;
+    SYS_ExitCriticalSection(status);
+    memset(Gps_GetParseStats(), 0, sizeof(GPS_Parse_Stats_t));
+    Perf_SampleHeap();
+}
+
+/**
+ * Upper bound of the bucket holding the given percentile, the histogram maximum
+ * for the last bucket.
+ */
+static uint32_t Percentile(const PerfHistogram_t* h, uint32_t percent)
+{
+    if (h->count == 0) return 0;
+    uint32_t rank = (h->count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < PERF_HIST_BUCKETS; ++i) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint32_t bound = (i == PERF_HIST_BUCKETS - 1) ? h->max : (1u << i) - 1;
+            return bound < h->max ? bound : h->max;
+        }
+    }
+    return h->max;
+}
+
+static void Snapshot(uint32_t* counterCopy, PerfHistogram_t* histCopy)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    memcpy(counterCopy, counters, sizeof(counters));
+    memcpy(histCopy, histograms, sizeof(histograms));
+    SYS_ExitCriticalSection(status);
+}
+
+void Perf_Print(CmdOutputFunc output)
+{
+    uint32_t        c[PERF_COUNTER_MAX];
+    PerfHistogram_t h[PERF_HISTOGRAM_MAX];
+    Perf_SampleHeap();
+    Snapshot(c, h);
+    const GPS_Parse_Stats_t* gps = Gps_GetParseStats();
+
+    output("uptime: %u s\r\n", TimeSync_Uptime());
+    // the probe holds the heap for a moment, it is not part of the upload
+    output("heap used: %u, lowest free: %u, largest free block: %u\r\n", heap_used, heap_min_free,
+           Mem_LargestFree());
+    output("NMEA bytes: %u, frames: %u, sentences: %u\r\n", gps->bytes, gps->frames, gps->sentences);
+    output("NMEA checksum/unknown: %u, parse failed: %u, dropped: %u, buffer overflows: %u\r\n",
+           gps->invalid, gps->failed, gps->dropped, gps->overflows);
+    for (int i = 0; i < PERF_COUNTER_MAX; ++i)
+        output("%-28s : %u\r\n", counter_descs[i], c[i]);
+    for (int i = 0; i < PERF_HISTOGRAM_MAX; ++i)
+        output("%-28s : n=%u p50<=%u p90<=%u p99<=%u max=%u %s\r\n", hist_descs[i], h[i].count,
+               Percentile(&h[i], 50), Percentile(&h[i], 90), Percentile(&h[i], 99), h[i].max, hist_units[i]);
+}
+
+void Perf_PrintHeap(CmdOutputFunc output)
+{
+    OS_Heap_Status_t heap;
+    MemStats_t       mem;
+    MemSite_t        site;
+    if (!OS_GetHeapUsageStatus(&heap)) memset(&heap, 0, sizeof(heap));
+    uint32_t free    = heap.totalSize - heap.usedSize;
+    uint32_t largest = Mem_LargestFree();
+    Mem_GetStats(&mem);
+
+    output("heap: %u of %u bytes used, %u free, largest free block %u (%u%% fragmented)\r\n",
+           heap.usedSize, heap.totalSize, free, largest, free > largest ? (uint32_t)((uint64_t)(free - largest) * 100 / free) : 0);
+    output("tracked: %u bytes used, peak %u, largest request %u\r\n", mem.used, mem.peak, mem.largestRequest);
+    output("tracked: %u allocs, %u frees, %u failed, %u bad frees\r\n", mem.allocs, mem.frees, mem.failures, mem.badFrees);
+
+    output("%-12s %6s %6s %6s %6s %9s %9s\r\n", "pool", "block", "blocks", "used", "peak", "allocs", "fallbacks");
+    const MemPool_t* pool;
+    for (int i = 0; (pool = Mem_GetPool(i)) != NULL; ++i)
+        output("%-12.12s %6u %6u %6u %6u %9u %9u\r\n", pool->name, pool->blockSize, pool->blockCount,
+               pool->used, pool->peak, pool->allocs, pool->fallbacks);
+
+    output("%-12s %6s %10s %9s\r\n", "site", "live", "live bytes", "allocs");
+    for (int i = 0; Mem_GetSite(i, &site); ++i)
+        output("%-12.12s %6u %10u %9u\r\n", site.tag, site.live, site.liveBytes, site.allocs);
+}
+
+int Perf_Format(char* buffer, int size)
+{
+    uint32_t        c[PERF_COUNTER_MAX];
+    PerfHistogram_t h[PERF_HISTOGRAM_MAX];
+    Perf_SampleHeap();
+    Snapshot(c, h);
+    const GPS_Parse_Stats_t* gps = Gps_GetParseStats();
+
+    int len = snprintf(buffer, size, "up:%u,hm:%u,hn:%u,gb:%u,gf:%u,gi:%u,gp:%u,go:%u",
+                       TimeSync_Uptime(), heap_used, heap_min_free,
+                       gps->bytes, gps->frames, gps->invalid, gps->failed, gps->overflows);
+    for (int i = 0; i < PERF_COUNTER_MAX && len > 0 && len < size; ++i) {
+        if (c[i] == 0) continue;
+        len += snprintf(buffer + len, size - len, ",%s:%u", counter_names[i], c[i]);
+    }
+    for (int i = 0; i < PERF_HISTOGRAM_MAX && len > 0 && len < size; ++i) {
+        if (h[i].count == 0) continue;
+        len += snprintf(buffer + len, size - len, ",%s:%u/%u/%u/%u", hist_names[i], h[i].count,
+                        Percentile(&h[i], 50), Percentile(&h[i], 90), h[i].max);
+    }
+    if (len >= size) {
+        // drop the truncated field
+        buffer[size - 1] = '\0';
+        char* comma = strrchr(buffer, ',');
+        if (comma) *comma = '\0';
+        len = strlen(buffer);
+    }
+    return len;
+}
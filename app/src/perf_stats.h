@@ -0,0 +1,128 @@
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include <time.h>
+
+#include "config_commands.h"
+
+/**
+ * Runtime performance counters
+ *
+ * A fixed set of 32 bit counters and log2 histograms, counting since boot (or the last
+ * "stats reset"). Updates run inside a critical section, so they may be called from any
+ * task; they cost a few instructions and no memory beyond the static tables below.
+ * The GPS parser counters live in libs/gps (Gps_GetParseStats()) and are reported with these.
+ *
+ * The table is printed by the "stats" command and, every stats_interval seconds, sent
+ * in compact form as the "stats" field of the position report (see Perf_Format()).
+ */
+
+// X(enum, short name used in the uploads, description)
+#define PERF_COUNTERS(X) \
+    X(PERF_HTTP_ATTEMPTS,      "ha", "HTTP requests") \
+    X(PERF_HTTP_FAILURES,      "hf", "HTTP requests failed") \
+    X(PERF_HTTP_DNS_FAILURES,  "hd", "DNS lookups failed") \
+    X(PERF_HTTP_CONN_FAILURES, "hc", "TCP connects failed") \
+    X(PERF_HTTP_TIMEOUTS,      "ht", "HTTP response timeouts") \
+    X(PERF_HTTP_BYTES_SENT,    "hs", "HTTP bytes sent") \
+    X(PERF_HTTP_BYTES_RECV,    "hr", "HTTP bytes received") \
+    X(PERF_REPORTS_SENT,       "rs", "position reports sent") \
+    X(PERF_REPORTS_DEFERRED,   "rd", "reports held back on a poor link") \
+    X(PERF_NET_ATTACHED,       "na", "GPRS attaches") \
+    X(PERF_NET_ACTIVATED,      "nv", "PDP activations") \
+    X(PERF_NET_DEACTIVATED,    "nd", "PDP deactivations") \
+    X(PERF_NET_FAILURES,       "nf", "attach/activation failures") \
+    X(PERF_NET_WATCHDOG,       "nw", "watchdog deactivations") \
+    X(PERF_NET_BACKOFF,        "nb", "reconnects held back by the backoff") \
+    X(PERF_GPS_EVENTS,         "ge", "GPS UART events") \
+    X(PERF_GPS_FILTER_REJECTS, "gr", "GPS fixes rejected by the filter") \
+    X(PERF_TRACK_DROPPED,      "td", "fixes dropped by the track simplifier") \
+    X(PERF_LOG_MESSAGES,       "lm", "log messages") \
+    X(PERF_LOG_ERRORS,         "le", "error log messages") \
+    X(PERF_LOG_WRITE_FAILURES, "lw", "log file write failures")
+
+// X(enum, short name, description, unit)
+#define PERF_HISTOGRAMS(X) \
+    X(PERF_HIST_HTTP_MS,       "hl", "HTTP request latency", "ms") \
+    X(PERF_HIST_GPS_US,        "gl", "GPS frame processing", "us")
+
+#define PERF_ENUM(id, ...) id,
+typedef enum { PERF_COUNTERS(PERF_ENUM) PERF_COUNTER_MAX } t_perfCounter;
+typedef enum { PERF_HISTOGRAMS(PERF_ENUM) PERF_HISTOGRAM_MAX } t_perfHistogram;
+#undef PERF_ENUM
+
+// bucket i holds the values below 2^i, the last one everything above
+#define PERF_HIST_BUCKETS 20
+
+// longest Perf_Format() output
+#define PERF_FORMAT_MAX_LENGTH 320
+
+/**
+ * @brief Add a value to a counter.
+ */
+void Perf_Add(t_perfCounter counter, uint32_t value);
+
+static inline void Perf_Inc(t_perfCounter counter)
+{
+    Perf_Add(counter, 1);
+}
+
+/**
+ * @brief Record a sample in a histogram.
+ */
+void Perf_Record(t_perfHistogram hist, uint32_t value);
+
+/**
+ * @brief Start time for Perf_ElapsedMs()/Perf_ElapsedUs(), in clock() ticks.
+ */
+static inline uint32_t Perf_Start(void)
+{
+    return (uint32_t)clock();
+}
+
+// clock() runs at 16384 Hz
+static inline uint32_t Perf_ElapsedMs(uint32_t start)
+{
+    return (uint32_t)(((uint64_t)((uint32_t)clock() - start) * 1000) >> 14);
+}
+
+static inline uint32_t Perf_ElapsedUs(uint32_t start)
+{
+    return (uint32_t)(((uint64_t)((uint32_t)clock() - start) * 1000000) >> 14);
+}
+
+/**
+ * @brief Sample the heap usage, keeping the lowest free size seen.
+ */
+void Perf_SampleHeap(void);
+
+/**
+ * @brief Clear all counters and histograms, including the GPS parser counters.
+ */
+void Perf_Reset(void);
+
+/**
+ * @brief Print the counters and histograms, one per line.
+ */
+void Perf_Print(CmdOutputFunc output);
+
+/**
+ * @brief Print the instrumented heap (libs/utils mem_pool.h): bytes in use and peak, the
+ *        largest free block and the fragmentation, the pools and the live blocks per call site.
+ */
+void Perf_PrintHeap(CmdOutputFunc output);
+
+/**
+ * @brief Format the non-zero counters and the histogram summaries for an upload.
+ *
+ * Format: "up:<s>,<name>:<value>,...,<hist>:<count>/<p50>/<p90>/<max>" with the short
+ * names above, plus "gb" (NMEA bytes), "gf" (frames), "gi" (checksum errors), "gp"
+ * (parse failures), "go" (buffer overflows), "hm" (heap used) and "hn" (lowest heap free).
+ * The largest free block is left out: Mem_LargestFree() holds the heap while it probes.
+ * Only characters that need no URL encoding are used.
+ *
+ * @return the length of the string written to buffer
+ */
+int  Perf_Format(char* buffer, int size);
+
+#endif // PERF_STATS_H
@@ -0,0 +1,36 @@
+#include <api_os.h>
+#include <api_hal_pm.h>
+
+#include "gps.h"
+
+#include "system.h"
+#include "utils.h"
+#include "power.h"
+#include "led_handler.h"
+#include "debug.h"
+
+#define MODULE_TAG "Power"
+
+void Power_Park(void)
+{
+    if (IS_SLEEPING()) return;
+    LOGI("parking: GPS standby, CPU sleep");
+    if (!GPS_SetStandbyMode(GPS_STANDBY_MODE_SLEEP))
+        LOGE("GPS standby failed");
+    SLEEPING_ON();
+    PM_SetSysMinFreq(PM_SYS_FREQ_32K);
+    PM_SleepMode(true);
+}
+
+void Power_Wake(void)
+{
+    if (!IS_SLEEPING()) return;
+    PM_SleepMode(false);
+    PM_SetSysMinFreq(POWER_RUN_FREQ);
+    SLEEPING_OFF();
+    LED_Resume();
+    LOGI("waking: GPS hot start");
+    // any command ends the standby, the hot start also restarts the fix search
+    if (!GPS_Reboot(GPS_REBOOT_MODE_HOT))
+        LOGE("GPS hot start failed");
+}
@@ -0,0 +1,37 @@
+#ifndef POWER_H
+#define POWER_H
+
+/**
+ * Low-power parking for the tracker task (config low_power).
+ *
+ * While the device stands still the tracker parks it: the GPS goes to standby (it keeps
+ * its almanac, ephemeris and time, so the next fix is a hot start), the system clock
+ * floor drops to 32 kHz and the CPU may sleep between events. GPRS stays attached, so
+ * SMS and network events still arrive. The console is not usable while parked.
+ * The LEDs and their timer stop; the console and SMS tasks sleep until input arrives,
+ * which leaves the network monitor (every NETWORK_MONITOR_INTERVAL_MS) and the modem's
+ * signal reports as the regular wake-ups.
+ *
+ * The tracker wakes after sleep_interval seconds or on a serving cell change (the only
+ * motion hint the board has), hot-starts the GPS, waits up to fix_timeout seconds for
+ * a fix, reports, and parks again if the fix shows no movement.
+ */
+
+// the tracker parks after this many consecutive reports slower than the limit (knots)
+#define POWER_STILL_SPEED         2.0
+#define POWER_STILL_REPORTS       3
+
+// clock floor while awake: TLS handshakes are slow below it
+#define POWER_RUN_FREQ            PM_SYS_FREQ_104M
+
+/**
+ * @brief Put the GPS in standby, drop the clock floor and enable CPU sleep.
+ */
+void Power_Park(void);
+
+/**
+ * @brief Leave sleep, restore the clock floor and hot-start the GPS.
+ */
+void Power_Wake(void);
+
+#endif // POWER_H
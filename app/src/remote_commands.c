@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include <api_os.h>
+
+#include "utils.h"
+#include "config_store.h"
+#include "config_commands.h"
+#include "remote_commands.h"
+#include "debug.h"
+
+#define MODULE_TAG "Remote"
+
+// plain text output of the executed commands
+static char    result_buf[REMOTE_RESULT_BUFFER_SIZE];
+static int     result_len = 0;
+
+// URL-encoded copy of result_buf, every character may take up to 3 bytes
+static char    result_encoded[REMOTE_RESULT_BUFFER_SIZE * 3 + 1];
+
+// commands waiting for their acknowledgement to be uploaded
+static char    deferred_cmds[REMOTE_MAX_DEFERRED][REMOTE_MAX_COMMAND_LENGTH];
+static uint8_t deferred_count = 0;
+
+static int32_t ResultPrintf(const char* fmt, ...)
+{
+    int space = (int)sizeof(result_buf) - result_len;
+    if (space <= 1) return 0;
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(result_buf + result_len, space, fmt, args);
+    va_end(args);
+
+    if (len < 0) return 0;
+    if (len >= space) len = space - 1;
+    result_len += len;
+    return len;
+}
+
+static void ExecuteLine(char* line)
+{
+    char cmd[REMOTE_MAX_COMMAND_LENGTH];
+    strncpy(cmd, line, sizeof(cmd) - 1);
+    cmd[sizeof(cmd) - 1] = '\0';
+
+    LOGI("remote command: %s", line);
+    ResultPrintf("> %s\n", line);
+
+    switch (HandleRemoteCommand(cmd, ResultPrintf, false))
+    {
+        case CMD_RESULT_OK:
+            break;
+        case CMD_RESULT_UNKNOWN:
+            ResultPrintf("unknown command\n");
+            break;
+        case CMD_RESULT_NOT_ALLOWED:
+            ResultPrintf("command not allowed remotely\n");
+            break;
+        case CMD_RESULT_DEFERRED:
+            if (deferred_count >= REMOTE_MAX_DEFERRED) {
+                ResultPrintf("too many deferred commands\n");
+                break;
+            }
+            strncpy(deferred_cmds[deferred_count], line, REMOTE_MAX_COMMAND_LENGTH - 1);
+            deferred_cmds[deferred_count][REMOTE_MAX_COMMAND_LENGTH - 1] = '\0';
+            deferred_count++;
+            ResultPrintf("scheduled\n");
+            break;
+    }
+}
+
+void RemoteCmd_ProcessResponse(const char* body)
+{
+    if (!body || !*body) return;
+
+    if (!g_ConfigStore.remote_commands) {
+        LOGW("remote commands are disabled, response ignored");
+        return;
+    }
+
+    char line[REMOTE_MAX_COMMAND_LENGTH];
+    int  executed = 0;
+
+    while (*body && executed < REMOTE_MAX_COMMANDS)
+    {
+        const char* end = strchr(body, '\n');
+        int len = end ? (int)(end - body) : (int)strlen(body);
+        if (len >= (int)sizeof(line)) {
+            LOGE("remote command too long, skipped");
+        } else {
+            memcpy(line, body, len);
+            line[len] = '\0';
+            char* cmd = trim_whitespace(line);
+            if (*cmd && *cmd != '#') {
+                ExecuteLine(cmd);
+                executed++;
+            }
+        }
+        if (!end) break;
+        body = end + 1;
+    }
+}
+
+const char* RemoteCmd_GetResults(void)
+{
+    if (result_len == 0) return "";
+    result_buf[result_len] = '\0';
+    url_encode(result_encoded, sizeof(result_encoded), result_buf);
+    return result_encoded;
+}
+
+void RemoteCmd_ResultsSent(void)
+{
+    result_len = 0;
+    result_buf[0] = '\0';
+
+    uint8_t count = deferred_count;
+    deferred_count = 0;
+    for (uint8_t i = 0; i < count; ++i) {
+        LOGW("executing deferred remote command: %s", deferred_cmds[i]);
+        HandleRemoteCommand(deferred_cmds[i], ResultPrintf, true);
+    }
+}
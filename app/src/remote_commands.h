@@ -0,0 +1,35 @@
+#ifndef REMOTE_COMMANDS_H
+#define REMOTE_COMMANDS_H
+
+#define REMOTE_MAX_COMMANDS          8
+#define REMOTE_MAX_DEFERRED          2
+#define REMOTE_MAX_COMMAND_LENGTH    128
+#define REMOTE_RESULT_BUFFER_SIZE    256
+
+/**
+ * @brief Execute the commands carried in the body of a server response.
+ *
+ * The body holds one command per line using the UART console syntax (e.g. "set report_interval 60").
+ * Empty lines and lines starting with '#' are ignored. Commands are executed through the
+ * UART command table, only the ones allowed remotely are accepted. Their output is collected
+ * and returned by RemoteCmd_GetResults() for the next upload.
+ *
+ * @param body The null terminated response body.
+ */
+void RemoteCmd_ProcessResponse(const char* body);
+
+/**
+ * @brief Get the URL-encoded results of the executed remote commands.
+ * @return Pointer to the encoded results or an empty string if there are none.
+ */
+const char* RemoteCmd_GetResults(void);
+
+/**
+ * @brief Confirm that the results returned by RemoteCmd_GetResults() were delivered.
+ *
+ * Clears the results and executes the deferred commands (e.g. restart) whose
+ * acknowledgement was part of the delivered upload.
+ */
+void RemoteCmd_ResultsSent(void);
+
+#endif // REMOTE_COMMANDS_H
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <api_os.h>
+#include <api_sms.h>
+
+#include "utils.h"
+#include "config_store.h"
+#include "sms_service.h"
+#include "sms_report.h"
+#include "track_simplify.h"
+#include "perf_stats.h"
+#include "debug.h"
+
+#define MODULE_TAG "SMS"
+
+// a report is decoded on its own, it must go out whole as one SMS
+#if SMS_REPORT_MAX_CHARS > SMS_REPLY_MAX_LEN
+#error "SMS_REPORT_MAX_CHARS does not fit in one queued SMS"
+#endif
+
+typedef struct {
+    uint32_t timestamp;
+    int32_t  latitude;    // 1e-5 degree
+    int32_t  longitude;   // 1e-5 degree
+    uint8_t  speed;       // km/h
+    uint8_t  course;      // 2 degree units
+} SmsReportFix_t;
+
+// ring buffer of the fixes waiting for the next SMS
+static SmsReportFix_t fixes[SMS_REPORT_MAX_FIXES];
+static uint8_t        fixes_head  = 0;   // index of the oldest fix
+static uint8_t        fixes_count = 0;
+static uint32_t       last_sent   = 0;
+// drops the sampled fixes the others describe within track_tolerance
+static TrackSimplify_t track = { 0 };
+
+static inline int32_t ToFixed(float degrees)
+{
+    float scaled = degrees * 100000.0f;
+    return (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+static const char base64url[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static void QueueFix(const TrackPoint_t* point)
+{
+    SmsReportFix_t* fix;
+    if (fixes_count == SMS_REPORT_MAX_FIXES) {
+        // queue full, overwrite the oldest fix
+        fix = &fixes[fixes_head];
+        fixes_head = (fixes_head + 1) % SMS_REPORT_MAX_FIXES;
+    } else {
+        fix = &fixes[(fixes_head + fixes_count) % SMS_REPORT_MAX_FIXES];
+        fixes_count++;
+    }
+
+    float speedKmh = point->speed * 1.852f;
+    float course = point->course < 0.0f ? 0.0f : point->course;
+
+    fix->timestamp = point->timestamp;
+    fix->latitude  = ToFixed(point->latitude);
+    fix->longitude = ToFixed(point->longitude);
+    fix->speed     = (speedKmh > 255.0f) ? 255 : (uint8_t)(speedKmh + 0.5f);
+    fix->course    = (uint8_t)(((uint32_t)(course + 1.0f) / 2) % 180);
+}
+
+void SmsReport_AddFix(uint32_t timestamp, float latitude, float longitude, float speedKnots, float course)
+{
+    TrackPoint_t point = { timestamp, latitude, longitude, speedKnots, course };
+    TrackPoint_t kept;
+    track.tolerance = g_ConfigStore.track_tolerance;
+    if (TrackSimplify_Add(&track, &point, &kept))
+        QueueFix(&kept);
+    else
+        Perf_Inc(PERF_TRACK_DROPPED);
+}
+
+void SmsReport_Reset(void)
+{
+    TrackSimplify_Reset(&track);
+    if (fixes_count)
+        LOGI("GPRS available, %d fixes not sent by SMS dropped", fixes_count);
+    fixes_head  = 0;
+    fixes_count = 0;
+}
+
+static int PutVarint(uint8_t* buf, int pos, int max, uint32_t value)
+{
+    do {
+        if (pos >= max) return -1;
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        buf[pos++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    return pos;
+}
+
+static inline uint32_t ZigZag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int PutUint32(uint8_t* buf, int pos, uint32_t value)
+{
+    buf[pos++] = value & 0xFF;
+    buf[pos++] = (value >> 8) & 0xFF;
+    buf[pos++] = (value >> 16) & 0xFF;
+    buf[pos++] = (value >> 24) & 0xFF;
+    return pos;
+}
+
+/**
+ * Encodes the oldest queued fixes into one SMS text, without removing them from the queue.
+ * @return number of encoded fixes
+ */
+static int SmsReport_Encode(char* text, uint8_t battery)
+{
+    uint8_t data[SMS_REPORT_MAX_BYTES];
+    int     len = 0;
+    int     count = 0;
+
+    if (fixes_count == 0) return 0;
+
+    const SmsReportFix_t* first = &fixes[fixes_head];
+    data[len++] = 0;          // number of fixes, set at the end
+    data[len++] = battery;
+    len = PutUint32(data, len, first->timestamp);
+    len = PutUint32(data, len, (uint32_t)first->latitude);
+    len = PutUint32(data, len, (uint32_t)first->longitude);
+    data[len++] = first->speed;
+    data[len++] = first->course;
+    count = 1;
+
+    while (count < fixes_count && count < SMS_REPORT_MAX_PER_SMS)
+    {
+        const SmsReportFix_t* prev = &fixes[(fixes_head + count - 1) % SMS_REPORT_MAX_FIXES];
+        const SmsReportFix_t* fix  = &fixes[(fixes_head + count) % SMS_REPORT_MAX_FIXES];
+
+        int pos = PutVarint(data, len, sizeof(data), fix->timestamp - prev->timestamp);
+        if (pos > 0) pos = PutVarint(data, pos, sizeof(data), ZigZag(fix->latitude  - prev->latitude));
+        if (pos > 0) pos = PutVarint(data, pos, sizeof(data), ZigZag(fix->longitude - prev->longitude));
+        if (pos < 0 || pos + 2 > (int)sizeof(data))
+            break;   // the fix does not fit, it goes to the next SMS
+        data[pos++] = fix->speed;
+        data[pos++] = fix->course;
+        len = pos;
+        count++;
+    }
+    data[0] = (uint8_t)count;
+
+    // base64url without padding
+    int out = 0;
+    strcpy(text, SMS_REPORT_PREFIX);
+    out = strlen(text);
+    for (int i = 0; i < len; i += 3) {
+        uint32_t chunk = (uint32_t)data[i] << 16;
+        if (i + 1 < len) chunk |= (uint32_t)data[i+1] << 8;
+        if (i + 2 < len) chunk |= data[i+2];
+        text[out++] = base64url[(chunk >> 18) & 0x3F];
+        text[out++] = base64url[(chunk >> 12) & 0x3F];
+        if (i + 1 < len) text[out++] = base64url[(chunk >> 6) & 0x3F];
+        if (i + 2 < len) text[out++] = base64url[chunk & 0x3F];
+    }
+    text[out] = '\0';
+    return count;
+}
+
+void SmsReport_Process(uint32_t now, uint8_t battery)
+{
+    if (g_ConfigStore.sms_report_number[0] == '\0')
+        return;
+    if (last_sent != 0 && now - last_sent < g_ConfigStore.sms_report_interval)
+        return;
+    // the SMS ends with the latest fix
+    TrackPoint_t kept;
+    if (TrackSimplify_Flush(&track, &kept))
+        QueueFix(&kept);
+    if (fixes_count == 0)
+        return;
+
+    char text[SMS_REPORT_MAX_CHARS + 1];
+    int  count = SmsReport_Encode(text, battery);
+    if (count == 0) return;
+
+    if (!Sms_QueueReply(g_ConfigStore.sms_report_number, text)) {
+        LOGE("SMS report not queued, will retry");
+        return;
+    }
+    LOGI("SMS report with %d of %d fixes queued (%d chars)", count, fixes_count, (int)strlen(text));
+    fixes_head   = (fixes_head + count) % SMS_REPORT_MAX_FIXES;
+    fixes_count -= count;
+    last_sent    = now;
+}
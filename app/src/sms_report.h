@@ -0,0 +1,57 @@
+#ifndef SMS_REPORT_H
+#define SMS_REPORT_H
+
+/**
+ * SMS fallback reports
+ *
+ * While the GPRS link is down fixes are sampled into a small queue and sent to
+ * sms_report_number every sms_report_interval seconds, several fixes per SMS.
+ *
+ * Message format: "T1" followed by base64url (no padding) encoded binary data:
+ *   byte  0      number of fixes in the message (1-15)
+ *   byte  1      battery level in percent
+ *   bytes 2-5    timestamp of the first fix, unix time, uint32 little endian
+ *   bytes 6-9    latitude of the first fix, 1e-5 degree, int32 little endian
+ *   bytes 10-13  longitude of the first fix, 1e-5 degree, int32 little endian
+ *   byte  14     speed, km/h (saturated at 255)
+ *   byte  15     course, 2 degree units
+ * followed by every next fix encoded as a delta to the previous one:
+ *   varint       seconds since the previous fix
+ *   varint       latitude difference, zigzag encoded, 1e-5 degree
+ *   varint       longitude difference, zigzag encoded, 1e-5 degree
+ *   byte         speed, km/h
+ *   byte         course, 2 degree units
+ * Fixes are ordered from the oldest to the newest. app/tool/sms_report_decode.py decodes the messages.
+ * Every report is queued as an SMS of its own, never joined with another report or alert,
+ * and its fixes are kept until the SMS service accepted it.
+ *
+ * The sampled fixes pass through a track simplifier (track_simplify.h): only those needed
+ * to rebuild the track within track_tolerance metres are queued, so the queue and every
+ * SMS cover a longer stretch of road. The newest fix is queued before each SMS.
+ */
+
+#define SMS_REPORT_PREFIX          "T1"
+#define SMS_REPORT_MAX_FIXES       32    // fixes kept while waiting for the next SMS
+#define SMS_REPORT_MAX_PER_SMS     15
+#define SMS_REPORT_MAX_CHARS       140
+#define SMS_REPORT_MAX_BYTES       (((SMS_REPORT_MAX_CHARS - sizeof(SMS_REPORT_PREFIX) + 1) * 6) / 8)
+
+/**
+ * @brief Add a fix to the SMS report queue, unless the track simplifier drops it.
+ * The oldest fix is dropped when the queue is full.
+ */
+void SmsReport_AddFix(uint32_t timestamp, float latitude, float longitude, float speedKnots, float course);
+
+/**
+ * @brief Send the queued fixes if the SMS report interval has elapsed.
+ * @param now     current unix time
+ * @param battery battery level in percent
+ */
+void SmsReport_Process(uint32_t now, uint8_t battery);
+
+/**
+ * @brief Drop the queued fixes, e.g. when the GPRS link is back.
+ */
+void SmsReport_Reset(void);
+
+#endif // SMS_REPORT_H
@@ -3,23 +3,280 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdarg.h>
 
 #include <api_os.h>
 #include <api_debug.h>
 #include <api_event.h>
 #include <api_sms.h>
 #include <api_hal_uart.h>
+#include <api_hal_pm.h>
 
 #include "system.h"
 #include "utils.h"
 #include "gps_parse.h"
 #include "gps_tracker.h"
 #include "config_store.h"
+#include "config_commands.h"
 #include "sms_service.h"
+#include "time_sync.h"
 #include "debug.h"
+#include "perf_stats.h"
+#include "task_profiler.h"
 
 #define MODULE_TAG "SMS"
 
+#define SMS_TASK_STACK_SIZE       (4096)   // runs the command handlers, like the console task
+#define SMS_TASK_PRIORITY         (1)
+#define SMS_TASK_NAME             "SMS Task"
+
+typedef void (*SmsCmdHandler)(char* args);
+
+static void SmsLocationCommand(char* args);
+static void SmsStatusCommand(char* args);
+static void SmsSetIntervalCommand(char* args);
+static void SmsTrackOnCommand(char* args);
+static void SmsTrackOffCommand(char* args);
+static void SmsSetCommand(char* args);
+static void SmsGetCommand(char* args);
+static void SmsHelpCommand(char* args);
+
+struct sms_cmd_entry {
+    const char*   cmd;
+    const int     cmd_len;
+    SmsCmdHandler handler;
+    const bool    privileged;   // requires the sender to be on the sms_whitelist
+    const char*   help;
+};
+
+/**
+ * SMS command table.
+ * Longer commands sharing a prefix with a shorter one (e.g. "set interval" and "set")
+ * must be listed first, the first matching entry is executed.
+ */
+static const struct sms_cmd_entry sms_cmd_table[] = {
+    {"get location", 12, SmsLocationCommand,    false, "get location"},
+    {"status",        6, SmsStatusCommand,      false, "status"},
+    {"help",          4, SmsHelpCommand,        false, "help"},
+    {"set interval", 12, SmsSetIntervalCommand, true,  "set interval <s>"},
+    {"track on",      8, SmsTrackOnCommand,     true,  "track on"},
+    {"track off",     9, SmsTrackOffCommand,    true,  "track off"},
+    {"set",           3, SmsSetCommand,         true,  "set <param> <value>"},
+    {"get",           3, SmsGetCommand,         true,  "get <param>"},
+};
+
+/**
+ * Command and reply queues.
+ * Received commands are executed and their replies sent by a dedicated task, so a burst
+ * of received SMS does not block the main event task on SMS_SendMessage, nor on the
+ * command mutex held by a long console command. Every message keeps its own queue entry,
+ * so a rate limited number delays its messages but never loses or merges them.
+ */
+typedef struct {
+    char phoneNumber[SMS_PHONE_NUMBER_MAX_LEN+1];
+    char text[SMS_BODY_MAX_LEN];
+} SmsCommand_t;
+
+typedef struct {
+    char phoneNumber[SMS_PHONE_NUMBER_MAX_LEN+1];
+    char text[SMS_REPLY_MAX_LEN+1];
+} SmsReply_t;
+
+static SmsCommand_t command_queue[SMS_COMMAND_QUEUE_SIZE];
+static uint8_t      command_count = 0;
+static SmsReply_t reply_queue[SMS_REPLY_QUEUE_SIZE];
+static uint8_t    reply_count = 0;
+static HANDLE     reply_mutex = 0;
+static HANDLE     reply_sem   = 0;
+static HANDLE     smsTaskHandle = 0;
+
+/**
+ * Time of the last reply sent to a number, used to limit the reply rate per number.
+ * The least recently used entry is replaced when the table is full.
+ */
+typedef struct {
+    char     phoneNumber[SMS_PHONE_NUMBER_MAX_LEN+1];
+    uint32_t lastReply;
+} SmsRate_t;
+
+static SmsRate_t rate_table[SMS_RATE_TABLE_SIZE];
+
+// reply built by the command handlers for the currently processed SMS
+static char sms_reply[SMS_REPLY_MAX_LEN+1];
+static int  sms_reply_len = 0;
+
+static int32_t SmsReplyPrintf(const char* fmt, ...)
+{
+    int space = (int)sizeof(sms_reply) - sms_reply_len;
+    if (space <= 1) return 0;
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(sms_reply + sms_reply_len, space, fmt, args);
+    va_end(args);
+
+    if (len < 0) return 0;
+    if (len >= space) len = space - 1;
+    sms_reply_len += len;
+    return len;
+}
+
+// Compares phone numbers on their last SMS_NUMBER_MATCH_DIGITS digits,
+// so the international (+48600100200) and national (600100200) forms match.
+static bool PhoneNumbersMatch(const char* a, int lenA, const char* b, int lenB)
+{
+    while (lenA > 0 && !isdigit((unsigned char)a[lenA-1])) lenA--;
+    while (lenB > 0 && !isdigit((unsigned char)b[lenB-1])) lenB--;
+    int n = SMS_NUMBER_MATCH_DIGITS;
+    if (lenA < n || lenB < n)
+        return (lenA == lenB) && (lenA > 0) && (strncmp(a, b, lenA) == 0);
+    return strncmp(a + lenA - n, b + lenB - n, n) == 0;
+}
+
+static bool IsAuthorisedNumber(const char* phoneNumber)
+{
+    const char* list = g_ConfigStore.sms_whitelist;
+    int phoneLen = strlen(phoneNumber);
+
+    while (*list) {
+        while (*list == ' ' || *list == ',') list++;
+        const char* end = list;
+        while (*end && *end != ',') end++;
+        int len = (int)(end - list);
+        while (len > 0 && list[len-1] == ' ') len--;
+        if (len > 0 && PhoneNumbersMatch(list, len, phoneNumber, phoneLen))
+            return true;
+        list = end;
+    }
+    return false;
+}
+
+static SmsRate_t* GetRateEntry(const char* phoneNumber)
+{
+    SmsRate_t* oldest = &rate_table[0];
+    for (int i = 0; i < SMS_RATE_TABLE_SIZE; ++i) {
+        if (strcmp(rate_table[i].phoneNumber, phoneNumber) == 0)
+            return &rate_table[i];
+        if (rate_table[i].lastReply < oldest->lastReply)
+            oldest = &rate_table[i];
+    }
+    strncpy(oldest->phoneNumber, phoneNumber, SMS_PHONE_NUMBER_MAX_LEN);
+    oldest->phoneNumber[SMS_PHONE_NUMBER_MAX_LEN] = '\0';
+    oldest->lastReply = 0;
+    return oldest;
+}
+
+bool Sms_QueueReply(const char* phoneNumber, const char* text)
+{
+    if (!phoneNumber || !*phoneNumber || !text || !reply_mutex) return false;
+
+    bool queued = false;
+    OS_LockMutex(reply_mutex);
+    if (reply_count < SMS_REPLY_QUEUE_SIZE) {
+        SmsReply_t* reply = &reply_queue[reply_count++];
+        strncpy(reply->phoneNumber, phoneNumber, SMS_PHONE_NUMBER_MAX_LEN);
+        reply->phoneNumber[SMS_PHONE_NUMBER_MAX_LEN] = '\0';
+        strncpy(reply->text, text, SMS_REPLY_MAX_LEN);
+        reply->text[SMS_REPLY_MAX_LEN] = '\0';
+        queued = true;
+    }
+    OS_UnlockMutex(reply_mutex);
+
+    if (!queued) {
+        LOGW("reply queue full, message to %s not queued", phoneNumber);
+        return false;
+    }
+    OS_ReleaseSemaphore(reply_sem);
+    return true;
+}
+
+/**
+ * Takes the first queued reply whose number is not rate limited.
+ * @param wait set to the milliseconds until a rate limited reply may go,
+ *             or OS_WAIT_FOREVER if none is left in the queue
+ * @return true if a reply was taken, false if nothing can be sent now
+ */
+static bool TakeReply(SmsReply_t* out, uint32_t now, uint32_t* wait)
+{
+    bool taken = false;
+    *wait = OS_WAIT_FOREVER;
+    OS_LockMutex(reply_mutex);
+    for (int i = 0; i < reply_count; ++i) {
+        SmsRate_t* rate = GetRateEntry(reply_queue[i].phoneNumber);
+        if (rate->lastReply != 0 && now - rate->lastReply < SMS_REPLY_MIN_INTERVAL_S) {
+            uint32_t left = (SMS_REPLY_MIN_INTERVAL_S - (now - rate->lastReply)) * 1000;
+            if (left < *wait) *wait = left;
+            continue;
+        }
+        *out = reply_queue[i];
+        memmove(&reply_queue[i], &reply_queue[i+1], (reply_count - i - 1) * sizeof(SmsReply_t));
+        reply_count--;
+        rate->lastReply = now;
+        taken = true;
+        break;
+    }
+    OS_UnlockMutex(reply_mutex);
+    return taken;
+}
+
+static bool QueueCommand(const char* phoneNumber, const char* text)
+{
+    if (!reply_mutex) return false;
+
+    bool queued = false;
+    OS_LockMutex(reply_mutex);
+    if (command_count < SMS_COMMAND_QUEUE_SIZE) {
+        SmsCommand_t* command = &command_queue[command_count++];
+        strncpy(command->phoneNumber, phoneNumber, SMS_PHONE_NUMBER_MAX_LEN);
+        command->phoneNumber[SMS_PHONE_NUMBER_MAX_LEN] = '\0';
+        strncpy(command->text, text, sizeof(command->text) - 1);
+        command->text[sizeof(command->text) - 1] = '\0';
+        queued = true;
+    }
+    OS_UnlockMutex(reply_mutex);
+    if (queued) OS_ReleaseSemaphore(reply_sem);
+    return queued;
+}
+
+static bool TakeCommand(SmsCommand_t* out)
+{
+    bool taken = false;
+    OS_LockMutex(reply_mutex);
+    if (command_count > 0) {
+        *out = command_queue[0];
+        memmove(&command_queue[0], &command_queue[1], (command_count - 1) * sizeof(SmsCommand_t));
+        command_count--;
+        taken = true;
+    }
+    OS_UnlockMutex(reply_mutex);
+    return taken;
+}
+
+static void ExecuteCommand(const char* phoneNumber, char* command);
+
+static void SmsTask(void* pData)
+{
+    static SmsCommand_t command;
+    static SmsReply_t reply;
+    int profilerSlot = Profiler_TaskStart();
+    uint32_t wait = OS_WAIT_FOREVER;
+
+    while (true)
+    {
+        // wake up on a new command or reply, or when a rate limited reply may go
+        OS_WaitForSemaphore(reply_sem, wait);
+        uint32_t start = Perf_Start();
+        while (TakeCommand(&command))
+            ExecuteCommand(command.phoneNumber, command.text);
+        while (TakeReply(&reply, TimeSync_Uptime(), &wait)) {
+            LOGI("Sending SMS to %s: %s", reply.phoneNumber, reply.text);
+            if (!SMS_SendMessage(reply.phoneNumber, (const uint8_t*)reply.text, strlen(reply.text), SIM0))
+                LOGE("sending SMS to %s failed", reply.phoneNumber);
+        }
+        Profiler_TaskBusy(profilerSlot, start);
+    }
+}
+
 void SmsInit()
 {
     if(!SMS_SetFormat(SMS_FORMAT_TEXT, SIM0))
@@ -46,6 +303,15 @@ void SmsInit()
         LOGE("sms set message storage fail");
         return;
     }
+
+    reply_mutex = OS_CreateMutex();
+    reply_sem   = OS_CreateSemaphore(0);
+    smsTaskHandle = OS_CreateTask(
+        SmsTask, NULL, NULL,
+        SMS_TASK_STACK_SIZE,
+        SMS_TASK_PRIORITY,
+        0, 0, SMS_TASK_NAME);
+    Profiler_TaskAdd(smsTaskHandle);
 }
 
 // Helper to get last known position as Google Maps link
@@ -62,6 +328,74 @@ static bool GetGoogleMapsLink(char* buf, size_t bufsize)
     return true;
 }
 
+static void SmsLocationCommand(char* args)
+{
+    char link[SMS_REPLY_MAX_LEN];
+    if (GetGoogleMapsLink(link, sizeof(link)))
+        SmsReplyPrintf("%s", link);
+    else
+        SmsReplyPrintf("Location not available");
+}
+
+static void SmsStatusCommand(char* args)
+{
+    uint8_t percent = 0;
+    PM_Voltage(&percent);
+    SmsReplyPrintf("GSM:%s GPS:%s fix:%s batt:%d%% int:%us track:%s",
+                   IS_GSM_ACTIVE() ? "on" : "off",
+                   IS_GPS_STATUS_ON() ? "on" : "off",
+                   gps_isValid() ? "yes" : "no",
+                   percent,
+                   (unsigned)g_ConfigStore.report_interval,
+                   g_ConfigStore.tracking ? "on" : "off");
+}
+
+static void SmsHelpCommand(char* args)
+{
+    for (unsigned i = 0; i < sizeof(sms_cmd_table)/sizeof(sms_cmd_table[0]); ++i)
+        SmsReplyPrintf("%s%s", i ? ", " : "", sms_cmd_table[i].help);
+}
+
+// Executes a configuration command through the UART command table
+static void SmsConfigCommand(const char* fmt, const char* args)
+{
+    char cmd[SMS_BODY_MAX_LEN + 16];
+    snprintf(cmd, sizeof(cmd), fmt, args);
+    if (HandleRemoteCommand(cmd, SmsReplyPrintf, false) != CMD_RESULT_OK)
+        SmsReplyPrintf("command failed");
+}
+
+static void SmsSetIntervalCommand(char* args)
+{
+    SmsConfigCommand("set " PARAM_REPORT_INTERVAL " %s", trim_whitespace(args));
+}
+
+static void SmsTrackOnCommand(char* args)
+{
+    SmsConfigCommand("set " PARAM_TRACKING " %s", "enabled");
+}
+
+static void SmsTrackOffCommand(char* args)
+{
+    SmsConfigCommand("set " PARAM_TRACKING " %s", "disabled");
+}
+
+static void SmsSetCommand(char* args)
+{
+    SmsConfigCommand("set %s", trim_whitespace(args));
+}
+
+static void SmsGetCommand(char* args)
+{
+    args = trim_whitespace(args);
+    if (!*args) {
+        // full configuration does not fit into a single SMS
+        SmsReplyPrintf("missing parameter");
+        return;
+    }
+    SmsConfigCommand("get %s", args);
+}
+
 void SmsReceivedCallback(SMS_Encode_Type_t encodeType,
                          const char* headerStr,
                          const char* contentStr,
@@ -80,7 +414,7 @@ void SmsReceivedCallback(SMS_Encode_Type_t encodeType,
         uint16_t cmdLen = 0;
         for (uint16_t i = 0; i < contentLen && cmdLen < sizeof(cmd)-1; i += 2) {
             // Check if it's ASCII character in Unicode format (high byte is 0)
-            if (i+1 < contentLen && contentStr[i] == 0) {
+            if (i+1 < (int)contentLen && contentStr[i] == 0) {
                 cmd[cmdLen++] = contentStr[i+1];
             }
         }
@@ -90,9 +424,9 @@ void SmsReceivedCallback(SMS_Encode_Type_t encodeType,
         return;
     }
     
-    trim_whitespace(cmd);
+    char* command = trim_whitespace(cmd);
     LOGI("SMS received header: %s, encodeType: %d, contentLength: %d", headerStr, encodeType, contentLen);
-    LOGI("SMS content (processed): '%s'", cmd);
+    LOGI("SMS content (processed): '%s'", command);
  
     // Parse phone number from header - it's enclosed in quotes and followed by a comma
     // Format example: "+1234567890","2023/06/08,11:22:33+00"
@@ -102,7 +436,7 @@ void SmsReceivedCallback(SMS_Encode_Type_t encodeType,
     bool insideQuotes = false;
     char phoneNumber[SMS_PHONE_NUMBER_MAX_LEN+1] = {0};
 
-    for (int i = 0; headerStr[i] != '\0' && phoneIdx < sizeof(phoneNumber) - 1; i++) {
+    for (int i = 0; headerStr[i] != '\0' && phoneIdx < (int)sizeof(phoneNumber) - 1; i++) {
         char c = headerStr[i];
         
         // Start collecting after finding the opening quote
@@ -137,24 +471,45 @@ void SmsReceivedCallback(SMS_Encode_Type_t encodeType,
         return;
     }
 
-    // parse command from SMS content
-    if (str_case_cmp(cmd, "get location") == 0) {
-        LOGI("Recognized 'get location' command from %s", phoneNumber);
-        SendLocationSms(phoneNumber);
-    } else {
-        LOGE("Unknown SMS command received: %s", cmd);
+    if (!QueueCommand(phoneNumber, command))
+        LOGE("command queue full, SMS from %s dropped", phoneNumber);
+}
+
+// Runs a received command on the SMS task and queues its reply
+static void ExecuteCommand(const char* phoneNumber, char* command)
+{
+    // an empty whitelist allows everyone to use the unprivileged commands
+    bool authorised = IsAuthorisedNumber(phoneNumber);
+    bool whitelistEmpty = (g_ConfigStore.sms_whitelist[0] == '\0');
+
+    for (unsigned i = 0; i < sizeof(sms_cmd_table)/sizeof(sms_cmd_table[0]); ++i) {
+        const struct sms_cmd_entry* entry = &sms_cmd_table[i];
+        int len = entry->cmd_len;
+        if (strnicmp(command, entry->cmd, len) != 0 || (command[len] != ' ' && command[len] != '\0'))
+            continue;
+
+        if (!authorised && (entry->privileged || !whitelistEmpty)) {
+            LOGE("SMS command '%s' from unauthorised number %s ignored", entry->cmd, phoneNumber);
+            return;
+        }
+
+        LOGI("Recognized '%s' command from %s", entry->cmd, phoneNumber);
+        sms_reply_len = 0;
+        sms_reply[0] = '\0';
+        entry->handler(command + len);
+
+        // replies coming from the UART handlers end with a new line
+        sms_reply[sms_reply_len] = '\0';
+        Sms_QueueReply(phoneNumber, trim_whitespace(sms_reply));
+        return;
     }
+    LOGE("Unknown SMS command received: %s", command);
 }
 
 void SendLocationSms(const char* phoneNumber)
 {
-    char msg[SMS_BODY_MAX_LEN];
-    if (GetGoogleMapsLink(msg, sizeof(msg))) {
-        LOGI("Sending location SMS to %s: %s", phoneNumber, msg);
-        SMS_SendMessage(phoneNumber, (const uint8_t*)msg, strlen(msg), SIM0);
-    } else {
-        const char* err = "Location not available";
-        LOGI("Sending error SMS to %s: %s", phoneNumber, err);
-        SMS_SendMessage(phoneNumber, (const uint8_t*)err, strlen(err), SIM0);
-    }
+    char msg[SMS_REPLY_MAX_LEN];
+    if (!GetGoogleMapsLink(msg, sizeof(msg)))
+        snprintf(msg, sizeof(msg), "Location not available");
+    Sms_QueueReply(phoneNumber, msg);
 }
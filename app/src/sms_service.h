@@ -1,15 +1,31 @@
 #ifndef SMS_SERVICE_H
 #define SMS_SERVICE_H
 
+#define SMS_REPLY_MAX_LEN          140   // single 8-bit SMS
+#define SMS_REPLY_QUEUE_SIZE       8     // messages waiting to be sent
+#define SMS_COMMAND_QUEUE_SIZE     4     // received commands waiting for the SMS task
+#define SMS_RATE_TABLE_SIZE        8     // numbers remembered by the rate limiter
+#define SMS_REPLY_MIN_INTERVAL_S   30    // minimum time between two replies to the same number
+#define SMS_NUMBER_MATCH_DIGITS    9     // trailing digits compared when checking the whitelist
+
+// Initializes SMS format and storage and starts the task running the commands and sending the replies
 void SmsInit();
 // Callback for SMS reception
 // This function will be called when an SMS is received
 // it parses the SMS header and content,
-// extracts the phone number and command, and processes it accordingly.
+// extracts the phone number and command, and queues the command for the SMS task.
+// Privileged commands (changing the configuration) are accepted only from numbers
+// listed in the sms_whitelist parameter.
 void SmsReceivedCallback(SMS_Encode_Type_t encodeType,
                          const char* headerStr,
                          const char* contentStr,
                          uint32_t    contentLen);
+
+// Queue a text message to be sent by the SMS task as an SMS of its own.
+// Messages to the same number are sent in order, at most one every
+// SMS_REPLY_MIN_INTERVAL_S seconds.
+// Returns false if the queue is full; the caller keeps its data and retries later.
+bool Sms_QueueReply(const char* phoneNumber, const char* text);
                          
 // Forward declaration for sending location SMS
 void SendLocationSms(const char* phoneNumber);
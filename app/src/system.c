@@ -4,6 +4,7 @@
 #include <api_event.h>
 #include <api_hal_uart.h>
 #include <api_hal_pm.h>
+#include <api_sys.h>
 
 #include "gps.h"
 #include "gps_parse.h"
@@ -13,10 +14,18 @@
 #include "network.h"
 #include "led_handler.h"
 #include "gps_tracker.h"
+#include "geofence.h"
+#include "trip.h"
+#include "time_sync.h"
+#include "lbs_cache.h"
+#include "link_manager.h"
 #include "sms_service.h"
 #include "config_store.h"
 #include "config_commands.h"
+#include "console.h"
 #include "debug.h"
+#include "perf_stats.h"
+#include "task_profiler.h"
 
 #define MODULE_TAG "System"
 
@@ -24,14 +33,30 @@
 #define MAIN_TASK_PRIORITY        (0)
 #define MAIN_TASK_NAME            "GPS Tracker"
 
-#define TRACKER_TASK_STACK_SIZE   (4096 * 2)
-#define TRACKER_TASK_PRIORITY     (0)
-#define TRACKER_TASK_NAME         "Reporting Task"
-
 HANDLE  trackerTaskHandle = NULL;
 HANDLE  appMainTaskHandle = NULL;
 
-uint8_t systemStatus = 0;
+volatile uint32_t systemStatus = 0;
+
+static void UpdateStatus(uint32_t flags, bool on)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    uint32_t old = systemStatus;
+    systemStatus = on ? (old | flags) : (old & ~flags);
+    bool changed = (systemStatus != old);
+    SYS_ExitCriticalSection(status);
+    if (changed) Tracker_Notify(TRACKER_EVENT_STATUS);
+}
+
+void System_SetStatus(StatusFlags flags)
+{
+    UpdateStatus(flags, true);
+}
+
+void System_ClearStatus(StatusFlags flags)
+{
+    UpdateStatus(flags, false);
+}
 
 static void EventHandler(API_Event_t* pEvent)
 {
@@ -78,22 +103,23 @@ static void EventHandler(API_Event_t* pEvent)
             SmsListMessageCallback(msg);
             break;
         }
-        case API_EVENT_ID_GPS_UART_RECEIVED:
+        case API_EVENT_ID_GPS_UART_RECEIVED: {
             if (g_ConfigStore.gps_logging)
                 LOGD("received GPS data, length:%d, data:\r\n%s",pEvent->param1,pEvent->pParam1);
             GPS_STATUS_ON();
+            uint32_t start = Perf_Start();
             GPS_Update(pEvent->pParam1, pEvent->param1);
             gps_Process();
+            Tracker_Notify(TRACKER_EVENT_FIX);
+            Perf_Record(PERF_HIST_GPS_US, Perf_ElapsedUs(start));
+            Perf_Inc(PERF_GPS_EVENTS);
             break;
+        }
         
         case API_EVENT_ID_UART_RECEIVED:
+            // commands are assembled and executed by the console task
             if(pEvent->param1 == UART1)
-            {
-                uint8_t data[(pEvent->param2 + 1)];
-                data[pEvent->param2] = 0;
-                memcpy(data, pEvent->pParam1, pEvent->param2);
-                HandleUartCommand(data);
-            }
+                Console_RxData(pEvent->pParam1, pEvent->param2);
             break;
         default:
             break;
@@ -102,6 +128,8 @@ static void EventHandler(API_Event_t* pEvent)
 
 void app_MainTask(void *pData)
 {
+    int profilerSlot = Profiler_TaskStart();
+
     // UART1 to print user logs
     UART_Config_t config = {
         .baudRate = UART_BAUD_RATE_115200,
@@ -119,9 +147,16 @@ void app_MainTask(void *pData)
     NetworkInit(appMainTaskHandle);
     LED_init(appMainTaskHandle);
     TIME_SetIsAutoUpdateRtcTime(true);
+    TimeSync_Init();
     ConfigStore_Init();
+    CommandsInit();
+    Console_Init();
     FsInfoTest();    
     gps_Init();
+    Geofence_Init();
+    Trip_Init();
+    LbsCache_Init();
+    Link_Init();
     SmsInit();
 
     trackerTaskHandle = OS_CreateTask(
@@ -129,6 +164,7 @@ void app_MainTask(void *pData)
         TRACKER_TASK_STACK_SIZE,
         TRACKER_TASK_PRIORITY, 
         0, 0, TRACKER_TASK_NAME);
+    Profiler_TaskAdd(trackerTaskHandle);
     
     // Dispatch loop
     while(true)
@@ -137,10 +173,12 @@ void app_MainTask(void *pData)
 
         if(OS_WaitEvent(appMainTaskHandle, (void**)&event, OS_TIME_OUT_WAIT_FOREVER))
         {
+            uint32_t start = Perf_Start();
             EventHandler(event);
             OS_Free(event->pParam1);
             OS_Free(event->pParam2);
             OS_Free(event);
+            Profiler_TaskBusy(profilerSlot, start);
             OS_Sleep(1); // Yield to other tasks
         }
     }
@@ -153,6 +191,7 @@ void app_Main(void)
         MAIN_TASK_STACK_SIZE, 
         MAIN_TASK_PRIORITY,
         0, 0, MAIN_TASK_NAME);
+    Profiler_TaskAdd(appMainTaskHandle);
 
     OS_SetUserMainHandle(&appMainTaskHandle);
 }
\ No newline at end of file
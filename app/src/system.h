@@ -18,32 +18,43 @@ typedef enum {
     STATUS_SLEEPING       = 1 << 4
 } StatusFlags;
 
+/**
+ * The flags are set from SDK callbacks and several tasks: System_SetStatus() and
+ * System_ClearStatus() update them inside a critical section, and a change wakes
+ * the tracker task (TRACKER_EVENT_STATUS). Reading the word needs no lock.
+ */
+void System_SetStatus(StatusFlags flags);
+void System_ClearStatus(StatusFlags flags);
+
 // Initialized
-#define INITIALIZED_ON()   (systemStatus |= STATUS_INITIALIZED)
-#define INITIALIZED_OFF()  (systemStatus &= ~STATUS_INITIALIZED)
+#define INITIALIZED_ON()   System_SetStatus(STATUS_INITIALIZED)
+#define INITIALIZED_OFF()  System_ClearStatus(STATUS_INITIALIZED)
 #define IS_INITIALIZED()   (systemStatus & STATUS_INITIALIZED)
 
 // GPS
-#define GPS_STATUS_ON()    (systemStatus |= STATUS_GPS_ON)
-#define GPS_STATUS_OFF()   (systemStatus &= ~STATUS_GPS_ON)
+#define GPS_STATUS_ON()    System_SetStatus(STATUS_GPS_ON)
+#define GPS_STATUS_OFF()   System_ClearStatus(STATUS_GPS_ON)
 #define IS_GPS_STATUS_ON() (systemStatus & STATUS_GPS_ON)
 
 // GSM Active
-#define GSM_ACTIVE_ON()    (systemStatus |= STATUS_GSM_ACTIVE)
-#define GSM_ACTIVE_OFF()   (systemStatus &= ~STATUS_GSM_ACTIVE)
+#define GSM_ACTIVE_ON()    System_SetStatus(STATUS_GSM_ACTIVE)
+#define GSM_ACTIVE_OFF()   System_ClearStatus(STATUS_GSM_ACTIVE)
 #define IS_GSM_ACTIVE()    (systemStatus & STATUS_GSM_ACTIVE)
 
 // GSM Registered
-#define GSM_REGISTERED_ON()   (systemStatus |= STATUS_GSM_REGISTERED)
-#define GSM_REGISTERED_OFF()  (systemStatus &= ~STATUS_GSM_REGISTERED)
+#define GSM_REGISTERED_ON()   System_SetStatus(STATUS_GSM_REGISTERED)
+#define GSM_REGISTERED_OFF()  System_ClearStatus(STATUS_GSM_REGISTERED)
 #define IS_GSM_REGISTERED()   (systemStatus & STATUS_GSM_REGISTERED)
 
 // Sleeping
-#define SLEEPING_ON()      (systemStatus |= STATUS_SLEEPING)
-#define SLEEPING_OFF()     (systemStatus &= ~STATUS_SLEEPING)
+#define SLEEPING_ON()      System_SetStatus(STATUS_SLEEPING)
+#define SLEEPING_OFF()     System_ClearStatus(STATUS_SLEEPING)
 #define IS_SLEEPING()      (systemStatus & STATUS_SLEEPING)
 
 // The actual bitfield variable
-extern uint8_t systemStatus;
+extern volatile uint32_t systemStatus;
+
+// The tracker task, woken by Tracker_Notify()
+extern HANDLE trackerTaskHandle;
 
 #endif
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <api_os.h>
+#include <api_sys.h>
+
+#include "utils.h"
+#include "time_sync.h"
+#include "task_profiler.h"
+
+// the words just below the caller's frame are left alone, they belong to the paint loop
+#define PROFILER_PAINT_GAP        256
+
+typedef struct {
+    HANDLE      handle;
+    const char* name;
+    uint32_t    stackBytes;
+    uint8_t*    stackLow;       // lowest word of the stack
+    uint8_t*    entry;          // frame of Profiler_TaskStart(), just below the task entry function
+    uint32_t*   paintLow;       // lowest painted word
+    uint32_t*   paintHigh;      // one above the highest painted word
+    uint32_t    busyMs;         // whole seconds, in ms
+    uint32_t    busyRest;       // clock ticks of the last partial second
+    uint32_t    wakeups;
+} ProfilerTask_t;
+
+static ProfilerTask_t tasks[PROFILER_MAX_TASKS];
+static int            task_count   = 0;
+// start of the measurement window, TimeSync_UptimeMs()
+static uint64_t       window_start = 0;
+
+static inline uint32_t TicksToMs(uint32_t ticks)
+{
+    return (ticks * 1000) >> 14;
+}
+
+/**
+ * Paints from PROFILER_PAINT_GAP bytes below this function's frame down to the bottom
+ * of the stack. Not inlined, so its frame lies below the caller's.
+ */
+static __attribute__((noinline)) void PaintStack(ProfilerTask_t* t)
+{
+    uint32_t* low  = (uint32_t*)t->stackLow;
+    uint32_t* high = (uint32_t*)((uint8_t*)__builtin_frame_address(0) - PROFILER_PAINT_GAP);
+    if (high <= low) return;
+    for (volatile uint32_t* p = low; p < high; ++p)
+        *p = PROFILER_STACK_PATTERN;
+    t->paintLow  = low;
+    t->paintHigh = high;
+}
+
+bool Profiler_TaskAdd(HANDLE task)
+{
+    OS_Task_Info_t info;
+    if (!task || !OS_GetTaskInfo(task, &info)) return false;
+
+    uint32_t status = SYS_EnterCriticalSection();
+    int slot = task_count < PROFILER_MAX_TASKS ? task_count : -1;
+    if (slot >= 0) {
+        ProfilerTask_t* t = &tasks[slot];
+        t->name       = info.name;
+        t->stackBytes = (uint32_t)info.stackSize * sizeof(uint32_t);
+        // stackTop is the initial stack pointer, the stack grows down from it; were it the
+        // other end, FindTask() would not match the task's frame and nothing is painted
+        t->stackLow   = (uint8_t*)(unsigned long)info.stackTop - t->stackBytes;
+        t->handle     = task;
+        if (slot == 0) window_start = TimeSync_UptimeMs();
+        task_count++;
+    }
+    SYS_ExitCriticalSection(status);
+    return slot >= 0;
+}
+
+// slot of the registered task whose stack holds the address
+static int FindTask(const uint8_t* frame)
+{
+    int found = -1;
+    uint32_t status = SYS_EnterCriticalSection();
+    for (int i = 0; i < task_count; ++i) {
+        if (frame >= tasks[i].stackLow && frame < tasks[i].stackLow + tasks[i].stackBytes) {
+            found = i;
+            break;
+        }
+    }
+    SYS_ExitCriticalSection(status);
+    return found;
+}
+
+int Profiler_TaskStart(void)
+{
+    uint8_t* entry = (uint8_t*)__builtin_frame_address(0);
+    // a task may run before OS_CreateTask() returned its handle to the creator
+    int slot = FindTask(entry);
+    for (int waited = 0; slot < 0 && waited < PROFILER_START_WAIT_MS; waited += 10) {
+        OS_Sleep(10);
+        slot = FindTask(entry);
+    }
+    if (slot < 0) return -1;
+
+    ProfilerTask_t* t = &tasks[slot];
+    t->entry = entry;
+    PaintStack(t);
+    return slot;
+}
+
+void Profiler_TaskBusy(int slot, uint32_t start)
+{
+    if (slot < 0 || slot >= PROFILER_MAX_TASKS) return;
+    ProfilerTask_t* t = &tasks[slot];
+    uint32_t ticks = (uint32_t)clock() - start;
+
+    uint32_t status = SYS_EnterCriticalSection();
+    t->busyRest += ticks;
+    t->busyMs   += (t->busyRest >> 14) * 1000;
+    t->busyRest &= 0x3FFF;
+    t->wakeups++;
+    SYS_ExitCriticalSection(status);
+}
+
+/**
+ * @return bytes of the painted area that were never written, the deepest written
+ *         address in *deepest (NULL if the whole area is intact)
+ */
+static uint32_t StackUntouched(const ProfilerTask_t* t, uint32_t** deepest)
+{
+    *deepest = NULL;
+    if (!t->paintLow) return 0;
+    const volatile uint32_t* p = t->paintLow;
+    while (p < t->paintHigh && *p == PROFILER_STACK_PATTERN) ++p;
+    if (p < t->paintHigh) *deepest = (uint32_t*)p;
+    return (uint32_t)((const uint8_t*)p - (const uint8_t*)t->paintLow);
+}
+
+void Profiler_Print(CmdOutputFunc output)
+{
+    uint32_t window = (uint32_t)(TimeSync_UptimeMs() - window_start);
+
+    output("%-16s %7s %7s %7s %9s %6s %8s\r\n", "task", "stack", "depth", "free", "busy ms", "busy%", "wakeups");
+    for (int i = 0; i < task_count && i < PROFILER_MAX_TASKS; ++i) {
+        const ProfilerTask_t* t = &tasks[i];
+        if (!t->entry) continue;    // registered, not started yet
+        uint32_t* deepest;
+        uint32_t  untouched = StackUntouched(t, &deepest);
+        // depth below the entry function; the painted gap counts when nothing below it was used
+        uint32_t  depth = (uint32_t)(t->entry - (const uint8_t*)(deepest ? deepest : t->paintHigh));
+        uint32_t  busy  = t->busyMs + TicksToMs(t->busyRest);
+        output("%-16.16s %7u %7u %7u %9u %5u%% %8u\r\n", t->name, t->stackBytes,
+               t->paintLow ? depth : 0, untouched, busy,
+               window ? (uint32_t)((uint64_t)busy * 100 / window) : 0, t->wakeups);
+    }
+
+    OS_Heap_Status_t heap;
+    if (OS_GetHeapUsageStatus(&heap))
+        output("heap: %u of %u bytes used\r\n", heap.usedSize, heap.totalSize);
+    output("window: %u ms\r\n", window);
+}
+
+void Profiler_Reset(void)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    for (int i = 0; i < task_count && i < PROFILER_MAX_TASKS; ++i) {
+        tasks[i].busyMs = 0;
+        tasks[i].busyRest = 0;
+        tasks[i].wakeups = 0;
+    }
+    window_start = TimeSync_UptimeMs();
+    SYS_ExitCriticalSection(status);
+}
@@ -0,0 +1,54 @@
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include "config_commands.h"
+
+/**
+ * Per-task stack and activity profiler
+ *
+ * The creator of a task registers it with Profiler_TaskAdd() right after OS_CreateTask(),
+ * which reads the stack bounds from OS_GetTaskInfo(). The task calls Profiler_TaskStart()
+ * first thing in its entry function: the unused part of its stack, down to the last word,
+ * is painted with PROFILER_STACK_PATTERN, and the deepest overwritten word gives the stack
+ * high-water mark, so stack sizes can be trimmed from field data and an overflow shows
+ * as 0 free.
+ *
+ * The task reports the time it spends awake with Profiler_TaskBusy(): from waking up on an
+ * event, semaphore or sleep until it waits again. Blocking calls in between (a TCP connect,
+ * an SMS send) count as busy, so this is the share of time the task is not available for
+ * new work rather than pure CPU time (the host simulator's "tasks" command shows that).
+ */
+
+#define PROFILER_MAX_TASKS        8
+#define PROFILER_STACK_PATTERN    0xA5A5A5A5
+#define PROFILER_START_WAIT_MS    100
+
+/**
+ * @brief Register a task just created, called by its creator.
+ * @return false if the table is full or the SDK does not know the task
+ */
+bool Profiler_TaskAdd(HANDLE task);
+
+/**
+ * @brief Paint the unused stack of the calling task, called first thing in its entry function.
+ * Waits up to PROFILER_START_WAIT_MS for the creator to register the task.
+ * @return slot for Profiler_TaskBusy(), -1 if the task was not registered
+ */
+int  Profiler_TaskStart(void);
+
+/**
+ * @brief Account the time since start (a Perf_Start() value) as busy time of the task.
+ */
+void Profiler_TaskBusy(int slot, uint32_t start);
+
+/**
+ * @brief Print stack use and busy time of every registered task and the heap use.
+ */
+void Profiler_Print(CmdOutputFunc output);
+
+/**
+ * @brief Restart the busy time measurement. Stack high-water marks are kept.
+ */
+void Profiler_Reset(void);
+
+#endif // TASK_PROFILER_H
@@ -0,0 +1,226 @@
+#include <string.h>
+#include <stdio.h>
+
+#include <api_os.h>
+#include <api_sys.h>
+#include <api_inc_time.h>
+#include <ntp.h>
+
+#include "utils.h"
+#include "config_store.h"
+#include "time_sync.h"
+#include "debug.h"
+
+#define MODULE_TAG "Time"
+
+static uint64_t ticks      = 0;     // clock() ticks since boot, 16384 Hz
+static uint32_t tickLast   = 0;
+static int64_t  offset     = 0;     // UTC ms - tick ms
+static bool     offsetSet  = false;
+static uint64_t handedOut  = 0;     // the latest time returned
+static uint8_t  source     = TIME_SOURCE_RTC;
+
+static uint32_t gpsUptime  = 0;     // of the last GPS sample
+static uint32_t gpsSamples = 0;
+static uint32_t ntpUptime  = 0;     // of the last NTP answer
+static uint32_t ntpAttempt = 0;
+static uint32_t ntpDelay   = 0;     // ms
+static uint32_t steps      = 0;
+static int64_t  lastStep   = 0;     // ms
+
+// clock() wraps after 3 days, the ticks between two calls accumulate
+uint64_t TimeSync_UptimeMs(void)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    uint32_t now = (uint32_t)clock();
+    ticks += now - tickLast;
+    tickLast = now;
+    uint64_t ms = ticks * 125 >> 11;    // * 1000 / 16384
+    SYS_ExitCriticalSection(status);
+    return ms;
+}
+
+// UTC ms - tick ms of the module RTC
+static bool RtcOffset(int64_t* measured)
+{
+    RTC_Time_t rtc;
+    if (!TIME_GetRtcTime(&rtc)) return false;
+    *measured = (int64_t)rtc_to_time(&rtc) * 1000 - (int64_t)TimeSync_UptimeMs();
+    return true;
+}
+
+static void SetFromRtc(void)
+{
+    int64_t measured;
+    if (!RtcOffset(&measured)) return;
+    uint32_t status = SYS_EnterCriticalSection();
+    if (!offsetSet) {
+        offset = measured;
+        offsetSet = true;
+    }
+    SYS_ExitCriticalSection(status);
+}
+
+void TimeSync_Init(void)
+{
+    SetFromRtc();
+}
+
+uint64_t TimeSync_NowMs(void)
+{
+    if (!offsetSet) SetFromRtc();
+    uint64_t tick = TimeSync_UptimeMs();
+    uint32_t status = SYS_EnterCriticalSection();
+    uint64_t now = (uint64_t)((int64_t)tick + offset);
+    if (now < handedOut) now = handedOut;
+    handedOut = now;
+    SYS_ExitCriticalSection(status);
+    return now;
+}
+
+uint32_t TimeSync_Now(void)
+{
+    return (uint32_t)(TimeSync_NowMs() / 1000);
+}
+
+uint32_t TimeSync_Uptime(void)
+{
+    return (uint32_t)(TimeSync_UptimeMs() / 1000);
+}
+
+Time_Source_t TimeSync_GetSource(void)
+{
+    return (Time_Source_t)source;
+}
+
+// sets the module RTC when it is off; not under the critical section
+static void SyncRtc(void)
+{
+    RTC_Time_t rtc;
+    if (!TIME_GetRtcTime(&rtc)) return;
+    uint32_t now = TimeSync_Now();
+    int32_t  off = (int32_t)(rtc_to_time(&rtc) - now);
+    if (off > -TIME_RTC_TOLERANCE && off < TIME_RTC_TOLERANCE) return;
+
+    int8_t zone = rtc.timeZone, zoneMinutes = rtc.timeZoneMinutes;
+    time_to_rtc(now, &rtc);
+    rtc.timeZone = zone;
+    rtc.timeZoneMinutes = zoneMinutes;
+    if (TIME_SetRtcTime(&rtc))
+        LOGI("RTC was %d s off, set to %04u-%02u-%02u %02u:%02u:%02u", (int)off, rtc.year, rtc.month,
+             rtc.day, rtc.hour, rtc.minute, rtc.second);
+    else
+        LOGE("RTC update failed");
+}
+
+// "-12.345 s"; steps can be larger than an int32 of ms
+static void FormatStep(int64_t ms, char* buffer, size_t size)
+{
+    uint64_t magnitude = ms < 0 ? (uint64_t)-ms : (uint64_t)ms;
+    snprintf(buffer, size, "%s%u.%03u s", ms < 0 ? "-" : "", (unsigned)(magnitude / 1000),
+             (unsigned)(magnitude % 1000));
+}
+
+/**
+ * Applies a measured offset; a first measurement of the source, or one that is off by
+ * more than TIME_STEP_LIMIT, steps the clock. Returns true if it stepped, by *error ms.
+ */
+static bool Correct(int64_t measured, Time_Source_t from, int shiftUp, int shiftDown, int64_t* error)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    int64_t diff = measured - offset;
+    bool step = !offsetSet || source < from || diff > TIME_STEP_LIMIT || diff < -TIME_STEP_LIMIT;
+    if (step) {
+        offset = measured;
+        offsetSet = true;
+        steps++;
+        lastStep = diff;
+        if (diff < -TIME_HOLD_LIMIT) handedOut = 0;
+    } else if (diff > 0) {
+        offset += (diff + (1 << shiftUp) - 1) >> shiftUp;
+    } else {
+        offset += diff >> shiftDown;
+    }
+    source = from;
+    SYS_ExitCriticalSection(status);
+    *error = diff;
+    return step;
+}
+
+void TimeSync_GpsSample(uint64_t utcMs)
+{
+    int64_t error;
+    int64_t measured = (int64_t)utcMs - (int64_t)TimeSync_UptimeMs();
+    bool stepped = Correct(measured, TIME_SOURCE_GPS, 1, 4, &error);
+    gpsUptime = TimeSync_Uptime();
+    gpsSamples++;
+    if (stepped) {
+        char step[24];
+        FormatStep(error, step, sizeof(step));
+        LOGI("Clock stepped by %s to the GPS time", step);
+        SyncRtc();
+    }
+}
+
+bool TimeSync_Poll(void)
+{
+    int64_t  measured, error;
+    char     step[24];
+    uint32_t uptime = TimeSync_Uptime();
+
+    // the network sets the RTC when it attaches
+    if (source == TIME_SOURCE_RTC && RtcOffset(&measured) && Correct(measured, TIME_SOURCE_RTC, 1, 1, &error)) {
+        FormatStep(error, step, sizeof(step));
+        LOGI("Clock stepped by %s to the network time", step);
+    }
+
+    if (!g_ConfigStore.ntp_server[0]) return false;
+    if (source == TIME_SOURCE_GPS && uptime - gpsUptime < TIME_GPS_HOLDOVER) return false;
+    if (ntpUptime && uptime - ntpUptime < TIME_NTP_INTERVAL) return false;
+    if (ntpAttempt && uptime - ntpAttempt < TIME_NTP_RETRY) return false;
+    ntpAttempt = uptime;
+
+    uint32_t delay;
+    int ret = NTP_GetOffset(g_ConfigStore.ntp_server, TIME_NTP_TIMEOUT, TimeSync_UptimeMs, &measured, &delay);
+    if (ret != 0) {
+        LOGW("NTP %s failed: %d", g_ConfigStore.ntp_server, ret);
+        return false;
+    }
+    // the GPS may have come back meanwhile
+    if (source == TIME_SOURCE_GPS && TimeSync_Uptime() - gpsUptime < TIME_GPS_HOLDOVER) return false;
+
+    ntpUptime = TimeSync_Uptime();
+    ntpDelay  = delay;
+    if (Correct(measured, TIME_SOURCE_NTP, 1, 1, &error)) {
+        FormatStep(error, step, sizeof(step));
+        LOGI("Clock stepped by %s to NTP %s, delay %u ms", step, g_ConfigStore.ntp_server, (unsigned)delay);
+    }
+    SyncRtc();
+    return true;
+}
+
+void TimeSync_Format(uint64_t ms, char* buffer, size_t size)
+{
+    uint32_t second = (uint32_t)(ms / 1000 % 86400);
+    snprintf(buffer, size, "%02u:%02u:%02u.%03u", (unsigned)(second / 3600), (unsigned)(second / 60 % 60),
+             (unsigned)(second % 60), (unsigned)(ms % 1000));
+}
+
+void TimeSync_Print(CmdOutputFunc output)
+{
+    static const char* const sources[] = {"rtc", "ntp", "gps"};
+    uint64_t now = TimeSync_NowMs();
+    uint32_t uptime = TimeSync_Uptime();
+    RTC_Time_t utc;
+    time_to_rtc((uint32_t)(now / 1000), &utc);
+    output("Time: %04u-%02u-%02u %02u:%02u:%02u.%03u UTC, from %s\r\n", utc.year, utc.month, utc.day,
+           utc.hour, utc.minute, utc.second, (unsigned)(now % 1000), sources[source]);
+    if (gpsSamples)
+        output("GPS: %u samples, last %u s ago\r\n", (unsigned)gpsSamples, (unsigned)(uptime - gpsUptime));
+    if (ntpUptime)
+        output("NTP: %s, %u s ago, delay %u ms\r\n", g_ConfigStore.ntp_server, (unsigned)(uptime - ntpUptime),
+               (unsigned)ntpDelay);
+    char step[24];
+    FormatStep(lastStep, step, sizeof(step));
+    output("Steps: %u, last %s; uptime %u s\r\n", (unsigned)steps, step, (unsigned)uptime);
+}
@@ -0,0 +1,106 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "config_commands.h"
+
+/**
+ * System time (config ntp_server).
+ *
+ * A millisecond UTC clock for the report and log timestamps: the tick counter (clock(),
+ * 16384 Hz, extended to 64 bits) plus an offset. Until a better source is known the
+ * offset comes from the module RTC (network time, whole seconds).
+ *
+ * The GPS disciplines it: every new epoch gives the UTC time of the fix with its fraction
+ * (TimeSync_GpsSample()). The NMEA sentences arrive some tens of ms after the epoch, more
+ * when the UART is busy, so a sample that shows less delay than the offset is taken at
+ * half and one that shows more only moves it by 1/16: the offset follows the fastest
+ * arrivals and the crystal drift without the jitter.
+ *
+ * Without a GPS time for TIME_GPS_HOLDOVER seconds, one SNTP exchange with ntp_server every
+ * TIME_NTP_INTERVAL seconds while GPRS is up keeps it (TimeSync_Poll(), blocking for up
+ * to TIME_NTP_TIMEOUT seconds). Until then the RTC is followed: the network sets it when
+ * it attaches.
+ *
+ * A correction of more than TIME_STEP_LIMIT ms steps the clock. The time handed out does
+ * not go back: after a step back of up to TIME_HOLD_LIMIT ms it stands still until the
+ * clock catches up, so the timestamps of queued reports and logs keep their order; a
+ * larger one replaces a wrong time and goes back. The module RTC is set when it
+ * is TIME_RTC_TOLERANCE seconds or more off.
+ *
+ * Intervals are measured with TimeSync_Uptime() and TimeSync_UptimeMs(), which no time
+ * step moves; they are the firmware's only extension of clock() beyond its wrap.
+ */
+
+#define TIME_STEP_LIMIT           1000    // ms
+#define TIME_HOLD_LIMIT           10000   // ms
+#define TIME_GPS_HOLDOVER         600     // s
+#define TIME_NTP_INTERVAL         3600    // s
+#define TIME_NTP_RETRY            300     // s
+#define TIME_NTP_TIMEOUT          5       // s
+#define TIME_RTC_TOLERANCE        2       // s
+
+typedef enum {
+    TIME_SOURCE_RTC = 0,
+    TIME_SOURCE_NTP,
+    TIME_SOURCE_GPS,
+} Time_Source_t;
+
+/**
+ * @brief Take the time from the module RTC.
+ */
+void TimeSync_Init(void);
+
+/**
+ * @brief UTC in ms since 1970; not less than the value returned before, but after a step
+ *        back of more than TIME_HOLD_LIMIT ms.
+ */
+uint64_t TimeSync_NowMs(void);
+
+/**
+ * @brief UTC in seconds since 1970, as TimeSync_NowMs().
+ */
+uint32_t TimeSync_Now(void);
+
+/**
+ * @brief Seconds since boot, for intervals.
+ */
+uint32_t TimeSync_Uptime(void);
+
+/**
+ * @brief Milliseconds since boot, for intervals.
+ */
+uint64_t TimeSync_UptimeMs(void);
+
+/**
+ * @brief UTC time of a new GPS epoch, taken as it is parsed.
+ * @param utcMs the fix time in ms since 1970
+ */
+void TimeSync_GpsSample(uint64_t utcMs);
+
+/**
+ * @brief Follow the RTC while it is the source, ask ntp_server when the GPS has not set
+ *        the time for a while; blocking. Call with GPRS up.
+ * @return true if NTP set the time
+ */
+bool TimeSync_Poll(void);
+
+/**
+ * @brief The source of the time.
+ */
+Time_Source_t TimeSync_GetSource(void);
+
+/**
+ * @brief "hh:mm:ss.mmm" of a time of TimeSync_NowMs().
+ */
+void TimeSync_Format(uint64_t ms, char* buffer, size_t size);
+
+/**
+ * @brief Print the time, its source and the corrections.
+ */
+void TimeSync_Print(CmdOutputFunc output);
+
+#endif // TIME_SYNC_H
@@ -0,0 +1,75 @@
+#include <math.h>
+
+#include "track_simplify.h"
+
+#define METRES_PER_DEG_LAT   111320.0f
+#define DEG_TO_RAD           0.017453292519943295
+
+void TrackSimplify_Init(TrackSimplify_t* track, float tolerance)
+{
+    track->tolerance = tolerance;
+    TrackSimplify_Reset(track);
+}
+
+void TrackSimplify_Reset(TrackSimplify_t* track)
+{
+    track->anchored = false;
+    track->count = 0;
+}
+
+static void SetAnchor(TrackSimplify_t* track, const TrackPoint_t* point)
+{
+    track->anchor = *point;
+    track->anchored = true;
+    track->metresPerDegLon = (float)(METRES_PER_DEG_LAT * cos(point->latitude * DEG_TO_RAD));
+}
+
+/**
+ * @return true if every fix in the window is within the tolerance of the segment from
+ *         the anchor to end, at the same time
+ */
+static bool WindowFits(const TrackSimplify_t* track, const TrackPoint_t* end)
+{
+    const TrackPoint_t* a = &track->anchor;
+    float ex = (end->longitude - a->longitude) * track->metresPerDegLon;
+    float ey = (end->latitude - a->latitude) * METRES_PER_DEG_LAT;
+    float duration = (float)(int32_t)(end->timestamp - a->timestamp);
+    float limit = track->tolerance * track->tolerance;
+
+    for (int i = 0; i < track->count; ++i) {
+        const TrackPoint_t* p = &track->window[i];
+        float f = duration > 0.0f ? (float)(int32_t)(p->timestamp - a->timestamp) / duration : 1.0f;
+        float dx = (p->longitude - a->longitude) * track->metresPerDegLon - f * ex;
+        float dy = (p->latitude - a->latitude) * METRES_PER_DEG_LAT - f * ey;
+        if (dx * dx + dy * dy > limit) return false;
+    }
+    return true;
+}
+
+bool TrackSimplify_Add(TrackSimplify_t* track, const TrackPoint_t* point, TrackPoint_t* kept)
+{
+    if (!track->anchored || track->tolerance <= 0.0f) {
+        SetAnchor(track, point);
+        *kept = *point;
+        return true;
+    }
+    if (track->count < TRACK_SIMPLIFY_WINDOW && WindowFits(track, point)) {
+        track->window[track->count++] = *point;
+        return false;
+    }
+    // the fix before this one ends the segment
+    *kept = track->window[track->count - 1];
+    SetAnchor(track, kept);
+    track->window[0] = *point;
+    track->count = 1;
+    return true;
+}
+
+bool TrackSimplify_Flush(TrackSimplify_t* track, TrackPoint_t* kept)
+{
+    if (track->count == 0) return false;
+    *kept = track->window[track->count - 1];
+    SetAnchor(track, kept);
+    track->count = 0;
+    return true;
+}
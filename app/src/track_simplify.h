@@ -0,0 +1,67 @@
+#ifndef TRACK_SIMPLIFY_H
+#define TRACK_SIMPLIFY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Online track simplification (config track_tolerance).
+ *
+ * Keeps the fixes needed to rebuild the track within a tolerance in metres and drops
+ * the others, one fix at a time: an opening window over the fixes since the last kept
+ * one (the anchor). A new fix extends the window while every fix in it lies within the
+ * tolerance of the segment from the anchor to the new fix; otherwise the previous fix
+ * is kept and becomes the anchor.
+ *
+ * The distance is the synchronized Euclidean distance: a fix is compared with the point
+ * of the segment at the same time, not the nearest one. The kept fixes, interpolated
+ * linearly in time, give every dropped position within the tolerance, so stops and
+ * speed changes on a straight road are kept too.
+ *
+ * The window holds TRACK_SIMPLIFY_WINDOW fixes; when it is full the last one is kept,
+ * which bounds the memory and the work per fix.
+ */
+
+#define TRACK_SIMPLIFY_WINDOW     32
+
+typedef struct {
+    uint32_t timestamp;         // unix time
+    float    latitude;
+    float    longitude;
+    float    speed;             // knots
+    float    course;
+} TrackPoint_t;
+
+typedef struct {
+    float        tolerance;     // m, 0 keeps every fix
+    bool         anchored;
+    TrackPoint_t anchor;        // the last kept fix
+    float        metresPerDegLon;
+    uint8_t      count;         // fixes in the window
+    TrackPoint_t window[TRACK_SIMPLIFY_WINDOW];
+} TrackSimplify_t;
+
+/**
+ * @brief Set up a simplifier keeping the track within tolerance metres.
+ */
+void TrackSimplify_Init(TrackSimplify_t* track, float tolerance);
+
+/**
+ * @brief Forget the track; the next fix is kept and starts a new one.
+ */
+void TrackSimplify_Reset(TrackSimplify_t* track);
+
+/**
+ * @brief Add the next fix of the track.
+ * @param kept set to the fix to keep, when there is one
+ * @return true if kept holds a fix
+ */
+bool TrackSimplify_Add(TrackSimplify_t* track, const TrackPoint_t* point, TrackPoint_t* kept);
+
+/**
+ * @brief Keep the last fix added, e.g. before the kept fixes are sent.
+ * @return true if kept holds a fix, false if the last fix was kept already
+ */
+bool TrackSimplify_Flush(TrackSimplify_t* track, TrackPoint_t* kept);
+
+#endif // TRACK_SIMPLIFY_H
@@ -0,0 +1,323 @@
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <api_os.h>
+#include <api_fs.h>
+#include <api_sys.h>
+
+#include "utils.h"
+#include "config_store.h"
+#include "gps_tracker.h"
+#include "trip.h"
+#include "debug.h"
+
+#define MODULE_TAG "Trip"
+
+#define METRES_PER_DEG_LAT   111320.0f
+#define DEG_TO_RAD           0.017453292519943295
+// SaveOdometer() writes here, then renames it over ODOMETER_FILE
+#define ODOMETER_TEMP        "/odometer.tmp"
+
+// ---------------------------------------------------------------------------
+// detector
+// ---------------------------------------------------------------------------
+
+void TripDetector_Init(TripDetector_t* detector, uint32_t stopTime, double odometer)
+{
+    memset(detector, 0, sizeof(*detector));
+    detector->stopTime = stopTime;
+    detector->state    = TRIP_STOPPED;
+    detector->odometer = odometer;
+}
+
+// metres, flat earth: the steps are a few metres to a few hundred
+static float Distance(const TripFix_t* a, float latitude, float longitude)
+{
+    float dy = (latitude - a->latitude) * METRES_PER_DEG_LAT;
+    float dx = (longitude - a->longitude) * METRES_PER_DEG_LAT * (float)cos(a->latitude * DEG_TO_RAD);
+    return (float)sqrt(dx * dx + dy * dy);
+}
+
+static void Start(TripDetector_t* d, uint32_t time, float latitude, float longitude, float distance,
+                  TripEvent_t* event)
+{
+    d->state          = TRIP_MOVING;
+    d->startTime      = time;
+    d->startLatitude  = latitude;
+    d->startLongitude = longitude;
+    d->distance       = distance;
+    d->odometer      += distance;
+    d->maxSpeed       = 0.0f;
+    d->movingFixes    = 0;
+
+    memset(event, 0, sizeof(*event));
+    event->type      = TRIP_EVENT_START;
+    event->startTime = time;
+    event->latitude  = latitude;
+    event->longitude = longitude;
+}
+
+// it left the last fix right after it, or some time in a gap without fixes
+static uint32_t DepartureTime(const TripDetector_t* d, const TripFix_t* fix)
+{
+    return fix->time - d->last.time < d->stopTime ? d->last.time : fix->time;
+}
+
+// ends the trip where it stopped, at the idle fix
+static void End(TripDetector_t* d, TripEvent_t* event)
+{
+    event->type      = TRIP_EVENT_END;
+    event->startTime = d->startTime;
+    event->endTime   = d->idle.time;
+    event->latitude  = d->idle.latitude;
+    event->longitude = d->idle.longitude;
+    event->distance  = (float)d->distance;
+    event->maxSpeed  = d->maxSpeed;
+
+    d->state       = TRIP_STOPPED;
+    d->anchor      = d->idle;
+    d->movingFixes = 0;
+}
+
+int TripDetector_Update(TripDetector_t* d, const TripFix_t* fix, TripEvent_t* events)
+{
+    int count = 0;
+    if (fix->accuracy > TRIP_MAX_ACCURACY) return 0;
+    if (!d->hasLast) {
+        d->hasLast = true;
+        d->last    = *fix;
+        d->anchor  = *fix;
+        return 0;
+    }
+    // a gap or a long stand ends the trip before this fix is looked at
+    if (d->state == TRIP_MOVING && fix->time - d->last.time >= d->stopTime) {
+        d->idle = d->last;
+        End(d, &events[count++]);
+    } else if (d->state == TRIP_IDLE && fix->time - d->idle.time >= d->stopTime) {
+        End(d, &events[count++]);
+    }
+
+    float step = Distance(&d->last, fix->latitude, fix->longitude);
+    switch (d->state) {
+        case TRIP_STOPPED:
+            if (fix->speed >= TRIP_MOVING_SPEED) {
+                if (d->movingFixes++ == 0) {
+                    d->candidate      = d->last;
+                    d->candidate.time = DepartureTime(d, fix);
+                    d->candidateDistance = 0.0f;
+                }
+                d->candidateDistance += step;
+            } else {
+                d->movingFixes = 0;
+            }
+            if (d->movingFixes >= TRIP_START_FIXES)
+                Start(d, d->candidate.time, d->candidate.latitude, d->candidate.longitude,
+                      d->candidateDistance, &events[count++]);
+            else if (Distance(&d->anchor, fix->latitude, fix->longitude) > TRIP_START_DISTANCE)
+                // moved off slowly, or during a gap
+                Start(d, DepartureTime(d, fix), d->anchor.latitude, d->anchor.longitude,
+                      Distance(&d->anchor, fix->latitude, fix->longitude), &events[count++]);
+            break;
+
+        case TRIP_IDLE:
+            if (fix->speed < TRIP_MOVING_SPEED) break;
+            d->state = TRIP_MOVING;
+            // fall through
+        case TRIP_MOVING:
+            d->distance += step;
+            d->odometer += step;
+            if (fix->speed < TRIP_STILL_SPEED) {
+                d->state = TRIP_IDLE;
+                d->idle  = *fix;
+            }
+            break;
+    }
+    if (d->state != TRIP_STOPPED && fix->speed > d->maxSpeed) d->maxSpeed = fix->speed;
+    d->last = *fix;
+    return count;
+}
+
+bool TripDetector_Timeout(TripDetector_t* d, uint32_t time, TripEvent_t* event)
+{
+    if (d->state == TRIP_MOVING && time - d->last.time >= d->stopTime) {
+        d->idle = d->last;
+        End(d, event);
+        return true;
+    }
+    if (d->state == TRIP_IDLE && time - d->idle.time >= d->stopTime) {
+        End(d, event);
+        return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// the tracker's detector
+// ---------------------------------------------------------------------------
+
+static TripDetector_t detector;
+static HANDLE         tripMutex = NULL;
+static uint32_t       odometerSaved = 0;    // m
+
+static TripEvent_t    events[TRIP_EVENT_QUEUE];
+static uint8_t        eventHead = 0, eventCount = 0;
+
+// a temporary file renamed over ODOMETER_FILE: a cut write does not truncate the odometer
+static bool SaveOdometer(void)
+{
+    char text[16];
+    int  length = snprintf(text, sizeof(text), "%u\r\n", (unsigned)detector.odometer);
+    int32_t fd = API_FS_Open(ODOMETER_TEMP, FS_O_RDWR | FS_O_CREAT | FS_O_TRUNC, 0);
+    if (fd < 0) {
+        LOGE("Open %s failed: %d", ODOMETER_TEMP, fd);
+        return false;
+    }
+    bool ok = API_FS_Write(fd, (uint8_t*)text, length) == length;
+    API_FS_Flush(fd);
+    API_FS_Close(fd);
+    if (ok) {
+        API_FS_Delete(ODOMETER_FILE);
+        ok = API_FS_Rename(ODOMETER_TEMP, ODOMETER_FILE) == 0;
+    }
+    if (ok) {
+        odometerSaved = (uint32_t)detector.odometer;
+    } else {
+        API_FS_Delete(ODOMETER_TEMP);
+        LOGE("Write %s failed", ODOMETER_FILE);
+    }
+    return ok;
+}
+
+static uint32_t LoadOdometer(void)
+{
+    int32_t fd = API_FS_Open(ODOMETER_FILE, FS_O_RDONLY, 0);
+    // power lost between the delete and the rename in SaveOdometer(): the new file is complete
+    if (fd < 0 && API_FS_Rename(ODOMETER_TEMP, ODOMETER_FILE) == 0) {
+        LOGW("%s recovered from %s", ODOMETER_FILE, ODOMETER_TEMP);
+        fd = API_FS_Open(ODOMETER_FILE, FS_O_RDONLY, 0);
+    }
+    if (fd < 0) return 0;
+    char text[16];
+    int32_t n = API_FS_Read(fd, (uint8_t*)text, sizeof(text) - 1);
+    API_FS_Close(fd);
+    uint32_t metres = 0;
+    for (int i = 0; i < n && text[i] >= '0' && text[i] <= '9'; ++i)
+        metres = metres * 10 + (text[i] - '0');
+    return metres;
+}
+
+void Trip_Init(void)
+{
+    tripMutex = OS_CreateMutex();
+    odometerSaved = LoadOdometer();
+    TripDetector_Init(&detector, g_ConfigStore.trip_stop_time, odometerSaved);
+    LOGI("Odometer %u.%03u km", (unsigned)(odometerSaved / 1000), (unsigned)(odometerSaved % 1000));
+}
+
+static void QueueEvent(const TripEvent_t* event)
+{
+    if (event->type == TRIP_EVENT_START)
+        LOGI("Trip started");
+    else
+        LOGI("Trip ended: %u m, %u s, max %.1f kn", (unsigned)event->distance,
+             (unsigned)(event->endTime - event->startTime), event->maxSpeed);
+
+    uint32_t status = SYS_EnterCriticalSection();
+    if (eventCount == TRIP_EVENT_QUEUE) {
+        // the oldest is lost
+        eventHead = (eventHead + 1) % TRIP_EVENT_QUEUE;
+        eventCount--;
+    }
+    events[(eventHead + eventCount++) % TRIP_EVENT_QUEUE] = *event;
+    SYS_ExitCriticalSection(status);
+}
+
+// queues the events and saves the odometer; under the mutex
+static void Handle(const TripEvent_t* found, int count)
+{
+    bool ended = false;
+    for (int i = 0; i < count; ++i) {
+        QueueEvent(&found[i]);
+        ended |= (found[i].type == TRIP_EVENT_END);
+    }
+    if (ended || detector.odometer - odometerSaved >= ODOMETER_SAVE_DISTANCE)
+        SaveOdometer();
+    if (count) Tracker_Notify(TRACKER_EVENT_TRIP);
+}
+
+void Trip_Update(uint32_t timestamp, float latitude, float longitude, float speed, float accuracy)
+{
+    if (!tripMutex) return;
+
+    TripFix_t   fix = {timestamp, latitude, longitude, speed, accuracy};
+    TripEvent_t found[2];
+    OS_LockMutex(tripMutex);
+    detector.stopTime = g_ConfigStore.trip_stop_time;
+    Handle(found, TripDetector_Update(&detector, &fix, found));
+    OS_UnlockMutex(tripMutex);
+}
+
+void Trip_Timeout(uint32_t sinceFix)
+{
+    if (!tripMutex) return;
+
+    TripEvent_t event;
+    OS_LockMutex(tripMutex);
+    detector.stopTime = g_ConfigStore.trip_stop_time;
+    if (detector.hasLast && TripDetector_Timeout(&detector, detector.last.time + sinceFix, &event))
+        Handle(&event, 1);
+    OS_UnlockMutex(tripMutex);
+}
+
+bool Trip_PeekEvent(TripEvent_t* event)
+{
+    bool found = false;
+    uint32_t status = SYS_EnterCriticalSection();
+    if (eventCount) {
+        *event = events[eventHead];
+        found = true;
+    }
+    SYS_ExitCriticalSection(status);
+    return found;
+}
+
+void Trip_PopEvent(void)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    if (eventCount) {
+        eventHead = (eventHead + 1) % TRIP_EVENT_QUEUE;
+        eventCount--;
+    }
+    SYS_ExitCriticalSection(status);
+}
+
+uint32_t Trip_GetOdometer(void)
+{
+    return (uint32_t)detector.odometer;
+}
+
+bool Trip_SetOdometer(uint32_t metres)
+{
+    OS_LockMutex(tripMutex);
+    detector.odometer = metres;
+    bool ok = SaveOdometer();
+    OS_UnlockMutex(tripMutex);
+    return ok;
+}
+
+void Trip_Print(CmdOutputFunc output)
+{
+    static const char* const states[] = {"stopped", "moving", "idle"};
+    OS_LockMutex(tripMutex);
+    output("State: %s\r\n", states[detector.state]);
+    if (detector.state != TRIP_STOPPED) {
+        RTC_Time_t start;
+        time_to_rtc(detector.startTime, &start);
+        output("Trip: since %02u:%02u:%02u UTC, %u m, %u s, max %.1f kn\r\n", start.hour, start.minute,
+               start.second, (unsigned)detector.distance, (unsigned)(detector.last.time - detector.startTime),
+               detector.maxSpeed);
+    }
+    output("Odometer: %u.%03u km\r\n", (unsigned)(Trip_GetOdometer() / 1000), (unsigned)(Trip_GetOdometer() % 1000));
+    OS_UnlockMutex(tripMutex);
+}
@@ -0,0 +1,151 @@
+#ifndef TRIP_H
+#define TRIP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config_commands.h"
+
+/**
+ * Trip detection and odometer (config trip_stop_time).
+ *
+ * Every new fix, filtered, drives a three state machine:
+ *
+ *   STOPPED  no trip. TRIP_START_FIXES fixes in a row at TRIP_MOVING_SPEED or more, or a
+ *            fix more than TRIP_START_DISTANCE from where the device stopped, start one.
+ *   MOVING   in a trip; a fix below TRIP_STILL_SPEED makes it IDLE.
+ *   IDLE     in a trip, standing (traffic lights, a delivery stop). Moving again resumes
+ *            the trip; trip_stop_time seconds standing, or without a fix, end it.
+ *
+ * The distance of a trip is the sum of the steps between the fixes while MOVING, so the
+ * wander of a parked receiver adds nothing; fixes less accurate than TRIP_MAX_ACCURACY
+ * are ignored. The same steps feed the odometer, which is kept in ODOMETER_FILE, saved
+ * at the end of a trip and every ODOMETER_SAVE_DISTANCE metres.
+ *
+ * A trip start and a trip end with its summary (distance, duration, top speed) are
+ * queued as events; the tracker reports each at once ("trip=start", "trip=end&...").
+ *
+ * Times are the fix times (unix time), so a gap without fixes, e.g. parked with the GPS
+ * in standby, counts as standing.
+ */
+
+#define ODOMETER_FILE             "/odometer.txt"
+#define ODOMETER_SAVE_DISTANCE    1000    // m
+#define TRIP_MOVING_SPEED         3.0f    // knots, 5.6 km/h
+#define TRIP_STILL_SPEED          1.5f    // knots
+#define TRIP_START_FIXES          3
+#define TRIP_START_DISTANCE       200.0f  // m
+#define TRIP_MAX_ACCURACY         50.0f   // m
+// events waiting for the tracker
+#define TRIP_EVENT_QUEUE          8
+
+typedef enum {
+    TRIP_STOPPED = 0,
+    TRIP_MOVING,
+    TRIP_IDLE,
+} Trip_State_t;
+
+typedef enum {
+    TRIP_EVENT_START = 0,
+    TRIP_EVENT_END,
+} Trip_EventType_t;
+
+typedef struct {
+    uint32_t time;              // unix time
+    float    latitude;
+    float    longitude;
+    float    speed;             // knots
+    float    accuracy;          // m
+} TripFix_t;
+
+typedef struct {
+    uint8_t  type;              // Trip_EventType_t
+    uint32_t startTime;
+    uint32_t endTime;           // when it came to a stop, 0 for a start
+    float    latitude;          // where it started or ended
+    float    longitude;
+    float    distance;          // m
+    float    maxSpeed;          // knots
+} TripEvent_t;
+
+typedef struct {
+    uint32_t  stopTime;         // s standing that end a trip
+    uint8_t   state;            // Trip_State_t
+    bool      hasLast;
+    TripFix_t last;             // the last fix used
+    TripFix_t anchor;           // where the device stopped
+    // fixes at TRIP_MOVING_SPEED in a row while STOPPED, from the first of them
+    uint8_t   movingFixes;
+    TripFix_t candidate;
+    float     candidateDistance;
+    // the trip
+    uint32_t  startTime;
+    float     startLatitude, startLongitude;
+    double    distance;
+    float     maxSpeed;
+    TripFix_t idle;             // the fix that started the IDLE state
+    double    odometer;         // m
+} TripDetector_t;
+
+/**
+ * @brief Set up a detector, stopped, with the odometer at the given distance (m).
+ */
+void TripDetector_Init(TripDetector_t* detector, uint32_t stopTime, double odometer);
+
+/**
+ * @brief Feed the next fix.
+ * @param events room for 2 events: a trip ended by a gap and the next one started
+ * @return the number of events
+ */
+int TripDetector_Update(TripDetector_t* detector, const TripFix_t* fix, TripEvent_t* events);
+
+/**
+ * @brief End the trip if the device stood, or had no fix, for the stop time by now.
+ * @param time unix time
+ * @return true if the trip ended, with its event
+ */
+bool TripDetector_Timeout(TripDetector_t* detector, uint32_t time, TripEvent_t* event);
+
+/**
+ * @brief Load the odometer from ODOMETER_FILE.
+ */
+void Trip_Init(void);
+
+/**
+ * @brief Feed the tracker's detector with a new fix; queues the events and wakes the tracker.
+ */
+void Trip_Update(uint32_t timestamp, float latitude, float longitude, float speed, float accuracy);
+
+/**
+ * @brief End the trip when there was no fix for the stop time.
+ * @param sinceFix seconds since the last valid fix
+ */
+void Trip_Timeout(uint32_t sinceFix);
+
+/**
+ * @brief The oldest queued event, left in the queue.
+ * @return false if there is none
+ */
+bool Trip_PeekEvent(TripEvent_t* event);
+
+/**
+ * @brief Drop the oldest queued event, once reported.
+ */
+void Trip_PopEvent(void);
+
+/**
+ * @brief Odometer in metres.
+ */
+uint32_t Trip_GetOdometer(void);
+
+/**
+ * @brief Set the odometer (m) and save it.
+ */
+bool Trip_SetOdometer(uint32_t metres);
+
+/**
+ * @brief Print the state, the current trip and the odometer.
+ */
+void Trip_Print(CmdOutputFunc output);
+
+#endif // TRIP_H
@@ -6,49 +6,63 @@
 #include "config_store.h"
 #include "debug.h"
 
-int is_leap_year(int year) {
-    year += 1900;
-    return (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+// days from civil and back, after H. Hinnant's chrono algorithms: the year starts in March so
+// that the leap day comes last, and a 400 year era has a fixed 146097 days
+int32_t days_from_civil(int year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    int      era = (year >= 0 ? year : year - 399) / 400;
+    unsigned yoe = (unsigned)(year - era * 400);                        // [0, 399]
+    unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1; // [0, 365]
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;              // [0, 146096]
+    return era * 146097 + (int32_t)doe - 719468;
 }
 
-int days_in_month(int month, int year) {
-    static const int days[12] = { 31,28,31,30,31,30,31,31,30,31,30,31 };
-    if (month == 1 && is_leap_year(year)) return 29;
-    return days[month];
+void civil_from_days(int32_t days, int* year, unsigned* month, unsigned* day)
+{
+    days += 719468;
+    int32_t  era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = (unsigned)(days - era * 146097);                         // [0, 146096]
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);              // [0, 365]
+    unsigned mp  = (5 * doy + 2) / 153;                                   // [0, 11], from March
+    *day   = doy - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year  = (int)yoe + era * 400 + (*month <= 2);
 }
 
 time_t mk_time(const struct minmea_date *date, const struct minmea_time *time_)
 {
+    if (date->month < 1 || date->month > 12 || date->day < 1 || date->day > 31)
+        return 0;
+    // two digit NMEA years: GPS time starts in 1980
     int year = date->year;
-    int month = date->month-1;
-    int day = date->day-1;
-    if (year < 70) year += 100;
-
-    // Normalize month/year
-    while (month < 0) { month += 12; year--; }
-    while (month >= 12) { month -= 12; year++; }
-
-    // Calculate days since 1970
-    long days = 0;
-
-    // Years
-    for (int y = 70; y < year; y++)
-        days += is_leap_year(y) ? 366 : 365;
-    
-    // Months
-    for (int m = 0; m < month; m++)
-        days += days_in_month(m, year);
-
-    // Days
-    days += day;
-
-    // Total seconds
-    time_t total = days * 86400L +
-                   time_->hours * 3600L +
-                   time_->minutes * 60L +
-                   time_->seconds;
- 
-    return total;
+    if (year < 100) year += year < 80 ? 2000 : 1900;
+
+    uint32_t days = (uint32_t)days_from_civil(year, date->month, date->day);
+    return (time_t)(days * 86400u + time_->hours * 3600u + time_->minutes * 60u + time_->seconds);
+}
+
+uint32_t rtc_to_time(const RTC_Time_t* rtc)
+{
+    uint32_t days = (uint32_t)days_from_civil(rtc->year, rtc->month, rtc->day);
+    return days * 86400u + rtc->hour * 3600u + rtc->minute * 60u + rtc->second;
+}
+
+void time_to_rtc(uint32_t t, RTC_Time_t* rtc)
+{
+    int      year;
+    unsigned month, day;
+    civil_from_days((int32_t)(t / 86400u), &year, &month, &day);
+    uint32_t second = t % 86400u;
+    rtc->year            = (uint16_t)year;
+    rtc->month           = (uint8_t)month;
+    rtc->day             = (uint8_t)day;
+    rtc->hour            = (uint8_t)(second / 3600);
+    rtc->minute          = (uint8_t)(second / 60 % 60);
+    rtc->second          = (uint8_t)(second % 60);
+    rtc->timeZone        = 0;
+    rtc->timeZoneMinutes = 0;
 }
 
 int str_case_cmp(const char *s1, const char *s2) {
@@ -88,6 +102,45 @@ char* trim_whitespace(char* str)
     return str;
 }
 
+size_t url_encode(char* dst, size_t dstsize, const char* src)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    size_t len = 0;
+
+    if (!dst || dstsize == 0) return 0;
+
+    for (; src && *src; ++src) {
+        unsigned char c = (unsigned char)*src;
+        if (c == '\r') continue;
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            if (len + 1 >= dstsize) break;
+            dst[len++] = c;
+        } else {
+            if (len + 3 >= dstsize) break;
+            dst[len++] = '%';
+            dst[len++] = hex[c >> 4];
+            dst[len++] = hex[c & 0x0F];
+        }
+    }
+    dst[len] = '\0';
+    return len;
+}
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len)
+{
+    // nibble table, 4 bit at a time: small enough for flash, fast enough for UART rates
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc = (crc >> 4) ^ table[(crc ^ data[i]) & 0x0F];
+        crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0x0F];
+    }
+    return ~crc;
+}
+
 void format_size(char* buf, size_t bufsize, int value, const char* label) {
     if (value >= 1024*1024*1024) {
         float gb = value / (1024.0f * 1024.0f * 1024.0f);
@@ -1,6 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdint.h>
+#include <api_inc_time.h>
+
 #include "minmea.h"
 
 // Protocol
@@ -53,19 +56,47 @@ char* trim_whitespace(char* str);
  */
 int str_case_cmp(const char *s1, const char *s2);
 
+/**
+ * @brief Days since 1970-01-01 of a date of the proleptic Gregorian calendar.
+ *
+ * Constant time, no tables or loops; negative before 1970.
+ *
+ * @param year Full year, e.g. 2024.
+ * @param month 1-12.
+ * @param day 1-31.
+ */
+int32_t days_from_civil(int year, unsigned month, unsigned day);
+
+/**
+ * @brief The date of a day number of days_from_civil().
+ */
+void civil_from_days(int32_t days, int* year, unsigned* month, unsigned* day);
+
 /**
  * @brief Convert a minmea date and time structure to a time_t value.
  * 
  * This function combines the date and time information from the provided
  * minmea_date and minmea_time structures to create a time_t value.
+ * Two digit years are 1980-2079. time_t is 32 bit on the module: read as
+ * uint32_t the value holds until 2106.
  * 
  * @param date Pointer to a minmea_date structure containing the date information.
  * @param time_ Pointer to a minmea_time structure containing the time information. 
- * @return time_t The combined date and time as a time_t value.
+ * @return time_t The combined date and time as a time_t value, 0 for an invalid date.
  * 
  */
 time_t mk_time(const struct minmea_date *date, const struct minmea_time *time_);
 
+/**
+ * @brief Unix time of an RTC time, taken as UTC (the time zone fields are ignored).
+ */
+uint32_t rtc_to_time(const RTC_Time_t* rtc);
+
+/**
+ * @brief RTC time, UTC, of a unix time.
+ */
+void time_to_rtc(uint32_t t, RTC_Time_t* rtc);
+
 /**
  * @brief Convert a CSQ (signal quality) value to a percentage.
  * 
@@ -80,4 +111,28 @@ time_t mk_time(const struct minmea_date *date, const struct minmea_time *time_);
  */
 uint8_t csq_to_percent(int csq);
 
+/**
+ * @brief URL-encode (percent-encode) a string for use in a form field.
+ *
+ * Unreserved characters (letters, digits, '-', '_', '.', '~') are copied, all other
+ * characters are encoded as %XX. Carriage returns are dropped to save space.
+ * The output is always null terminated and truncated if the buffer is too small.
+ *
+ * @param dst     Destination buffer.
+ * @param dstsize Size of the destination buffer.
+ * @param src     Null terminated source string.
+ * @return The length of the encoded string.
+ */
+size_t url_encode(char* dst, size_t dstsize, const char* src);
+
+/**
+ * @brief Update a CRC-32 (IEEE 802.3, as zlib.crc32) with a block of data.
+ *
+ * @param crc  CRC of the preceding data, 0 for the first block.
+ * @param data Data block.
+ * @param len  Length of the data block.
+ * @return The updated CRC.
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t len);
+
 #endif
\ No newline at end of file
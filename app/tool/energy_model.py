@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""
+Energy estimate from a simulator power log (app/sim --power-log FILE).
+
+The log holds "<seconds> <part> <state>" lines: the CPU sleep mode, the system clock
+floor, the GPS receiver state, the task wake-ups while the CPU is in sleep mode, and at
+the end the link counters of the run. The model integrates the time spent in every state,
+moves --wake-ms of every wake-up from the sleep to the run current, and charges the radio
+per TCP connection (the activation and the tail the modem stays in the high power state)
+and per kilobyte on the air:
+
+    cpu run       module awake, GPRS attached
+    cpu sleep     sleep mode with the clock floor at 32 kHz; with a higher floor the
+                  module cannot sleep and draws the run current
+    gps on        acquiring or tracking
+    gps standby   $PGKC051 sleep, almanac and ephemeris kept
+    gps off       UART closed, receiver unpowered
+
+The default currents are datasheet-level figures for the A9G and the GK9501 at 3.8 V,
+good for comparing configurations rather than predicting the battery life of a unit.
+Every one of them can be overridden.
+
+    make -C app/sim
+    app/sim/build/a9g_sim --nmea app/sim/parked.nmea --nmea-loop --power-log power.log ...
+    python3 energy_model.py power.log --battery-mah 1000
+"""
+
+import argparse
+import sys
+
+# clock floors below this let the CPU sleep
+SLEEP_FREQ_MAX = 1000000
+
+
+def parse(path):
+    events, link, end = [], {}, None
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) < 3:
+                continue
+            t, part = float(fields[0]), fields[1]
+            if part == "link" and len(fields) >= 4:
+                link[fields[2]] = int(fields[3])
+            elif part == "end":
+                end = t
+            else:
+                events.append((t, part, fields[2]))
+    if end is None:
+        end = events[-1][0] if events else 0.0
+    return events, link, end
+
+
+def integrate(events, end):
+    """seconds per CPU and GPS state, and the wake-ups per task while the CPU slept"""
+    cpu_mode, freq, gps = "run", None, "off"
+    times = {"cpu run": 0.0, "cpu sleep": 0.0, "gps on": 0.0, "gps standby": 0.0, "gps off": 0.0}
+    wakes = {}
+    last = 0.0
+    for t, part, state in events + [(end, "end", "-")]:
+        dt = max(0.0, t - last)
+        asleep = cpu_mode == "sleep" and freq is not None and freq < SLEEP_FREQ_MAX
+        times["cpu sleep" if asleep else "cpu run"] += dt
+        times["gps " + gps] += dt
+        last = t
+        if part == "wake":
+            if asleep:
+                wakes[state] = wakes.get(state, 0) + 1
+        elif part == "cpu":
+            cpu_mode = state
+        elif part == "freq":
+            freq = int(state)
+        elif part == "gps" and "gps " + state in times:
+            gps = state
+    return times, wakes
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Energy estimate from a simulator power log")
+    parser.add_argument("log", help="file written by the simulator's --power-log option")
+    parser.add_argument("--cpu-run-ma", type=float, default=30.0, help="awake, GPRS attached (default: 30)")
+    parser.add_argument("--cpu-sleep-ma", type=float, default=3.0, help="sleep mode, GPRS attached (default: 3)")
+    parser.add_argument("--gps-on-ma", type=float, default=28.0, help="GPS tracking (default: 28)")
+    parser.add_argument("--gps-standby-ma", type=float, default=0.6, help="GPS standby (default: 0.6)")
+    parser.add_argument("--wake-ms", type=float, default=10.0,
+                        help="CPU run time per wake-up from sleep, the transitions included (default: 10)")
+    parser.add_argument("--connect-mah", type=float, default=0.15,
+                        help="radio charge per TCP connection, tail included (default: 0.15)")
+    parser.add_argument("--kb-mah", type=float, default=0.017, help="radio charge per KB on the air (default: 0.017)")
+    parser.add_argument("--battery-mah", type=float, default=1000.0, help="battery capacity (default: 1000)")
+    args = parser.parse_args()
+
+    events, link, end = parse(args.log)
+    if end <= 0:
+        print("error: %s holds no events" % args.log, file=sys.stderr)
+        return 1
+    times, wakes = integrate(events, end)
+    woken = min(times["cpu sleep"], sum(wakes.values()) * args.wake_ms / 1000.0)
+    times["cpu sleep"] -= woken
+    times["cpu run"] += woken
+
+    current = {"cpu run": args.cpu_run_ma, "cpu sleep": args.cpu_sleep_ma, "gps on": args.gps_on_ma,
+               "gps standby": args.gps_standby_ma, "gps off": 0.0}
+    print("%-12s %10s %7s %9s" % ("state", "seconds", "time%", "mAh"))
+    total = 0.0
+    for name in ("cpu run", "cpu sleep", "gps on", "gps standby", "gps off"):
+        mah = current[name] * times[name] / 3600.0
+        total += mah
+        print("%-12s %10.1f %6.1f%% %9.4f" % (name, times[name], 100.0 * times[name] / end, mah))
+    connects = link.get("connects", 0)
+    wire = link.get("wire_bytes", 0)
+    radio = connects * args.connect_mah + wire / 1024.0 * args.kb_mah
+    total += radio
+    print("%-12s %10s %7s %9.4f   (%d connections, %d bytes on the air)" % ("radio", "", "", radio, connects, wire))
+    if wakes:
+        print("wake-ups while asleep, in cpu run: %s" % ", ".join(
+            "%s %d" % (task, n) for task, n in sorted(wakes.items(), key=lambda w: -w[1])))
+
+    average = total * 3600.0 / end
+    per_day = average * 24.0
+    print("run: %.1f s, %.4f mAh, average %.2f mA, %.1f mAh/day, %.1f days on %.0f mAh" % (
+        end, total, average, per_day, args.battery_mah / per_day if per_day else float("inf"), args.battery_mah))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
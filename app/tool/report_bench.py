@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""
+End-to-end reporting benchmark: the tracker firmware running in the host simulator
+(app/sim) reports to tracking_server.py over loopback, through the simulator's GPRS
+link model (latency, jitter, bandwidth, segment loss, connection resets) and with
+bearer drops injected by the simulator script.
+
+For every network profile it prints:
+
+    reports/s     position reports delivered per second
+    loss          reports the tracker attempted that never reached the server; a failed
+                  report is not queued, the next one carries a newer fix
+    wire B/fix    bytes on the air per delivered report: payload, retransmissions and
+                  40 bytes of TCP/IP header per packet, handshakes and DNS included
+    payload B/fix HTTP request and response bytes per delivered report
+    conn/fix      TCP handshakes per delivered report
+    age p50/p95   fix age at delivery: server receipt time - fix timestamp
+    gap max       longest time without a delivered report
+
+    make -C app/sim
+    python3 report_bench.py --duration 300 --profile gprs --profile gprs-poor
+"""
+
+import argparse
+import os
+import random
+import re
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SIM_DIR = os.path.join(HERE, "..", "sim")
+
+# latency/jitter in ms, loss/reset probabilities, bandwidth in kbit/s, bearer drops per hour
+PROFILES = {
+    "lan":       dict(latency=0,   jitter=0,   loss=0.0,  reset=0.0,  kbps=0,  drops=0),
+    "gprs":      dict(latency=350, jitter=150, loss=0.02, reset=0.01, kbps=40, drops=6),
+    "gprs-poor": dict(latency=800, jitter=500, loss=0.08, reset=0.04, kbps=16, drops=30),
+}
+
+
+def free_port():
+    s = socket.socket()
+    s.bind(("127.0.0.1", 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))]
+
+
+def write_script(path, port, interval, duration, drops_per_hour, rng):
+    with open(path, "w") as f:
+        # the console is open once app_Main returned
+        for cmd in ("set server 127.0.0.1", "set port %d" % port, "set protocol http",
+                    "set report_interval %d" % interval):
+            f.write("3 uart %s\n" % cmd)
+        # bearer drops as a Poisson process, the network model re-activates the context
+        t = 10.0
+        while drops_per_hour > 0:
+            t += rng.expovariate(drops_per_hour / 3600.0)
+            if t >= duration:
+                break
+            f.write("%.1f deactivate\n" % t)
+
+
+def read_stats(path):
+    stats = {}
+    if os.path.exists(path):
+        with open(path) as f:
+            for line in f:
+                name, _, value = line.partition(" ")
+                if value.strip():
+                    stats[name] = int(value)
+    return stats
+
+
+def run_profile(name, profile, args, workdir, rng):
+    port = free_port()
+    server_log = os.path.join(workdir, "server.log")
+    stats_file = os.path.join(workdir, "link.txt")
+    script = os.path.join(workdir, "script.txt")
+    write_script(script, port, args.interval, args.duration, profile["drops"], rng)
+
+    server = subprocess.Popen([sys.executable, os.path.join(HERE, "tracking_server.py"),
+                               "--host", "127.0.0.1", "--port", str(port), "--log", server_log],
+                              stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        time.sleep(0.5)
+        cmd = [args.sim, "--fs", os.path.join(workdir, "fs"),
+               "--nmea", args.nmea, "--nmea-loop", "--nmea-now",
+               "--script", script, "--duration", str(args.duration), "--no-stdin",
+               "--net-latency", str(profile["latency"]), "--net-jitter", str(profile["jitter"]),
+               "--net-kbps", str(profile["kbps"]), "--net-loss", str(profile["loss"]),
+               "--net-reset", str(profile["reset"]), "--net-stats", stats_file]
+        sim = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             timeout=args.duration + 60, universal_newlines=True, errors="replace")
+    finally:
+        server.terminate()
+        server.wait()
+
+    sent = len(re.findall(r"Sent location to ", sim.stdout))
+    failed = len(re.findall(r"FAILED to send the location", sim.stdout))
+
+    received, ages = [], []
+    if os.path.exists(server_log):
+        with open(server_log) as f:
+            for line in f:
+                stamp, _, body = line.partition(" ")
+                received.append(float(stamp))
+                m = re.search(r"(?:^|&)timestamp=(\d+)", body)
+                if m and "valid=1" in body:
+                    # seconds followed by three digits of ms, like Traccar reads it
+                    ages.append(float(stamp) - int(m.group(1)) / 1000.0)
+
+    stats = read_stats(stats_file)
+    delivered = len(received)
+    attempts = sent + failed
+    gaps = [b - a for a, b in zip(received, received[1:])]
+    per_fix = lambda key: stats.get(key, 0) / float(delivered) if delivered else float("nan")
+    return {
+        "profile": name,
+        "attempts": attempts,
+        "delivered": delivered,
+        "rate": delivered / float(args.duration),
+        "loss": 100.0 * (attempts - delivered) / attempts if attempts else float("nan"),
+        "wire": per_fix("wire_bytes"),
+        "payload": (stats.get("payload_sent", 0) + stats.get("payload_received", 0)) / float(delivered)
+                   if delivered else float("nan"),
+        "conn": per_fix("connects"),
+        "resets": stats.get("resets", 0),
+        "lost": stats.get("segments_lost", 0),
+        "age50": percentile(ages, 50),
+        "age95": percentile(ages, 95),
+        "agemax": max(ages) if ages else float("nan"),
+        "gap": max(gaps) if gaps else float("nan"),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="End-to-end position reporting benchmark")
+    parser.add_argument("--profile", action="append", choices=sorted(PROFILES),
+                        help="network profile, repeatable (default: all)")
+    parser.add_argument("--duration", type=float, default=120, help="seconds per profile (default: 120)")
+    parser.add_argument("--interval", type=int, default=5, help="report interval in seconds (default: 5)")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the bearer drop schedule")
+    parser.add_argument("--sim", default=os.path.join(SIM_DIR, "build", "a9g_sim"), help="simulator binary")
+    parser.add_argument("--nmea", default=os.path.join(SIM_DIR, "sample.nmea"), help="NMEA log replayed as GPS output")
+    parser.add_argument("--keep", action="store_true", help="keep the work directories")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.sim):
+        print("error: %s not found, run 'make -C app/sim' first" % args.sim, file=sys.stderr)
+        return 1
+
+    rng = random.Random(args.seed)
+    print("%-10s %8s %9s %9s %6s %8s %9s %8s %7s %6s %8s %8s %8s %7s" % (
+        "profile", "attempts", "delivered", "reports/s", "loss%", "wire B", "payload B", "conn",
+        "resets", "lost", "age p50", "age p95", "age max", "gap"))
+    for name in args.profile or ["lan", "gprs", "gprs-poor"]:
+        workdir = tempfile.mkdtemp(prefix="report_bench_%s_" % name)
+        try:
+            r = run_profile(name, PROFILES[name], args, workdir, rng)
+        finally:
+            if args.keep:
+                print("  work directory: %s" % workdir)
+            else:
+                shutil.rmtree(workdir, ignore_errors=True)
+        print("%-10s %8d %9d %9.3f %6.1f %8.0f %9.0f %8.2f %7d %6d %7.2fs %7.2fs %7.2fs %6.1fs" % (
+            r["profile"], r["attempts"], r["delivered"], r["rate"], r["loss"], r["wire"], r["payload"],
+            r["conn"], r["resets"], r["lost"], r["age50"], r["age95"], r["agemax"], r["gap"]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
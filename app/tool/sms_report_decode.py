@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Decoder for the SMS fallback position reports (see app/src/sms_report.h).
+
+Messages starting with "T1" are taken from the command line or, if none is given,
+one per line from stdin. Each line is one report; older firmware could join several
+reports, or a report and a geofence alert, in one SMS. Every fix is printed as a CSV line:
+
+    time,lat,lon,speed_kmh,course,battery
+
+    python3 sms_report_decode.py T1BFkAAAAA...
+"""
+
+import base64
+import struct
+import sys
+import time
+
+PREFIX = "T1"
+
+
+def read_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode(text):
+    text = text.strip()
+    if not text.startswith(PREFIX):
+        raise ValueError("not a position report: %r" % text)
+    payload = text[len(PREFIX):]
+    data = base64.urlsafe_b64decode(payload + "=" * (-len(payload) % 4))
+
+    count, battery = data[0], data[1]
+    ts, lat, lon = struct.unpack_from("<Iii", data, 2)
+    speed, course = data[14], data[15]
+    pos = 16
+    fixes = [(ts, lat, lon, speed, course)]
+    for _ in range(count - 1):
+        dt, pos = read_varint(data, pos)
+        dlat, pos = read_varint(data, pos)
+        dlon, pos = read_varint(data, pos)
+        speed, course = data[pos], data[pos + 1]
+        pos += 2
+        ts, lat, lon = ts + dt, lat + unzigzag(dlat), lon + unzigzag(dlon)
+        fixes.append((ts, lat, lon, speed, course))
+    return battery, fixes
+
+
+def main():
+    messages = [line for arg in sys.argv[1:] for line in arg.splitlines() if line.strip()]
+    messages = messages or [line for line in sys.stdin if line.strip()]
+    print("time,lat,lon,speed_kmh,course,battery")
+    rc = 0
+    for msg in messages:
+        try:
+            battery, fixes = decode(msg)
+        except (ValueError, IndexError, struct.error) as e:
+            print("error: %s" % e, file=sys.stderr)
+            rc = 1
+            continue
+        for ts, lat, lon, speed, course in fixes:
+            print("%s,%.5f,%.5f,%d,%d,%d" % (
+                time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime(ts)),
+                lat / 1e5, lon / 1e5, speed, course * 2, battery))
+    return rc
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""
+Local stand-in for an OsmAnd-protocol tracking server (e.g. Traccar on port 5055).
+
+It prints every position report posted by the tracker and answers with the queued
+remote commands, one per line, in the response body. Commands are taken from the
+command line (-c) and from a commands file that is re-read before every response,
+so new commands can be appended while the server runs:
+
+    python3 tracking_server.py --port 5055 -c "set report_interval 60" -c "get"
+    echo "get report_interval" >> commands.txt
+
+Point the tracker at it with "set server <host ip>", "set port 5055", "set protocol http".
+The "result" field of the following reports carries the command output.
+"""
+
+import argparse
+import os
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, HTTPServer
+from urllib.parse import parse_qs
+
+
+class CommandQueue:
+    def __init__(self, commands, commands_file):
+        self.pending = list(commands)
+        self.commands_file = commands_file
+
+    def take(self):
+        if self.commands_file and os.path.exists(self.commands_file):
+            with open(self.commands_file, "r") as f:
+                self.pending += [line.strip() for line in f if line.strip()]
+            # commands are consumed once they are delivered
+            open(self.commands_file, "w").close()
+        commands, self.pending = self.pending, []
+        return commands
+
+
+def decode_cells(text):
+    """The cells field, "260,001,4d2:162e:-70,:162f:-80": [(mcc, mnc, lac, cid, rxlev)]"""
+    parts = text.split(",")
+    cells, lac = [], None
+    for cell in parts[2:]:
+        lac_hex, cid_hex, rxlev = cell.split(":")
+        lac = int(lac_hex, 16) if lac_hex else lac
+        cells.append((parts[0], parts[1], lac, int(cid_hex, 16), int(rxlev)))
+    return cells
+
+
+def make_handler(queue, log):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def do_POST(self):
+            length = int(self.headers.get("Content-Length", 0))
+            body = self.rfile.read(length).decode("utf-8", "replace").strip()
+            fields = {k: v[0] for k, v in parse_qs(body, keep_blank_values=True).items()}
+
+            stamp = time.strftime("%H:%M:%S")
+            print("[%s] %s id=%s valid=%s lat=%s lon=%s speed=%s batt=%s" % (
+                stamp, self.client_address[0], fields.get("id"), fields.get("valid"),
+                fields.get("lat"), fields.get("lon"), fields.get("speed"), fields.get("batt")))
+            if "cells" in fields:
+                print("    cells: " + ", ".join("%s-%s %d/%d %d dBm" % cell for cell in decode_cells(fields["cells"])))
+            if "result" in fields:
+                print("    command results:")
+                for line in fields["result"].splitlines():
+                    print("      " + line)
+            if log:
+                log.write("%.3f %s\n" % (time.time(), body))
+                log.flush()
+
+            commands = queue.take()
+            for cmd in commands:
+                print("    -> %s" % cmd)
+            reply = "".join(cmd + "\n" for cmd in commands).encode("utf-8")
+
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain")
+            self.send_header("Content-Length", str(len(reply)))
+            self.end_headers()
+            self.wfile.write(reply)
+
+        def log_message(self, fmt, *args):
+            pass
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description="OsmAnd protocol tracking server stand-in")
+    parser.add_argument("--host", default="0.0.0.0", help="address to listen on (default: 0.0.0.0)")
+    parser.add_argument("--port", type=int, default=5055, help="port to listen on (default: 5055)")
+    parser.add_argument("-c", "--command", action="append", default=[],
+                        help="command sent in the next response (may be repeated)")
+    parser.add_argument("-f", "--commands-file", default=None,
+                        help="file with commands, one per line, consumed on every report")
+    parser.add_argument("--log", default=None, help="append the raw reports to this file, each after its receipt time")
+    args = parser.parse_args()
+
+    log = open(args.log, "a") if args.log else None
+    server = HTTPServer((args.host, args.port), make_handler(CommandQueue(args.command, args.commands_file), log))
+    print("listening on %s:%d" % (args.host, args.port))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if log:
+            log.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
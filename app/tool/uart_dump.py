@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Receiver for the tracker "dump" command (see app/src/file_dump.h).
+
+Downloads a file from the tracker over the console UART in CRC protected frames.
+Frames which are lost or corrupted (e.g. by log output of other tasks) are requested
+again by range, and an interrupted download can be resumed with --resume:
+
+    python3 uart_dump.py /dev/ttyUSB0 /t/gps_log.txt gps_log.txt
+    python3 uart_dump.py /dev/ttyUSB0 /t/gps_log.txt gps_log.txt --resume
+
+Requires pyserial (pip install pyserial).
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+import zlib
+
+SYNC = b"\xa5\x5a"
+HEADER = struct.Struct("<IH")        # offset, length
+BEGIN_RE = re.compile(rb"DUMP BEGIN (\d+) (\d+) (\d+)\r?\n")
+END_RE = re.compile(rb"DUMP END (\d+) ([0-9a-fA-F]{8})\r?\n")
+ERROR_RE = re.compile(rb"DUMP ERROR ([^\r\n]*)\r?\n")
+
+
+class DumpError(Exception):
+    pass
+
+
+class FrameParser:
+    """Splits the UART byte stream into dump frames and the BEGIN/END/ERROR lines."""
+
+    def __init__(self):
+        self.buf = b""
+
+    def feed(self, data):
+        self.buf += data
+        events = []
+        while True:
+            sync = self.buf.find(SYNC)
+            text = self.buf if sync < 0 else self.buf[:sync]
+            for regex, kind in ((BEGIN_RE, "begin"), (END_RE, "end"), (ERROR_RE, "error")):
+                m = regex.search(text)
+                if m:
+                    events.append((kind, m.groups()))
+            if sync < 0:
+                # keep a tail which may hold an incomplete line
+                nl = self.buf.rfind(b"\n")
+                if nl >= 0:
+                    self.buf = self.buf[nl + 1:]
+                return events
+            self.buf = self.buf[sync:]
+            if len(self.buf) < 2 + HEADER.size:
+                return events
+            offset, length = HEADER.unpack_from(self.buf, 2)
+            total = 2 + HEADER.size + length + 4
+            if length > 4096:
+                self.buf = self.buf[1:]      # false sync
+                continue
+            if len(self.buf) < total:
+                return events
+            body = self.buf[2:2 + HEADER.size + length]
+            (crc,) = struct.unpack_from("<I", self.buf, 2 + HEADER.size + length)
+            if zlib.crc32(body) & 0xFFFFFFFF == crc:
+                events.append(("frame", (offset, body[HEADER.size:])))
+                self.buf = self.buf[total:]
+            else:
+                events.append(("bad", ()))
+                self.buf = self.buf[1:]
+
+
+def dump_range(port, remote, out, offset, length, timeout):
+    """Requests one range and writes the valid frames to out.
+
+    Returns (file size, list of missing (offset, length) ranges within the request).
+    """
+    port.reset_input_buffer()
+    port.write(("dump %s %d %d\r\n" % (remote, offset, length)).encode())
+    parser = FrameParser()
+    received = {}
+    file_size = None
+    end = None
+    last_data = time.time()
+    while end is None:
+        data = port.read(4096)
+        if data:
+            last_data = time.time()
+        elif time.time() - last_data > timeout:
+            break
+        for kind, args in parser.feed(data):
+            if kind == "begin":
+                file_size, offset, length = (int(x) for x in args)
+            elif kind == "error":
+                raise DumpError(args[0].decode(errors="replace"))
+            elif kind == "frame":
+                frame_offset, payload = args
+                out.seek(frame_offset)
+                out.write(payload)
+                received[frame_offset] = len(payload)
+            elif kind == "bad":
+                print("  corrupted frame skipped", file=sys.stderr)
+            elif kind == "end":
+                end = args
+    if file_size is None:
+        raise DumpError("no response from the device")
+
+    # collect the gaps between the received frames
+    missing = []
+    pos = offset
+    for frame_offset in sorted(received):
+        if frame_offset > pos:
+            missing.append((pos, frame_offset - pos))
+        pos = max(pos, frame_offset + received[frame_offset])
+    if pos < offset + length:
+        missing.append((pos, offset + length - pos))
+    return file_size, missing
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Download a file from the tracker over UART")
+    parser.add_argument("port", help="serial port, e.g. /dev/ttyUSB0")
+    parser.add_argument("remote", help="file on the tracker, e.g. /t/gps_log.txt")
+    parser.add_argument("output", help="local file")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--offset", type=int, default=0, help="first byte to download")
+    parser.add_argument("--length", type=int, default=0, help="bytes to download (default: to the end)")
+    parser.add_argument("--resume", action="store_true", help="continue after the existing output file")
+    parser.add_argument("--retries", type=int, default=5, help="attempts per missing range")
+    parser.add_argument("--timeout", type=float, default=3.0, help="seconds without data ending a transfer")
+    args = parser.parse_args()
+
+    import serial  # pyserial
+
+    offset = args.offset
+    if args.resume and os.path.exists(args.output):
+        offset = os.path.getsize(args.output)
+    mode = "r+b" if os.path.exists(args.output) and (args.resume or offset) else "w+b"
+
+    start = time.time()
+    with serial.Serial(args.port, args.baud, timeout=0.2) as port, open(args.output, mode) as out:
+        todo = [(offset, args.length)]
+        file_size = None
+        attempts = 0
+        while todo:
+            range_offset, range_length = todo.pop(0)
+            try:
+                size, missing = dump_range(port, args.remote, out, range_offset, range_length, args.timeout)
+            except DumpError as e:
+                print("error: %s" % e, file=sys.stderr)
+                return 1
+            if file_size is None:
+                file_size = size
+                end = file_size if args.length == 0 else min(file_size, offset + args.length)
+                print("%s: %d bytes, downloading %d-%d" % (args.remote, file_size, offset, end))
+            if missing:
+                attempts += 1
+                if attempts > args.retries * len(missing):
+                    print("error: giving up, %d ranges missing" % len(missing), file=sys.stderr)
+                    return 1
+                print("  re-requesting %d ranges" % len(missing))
+                todo += missing
+        if args.length == 0:
+            out.truncate(end)
+
+    elapsed = time.time() - start
+    print("done: %d bytes in %.1f s (%.0f B/s)" % (end - offset, elapsed, (end - offset) / max(elapsed, 0.001)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -22,6 +22,10 @@ extern "C"{
 ////////////////config//////////////////
 #define GPS_BUFFER_MAX_LENGTH 530  //max:agps gpd file pack need 512+8+3=523(Bytes)
 #define GPS_TIME_OUT_CMD      1500
+#define GPS_CMD_QUEUE_SIZE    8      //commands queued or waiting for their ack
+#define GPS_CMD_PIPELINE      4      //commands sent before the first ack comes back
+#define GPS_CMD_STR_MAX       96     //$PGKC command with its parity tail
+#define GPS_CMD_TICK_MS       100    //ack timeout resolution
 #define GPS_NMEA_FRAME_BUFFER_LENGTH 1024
 #define GPS_DATA_BUFFER_MAX_LENGTH 2048
 
@@ -30,6 +34,14 @@ extern "C"{
 #define GPS_AGPS_GPD_FILE_SERVER       "www.goke-agps.com"
 #define GPS_AGPS_GPD_FILE_SERVER_PORT   7777
 #define GPS_AGPS_GPD_FILE_PATH         "/brdcGPD.dat"
+//GPD transfer: 512 bytes packs in binary frames, streamed from the server to the gps
+#define GPS_GPD_PACK_SIZE              512
+#define GPS_GPD_FRAME_HEADER           8
+#define GPS_GPD_FRAME_SIZE             (GPS_GPD_FRAME_HEADER+GPS_GPD_PACK_SIZE+3)
+#define GPS_GPD_SEND_RETRIES           3
+#define GPS_GPD_HTTP_HEADER_MAX        384
+#define GPS_GPD_HTTP_TIMEOUT           12     //seconds without data
+#define GPS_GPD_HTTP_RETRIES           3      //resumed downloads after a broken connection
 
 /////////////////////////////////////////
 
@@ -128,6 +140,14 @@ typedef enum{
     GPS_FIX_MODE_MAX
 }GPS_Fix_Mode_t;
 
+/**
+ * completion of a queued command, called once in the main task
+ * @param result: GPS_CMD_ACK_FAIL if no ack came within the timeout
+ * @param ack: the ack without parity, e.g. "$PGKC463,GOKE9501_1.3_17101100", valid during
+ *             the call; NULL for binary acks and timeouts
+ */
+typedef void (*GPS_CMD_Callback_t)(void* param, GPS_CMD_t cmd, GPS_CMD_Ack_t result, const char* ack);
+
 
 void GPS_Init();
 /*
@@ -136,6 +156,16 @@ bool GPS_Close(void);
 bool GPS_IsOpen()
 */
 void GPS_Update(uint8_t* data,uint32_t length);
+/**
+ * queue a $PGKC command and return at once; the nmea output keeps being parsed while
+ * the command waits for its ack. The GPS_Set* functions queue the same way and block
+ * until done, not to be called from the main task, which receives the acks.
+ * @param args: the parameters, e.g. "1,0,1,1", NULL if none
+ * @param timeout: ms from the sending of the command
+ * @param done: NULL, or called with the result
+ * @return false if the queue is full or the command too long
+ */
+bool GPS_CMDQueue(GPS_CMD_t cmd, const char* args, uint16_t timeout, GPS_CMD_Callback_t done, void* param);
 bool GPS_Reboot(GPS_Reboot_Mode_t mode);
 bool GPS_ClearInfoInFlash();
 bool GPS_SetStandbyMode(GPS_STANDBY_Mode_t mode);
@@ -168,6 +198,55 @@ void GPS_SaveLog(bool save, const char* logPath);
 bool GPS_IsSaveLog();
 bool GPS_ClearLog();
 
+/**
+ * source of a GPD file
+ * @return bytes read to data (at most len), 0 at the end of the file, -1 on error
+ */
+typedef int  (*GPS_GPD_Read_t)(void* param, uint8_t* data, int len);
+/**
+ * sees every pack before it is sent, e.g. to cache the file
+ * @return false aborts the transfer
+ */
+typedef bool (*GPS_GPD_Tap_t)(void* param, const uint8_t* pack, int len);
+
+/**
+ * GPD file download from GPS_AGPS_GPD_FILE_SERVER, read with GPS_GPDHttpRead();
+ * a broken connection is resumed with a Range request
+ */
+typedef struct{
+    int      fd;
+    int32_t  length;        //Content-Length, -1 if the server did not send one
+    uint32_t received;      //file bytes returned by GPS_GPDHttpRead()
+    uint8_t  retries;
+    uint16_t bufStart;      //file bytes received with the header
+    uint16_t bufLen;
+    char     buf[GPS_GPD_HTTP_HEADER_MAX];
+}GPS_GPD_Http_t;
+
+/**
+ * connect and read the response header
+ * @return false if the server cannot be reached or does not have the file, close it anyway
+ */
+bool GPS_GPDHttpOpen(GPS_GPD_Http_t* http);
+/**
+ * GPS_GPD_Read_t reading the body, param: the GPS_GPD_Http_t
+ */
+int  GPS_GPDHttpRead(void* param, uint8_t* data, int len);
+void GPS_GPDHttpClose(GPS_GPD_Http_t* http);
+
+/**
+ * upload a GPD file to the gps chip pack by pack as source() returns it: the next pack
+ * is read while the gps acknowledges the current one, a pack is sent up to
+ * GPS_GPD_SEND_RETRIES more times. Needs about 1.1k of stack and no heap.
+ * @param tap: NULL, or called with every pack before it is sent
+ * @return file length, -1 on failure
+ */
+int  GPS_GPDStream(GPS_GPD_Read_t source, void* param, GPS_GPD_Tap_t tap, void* tapParam);
+/**
+ * set the gps rtc time from the module rtc, then the reference location (from lbs)
+ */
+bool GPS_SetSeed(float latitude, float longitude, float altitude);
+
 /**
  * do AGPS process, to accelerate GPS fix( download brdc GPD file and upload to GPS, and set location and time)
  * @param latitude:  latitude got from lbs
@@ -36,6 +36,16 @@ typedef struct{
 	struct minmea_sentence_zda zda;
 }GPS_Info_t;
 
+typedef struct{
+    uint32_t bytes;         // NMEA bytes passed to GPS_Update()
+    uint32_t frames;        // GPS_Parse() calls
+    uint32_t sentences;     // sentences found in the frames
+    uint32_t invalid;       // unknown talker/type or bad checksum
+    uint32_t failed;        // known sentence that minmea could not parse
+    uint32_t dropped;       // GSV/GSA sentences beyond the GPS_Info_t slots
+    uint32_t overflows;     // GPS_Update() calls that did not fit the NMEA buffer
+}GPS_Parse_Stats_t;
+
 
 /**
  * Get address of global gps infomatioin variable 
@@ -43,6 +53,12 @@ typedef struct{
  */
 GPS_Info_t* Gps_GetInfo();
 
+/**
+ * Get address of the parser statistics, counting since boot
+ * @return GPS_Parse_Stats_t*: Address of the parser statistics
+ */
+GPS_Parse_Stats_t* Gps_GetParseStats();
+
 /**
  * Parse a full frame gps NMEA message.
  * @param nmeas: A full GPA NMEA message frame. e.g.
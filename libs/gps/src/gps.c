@@ -18,6 +18,9 @@
 
 #include "api_socket.h"
 #include "api_os.h"
+#include "api_sys.h"
+#include "stdlib.h"
+#include "time.h"
 
 
 
@@ -26,12 +29,10 @@ const uint8_t GPS_CMD_BINARY_HEADER[2] = {0xaa,0xf0};
 const unsigned char Hex_Str[16]={'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
 
 
-static bool isCmdSendTimeOut = false;
-static HANDLE semCmdSending = NULL;
 static uint8_t tmp[GPS_NMEA_FRAME_BUFFER_LENGTH+1];
+static uint32_t tmpLen = 0;     //lines of the nmea frame collected in tmp
 static Buffer_t gpsNmeaBuffer;
 static uint8_t  gpsDataBuffer[GPS_DATA_BUFFER_MAX_LENGTH];
-static char*  gpsAckMsg = NULL;
 static bool isSaveLog = false;
 static const char* gpsLogPath = NULL;
 
@@ -40,6 +41,7 @@ void GPS_Init()
 {
     //Initialize buffer to cache nmea message
     Buffer_Init(&gpsNmeaBuffer,gpsDataBuffer,GPS_DATA_BUFFER_MAX_LENGTH);
+    tmpLen = 0;
 }
 
 void GPS_SaveLog( bool save, const char* path)
@@ -92,121 +94,61 @@ bool SaveToTFCard(char* str)
 	return true;
 }
 
+static bool GPS_CMDAck(uint8_t* line, uint32_t len);
+
+//parse the nmea frame collected in tmp
+static void GPS_ParseFrame()
+{
+    if(tmpLen == 0)
+        return;
+    tmp[tmpLen] = '\0';
+    tmpLen = 0;
+    GPS_DEBUG_I("parse nmea frame");
+    if(isSaveLog)
+        SaveToTFCard((char*)tmp);
+    GPS_Parse(tmp);
+}
+
+/**
+ * Split the received data into lines: command acks go to the command queue, nmea
+ * sentences are collected into a frame that is parsed at its last sentence (VTG),
+ * so the nmea output keeps being parsed while commands wait for their acks
+ */
 void GPS_Update(uint8_t* data,uint32_t length)
 {
-    int32_t index;
-    int32_t index2;
     bool ret = false;
+    Gps_GetParseStats()->bytes += length;
     ret = Buffer_Puts(&gpsNmeaBuffer,data,length);
     if(!ret)
-        GPS_DEBUG_I("buffer overflow");
-    if(semCmdSending == NULL)
     {
-        while(1)
-        {
-            index = Buffer_Query(&gpsNmeaBuffer,"VTG",strlen("VTG"),Buffer_StartPostion(&gpsNmeaBuffer));
-            if(index >= 0)
-            {
-                // GPS_DEBUG_I("find $GNVTG");
-                index = Buffer_Query(&gpsNmeaBuffer,"\r\n",strlen("\r\n"),index);
-                if(index >= 0)
-                {
-                    // GPS_DEBUG_I("find complete GPS frame");
-                    
-                    memset(tmp,0,sizeof(tmp));
-                    uint32_t len = Buffer_Size2(&gpsNmeaBuffer,index)+1;
-                    // GPS_DEBUG_I("frame len:%d",len);
-                    if(!Buffer_Gets(&gpsNmeaBuffer,tmp,len>GPS_NMEA_FRAME_BUFFER_LENGTH?GPS_NMEA_FRAME_BUFFER_LENGTH:len))
-                    {
-                        GPS_DEBUG_I("get data from buffer fail");
-                        return;
-                    }
-                    GPS_DEBUG_I("parse nmea frame");
-                    if(isSaveLog)
-                        SaveToTFCard((char*)tmp);
-                    GPS_Parse(tmp);
-                }
-            }
-            else
-                break;
-        }
+        ++Gps_GetParseStats()->overflows;
+        GPS_DEBUG_I("buffer overflow");
     }
-    else//sending command
+    while(1)
     {
-        index = Buffer_Query(&gpsNmeaBuffer,GPS_CMD_HEADER,strlen(GPS_CMD_HEADER),Buffer_StartPostion(&gpsNmeaBuffer));
-        if(index >= 0)//NMEA command
+        int32_t index = Buffer_Query(&gpsNmeaBuffer,"\r\n",strlen("\r\n"),Buffer_StartPostion(&gpsNmeaBuffer));
+        if(index < 0)//line not complete yet, wait for more data
+            break;
+        uint32_t len = Buffer_Size2(&gpsNmeaBuffer,index)+1;
+        if(len > GPS_NMEA_FRAME_BUFFER_LENGTH - tmpLen)
         {
-            index2 = Buffer_Query(&gpsNmeaBuffer,"\r\n",strlen("\r\n"),index);
-            if(index2 >= 0)//find one frame command
-            {
-                GPS_DEBUG_I("GPS find ack message");
-                memset(tmp,0,sizeof(tmp));
-                uint32_t len = Buffer_Size2(&gpsNmeaBuffer,index2)+1;
-                len = len>GPS_NMEA_FRAME_BUFFER_LENGTH?GPS_NMEA_FRAME_BUFFER_LENGTH:len;
-                if(!Buffer_Gets(&gpsNmeaBuffer,tmp,(uint16_t)len))
-                {
-                    GPS_DEBUG_I("get data from buffer fail");
-                    return;
-                }
-                // GPS_DEBUG_I("tmp:%s,%d,%d,%d",tmp,index,index2,len);
-                if(semCmdSending)
-                {
-                    // Assert(gpsAckMsg == NULL,"already malloced"); //test
-                    char* index0 = strstr(tmp,GPS_CMD_HEADER);
-                    // Assert(index0 != NULL,"index null"); //test
-                    len = len - ((uint32_t)index0 - (uint32_t)tmp);
-                    gpsAckMsg = OS_Malloc(len);
-                    if(gpsAckMsg)
-                    {
-                        memcpy(gpsAckMsg,index0,len);
-                        OS_ReleaseSemaphore(semCmdSending);
-                    }
-                }
-            }
+            //no room for the line: parse what the frame has, a longer line is cut
+            GPS_ParseFrame();
+            if(len > GPS_NMEA_FRAME_BUFFER_LENGTH)
+                len = GPS_NMEA_FRAME_BUFFER_LENGTH;
         }
-        else//no NMEA command
+        uint8_t* line = tmp + tmpLen;
+        if(!Buffer_Gets(&gpsNmeaBuffer,line,(uint16_t)len))
         {
-            index = Buffer_Query(&gpsNmeaBuffer,(uint8_t*)GPS_CMD_BINARY_HEADER,2,Buffer_StartPostion(&gpsNmeaBuffer));
-            if(index >= 0)//find binary command
-            {
-                index2 = Buffer_Query(&gpsNmeaBuffer,"\r\n",strlen("\r\n"),index);
-                if(index2 >= 0)//find one frame command
-                {
-                    GPS_DEBUG_I("GPS find binary ack message");
-                    memset(tmp,0,sizeof(tmp));
-                    uint32_t len = Buffer_Size2(&gpsNmeaBuffer,index2)+1;
-                    len = len>GPS_NMEA_FRAME_BUFFER_LENGTH?GPS_NMEA_FRAME_BUFFER_LENGTH:len;
-                    if(!Buffer_Gets(&gpsNmeaBuffer,tmp,(uint16_t)len))
-                    {
-                        GPS_DEBUG_I("get data from buffer fail");
-                        return;
-                    }
-                    // GPS_DEBUG_I("tmp:%s,%d,%d,%d",tmp,index,index2,len);
-                    if(semCmdSending)
-                    {
-                        // Assert(gpsAckMsg == NULL,"already malloced"); //test
-                        char* index0 = NULL;
-                        for(int i=1;i<len;++i)
-                        {
-                            if(tmp[i] == GPS_CMD_BINARY_HEADER[1] && tmp[i-1]==GPS_CMD_BINARY_HEADER[0])
-                            {
-                                index0 = tmp+i-1;
-                                break;
-                            }
-                        }
-                        // Assert(index0 != NULL,"index null"); //test
-                        len = len - ((uint32_t)index0 - (uint32_t)tmp);
-                        gpsAckMsg = OS_Malloc(len);
-                        if(gpsAckMsg)
-                        {
-                            memcpy(gpsAckMsg,index0,len);
-                            GPS_DEBUG_MEM(gpsAckMsg,len,16);
-                            OS_ReleaseSemaphore(semCmdSending);
-                        }
-                    }
-                }
-            }
+            GPS_DEBUG_I("get data from buffer fail");
+            return;
         }
+        line[len] = '\0';
+        if(GPS_CMDAck(line,len))
+            continue;
+        tmpLen += len;
+        if(strstr((char*)line,"VTG"))
+            GPS_ParseFrame();
     }
 }
 
@@ -357,9 +299,10 @@ GPS_CMD_Ack_t GPS_AckCheck(char* ackStr, GPS_CMD_t cmdSend)
 }
 
 /**
- * Add parity tail and send to gps
+ * Add parity tail
+ * @return length of the command to send
  */
-void GPS_CMDSend(char* str,GPS_Format_t format)
+static uint16_t GPS_CMDFrame(char* str,GPS_Format_t format)
 {
     if(format == GPS_FORMAT_NMEA)
     {
@@ -375,9 +318,8 @@ void GPS_CMDSend(char* str,GPS_Format_t format)
         *(str+i++) = '\r';
         *(str+i++) = '\n';
         *(str+i) = 0;
-        GPS_DEBUG_I("gps send nmea cmd:%s,len:%d",str,strlen(str));
-        Buffer_Clear(&gpsNmeaBuffer);
-        GPS_Send(str,strlen(str));
+        GPS_DEBUG_I("gps nmea cmd:%s,len:%d",str,strlen(str));
+        return i;
     }
     else
     {
@@ -391,110 +333,408 @@ void GPS_CMDSend(char* str,GPS_Format_t format)
         data[len] = result;
         data[len+1] = 0x0D;
         data[len+2] = 0x0A;
-        GPS_DEBUG_I("gsp send binary cmd,len:%d",len+3);
+        GPS_DEBUG_I("gps binary cmd,len:%d",len+3);
         GPS_DEBUG_MEM(data,len+3,16);
-        GPS_Send(data,len+3);
+        return len+3;
     }
 }
 
-void OnCmdAckFail(void* param)
+/**
+ * Command queue. A command waits in a slot until it may be sent and then until its ack
+ * comes or its timeout passes; the acks are told apart by the command they answer.
+ * Up to GPS_CMD_PIPELINE commands are on the way at once, but not two of the same
+ * command, and the commands that change how the gps answers (reboot, standby, erase,
+ * format) go alone. A command waits while the gps is in the other format, and fails when
+ * no format command is left that could switch it there (the last one was not acked).
+ */
+typedef enum{
+    GPS_CMD_SLOT_FREE = 0,
+    GPS_CMD_SLOT_QUEUED,
+    GPS_CMD_SLOT_SENT,
+}GPS_CMD_Slot_State_t;
+
+typedef struct{
+    GPS_CMD_Slot_State_t state;
+    GPS_CMD_t            cmd;
+    GPS_Format_t         format;
+    uint16_t             timeout;
+    uint16_t             len;
+    uint32_t             seq;        //queue order
+    uint32_t             sent;       //clock() when sent
+    GPS_CMD_Callback_t   done;
+    void*                param;
+    uint8_t*             data;       //str, or the binary frame of the caller, who waits for it
+    char                 str[GPS_CMD_STR_MAX];
+}GPS_CMD_Slot_t;
+
+static GPS_CMD_Slot_t gpsCmdQueue[GPS_CMD_QUEUE_SIZE];
+static uint32_t       gpsCmdSeq = 0;
+static bool           gpsCmdTimerOn = false;
+static GPS_Format_t   gpsCmdFormat = GPS_FORMAT_NMEA;   //format the gps reads now
+
+static void GPS_CMDTimer(void* param);
+
+static bool GPS_CMDIsBarrier(GPS_CMD_t cmd)
 {
-    isCmdSendTimeOut = true;
-    OS_ReleaseSemaphore(semCmdSending);    
-    GPS_DEBUG_I("gps ack time out");
+    return cmd == GPS_CMD_REBOOT || cmd == GPS_CMD_ERASE_INFO_IN_FLASH ||
+           cmd == GPS_CMD_STANDBY_MODE || cmd == GPS_CMD_FORMAT;
 }
 
-/**
- * Send command and wait for acknowledgement from gps
- * @return GPS_CMD_t: return GPS_CMD_FAIL if wait ack fail
- *                    return GPS_CMD_* command if get ack success, and the return value is the ack cmd
- * 
- */
-GPS_CMD_t GPS_SendCMDWaitAck(GPS_CMD_t cmdSend, char* cmdStr,GPS_Format_t format, char** ackStr, uint16_t timeout)
+//the next command to send, NULL if it has to wait for acks; call in a critical section
+static GPS_CMD_Slot_t* GPS_CMDNext()
 {
+    GPS_CMD_Slot_t* next = NULL;
+    uint8_t sent = 0;
+    for(int i=0;i<GPS_CMD_QUEUE_SIZE;++i)
+    {
+        GPS_CMD_Slot_t* slot = &gpsCmdQueue[i];
+        if(slot->state == GPS_CMD_SLOT_SENT)
+        {
+            if(GPS_CMDIsBarrier(slot->cmd))
+                return NULL;
+            ++sent;
+        }
+        else if(slot->state == GPS_CMD_SLOT_QUEUED && slot->format == gpsCmdFormat &&
+                (!next || (int32_t)(slot->seq - next->seq) < 0))
+            next = slot;
+    }
+    if(!next || sent >= GPS_CMD_PIPELINE || (sent && GPS_CMDIsBarrier(next->cmd)))
+        return NULL;
+    for(int i=0;i<GPS_CMD_QUEUE_SIZE;++i)
+    {
+        if(gpsCmdQueue[i].state == GPS_CMD_SLOT_SENT && gpsCmdQueue[i].cmd == next->cmd)
+            return NULL;
+    }
+    return next;
+}
 
-    isCmdSendTimeOut = false;
-    semCmdSending = OS_CreateSemaphore(0);
-    GPS_CMDSend(cmdStr,format);
-    OS_StartCallbackTimer(OS_GetUserMainHandle(),timeout,OnCmdAckFail,NULL);
-    OS_WaitForSemaphore(semCmdSending,OS_TIME_OUT_WAIT_FOREVER);
-    OS_DeleteSemaphore(semCmdSending);
-    semCmdSending = NULL;
-    if(isCmdSendTimeOut)
+static void GPS_CMDComplete(GPS_CMD_Slot_t* slot, GPS_CMD_Ack_t result, const char* ack);
+
+//a queued command in the other format with no format command pending; call in a critical section
+static GPS_CMD_Slot_t* GPS_CMDStranded()
+{
+    GPS_CMD_Slot_t* stranded = NULL;
+    for(int i=0;i<GPS_CMD_QUEUE_SIZE;++i)
     {
-        GPS_DEBUG_I("GPS exec command fail");
-        return GPS_CMD_FAIL;
+        GPS_CMD_Slot_t* slot = &gpsCmdQueue[i];
+        if(slot->state != GPS_CMD_SLOT_FREE && slot->cmd == GPS_CMD_FORMAT)
+            return NULL;
+        if(slot->state == GPS_CMD_SLOT_QUEUED && slot->format != gpsCmdFormat)
+            stranded = slot;
     }
-    else
+    return stranded;
+}
+
+//send what the queue allows, fail what it never will
+static void GPS_CMDDispatch()
+{
+    while(1)
     {
-        OS_StopCallbackTimer(OS_GetUserMainHandle(),OnCmdAckFail,NULL);
-        char* ack = NULL;
-        if(((gpsAckMsg[0]&0xff) == GPS_CMD_BINARY_HEADER[0]) && ((gpsAckMsg[1]&0xff) == GPS_CMD_BINARY_HEADER[1]))
-        {//binary ack
-            if(!GPS_CheckParityBinary(gpsAckMsg))
-            {
-                GPS_DEBUG_I("check parity binary fail");
-                return GPS_CMD_FAIL;
-            }
-            *ackStr = gpsAckMsg;
-            return GPS_GetAckCmdBinary(gpsAckMsg);
-        }
-        else
+        uint32_t status = SYS_EnterCriticalSection();
+        GPS_CMD_Slot_t* slot = GPS_CMDStranded();
+        SYS_ExitCriticalSection(status);
+        if(!slot)
+            break;
+        GPS_DEBUG_I("gps in the other format, cmd:%d failed",slot->cmd);
+        GPS_CMDComplete(slot,GPS_CMD_ACK_FAIL,NULL);
+    }
+    while(1)
+    {
+        bool startTimer = false;
+        uint32_t status = SYS_EnterCriticalSection();
+        GPS_CMD_Slot_t* slot = GPS_CMDNext();
+        if(slot)
         {
-            ack = strstr(gpsAckMsg,GPS_CMD_HEADER);
-            //check parity 
-            if(!GPS_CheckParity(ack))
-            {
-                GPS_DEBUG_I("check parity fail");
-                return GPS_CMD_FAIL;
-            }
-            *ackStr = ack;
-            GPS_DEBUG_I("ack string:%s",ack);
-            return GPS_GetAckCmd(ack);
+            slot->state = GPS_CMD_SLOT_SENT;
+            slot->sent = clock();
+            startTimer = !gpsCmdTimerOn;
+            gpsCmdTimerOn = true;
         }
+        SYS_ExitCriticalSection(status);
+        if(!slot)
+            return;
+        if(startTimer)
+            OS_StartCallbackTimer(OS_GetUserMainHandle(),GPS_CMD_TICK_MS,GPS_CMDTimer,NULL);
+        GPS_DEBUG_I("gps send cmd:%d",slot->cmd);
+        GPS_Send((char*)slot->data,slot->len);
     }
 }
 
+//free the slot and tell the caller
+static void GPS_CMDComplete(GPS_CMD_Slot_t* slot, GPS_CMD_Ack_t result, const char* ack)
+{
+    GPS_CMD_t cmd = slot->cmd;
+    GPS_CMD_Callback_t done = slot->done;
+    void* param = slot->param;
+    if(cmd == GPS_CMD_FORMAT && result == GPS_CMD_ACK_EXEC_SUCCESS)
+    {
+        //$PGKC149,<format>,<baudrate> or the binary 149 with the format at [6]
+        bool binary = (slot->format == GPS_FORMAT_NMEA) ? (slot->str[9] == '1') : (slot->data[6] == 1);
+        gpsCmdFormat = binary ? GPS_FORMAT_BINARY : GPS_FORMAT_NMEA;
+    }
+    uint32_t status = SYS_EnterCriticalSection();
+    slot->state = GPS_CMD_SLOT_FREE;
+    SYS_ExitCriticalSection(status);
+    if(done)
+        done(param,cmd,result,ack);
+}
 
-static bool GPS_SendWaiteNormalAck(GPS_CMD_t cmdSend, char* cmdStr, GPS_Format_t format, uint16_t timeout)
+//times out the commands without ack, runs in the main task every GPS_CMD_TICK_MS while commands are sent
+static void GPS_CMDTimer(void* param)
 {
-    char* ackStr = NULL;
-    GPS_CMD_t ackCmd;
-    GPS_CMD_Ack_t result;
-    
-    ackCmd = GPS_SendCMDWaitAck(cmdSend,cmdStr,format,&ackStr,timeout);
-    if((ackCmd != GPS_CMD_ACK) && (ackCmd != GPS_CMD_ACK_GPD))
+    uint32_t now = clock();
+    bool busy = false;
+    for(int i=0;i<GPS_CMD_QUEUE_SIZE;++i)
+    {
+        GPS_CMD_Slot_t* slot = &gpsCmdQueue[i];
+        if(slot->state != GPS_CMD_SLOT_SENT)
+            continue;
+        if(now - slot->sent >= slot->timeout * CLOCKS_PER_MSEC)
+        {
+            GPS_DEBUG_I("gps ack time out, cmd:%d",slot->cmd);
+            GPS_CMDComplete(slot,GPS_CMD_ACK_FAIL,NULL);
+        }
+    }
+    uint32_t status = SYS_EnterCriticalSection();
+    for(int i=0;i<GPS_CMD_QUEUE_SIZE;++i)
+        busy |= (gpsCmdQueue[i].state == GPS_CMD_SLOT_SENT);
+    gpsCmdTimerOn = busy;
+    SYS_ExitCriticalSection(status);
+    if(busy)
+        OS_StartCallbackTimer(OS_GetUserMainHandle(),GPS_CMD_TICK_MS,GPS_CMDTimer,NULL);
+    GPS_CMDDispatch();
+}
+
+/**
+ * route an ack line to the oldest command sent that it answers
+ * @return false if the line is no ack
+ */
+static bool GPS_CMDAck(uint8_t* line, uint32_t len)
+{
+    GPS_CMD_t ackFor;
+    int result;
+    int32_t pack = -1;
+    char* ack = NULL;
+    uint8_t* binary = NULL;
+
+    for(uint32_t i=1;i<len;++i)
     {
-        GPS_DEBUG_I("ack cmd check fail, wish:%d, actual:%d",GPS_CMD_ACK,ackCmd);
-        goto fail;
+        if(line[i] == GPS_CMD_BINARY_HEADER[1] && line[i-1] == GPS_CMD_BINARY_HEADER[0])
+        {
+            binary = line+i-1;
+            break;
+        }
     }
-    if(ackCmd == GPS_CMD_ACK_GPD)
-    {//0xaa,0xf0,0x0c,0x00,0x03,0x00,0x00,0x00,0x01,0x0e,0x0d,0x0a 
-        if( (cmdStr[6]!= ackStr[6]) || (cmdStr[7]!= ackStr[7]) || (ackStr[8]!=1))
+    if(binary)
+    {
+        //0xaa,0xf0,<length:2>,<id:2>,<command or gpd pack:2>,<result>,<parity>,0x0d,0x0a
+        uint16_t frameLen = (binary[2]&0x00ff) | (binary[3] << 8 & 0xff00);
+        if(frameLen < 12 || frameLen > line + len - binary || !GPS_CheckParityBinary(binary))
+        {
+            GPS_DEBUG_I("check parity binary fail");
+            return true;
+        }
+        uint16_t id = (binary[4]&0x00ff) | (binary[5] << 8 & 0xff00);
+        uint16_t arg = (binary[6]&0x00ff) | (binary[7] << 8 & 0xff00);
+        if(id == GPS_CMD_ACK_GPD)
         {
-            GPS_DEBUG_I("ack pack number error");
-            goto fail;
+            ackFor = GPS_CMD_GPD_PACK;
+            pack = arg;
+            result = (binary[8] == 1) ? GPS_CMD_ACK_EXEC_SUCCESS : GPS_CMD_ACK_EXEC_FAIL;
         }
+        else if(id == GPS_CMD_ACK)
+        {
+            ackFor = (GPS_CMD_t)arg;
+            result = binary[8];
+        }
+        else
+            return true;
     }
     else
     {
-        result = GPS_AckCheck(ackStr,cmdSend);
-        if(result != GPS_CMD_ACK_EXEC_SUCCESS)
+        //$PGKC001,<command>,<result>*xx or $PGKC463,<version>*xx
+        ack = strstr((char*)line,GPS_CMD_HEADER);
+        if(!ack)
+            return false;
+        if(!GPS_CheckParity(ack))
+        {
+            GPS_DEBUG_I("check parity fail");
+            return true;
+        }
+        *strchr(ack,'*') = '\0';
+        GPS_DEBUG_I("ack string:%s",ack);
+        uint16_t id = atoi(ack+strlen(GPS_CMD_HEADER));
+        char* field = strchr(ack,',');
+        if(id == GPS_CMD_ACK && field)
+        {
+            ackFor = (GPS_CMD_t)atoi(field+1);
+            field = strchr(field+1,',');
+            result = field ? atoi(field+1) : GPS_CMD_ACK_FAIL;
+        }
+        else if(id == GPS_CMD_ACK_VERSION)
+        {
+            ackFor = GPS_CMD_GET_VERSION;
+            result = GPS_CMD_ACK_EXEC_SUCCESS;
+        }
+        else
+            return true;    //other output of the gps
+    }
+    if(!GPS_IsCMDACKValid(result))
+        result = GPS_CMD_ACK_FAIL;
+
+    GPS_CMD_Slot_t* slot = NULL;
+    for(int i=0;i<GPS_CMD_QUEUE_SIZE;++i)
+    {
+        GPS_CMD_Slot_t* s = &gpsCmdQueue[i];
+        if(s->state == GPS_CMD_SLOT_SENT && s->cmd == ackFor &&
+           (pack < 0 || (s->data[6]|s->data[7]<<8) == pack) &&
+           (!slot || (int32_t)(s->seq - slot->seq) < 0))
+            slot = s;
+    }
+    if(!slot)
+    {
+        GPS_DEBUG_I("ack of no command sent:%d",ackFor);
+        return true;
+    }
+    GPS_CMDComplete(slot,(GPS_CMD_Ack_t)result,ack);
+    GPS_CMDDispatch();
+    return true;
+}
+
+/**
+ * queue a command, binary frames stay with the caller until it completes
+ * @return false if the queue is full
+ */
+static bool GPS_CMDPut(GPS_CMD_t cmd, char* cmdStr, GPS_Format_t format, uint16_t timeout, GPS_CMD_Callback_t done, void* param)
+{
+    uint16_t len = GPS_CMDFrame(cmdStr,format);
+    if(format == GPS_FORMAT_NMEA && len >= GPS_CMD_STR_MAX)
+    {
+        GPS_DEBUG_I("gps command too long:%d",len);
+        return false;
+    }
+    GPS_CMD_Slot_t* slot = NULL;
+    uint32_t status = SYS_EnterCriticalSection();
+    for(int i=0;i<GPS_CMD_QUEUE_SIZE && !slot;++i)
+    {
+        if(gpsCmdQueue[i].state == GPS_CMD_SLOT_FREE)
+            slot = &gpsCmdQueue[i];
+    }
+    if(slot)
+    {
+        slot->cmd = cmd;
+        slot->format = format;
+        slot->timeout = timeout;
+        slot->len = len;
+        slot->seq = gpsCmdSeq++;
+        slot->done = done;
+        slot->param = param;
+        if(format == GPS_FORMAT_NMEA)
         {
-            GPS_DEBUG_I("ack result:%d",result);
-            goto fail;
+            memcpy(slot->str,cmdStr,len+1);
+            slot->data = (uint8_t*)slot->str;
         }
+        else
+            slot->data = (uint8_t*)cmdStr;
+        slot->state = GPS_CMD_SLOT_QUEUED;
+    }
+    SYS_ExitCriticalSection(status);
+    if(!slot)
+    {
+        GPS_DEBUG_I("gps command queue full");
+        return false;
     }
-    OS_Free(gpsAckMsg);
-    gpsAckMsg = NULL;
+    GPS_CMDDispatch();
     return true;
+}
+
+bool GPS_CMDQueue(GPS_CMD_t cmd, const char* args, uint16_t timeout, GPS_CMD_Callback_t done, void* param)
+{
+    char temp[GPS_CMD_STR_MAX+6];
+    int len = snprintf(temp,GPS_CMD_STR_MAX,"%s%03d%s%s",GPS_CMD_HEADER,cmd,args?",":"",args?args:"");
+    if(len >= GPS_CMD_STR_MAX)
+        return false;
+    return GPS_CMDPut(cmd,temp,GPS_FORMAT_NMEA,timeout,done,param);
+}
+
+//a blocking command: the caller waits for the completion on a semaphore
+typedef struct{
+    HANDLE        sem;
+    uint16_t      timeout;
+    GPS_CMD_Ack_t result;
+    char*         ack;      //copy of the ack, NULL if not needed
+    uint8_t       ackLen;
+}GPS_CMD_Wait_t;
+
+static void GPS_CMDWaitDone(void* param, GPS_CMD_t cmd, GPS_CMD_Ack_t result, const char* ack)
+{
+    GPS_CMD_Wait_t* wait = (GPS_CMD_Wait_t*)param;
+    wait->result = result;
+    if(wait->ack)
+        snprintf(wait->ack,wait->ackLen,"%s",ack?ack:"");
+    OS_ReleaseSemaphore(wait->sem);
+}
 
-fail:
-    OS_Free(gpsAckMsg);
-    gpsAckMsg = NULL;
+static bool GPS_CMDStart(GPS_CMD_Wait_t* wait, GPS_CMD_t cmdSend, char* cmdStr, GPS_Format_t format, uint16_t timeout)
+{
+    wait->sem = OS_CreateSemaphore(0);
+    wait->timeout = timeout;
+    wait->result = GPS_CMD_ACK_FAIL;
+    if(GPS_CMDPut(cmdSend,cmdStr,format,timeout,GPS_CMDWaitDone,wait))
+        return true;
+    OS_DeleteSemaphore(wait->sem);
     return false;
 }
 
+//the timeout counts from the sending, so the commands queued ahead may each take theirs first
+#define GPS_CMD_WAIT_MARGIN   (GPS_CMD_QUEUE_SIZE*GPS_TIME_OUT_CMD)
+
+//the completion should come in any case; if it does not, the slot is taken back from the queue
+static GPS_CMD_Ack_t GPS_CMDFinish(GPS_CMD_Wait_t* wait)
+{
+    if(!OS_WaitForSemaphore(wait->sem,wait->timeout+GPS_CMD_WAIT_MARGIN))
+    {
+        bool found = false;
+        uint32_t status = SYS_EnterCriticalSection();
+        for(int i=0;i<GPS_CMD_QUEUE_SIZE;++i)
+        {
+            GPS_CMD_Slot_t* slot = &gpsCmdQueue[i];
+            if(slot->state != GPS_CMD_SLOT_FREE && slot->done == GPS_CMDWaitDone && slot->param == wait)
+            {
+                GPS_DEBUG_I("gps cmd:%d never completed",slot->cmd);
+                slot->state = GPS_CMD_SLOT_FREE;
+                found = true;
+            }
+        }
+        SYS_ExitCriticalSection(status);
+        //not found: the completion is on its way and releases the semaphore
+        if(!found)
+            OS_WaitForSemaphore(wait->sem,OS_TIME_OUT_WAIT_FOREVER);
+        else
+            GPS_CMDDispatch();
+    }
+    OS_DeleteSemaphore(wait->sem);
+    return wait->result;
+}
+
+/**
+ * Send command and wait for the acknowledgement from gps
+ * @return true if the gps executed the command
+ */
+static bool GPS_SendWaiteNormalAck(GPS_CMD_t cmdSend, char* cmdStr, GPS_Format_t format, uint16_t timeout)
+{
+    GPS_CMD_Wait_t wait = {0};
+    if(!GPS_CMDStart(&wait,cmdSend,cmdStr,format,timeout))
+        return false;
+    GPS_CMD_Ack_t result = GPS_CMDFinish(&wait);
+    if(result != GPS_CMD_ACK_EXEC_SUCCESS)
+    {
+        GPS_DEBUG_I("cmd:%d ack result:%d",cmdSend,result);
+        return false;
+    }
+    return true;
+}
+
 bool GPS_Reboot(GPS_Reboot_Mode_t mode)
 {
     GPS_CMD_t  cmdSend;
@@ -635,8 +875,8 @@ bool GPS_SetRtcTime(RTC_Time_t* t)
 //GOKE9501_1.3_17101100
 bool GPS_GetVersion(char* version, uint8_t len)
 {
-    char* ackStr = NULL;
-    GPS_CMD_t ackCmd;
+    GPS_CMD_Wait_t wait = {0};
+    char ack[GPS_CMD_STR_MAX];
     GPS_CMD_t cmdSend;
     char temp[GPS_BUFFER_MAX_LENGTH+6];
 
@@ -644,28 +884,20 @@ bool GPS_GetVersion(char* version, uint8_t len)
 
     snprintf(temp,GPS_BUFFER_MAX_LENGTH,"%s%03d",GPS_CMD_HEADER,cmdSend);
 
-    
-    ackCmd = GPS_SendCMDWaitAck(cmdSend,temp,GPS_FORMAT_NMEA,&ackStr,GPS_TIME_OUT_CMD);
-    if(ackCmd != GPS_CMD_ACK_VERSION)
+    wait.ack = ack;
+    wait.ackLen = sizeof(ack);
+    if(!GPS_CMDStart(&wait,cmdSend,temp,GPS_FORMAT_NMEA,GPS_TIME_OUT_CMD))
+        return false;
+    if(GPS_CMDFinish(&wait) != GPS_CMD_ACK_EXEC_SUCCESS)
     {
-        GPS_DEBUG_I("ack cmd check fail, wish:%d, actual:%d",GPS_CMD_ACK,ackCmd);
-        goto fail;
+        GPS_DEBUG_I("get version fail");
+        return false;
     }
-    char* index = strstr(ackStr,",");
-    char* index2 = strstr(index,"*");
-    if(index == NULL || index2 == NULL)
-        goto fail;
-    *index2 = '\0';
+    char* index = strstr(ack,",");
+    if(index == NULL)
+        return false;
     snprintf(version,len,"%s",index);
-
-    OS_Free(gpsAckMsg);
-    gpsAckMsg = NULL;
     return true;
-
-fail:
-    OS_Free(gpsAckMsg);
-    gpsAckMsg = NULL;
-    return false;
 }
 bool GPS_SetLocationTime(float latitude, float longitude, float altitude, RTC_Time_t* t)
 {
@@ -697,104 +929,200 @@ bool GPS_SetFixMode(GPS_Fix_Mode_t mode)
 }
 
 
-//http get with no header
-static int Http_Get(const char* domain, int port,const char* path, char* retBuffer, int* bufferLen)
+//wait up to GPS_GPD_HTTP_TIMEOUT seconds and receive, 0 if the server closed, -1 on error or timeout
+static int GPD_HttpRecv(int fd, uint8_t* data, int len)
+{
+    struct fd_set fds;
+    struct timeval timeout={GPS_GPD_HTTP_TIMEOUT,0};
+    FD_ZERO(&fds);
+    FD_SET(fd,&fds);
+    int ret = select(fd+1,&fds,NULL,NULL,&timeout);
+    if(ret <= 0)
+    {
+        GPS_DEBUG_I("select error or timeout:%d",ret);
+        return -1;
+    }
+    ret = recv(fd,data,len,0);
+    GPS_DEBUG_I("recv:%d",ret);
+    return ret < 0 ? -1 : ret;
+}
+
+//value of header field name (lower case) in the header, -1 if it is missing
+static int32_t GPD_HttpHeaderValue(const char* header, const char* name)
+{
+    int nameLen = strlen(name);
+    for(const char* line = strstr(header,"\r\n"); line; line = strstr(line+2,"\r\n"))
+    {
+        const char* field = line + 2;
+        int i = 0;
+        while(i < nameLen && field[i] && (field[i] | 0x20) == name[i])
+            ++i;
+        if(i == nameLen && field[i] == ':')
+            return atoi(field + i + 1);
+    }
+    return -1;
+}
+
+/**
+ * connect, request the file from http->received on and read the response header;
+ * body bytes that came with the header stay in http->buf
+ */
+static bool GPD_HttpConnect(GPS_GPD_Http_t* http)
 {
-    bool flag = false;
-    uint16_t recvLen = 0;
     uint8_t ip[16];
-    int retBufferLen = *bufferLen;
-    //connect server
     memset(ip,0,sizeof(ip));
-    if(DNS_GetHostByName2(domain,ip) != 0)
+    if(DNS_GetHostByName2(GPS_AGPS_GPD_FILE_SERVER,ip) != 0)
     {
         GPS_DEBUG_I("get ip error");
-        return -1;
+        return false;
     }
-    GPS_DEBUG_I("get ip success:%s -> %s",domain,ip);
-    char* servInetAddr = ip;
-    snprintf(retBuffer,retBufferLen,"GET %s HTTP/1.1\r\nHost: %s\r\n\r\n",path,domain);
-    char* pData = retBuffer;
-    int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if(fd < 0){
+    http->fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if(http->fd < 0)
+    {
         GPS_DEBUG_I("socket fail");
-        return -1;
+        return false;
     }
-    GPS_DEBUG_I("fd:%d",fd);
-
     struct sockaddr_in sockaddr;
     memset(&sockaddr,0,sizeof(sockaddr));
     sockaddr.sin_family = AF_INET;
-    sockaddr.sin_port = htons(port);
-    inet_pton(AF_INET,servInetAddr,&sockaddr.sin_addr);
-
-    int ret = connect(fd, (struct sockaddr*)&sockaddr, sizeof(struct sockaddr_in));
-    if(ret < 0){
+    sockaddr.sin_port = htons(GPS_AGPS_GPD_FILE_SERVER_PORT);
+    inet_pton(AF_INET,(char*)ip,&sockaddr.sin_addr);
+    if(connect(http->fd, (struct sockaddr*)&sockaddr, sizeof(struct sockaddr_in)) < 0)
+    {
         GPS_DEBUG_I("socket connect fail");
-        close(fd);
-        return -1;
+        return false;
     }
-    GPS_DEBUG_I("socket connect success");
-    GPS_DEBUG_I("send request:%s",pData);
-    ret = send(fd, pData, strlen(pData), 0);
-    if(ret < 0){
+
+    //a resumed download asks for the rest of the file only
+    int len = snprintf(http->buf,sizeof(http->buf),"GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n",
+                       GPS_AGPS_GPD_FILE_PATH,GPS_AGPS_GPD_FILE_SERVER);
+    if(http->received)
+        len += snprintf(http->buf+len,sizeof(http->buf)-len,"Range: bytes=%u-\r\n",(unsigned int)http->received);
+    len += snprintf(http->buf+len,sizeof(http->buf)-len,"\r\n");
+    if(send(http->fd,http->buf,len,0) != len)
+    {
         GPS_DEBUG_I("socket send fail");
-        close(fd);
-        return -1;
+        return false;
     }
-    GPS_DEBUG_I("socket send success");
 
-    struct fd_set fds;
-    struct timeval timeout={12,0};
-    FD_ZERO(&fds);
-    FD_SET(fd,&fds);
-    while(!flag)
+    //header
+    int fill = 0;
+    char* body = NULL;
+    while(!body)
     {
-        ret = select(fd+1,&fds,NULL,NULL,&timeout);
-        switch(ret)
+        if(fill >= (int)sizeof(http->buf) - 1)
         {
-            case -1:
-                GPS_DEBUG_I("select error");
-                flag = true;
-                break;
-            case 0:
-                GPS_DEBUG_I("select timeout");
-                flag = true;
-                break;
-            default:
-                if(FD_ISSET(fd,&fds))
-                {
-                    GPS_DEBUG_I("select return:%d",ret);
-                    memset(retBuffer+recvLen,0,retBufferLen-recvLen);
-                    ret = recv(fd,retBuffer+recvLen,retBufferLen-recvLen,0);
-                    GPS_DEBUG_I("ret:%d",ret);
-                    recvLen += ret;
-                    if(ret < 0)
-                    {
-                        GPS_DEBUG_I("recv error");
-                        flag = true;
-                        break;
-                    }
-                    else if(ret == 0)
-                    {
-                        GPS_DEBUG_I("ret == 0");
-                        flag = true;
-                        break;
-                    }
-                    else if(ret < 1352)
-                    {
-                        GPS_DEBUG_I("recv len:%d,data:%s",recvLen,retBuffer);
-                        *bufferLen = recvLen;
-                        close(fd);
-                        return recvLen;
-                    }                  
-                    
-                }
-                break;
+            GPS_DEBUG_I("http header too long");
+            return false;
         }
+        int ret = GPD_HttpRecv(http->fd,(uint8_t*)http->buf+fill,sizeof(http->buf)-1-fill);
+        if(ret <= 0)
+            return false;
+        fill += ret;
+        http->buf[fill] = '\0';
+        body = strstr(http->buf,"\r\n\r\n");
     }
-    close(fd);
-    return -1;
+    body[2] = '\0';    //ends the header for the field search, the body starts at body+4
+    int status = 0;
+    if(strncmp(http->buf,"HTTP/1.",7) != 0 || (status = atoi(http->buf+9)) == 0)
+        return false;
+    GPS_DEBUG_I("http status:%d",status);
+    uint32_t skip = 0;
+    if(status == 206 && http->received)
+    {
+        //the rest of the file, as asked
+    }
+    else if(status == 200)
+    {
+        //the whole file: what was received before is skipped
+        skip = http->received;
+        http->length = GPD_HttpHeaderValue(http->buf,"content-length");
+    }
+    else
+    {
+        GPS_DEBUG_I("http response status:%d",status);
+        return false;
+    }
+    http->bufStart = (uint16_t)(body + 4 - http->buf);
+    http->bufLen   = (uint16_t)(fill - http->bufStart);
+
+    while(skip)
+    {
+        if(http->bufLen == 0)
+        {
+            int ret = GPD_HttpRecv(http->fd,(uint8_t*)http->buf,sizeof(http->buf));
+            if(ret <= 0)
+                return false;
+            http->bufStart = 0;
+            http->bufLen = ret;
+        }
+        uint16_t n = skip < http->bufLen ? skip : http->bufLen;
+        http->bufStart += n;
+        http->bufLen -= n;
+        skip -= n;
+    }
+    return true;
+}
+
+bool GPS_GPDHttpOpen(GPS_GPD_Http_t* http)
+{
+    memset(http,0,sizeof(*http));
+    http->fd = -1;
+    http->length = -1;
+    if(GPD_HttpConnect(http))
+        return true;
+    GPS_GPDHttpClose(http);
+    return false;
+}
+
+int GPS_GPDHttpRead(void* param, uint8_t* data, int len)
+{
+    GPS_GPD_Http_t* http = (GPS_GPD_Http_t*)param;
+    for(;;)
+    {
+        if(http->length >= 0)
+        {
+            if(http->received >= (uint32_t)http->length)
+                return 0;
+            if((uint32_t)len > http->length - http->received)
+                len = http->length - http->received;
+        }
+        int ret;
+        if(http->bufLen)
+        {
+            ret = len < http->bufLen ? len : http->bufLen;
+            memcpy(data,http->buf+http->bufStart,ret);
+            http->bufStart += ret;
+            http->bufLen -= ret;
+        }
+        else
+        {
+            //straight to the caller's buffer, no copy
+            ret = GPD_HttpRecv(http->fd,data,len);
+        }
+        if(ret > 0)
+        {
+            http->received += ret;
+            return ret;
+        }
+        if(ret == 0 && http->length < 0)
+            return 0;   //closed: the end of a file of unknown length
+        //broken before the end: resume where it stopped
+        if(http->length < 0 || ++http->retries > GPS_GPD_HTTP_RETRIES)
+            return -1;
+        GPS_DEBUG_I("resume at %d",http->received);
+        close(http->fd);
+        http->fd = -1;
+        if(!GPD_HttpConnect(http))
+            return -1;
+    }
+}
+
+void GPS_GPDHttpClose(GPS_GPD_Http_t* http)
+{
+    if(http->fd >= 0)
+        close(http->fd);
+    http->fd = -1;
 }
 
 
@@ -828,164 +1156,173 @@ bool GPS_SetNMEAMode()
     return GPS_SendWaiteNormalAck(cmdSend,temp,GPS_FORMAT_BINARY,GPS_TIME_OUT_CMD);
 }
 
+//binary frame of GPD pack index around the data at frame+GPS_GPD_FRAME_HEADER
+static void GPD_Frame(uint8_t* frame, uint16_t index)
+{
+    //header, index, 512 data bytes, parity and \r\n; the end pack has no data
+    uint16_t len = (index == 0xffff) ? 0x000b : GPS_GPD_FRAME_SIZE;
+    frame[0] = GPS_CMD_BINARY_HEADER[0];
+    frame[1] = GPS_CMD_BINARY_HEADER[1];
+    frame[2] = len&0xff;
+    frame[3] = (len>>8) & 0x00ff;
+    frame[4] = (GPS_CMD_GPD_PACK&0xff);
+    frame[5] = (GPS_CMD_GPD_PACK>>8&0x00ff);
+    frame[6] = index&0xff;
+    frame[7] = (index>>8) & 0x00ff;
+}
+
 //send 512 bytes pack  data, padding 0 if less than 512 bytes
 bool GPS_SendGPDPack(uint16_t index, uint8_t* pack)
 {
-    GPS_CMD_t  cmdSend;
-    uint8_t temp[GPS_BUFFER_MAX_LENGTH+6];
-    uint16_t len = 523;//512+8+3
-
-    if(index == 0xffff)
-    {
-        len = 0x000b;
-    }
+    uint8_t frame[GPS_GPD_FRAME_SIZE];
 
-    cmdSend = GPS_CMD_GPD_PACK;
-    temp[0] = GPS_CMD_BINARY_HEADER[0];
-    temp[1] = GPS_CMD_BINARY_HEADER[1];
-    temp[2] = len&0xff;
-    temp[3] = (len>>8) & 0x00ff;
-    temp[4] = (cmdSend&0xff);
-    temp[5] = (cmdSend>>8&0x00ff);
-    temp[6] = index&0xff;
-    temp[7] = (index>>8) & 0x00ff;
+    GPD_Frame(frame,index);
     if(pack)
-        memcpy(temp+8,pack,512);
-    return GPS_SendWaiteNormalAck(cmdSend,temp,GPS_FORMAT_BINARY,GPS_TIME_OUT_CMD);
+        memcpy(frame+GPS_GPD_FRAME_HEADER,pack,GPS_GPD_PACK_SIZE);
+    return GPS_SendWaiteNormalAck(GPS_CMD_GPD_PACK,(char*)frame,GPS_FORMAT_BINARY,GPS_TIME_OUT_CMD);
 }
 
-
-/**
- * do AGPS process, to accelerate GPS fix( download brdc GPD file and upload to GPS, and set location and time)
- * @param latitude:  latitude got from lbs
- * @param longitude: longitude got from lbs
- * @param altitude:  altitude, you can get from internet or set to zero
- * @param downloadGPD: the GPD file size about 3.4k, file change in every 2 hours, and file is valid in 6 hours,
- *                     you can only update onece in 2 hours or 6 hours to save money
- * @return execute agps proccess success or not
- */
-bool GPS_AGPS(float latitude, float longitude, float altitude, bool downloadGPD)
+//fill a pack from read(), @return bytes read, 0 at the end of the file, -1 on error
+static int GPD_ReadPack(GPS_GPD_Read_t source, void* param, uint8_t* pack)
 {
-    char* buffer = NULL;
-
-    if(downloadGPD)
+    int fill = 0;
+    while(fill < GPS_GPD_PACK_SIZE)
     {
-        ///////////////////////////////////////////////////////////
-        //1. get GPD file from server
-        int bufferLen = 5120; // if(bufferLen%512 != 0) bufferLen >= gpd_file_len + (512-gpd_file_len%512)
-        buffer = (char*)OS_Malloc(bufferLen);
-        if(!buffer)
-        {
-            GPS_DEBUG_I("malloc fail");
-            return false;
-        }
-        memset(buffer,0,bufferLen);
-        int ret = Http_Get(GPS_AGPS_GPD_FILE_SERVER,GPS_AGPS_GPD_FILE_SERVER_PORT,
-                GPS_AGPS_GPD_FILE_PATH,buffer,&bufferLen);
+        int ret = source(param,pack+fill,GPS_GPD_PACK_SIZE-fill);
         if(ret < 0)
-        {
-            GPS_DEBUG_I("http get fail");
-            OS_Free(buffer);
-            return false;
-        }
-        char* indexResult = strstr(buffer,"200 OK");
-        if(!indexResult)
-        {
-            GPS_DEBUG_I("http get response error:%s",buffer);
-            OS_Free(buffer);
-            return false; 
-        }
-        char* indexBody = strstr(indexResult,"\r\n\r\n");
-        if(!indexBody)
-        {
-            GPS_DEBUG_I("http get response content error:%s",buffer);
-            OS_Free(buffer);
-            return false; 
-        }
-        indexBody+=4;
-        uint8_t* gpdData = indexBody;
-        uint16_t gpdLen  = ret-(indexBody-buffer);
-        GPS_DEBUG_I("GPD file length:%d",gpdLen);
-        if(gpdLen%512)//padding 0 
-        {
-            memset(gpdData+gpdLen,0,512 - gpdLen%512);
-            gpdLen = gpdLen + (512 - gpdLen%512);
-        }
-        GPS_DEBUG_I("GPD file length(with padding 0):%d",gpdLen);
-        GPS_DEBUG_MEM(gpdData,gpdLen,16);
-        
-        ///////////////////////////////////////////////////////////
-        //2. set mode to binary mode
-        if(!GPS_SetBinaryMode())
-        {
-            GPS_DEBUG_I("set binary mode fail");
+            return -1;
+        if(ret == 0)
+            break;
+        fill += ret;
+    }
+    return fill;
+}
+
+//send the frame up to GPS_GPD_SEND_RETRIES times, the next pack is read while the first ack is awaited
+static bool GPD_SendFrame(uint8_t* frame, GPS_GPD_Read_t source, void* param, uint8_t* next, int* nextFill)
+{
+    for(int attempt = 0; attempt <= GPS_GPD_SEND_RETRIES; ++attempt)
+    {
+        GPS_CMD_Wait_t wait = {0};
+        if(!GPS_CMDStart(&wait,GPS_CMD_GPD_PACK,(char*)frame,GPS_FORMAT_BINARY,GPS_TIME_OUT_CMD))
             return false;
-        }
+        if(attempt == 0 && next)
+            *nextFill = GPD_ReadPack(source,param,next);
+        if(GPS_CMDFinish(&wait) == GPS_CMD_ACK_EXEC_SUCCESS)
+            return true;
+        GPS_DEBUG_I("gpd pack %d not acked",frame[6]|frame[7]<<8);
+    }
+    return false;
+}
+
+int GPS_GPDStream(GPS_GPD_Read_t source, void* param, GPS_GPD_Tap_t tap, void* tapParam)
+{
+    //two frames: one waits for its ack while the other fills
+    uint8_t frames[2][GPS_GPD_FRAME_SIZE];
+    int cur = 0;
+    int fill = GPD_ReadPack(source,param,frames[cur]+GPS_GPD_FRAME_HEADER);
+    if(fill <= 0)
+        return -1;
 
-        ///////////////////////////////////////////////////////////
-        //3. send gpd file to gps chip
-        //512 bytes evry time transmission(padding 0 if less than 512 bytes)
-        uint16_t i=0;
-        uint8_t sendFailTimes = 0;
+    ///////////////////////////////////////////////////////////
+    //1. set mode to binary mode
+    if(!GPS_SetBinaryMode())
+    {
+        GPS_DEBUG_I("set binary mode fail");
+        return -1;
+    }
 
-        for(;;)
+    ///////////////////////////////////////////////////////////
+    //2. send the file as it arrives, 512 bytes per pack (padding 0), pack 0xffff ends it
+    uint32_t total = 0;
+    uint16_t index = 0;
+    bool ok = true;
+    while(fill > 0)
+    {
+        uint8_t* pack = frames[cur]+GPS_GPD_FRAME_HEADER;
+        if(tap && !tap(tapParam,pack,fill))
         {
-            if(i*512 > gpdLen)
-            {
-                if(!GPS_SendGPDPack(0xffff,NULL))//end
-                {
-                    if(++sendFailTimes > 3)
-                    {
-                        GPS_DEBUG_I("send gpd file max retry");
-                        if(!GPS_SetNMEAMode())
-                            GPS_DEBUG_I("set nmea mode fail");
-                        return false;
-                    }
-                    continue;
-                }
-                break;
-            }
-            if(!GPS_SendGPDPack(i,gpdData+i*512))//send fail
-            {
-                if(++sendFailTimes > 3)
-                {
-                    GPS_DEBUG_I("send gpd file max retry");
-                    if(!GPS_SetNMEAMode())
-                        GPS_DEBUG_I("set nmea mode fail");
-                    return false;
-                }
-                continue;   
-            }
-            sendFailTimes = 0;
-            ++i;
+            ok = false;
+            break;
         }
-        GPS_DEBUG_I("send gpd file to gps success");
-        
-        ///////////////////////////////////////////////////////////
-        //4. set mode to nmea mode
-        if(!GPS_SetNMEAMode())
+        if(fill < GPS_GPD_PACK_SIZE)
+            memset(pack+fill,0,GPS_GPD_PACK_SIZE-fill);
+        GPD_Frame(frames[cur],index);
+        int next = 0;
+        bool more = (fill == GPS_GPD_PACK_SIZE);
+        if(!GPD_SendFrame(frames[cur],source,param,more ? frames[!cur]+GPS_GPD_FRAME_HEADER : NULL,&next) || next < 0)
         {
-            GPS_DEBUG_I("set nmea mode fail");
-            return false;
+            GPS_DEBUG_I("send gpd file fail at pack %d",index);
+            ok = false;
+            break;
         }
-
+        total += fill;
+        ++index;
+        cur = !cur;
+        fill = next;
+    }
+    if(ok)
+    {
+        GPD_Frame(frames[cur],0xffff);
+        ok = GPD_SendFrame(frames[cur],NULL,NULL,NULL,NULL);
     }
+    GPS_DEBUG_I("send gpd file %d bytes:%d",total,ok);
 
     ///////////////////////////////////////////////////////////
-    //5. set gps rtc time
+    //3. set mode to nmea mode
+    if(!GPS_SetNMEAMode())
+    {
+        GPS_DEBUG_I("set nmea mode fail");
+        return -1;
+    }
+    return ok ? (int)total : -1;
+}
+
+/**
+ * set gps rtc time from the module rtc, then the reference location and time
+ */
+bool GPS_SetSeed(float latitude, float longitude, float altitude)
+{
     RTC_Time_t time;
     TIME_GetRtcTime(&time);
     if(!GPS_SetRtcTime(&time))
         GPS_DEBUG_I("set rtc time fail");
     
-    ///////////////////////////////////////////////////////////
-    //6. send location and date time to gps
     TIME_GetRtcTime(&time);
     if(!GPS_SetLocationTime(latitude,longitude,altitude,&time))
+    {
         GPS_DEBUG_I("set location time fail");
+        return false;
+    }
+    return true;
+}
 
+/**
+ * do AGPS process, to accelerate GPS fix( download brdc GPD file and upload to GPS, and set location and time)
+ * @param latitude:  latitude got from lbs
+ * @param longitude: longitude got from lbs
+ * @param altitude:  altitude, you can get from internet or set to zero
+ * @param downloadGPD: the GPD file size about 3.4k, file change in every 2 hours, and file is valid in 6 hours,
+ *                     you can only update onece in 2 hours or 6 hours to save money
+ * @return execute agps proccess success or not
+ */
+bool GPS_AGPS(float latitude, float longitude, float altitude, bool downloadGPD)
+{
     if(downloadGPD)
-        OS_Free(buffer);
+    {
+        GPS_GPD_Http_t http;
+        if(!GPS_GPDHttpOpen(&http))
+        {
+            GPS_DEBUG_I("http get fail");
+            return false;
+        }
+        int ret = GPS_GPDStream(GPS_GPDHttpRead,&http,NULL,NULL);
+        GPS_GPDHttpClose(&http);
+        if(ret < 0)
+            return false;
+    }
+
+    GPS_SetSeed(latitude,longitude,altitude);
     return true;
 }
 
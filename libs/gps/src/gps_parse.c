@@ -19,6 +19,7 @@
 #include "gps.h"
 
 GPS_Info_t g_gps_info;
+GPS_Parse_Stats_t g_gps_parse_stats;
 
 /**
  * 
@@ -40,11 +41,13 @@ bool ParseOneNmea(uint8_t* nmea, uint8_t flag)
         gsa_count = 0;
     }
 
+    ++g_gps_parse_stats.sentences;
     switch (minmea_sentence_id(line, false)) {
         case MINMEA_SENTENCE_RMC: {
             if (minmea_parse_rmc(&g_gps_info.rmc, line)) {
             }
             else {
+                ++g_gps_parse_stats.failed;
                 GPS_DEBUG_I("$xxRMC sentence is not parsed\n");
             }
         } break;
@@ -53,6 +56,7 @@ bool ParseOneNmea(uint8_t* nmea, uint8_t flag)
             if (minmea_parse_gga(&g_gps_info.gga, line)) {
             }
             else {
+                ++g_gps_parse_stats.failed;
                 GPS_DEBUG_I("$xxGGA sentence is not parsed\n");
             }
         } break;
@@ -61,6 +65,7 @@ bool ParseOneNmea(uint8_t* nmea, uint8_t flag)
             if (minmea_parse_gst(&g_gps_info.gst, line)) {
             }
             else {
+                ++g_gps_parse_stats.failed;
                 GPS_DEBUG_I("$xxGST sentence is not parsed\n");
             }
         } break;
@@ -70,15 +75,19 @@ bool ParseOneNmea(uint8_t* nmea, uint8_t flag)
                 if (minmea_parse_gsv(&g_gps_info.gsv[gsv_count++], line)) {
                 }
                 else {
+                    ++g_gps_parse_stats.failed;
                     GPS_DEBUG_I("$xxGSV sentence is not parsed\n");
                 }
             }
+            else
+                ++g_gps_parse_stats.dropped;
         } break;
 
         case MINMEA_SENTENCE_VTG: {
             if (minmea_parse_vtg(&g_gps_info.vtg, line)) {
             }
             else {
+                ++g_gps_parse_stats.failed;
                 GPS_DEBUG_I("$xxVTG sentence is not parsed\n");
             }
         } break;
@@ -87,6 +96,7 @@ bool ParseOneNmea(uint8_t* nmea, uint8_t flag)
             if (minmea_parse_zda(&g_gps_info.zda, line)) {
             }
             else {
+                ++g_gps_parse_stats.failed;
                 GPS_DEBUG_I("$xxZDA sentence is not parsed\n");
             }
         } break;
@@ -95,19 +105,24 @@ bool ParseOneNmea(uint8_t* nmea, uint8_t flag)
                 if (minmea_parse_gsa(&g_gps_info.gsa[gsa_count++], line)) {
                 }
                 else {
+                    ++g_gps_parse_stats.failed;
                     GPS_DEBUG_I("$xxGSA sentence is not parsed\n");
                 }
             }
+            else
+                ++g_gps_parse_stats.dropped;
         } break;
         case MINMEA_SENTENCE_GLL:{
             if (minmea_parse_gll(&g_gps_info.gll, line)) {
             }
             else {
+                ++g_gps_parse_stats.failed;
                 GPS_DEBUG_I("$xxGLL sentence is not parsed\n");
             }
         } break;
         case MINMEA_INVALID:
         default:
+            ++g_gps_parse_stats.invalid;
             GPS_DEBUG_I("$xxxxx sentence is not parsed:%s\n",line);
             return false;
     }
@@ -138,6 +153,7 @@ bool GPS_Parse(uint8_t* nmeas)
     static uint8_t flag  = 0;
     uint8_t tmpStore;
 
+    ++g_gps_parse_stats.frames;
     while(nmeas)
     {
         uint8_t* index1 = strstr(nmeas,"$");
@@ -174,3 +190,12 @@ GPS_Info_t* Gps_GetInfo()
     return &g_gps_info;
 }
 
+/**
+ * Get address of the parser statistics, counting since boot
+ * @return GPS_Parse_Stats_t*: Address of the parser statistics
+ */
+GPS_Parse_Stats_t* Gps_GetParseStats()
+{
+    return &g_gps_parse_stats;
+}
+
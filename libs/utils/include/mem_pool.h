@@ -0,0 +1,130 @@
+#ifndef _MEM_POOL_H_
+#define _MEM_POOL_H_
+
+#include "stdint.h"
+#include "stdbool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fixed-size block pools and an instrumented heap
+ *
+ * The recurring buffers (HTTP requests) come from static pools of equally sized
+ * blocks instead of the heap, so months of allocate/free cycles with
+ * varying sizes cannot fragment it. A request larger than the block size, or one made
+ * while all blocks are in use, falls back to the heap and is counted.
+ *
+ * Mem_Malloc()/Mem_Free() wrap OS_Malloc()/OS_Free() with a small header: they keep
+ * the bytes in use and their peak, allocation failures and the live blocks per call
+ * site, so a site whose live count keeps growing shows up as a leak.
+ * Mem_LargestFree() probes the heap for the largest block it can still hand out; with
+ * the free total from OS_GetHeapUsageStatus() this gives the fragmentation. The probe
+ * allocates up to the whole free heap about 20 times, so other tasks' allocations may
+ * fail meanwhile: it is meant for the interactive commands only.
+ *
+ * All functions may be called from any task.
+ */
+
+// call sites tracked by the instrumented heap, further tags share the last slot
+#define MEM_MAX_SITES 12
+
+typedef struct {
+    const char* name;
+    uint16_t    blockSize;      // multiple of 4
+    uint16_t    blockCount;
+    uint32_t*   storage;        // blockCount * blockSize bytes
+    void*       freeList;
+    bool        initialised;
+    uint16_t    used;
+    uint16_t    peak;
+    uint32_t    allocs;
+    uint32_t    fallbacks;      // requests served by the heap
+} MemPool_t;
+
+/**
+ * Define a pool with static storage, usable without an init call:
+ *     MEM_POOL_DEFINE(ackPool, "gps ack", 128, 2);
+ */
+#define MEM_POOL_DEFINE(var, poolName, size, count)                              \
+    static uint32_t var##Storage[(count) * (((size) + 3) / 4)];                  \
+    static MemPool_t var = { .name = (poolName), .blockSize = (((size) + 3) / 4) * 4, \
+                             .blockCount = (count), .storage = var##Storage }
+
+typedef struct {
+    const char* tag;
+    uint32_t    live;           // blocks allocated and not freed
+    uint32_t    liveBytes;
+    uint32_t    allocs;
+} MemSite_t;
+
+typedef struct {
+    uint32_t    used;           // bytes requested and not freed, headers excluded
+    uint32_t    peak;
+    uint32_t    allocs;
+    uint32_t    frees;
+    uint32_t    failures;       // OS_Malloc() returned NULL
+    uint32_t    badFrees;       // pointer without a valid header: double free or foreign block
+    uint32_t    largestRequest;
+} MemStats_t;
+
+/**
+ * @brief Allocate a block from the pool, from the heap if size exceeds the block size
+ *        or the pool is exhausted.
+ * @return NULL only if the heap fallback fails too
+ */
+void* MemPool_Alloc(MemPool_t* pool, uint32_t size);
+
+/**
+ * @brief Return a block from MemPool_Alloc(), NULL is ignored.
+ */
+void  MemPool_Free(MemPool_t* pool, void* ptr);
+
+/**
+ * @brief Register a pool for Mem_GetPool(); MemPool_Alloc() does this on first use.
+ */
+void  MemPool_Register(MemPool_t* pool);
+
+/**
+ * @brief Allocate from the heap, accounted to the call site tag (a string literal).
+ */
+void* Mem_Malloc(uint32_t size, const char* tag);
+
+/**
+ * @brief Free a block from Mem_Malloc(), NULL is ignored.
+ */
+void  Mem_Free(void* ptr);
+
+/**
+ * @brief Largest block the heap can hand out right now, found by trial allocations
+ *        (about 20 OS_Malloc()/OS_Free() pairs). For diagnostics, not the hot path.
+ */
+uint32_t Mem_LargestFree(void);
+
+/**
+ * @brief Copy the heap counters.
+ */
+void  Mem_GetStats(MemStats_t* stats);
+
+/**
+ * @brief Copy the counters of call site i.
+ * @return false if there is no site i
+ */
+bool  Mem_GetSite(int i, MemSite_t* site);
+
+/**
+ * @brief Pool i in registration order, NULL past the last one.
+ */
+const MemPool_t* Mem_GetPool(int i);
+
+/**
+ * @brief Restart the peak values of the heap and the pools.
+ */
+void  Mem_ResetPeaks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
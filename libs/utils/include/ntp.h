@@ -1,6 +1,7 @@
 #ifndef __NTP_H
 #define __NTP_H
 
+#include <stdint.h>
 #include <time.h>
 
 /**
@@ -19,5 +20,19 @@
   */
 int NTP_Update(const char* server, time_t timeoutS, time_t* utcTime, bool isSetRTC);
 
+/**
+  * Offset of a local millisecond clock to UTC, from one SNTP exchange
+  * 
+  * @param server: ntp server ip or domain
+  * @param timeoutS: ntp request timeout, unit:s
+  * @param clockMs: the local clock, read when the request leaves and the answer arrives
+  * @param offsetMs: UTC - local clock, unit:ms (unix time)
+  * @param delayMs: round trip delay of the exchange, unit:ms
+  * 
+  * @return int: return 0 if success, or return error code( < 0)
+  * 
+  */
+int NTP_GetOffset(const char* server, time_t timeoutS, uint64_t (*clockMs)(void), int64_t* offsetMs, uint32_t* delayMs);
+
 
 #endif
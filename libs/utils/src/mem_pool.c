@@ -0,0 +1,188 @@
+#include "mem_pool.h"
+#include "string.h"
+#include "api_os.h"
+#include "api_sys.h"
+
+#define MEM_MAX_POOLS      8
+#define MEM_HEADER_MAGIC   0xB10C
+// resolution of Mem_LargestFree()
+#define MEM_PROBE_STEP     64
+
+// in front of every Mem_Malloc() block, 8 bytes keep the payload aligned like OS_Malloc()'s
+typedef struct {
+    uint32_t size;
+    uint16_t site;
+    uint16_t magic;
+} MemHeader_t;
+
+static MemPool_t*  pools[MEM_MAX_POOLS];
+static int         pool_count = 0;
+static MemSite_t   sites[MEM_MAX_SITES];
+static int         site_count = 0;
+static MemStats_t  stats;
+
+static void PoolInit(MemPool_t* pool)
+{
+    uint8_t* block = (uint8_t*)pool->storage;
+    pool->freeList = NULL;
+    for (int i = pool->blockCount - 1; i >= 0; --i) {
+        void** link = (void**)(block + (uint32_t)i * pool->blockSize);
+        *link = pool->freeList;
+        pool->freeList = link;
+    }
+    pool->initialised = true;
+    if (pool_count < MEM_MAX_POOLS) pools[pool_count++] = pool;
+}
+
+void MemPool_Register(MemPool_t* pool)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    if (!pool->initialised) PoolInit(pool);
+    SYS_ExitCriticalSection(status);
+}
+
+void* MemPool_Alloc(MemPool_t* pool, uint32_t size)
+{
+    void* block = NULL;
+    uint32_t status = SYS_EnterCriticalSection();
+    if (!pool->initialised) PoolInit(pool);
+    if (size <= pool->blockSize && pool->freeList) {
+        block = pool->freeList;
+        pool->freeList = *(void**)block;
+        pool->allocs++;
+        if (++pool->used > pool->peak) pool->peak = pool->used;
+    } else {
+        pool->fallbacks++;
+    }
+    SYS_ExitCriticalSection(status);
+    return block ? block : Mem_Malloc(size, pool->name);
+}
+
+void MemPool_Free(MemPool_t* pool, void* ptr)
+{
+    if (!ptr) return;
+    uint8_t* start = (uint8_t*)pool->storage;
+    if ((uint8_t*)ptr < start || (uint8_t*)ptr >= start + (uint32_t)pool->blockCount * pool->blockSize) {
+        Mem_Free(ptr);
+        return;
+    }
+    uint32_t status = SYS_EnterCriticalSection();
+    *(void**)ptr = pool->freeList;
+    pool->freeList = ptr;
+    pool->used--;
+    SYS_ExitCriticalSection(status);
+}
+
+// called inside the critical section
+static int SiteIndex(const char* tag)
+{
+    for (int i = 0; i < site_count; ++i)
+        if (sites[i].tag == tag || strcmp(sites[i].tag, tag) == 0) return i;
+    if (site_count < MEM_MAX_SITES) {
+        sites[site_count].tag = tag;
+        return site_count++;
+    }
+    sites[MEM_MAX_SITES - 1].tag = "other";
+    return MEM_MAX_SITES - 1;
+}
+
+void* Mem_Malloc(uint32_t size, const char* tag)
+{
+    MemHeader_t* header = (MemHeader_t*)OS_Malloc(sizeof(MemHeader_t) + size);
+
+    uint32_t status = SYS_EnterCriticalSection();
+    if (!header) {
+        stats.failures++;
+        SYS_ExitCriticalSection(status);
+        return NULL;
+    }
+    int site = SiteIndex(tag ? tag : "?");
+    sites[site].live++;
+    sites[site].liveBytes += size;
+    sites[site].allocs++;
+    stats.allocs++;
+    stats.used += size;
+    if (stats.used > stats.peak) stats.peak = stats.used;
+    if (size > stats.largestRequest) stats.largestRequest = size;
+    SYS_ExitCriticalSection(status);
+
+    header->size  = size;
+    header->site  = (uint16_t)site;
+    header->magic = MEM_HEADER_MAGIC;
+    return header + 1;
+}
+
+void Mem_Free(void* ptr)
+{
+    if (!ptr) return;
+    MemHeader_t* header = (MemHeader_t*)ptr - 1;
+
+    uint32_t status = SYS_EnterCriticalSection();
+    if (header->magic != MEM_HEADER_MAGIC || header->site >= site_count) {
+        // leaking the block is safer than handing the heap a pointer it does not own
+        stats.badFrees++;
+        SYS_ExitCriticalSection(status);
+        return;
+    }
+    header->magic = 0;
+    sites[header->site].live--;
+    sites[header->site].liveBytes -= header->size;
+    stats.frees++;
+    stats.used -= header->size;
+    SYS_ExitCriticalSection(status);
+
+    OS_Free(header);
+}
+
+uint32_t Mem_LargestFree(void)
+{
+    OS_Heap_Status_t heap;
+    if (!OS_GetHeapUsageStatus(&heap) || heap.totalSize <= heap.usedSize) return 0;
+
+    // invariant: low can be allocated, high cannot
+    uint32_t low = 0, high = heap.totalSize - heap.usedSize + 1;
+    while (high - low > MEM_PROBE_STEP) {
+        uint32_t mid = low + (high - low) / 2;
+        void* p = OS_Malloc(mid);
+        if (p) {
+            OS_Free(p);
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void Mem_GetStats(MemStats_t* out)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    *out = stats;
+    SYS_ExitCriticalSection(status);
+}
+
+bool Mem_GetSite(int i, MemSite_t* site)
+{
+    bool ok = false;
+    uint32_t status = SYS_EnterCriticalSection();
+    if (i >= 0 && i < site_count) {
+        *site = sites[i];
+        ok = true;
+    }
+    SYS_ExitCriticalSection(status);
+    return ok;
+}
+
+const MemPool_t* Mem_GetPool(int i)
+{
+    return (i >= 0 && i < pool_count) ? pools[i] : NULL;
+}
+
+void Mem_ResetPeaks(void)
+{
+    uint32_t status = SYS_EnterCriticalSection();
+    stats.peak = stats.used;
+    for (int i = 0; i < pool_count; ++i)
+        pools[i]->peak = pools[i]->used;
+    SYS_ExitCriticalSection(status);
+}
@@ -42,7 +42,10 @@ typedef struct
 
 } ntp_packet;              // Total: 384 bits or 48 bytes.
 
-int NTP_Update(const char* server, time_t timeoutS, time_t* timeNow, bool isSetRTC)
+// Sends the request in packet and reads the answer into it. clockMs, if given, is read right
+// before the request is sent and right after the answer came, into sentMs and receivedMs.
+static int Exchange(const char* server, time_t timeoutS, ntp_packet* pkt,
+                    uint64_t (*clockMs)(void), uint64_t* sentMs, uint64_t* receivedMs)
 {
     int sockfd, n; // Socket file descriptor and the n return result from writing/reading from the socket.
 
@@ -50,14 +53,8 @@ int NTP_Update(const char* server, time_t timeoutS, time_t* timeNow, bool isSetR
     uint8_t ip[16];
     int ret;
     bool flag = false;
-    uint32_t t4;
-    TIME_System_t sysTime;
     char* host_name = (char*)server; // NTP server host-name.
-    ntp_packet packet;
-
-    memset( &packet, 0, sizeof( ntp_packet ) );
-
-    // Set the first byte's bits to 00,011,011 for li = 0, vn = 3, and mode = 3. The rest will be left set to zero.
+    ntp_packet packet = *pkt;
 
     // Create a UDP socket, convert the host-name to an IP address, set the port number,
     // connect to the server, send the packet, and then read in the return packet.
@@ -74,6 +71,7 @@ int NTP_Update(const char* server, time_t timeoutS, time_t* timeNow, bool isSetR
     if(DNS_GetHostByName2( host_name, ip)!=0) // Convert URL to IP.
     {
         Trace(1,"get ip error");
+        close(sockfd);
         return -11;
     }
 
@@ -90,8 +88,8 @@ int NTP_Update(const char* server, time_t timeoutS, time_t* timeNow, bool isSetR
     }
 
 
-    packet.li_vn_mode = (0x00<<6)|(0x04<<3)|0x03; //not sync, version 4, client mode
-    packet.txTm_s = ntohl( (uint32_t)time(NULL) + NTP_TIMESTAMP_70_YEARS );
+    if(clockMs)
+        *sentMs = clockMs();
     n = write( sockfd, ( char* ) &packet, sizeof( ntp_packet ) );
     if ( n < 0 )
     {
@@ -142,6 +140,8 @@ int NTP_Update(const char* server, time_t timeoutS, time_t* timeNow, bool isSetR
                     {
                         if(recvLen==retBufferLen)
                         {
+                        if(clockMs)
+                            *receivedMs = clockMs();
                         Trace(1,"recv len:%d",recvLen);
                         close(sockfd);
                         flag = true;
@@ -153,6 +153,25 @@ int NTP_Update(const char* server, time_t timeoutS, time_t* timeNow, bool isSetR
                 break;
         }
     }
+    *pkt = packet;
+    return 0;
+}
+
+int NTP_Update(const char* server, time_t timeoutS, time_t* timeNow, bool isSetRTC)
+{
+    uint32_t t4;
+    TIME_System_t sysTime;
+    ntp_packet packet;
+
+    memset( &packet, 0, sizeof( ntp_packet ) );
+
+    // Set the first byte's bits to 00,011,011 for li = 0, vn = 3, and mode = 3. The rest will be left set to zero.
+    packet.li_vn_mode = (0x00<<6)|(0x04<<3)|0x03; //not sync, version 4, client mode
+    packet.txTm_s = ntohl( (uint32_t)time(NULL) + NTP_TIMESTAMP_70_YEARS );
+    int ret = Exchange(server, timeoutS, &packet, NULL, NULL, NULL);
+    if(ret != 0)
+        return ret;
+
     // These two fields contain the time-stamp seconds as the packet left the NTP server.
     // The number of seconds correspond to the seconds passed since 1900.
     // ntohl() converts the bit/byte order from the network's to host's "endianness".
@@ -184,3 +203,33 @@ int NTP_Update(const char* server, time_t timeoutS, time_t* timeNow, bool isSetR
     return 0;
 }
 
+// NTP time-stamp (seconds and 2^-32 fractions since 1900) in ms since 1970
+static int64_t TimestampMs(uint32_t seconds, uint32_t fraction)
+{
+    return (int64_t)(seconds - NTP_TIMESTAMP_70_YEARS) * 1000 + (int64_t)(((uint64_t)fraction * 1000) >> 32);
+}
+
+int NTP_GetOffset(const char* server, time_t timeoutS, uint64_t (*clockMs)(void), int64_t* offsetMs, uint32_t* delayMs)
+{
+    ntp_packet packet;
+    uint64_t t1, t4;
+
+    memset( &packet, 0, sizeof( ntp_packet ) );
+    packet.li_vn_mode = (0x00<<6)|(0x04<<3)|0x03; //not sync, version 4, client mode
+    int ret = Exchange(server, timeoutS, &packet, clockMs, &t1, &t4);
+    if(ret != 0)
+        return ret;
+
+    // a server answer, synchronised, not a kiss-of-death
+    if(MODE(packet) != 4 || LI(packet) == 3 || packet.stratum == 0)
+    {
+        Trace(1,"ntp server not synchronised");
+        return -9;
+    }
+    int64_t t2 = TimestampMs(ntohl(packet.rxTm_s), ntohl(packet.rxTm_f));
+    int64_t t3 = TimestampMs(ntohl(packet.txTm_s), ntohl(packet.txTm_f));
+    *offsetMs = ((t2 - (int64_t)t1) + (t3 - (int64_t)t4)) / 2;
+    int64_t delay = (int64_t)(t4 - t1) - (t3 - t2);
+    *delayMs  = delay > 0 ? (uint32_t)delay : 0;
+    return 0;
+}